@@ -0,0 +1,56 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Micro benchmarks - shared helpers
+//===========================================================================
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#ifndef BENCH_H
+#define BENCH_H
+
+namespace vlark::bench
+{
+
+// number of global operator new calls so far
+std::uint64_t allocations();
+
+// seconds since start
+class stopwatch
+{
+public:
+    double elapsed() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+private:
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+// path of the benchmark input, generated (about mbytes big) when none is given
+std::string input_file(std::string_view given, std::size_t mbytes = 64);
+
+void bench_tokens(std::string const& path);
+void bench_keywords(std::string const& path);
+void bench_symbols(std::string const& path);
+void bench_names(std::string const& path);
+void bench_exprs(std::string const& path);
+void bench_parse(std::string const& path);
+void bench_json(std::string const& path);
+void bench_cache(std::string const& path);
+void bench_reparse(std::string const& path);
+
+} // namespace vlark::bench
+
+#endif // BENCH_H
@@ -0,0 +1,74 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Cache benchmark - parse against a warm AST cache
+//===========================================================================
+
+#include "ast_cache.h"
+#include "bench.h"
+#include <filesystem>
+#include <iostream>
+
+namespace vlark::bench
+{
+
+//-----------------------------------------------------------------------
+//  bench_cache: hash the file, parse it cold and store it, then load it
+//  back from the cache (the hash included), once more with its tokens
+//
+void bench_cache(std::string const& path)
+{
+    sourceBuffer sbuf(path);
+    const double mbytes = static_cast<double>(sbuf.text().size()) / (1 << 20);
+    auto dir = std::filesystem::temp_directory_path() / "vlark_bench_cache";
+    ast_cache cache{dir.string()};
+
+    {
+        stopwatch w;
+        auto h = content_hash(sbuf.text());
+        double secs = w.elapsed();
+        std::cout << "hash:  " << mbytes / secs << " MB/s (" << h % 10 << ")\n";
+    }
+
+    diagnostics diags;
+    stopwatch cold;
+    auto tokens = tokenize_lines(sbuf);
+    auto tree = parse_design_units(tokens, sbuf.text(), diags);
+    double parse_secs = cold.elapsed();
+    stopwatch w;
+    cache.store(sbuf.text(), parse_mode::full, tree, tokens, diags);
+    double store_secs = w.elapsed();
+    std::cout << "cold:  " << parse_secs * 1e3 << " ms parse, " << store_secs * 1e3 << " ms store, "
+              << std::filesystem::file_size(cache.path_of(sbuf.text(), parse_mode::full)) / (1 << 20) << " MB\n";
+
+    for (int run = 0; run < 3; run++)
+    {
+        diagnostics again;
+        stopwatch warm;
+        auto hit = cache.load(sbuf.text(), parse_mode::full, again);
+        double secs = warm.elapsed();
+        std::cout << "warm:  " << secs * 1e3 << " ms, " << mbytes / secs << " MB/s, "
+                  << (hit ? hit->node_count() : 0) << " nodes\n";
+    }
+    {
+        diagnostics again;
+        token_stream loaded;
+        stopwatch warm;
+        auto hit = cache.load(sbuf.text(), parse_mode::full, again, &loaded);
+        double secs = warm.elapsed();
+        std::cout << "warm with tokens:  " << secs * 1e3 << " ms, " << (hit ? loaded.size() : 0) << " tokens\n";
+    }
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace vlark::bench
@@ -0,0 +1,111 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Expression benchmarks - throughput of the expression parser
+//===========================================================================
+
+#include "bench.h"
+#include "expr_parser.h"
+#include <iostream>
+
+namespace vlark::bench
+{
+
+namespace
+{
+
+//  a balanced tree of depth levels, and/or alternating per level
+//
+void logic_tree(std::string& out, unsigned depth, unsigned& leaf)
+{
+    if (depth == 0)
+    {
+        out += "s(" + std::to_string(leaf++ % 64) + ")";
+        return;
+    }
+    out += '(';
+    logic_tree(out, depth - 1, leaf);
+    out += depth % 2 != 0 ? " and " : " or ";
+    logic_tree(out, depth - 1, leaf);
+    out += ')';
+}
+
+//  assignments with deep and/or trees, long flat chains and arithmetic
+//
+std::string expression_source(std::size_t lines)
+{
+    std::string text;
+    unsigned leaf = 0;
+    for (std::size_t k = 0; k < lines; k++)
+    {
+        text += "y <= ";
+        switch (k % 3)
+        {
+        case 0: logic_tree(text, 8, leaf); break;
+        case 1:
+            text += "a(0)";
+            for (unsigned j = 1; j < 128; j++)
+            {
+                text += " xor a(" + std::to_string(j) + ")";
+            }
+            break;
+        default: text += "(x * 3 + y'length - 1) / 2 ** n + rec.f(i to i + 7) & (others => '0')"; break;
+        }
+        text += ";\n";
+    }
+    return text;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  bench_exprs: parse the right hand side of every assignment of a
+//  generated, expression heavy source
+//
+void bench_exprs(std::string const&)
+{
+    const std::string text = expression_source(30000);
+    const double mbytes = static_cast<double>(text.size()) / (1 << 20);
+
+    token_stream tokens;
+    tokenize(text, tokens);
+
+    ast tree;
+    diagnostics diags;
+    expr_parser parser{tokens, text, tree, diags};
+
+    auto allocs = allocations();
+    stopwatch w;
+    std::size_t exprs = 0;
+    for (std::size_t i = 0; i < tokens.size(); i++)
+    {
+        if (tokens.type(i) == token_type::Less_Equal)
+        {
+            parser.seek(i + 1);
+            parser.expression();
+            i = parser.position();
+            exprs++;
+        }
+    }
+    double secs = w.elapsed();
+    auto parse_allocs = allocations() - allocs;
+
+    const double ntokens = static_cast<double>(tokens.size());
+    std::cout << "expressions: " << exprs << " parsed, " << ntokens / secs / 1e6 << " Mtokens/s, " << mbytes / secs
+              << " MB/s, " << diags.total() << " errors\n";
+    std::cout << "ast:         " << tree.node_count() << " nodes, "
+              << static_cast<double>(tree.bytes()) / static_cast<double>(tree.node_count()) << " bytes/node, "
+              << static_cast<double>(parse_allocs) / static_cast<double>(exprs) << " allocs/expression\n";
+}
+
+} // namespace vlark::bench
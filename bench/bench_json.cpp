@@ -0,0 +1,53 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  JSON benchmark - the AST of the input written as JSON
+//===========================================================================
+
+#include "bench.h"
+#include "json_writer.h"
+#include "unit_parser.h"
+#include <fstream>
+#include <iostream>
+
+namespace vlark::bench
+{
+
+//-----------------------------------------------------------------------
+//  bench_json: write the AST of the file as JSON to /dev/null, compact
+//  and pretty, MB/s of JSON written
+//
+void bench_json(std::string const& path)
+{
+    sourceBuffer sbuf(path);
+    auto tokens = tokenize_lines(sbuf);
+    diagnostics diags;
+    auto tree = parse_design_units(tokens, sbuf.text(), diags);
+
+    std::ofstream sink("/dev/null", std::ios::binary);
+    for (bool pretty : {false, true})
+    {
+        json_writer out{sink, pretty};
+        auto before = allocations();
+        stopwatch w;
+        write_json(tree, out, path);
+        out.flush();
+        double secs = w.elapsed();
+        const double mbytes = static_cast<double>(out.size()) / (1 << 20);
+        std::cout << (pretty ? "pretty:  " : "compact: ") << mbytes << " MB in " << secs * 1e3 << " ms, "
+                  << mbytes / secs << " MB/s, " << static_cast<double>(tree.node_count()) / secs / 1e6
+                  << " Mnodes/s, " << allocations() - before << " allocations\n";
+    }
+}
+
+} // namespace vlark::bench
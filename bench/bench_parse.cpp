@@ -0,0 +1,62 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Parse benchmarks - design units, serial and on the work pool
+//===========================================================================
+
+#include "bench.h"
+#include "unit_parser.h"
+#include "work_pool.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace vlark::bench
+{
+
+//-----------------------------------------------------------------------
+//  bench_parse: parse the design units of a tokenized file on one
+//  thread and on one per core, then its outline only
+//
+void bench_parse(std::string const& path)
+{
+    sourceBuffer sbuf(path);
+    const double mbytes = static_cast<double>(sbuf.text().size()) / (1 << 20);
+    auto tokens = tokenize_lines(sbuf);
+    auto starts = unit_starts(tokens);
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned jobs : {1u, std::max(2u, cores)})
+    {
+        diagnostics diags;
+        work_pool pool{jobs};
+        stopwatch w;
+        auto tree = parse_design_units(tokens, sbuf.text(), diags, &pool);
+        double secs = w.elapsed();
+        std::cout << "parse -j" << jobs << ": " << tree.design_units().size() << " units, " << mbytes / secs
+                  << " MB/s, " << static_cast<double>(tokens.size()) / secs / 1e6 << " Mtokens/s, "
+                  << tree.node_count() << " nodes, " << diags.total() << " errors\n";
+    }
+    {
+        diagnostics diags;
+        stopwatch w;
+        auto tree = parse_design_units(tokens, sbuf.text(), diags, nullptr, parse_mode::outline);
+        double secs = w.elapsed();
+        std::cout << "outline:  " << tree.design_units().size() << " units, " << mbytes / secs << " MB/s, "
+                  << static_cast<double>(tokens.size()) / secs / 1e6 << " Mtokens/s, " << tree.node_count()
+                  << " nodes\n";
+    }
+    std::cout << "split:    " << starts.size() << " unit starts\n";
+}
+
+} // namespace vlark::bench
@@ -0,0 +1,74 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//===========================================================================
+//  Reparse benchmark - one-name edits against a parse from scratch
+//===========================================================================
+
+#include "bench.h"
+#include "reparse.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+namespace vlark::bench
+{
+
+//  an editor buffer: the design units in the first MB of the file
+//
+constexpr std::size_t buffer_size = 1 << 20;
+
+//-----------------------------------------------------------------------
+//  bench_reparse: parse the buffer, then rename names at random places
+//  (and name them back) through reparse. Tokens and nodes behind an edit
+//  are moved, so an edit costs a pass over the buffer on top of the
+//  tokens parsed again.
+//
+void bench_reparse(std::string const& path)
+{
+    sourceBuffer sbuf(path);
+    auto cut = sbuf.text().find("\nlibrary", std::min(buffer_size, sbuf.text().size()));
+    std::string text{sbuf.text().substr(0, cut == std::string_view::npos ? cut : cut + 1)};
+
+    diagnostics diags;
+    stopwatch cold;
+    token_stream tokens;
+    tokenize(text, tokens);
+    diags.append(tokens.diags());
+    auto tree = parse_design_units(tokens, text, diags);
+    std::cout << "full:    " << cold.elapsed() * 1e3 << " ms, " << tokens.size() << " tokens\n";
+
+    std::mt19937 gen{1};
+    constexpr int edits = 200;
+    std::size_t reparsed = 0;
+    int whole_units = 0;
+    stopwatch w;
+    for (int k = 0; k < edits; k++)
+    {
+        std::size_t t;
+        do
+        {
+            t = gen() % tokens.size();
+        } while (tokens.type(t) != token_type::Identifier);
+        auto at = tokens.offset(t) + tokens.length(t);
+        auto stats = reparse(text, tokens, tree, diags, {at, at, "_x"});
+        reparsed += stats.reparsed;
+        whole_units += stats.whole_units ? 1 : 0;
+        reparse(text, tokens, tree, diags, {at, at + 2, ""});
+    }
+    double secs = w.elapsed();
+    std::cout << "edit:    " << secs * 1e6 / (2 * edits) << " us, " << reparsed / edits << " tokens parsed again, "
+              << whole_units << "/" << edits << " whole units\n";
+}
+
+} // namespace vlark::bench
@@ -0,0 +1,264 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Token benchmarks - allocations and throughput of the tokenizer
+//===========================================================================
+
+#include "bench.h"
+#include "simd.h"
+#include "token.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+
+namespace vlark::bench
+{
+
+//-----------------------------------------------------------------------
+//  bench_tokens: allocations per token while tokenizing and while
+//  comparing tokens
+//
+void bench_tokens(std::string const& path)
+{
+    sourceBuffer sbuf(path);
+    const double mbytes = static_cast<double>(sbuf.text().size()) / (1 << 20);
+
+    auto allocs = allocations();
+    stopwatch tw;
+    auto tokens = tokenize_lines(sbuf);
+    double secs = tw.elapsed();
+    auto tok_allocs = allocations() - allocs;
+
+    const double ntokens = static_cast<double>(tokens.size());
+    std::cout << "tokenize:    " << tokens.size() << " tokens, " << mbytes / secs << " MB/s, "
+              << static_cast<double>(tok_allocs) / ntokens << " allocs/token (" << tok_allocs << " total)\n";
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    stopwatch pw;
+    auto ptokens = tokenize_lines(sbuf, cores);
+    secs = pw.elapsed();
+    std::cout << "tokenize -j" << cores << ": " << ptokens.size() << " tokens, " << mbytes / secs << " MB/s\n";
+
+    //  the lossless mode, comments and blank lines kept beside the tokens
+    //
+    stopwatch kw;
+    auto ktokens = tokenize_lines(sbuf, 1, trivia_mode::keep);
+    secs = kw.elapsed();
+    std::cout << "tokenize keep trivia: " << ktokens.trivia().size() << " trivia, " << mbytes / secs << " MB/s\n";
+
+    //  compare every token with its successor, as a parser would when
+    //  matching names
+    //
+    allocs = allocations();
+    stopwatch cw;
+    std::size_t same = 0;
+    for (std::size_t i = 1; i < tokens.size(); i++)
+    {
+        same += tokens[i] == tokens[i - 1] ? 1 : 0;
+        same += tokens[i] == token_type::Identifier ? 1 : 0;
+    }
+    secs = cw.elapsed();
+    auto cmp_allocs = allocations() - allocs;
+
+    std::cout << "compare:     " << ntokens / secs / 1e6 << " Mtokens/s, "
+              << static_cast<double>(cmp_allocs) / ntokens << " allocs/token (" << same << " matches)\n";
+    //  what most parser decisions look at: the type array only
+    //
+    stopwatch sw;
+    std::size_t semis = 0;
+    for (auto type : tokens.types())
+    {
+        semis += type == token_type::Semi_Colon ? 1 : 0;
+    }
+    secs = sw.elapsed();
+    std::cout << "type scan:   " << ntokens / secs / 1e6 << " Mtokens/s (" << semis << " ';')\n";
+
+    std::cout << "token size:  " << sizeof(token) << " bytes, type array " << tokens.types().size_bytes() / 1024
+              << " KB\n";
+}
+
+//-----------------------------------------------------------------------
+//  bench_keywords: perfect hash key word lookup against the std::hash
+//  based unordered_map it replaced, over every name of the input
+//
+void bench_keywords(std::string const& path)
+{
+    sourceBuffer sbuf(path);
+    auto tokens = tokenize_lines(sbuf);
+
+    std::vector<std::string_view> names;
+    for (auto tk : tokens)
+    {
+        if (tk.type() == token_type::Identifier || tk.type() >= token_type::Mod)
+        {
+            names.push_back(tk.text(sbuf.text()));
+        }
+    }
+
+    std::vector<std::string> spellings; // keeps the keys alive
+    spellings.reserve(256);
+    std::unordered_map<std::string_view, token_type> keyword_map;
+    for (auto t = static_cast<int>(token_type::Mod); t <= static_cast<int>(token_type::View); t++)
+    {
+        spellings.push_back(token_tostr(static_cast<token_type>(t)));
+        keyword_map.emplace(spellings.back(), static_cast<token_type>(t));
+    }
+
+    const double nnames = static_cast<double>(names.size());
+    std::size_t found = 0;
+    stopwatch mw;
+    for (auto name : names)
+    {
+        found += keyword_map.contains(name) ? 1 : 0;
+    }
+    std::cout << "unordered_map: " << nnames / mw.elapsed() / 1e6 << " Mnames/s (" << found << " key words)\n";
+
+    found = 0;
+    stopwatch pw;
+    for (auto name : names)
+    {
+        found += keyword_lookup(name) != token_type::Invalid ? 1 : 0;
+    }
+    std::cout << "perfect hash:  " << nnames / pw.elapsed() / 1e6 << " Mnames/s (" << found << " key words)\n";
+}
+
+//-----------------------------------------------------------------------
+//  bench_symbols: intern every identifier of the input from all cores at
+//  once, as a multi file analysis would
+//
+void bench_symbols(std::string const& path)
+{
+    sourceBuffer sbuf(path);
+    auto tokens = tokenize_lines(sbuf);
+
+    std::vector<std::string_view> names;
+    for (auto tk : tokens)
+    {
+        if (tk.type() == token_type::Identifier)
+        {
+            names.push_back(tk.text(sbuf.text()));
+        }
+    }
+
+    const unsigned nthreads = std::max(1u, std::thread::hardware_concurrency());
+    symbol_table table;
+    stopwatch sw;
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < nthreads; t++)
+    {
+        workers.emplace_back([&, t] {
+            for (std::size_t i = t; i < names.size(); i += nthreads)
+            {
+                table.intern(names[i]);
+            }
+        });
+    }
+    for (auto& w : workers)
+    {
+        w.join();
+    }
+    double secs = sw.elapsed();
+
+    std::cout << "intern:      " << static_cast<double>(names.size()) / secs / 1e6 << " Mnames/s on " << nthreads
+              << " threads, " << names.size() << " names -> " << table.size() << " symbols\n";
+}
+
+namespace
+{
+
+//  get_name_len as it was before the class kernels, but for the cast to
+//  unsigned char. Its argument was a std::string made from the rest of
+//  the line, once per name.
+//
+std::size_t legacy_get_name_len(const std::string& text)
+{
+    auto nonMatchingCharPos = std::find_if_not(text.begin(), text.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    });
+
+    return (nonMatchingCharPos != text.end())
+               ? static_cast<std::size_t>(std::distance(text.begin(), nonMatchingCharPos))
+               : text.size();
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  bench_names: identifier run length at every name of the input, the
+//  class kernels against the old get_name_len, called as find_add_tokens
+//  did on a std::string per line
+//
+void bench_names(std::string const& path)
+{
+    sourceBuffer sbuf(path);
+    auto tokens = tokenize_lines(sbuf);
+    auto text = sbuf.text();
+
+    std::vector<std::string> lines; // each an owned string without its '\n', as they were kept
+    lines.reserve(sbuf.line_count());
+    for (std::size_t l = 0; l < sbuf.line_count(); l++)
+    {
+        lines.emplace_back(sbuf.get_line(l).text);
+    }
+
+    std::vector<std::string_view> rests;                 // from each name to the end of its line
+    std::vector<std::pair<std::size_t, std::size_t>> at; // line and column of each name
+    for (auto tk : tokens)
+    {
+        if (tk.type() == token_type::Identifier || tk.type() >= token_type::Mod)
+        {
+            auto rest = text.substr(tk.offset());
+            rests.push_back(rest.substr(0, rest.find('\n')));
+            auto pos = sbuf.position_of(tk.offset());
+            at.emplace_back(pos.lineno - 1, pos.colno);
+        }
+    }
+    const double nnames = static_cast<double>(rests.size());
+
+    std::size_t total = 0;
+    stopwatch lw;
+    for (auto [l, col] : at)
+    {
+        std::string_view carr(lines[l]);
+        total += legacy_get_name_len(&carr[col]);
+    }
+    std::cout << "old get_name_len: " << nnames / lw.elapsed() / 1e6 << " Mnames/s (" << total << " chars)\n";
+
+    for (auto level : {simd::isa::scalar, simd::isa::sse2, simd::isa::avx2})
+    {
+        if (level > simd::best())
+        {
+            continue;
+        }
+        total = 0;
+        stopwatch kw;
+        for (auto rest : rests)
+        {
+            total += simd::ident_run(rest, level);
+        }
+        std::cout << "ident_run " << simd::isa_name(level) << ": " << nnames / kw.elapsed() / 1e6 << " Mnames/s ("
+                  << total << " chars)\n";
+    }
+
+    total = 0;
+    stopwatch gw;
+    for (auto rest : rests)
+    {
+        total += get_name_len(rest);
+    }
+    std::cout << "get_name_len: " << nnames / gw.elapsed() / 1e6 << " Mnames/s (" << total << " chars)\n";
+}
+
+} // namespace vlark::bench
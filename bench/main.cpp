@@ -0,0 +1,138 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Micro benchmarks
+//
+//  Usage: vlark_bench [name|all] [vhdl file]
+//===========================================================================
+
+#include "bench.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+namespace
+{
+std::atomic<std::uint64_t> alloc_count{0};
+}
+
+//  count every allocation of the process
+//
+void* operator new(std::size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace vlark::bench
+{
+
+std::uint64_t allocations()
+{
+    return alloc_count.load(std::memory_order_relaxed);
+}
+
+//  A typical design unit, repeated until the requested size is reached
+//
+std::string input_file(std::string_view given, std::size_t mbytes)
+{
+    if (!given.empty())
+    {
+        return std::string(given);
+    }
+
+    static constexpr std::string_view unit = R"(library ieee;
+use ieee.std_logic_1164.all;
+
+-- generated unit
+entity aggr is
+  port (a : std_logic_vector (7 downto 0);
+        b : out std_logic_vector (7 downto 0));
+end aggr;
+
+architecture behav of aggr is
+  signal mask, data_in_reg, data_out_reg : std_logic_vector (7 downto 0);
+begin
+  b <= a and mask;
+  data_out_reg <= data_in_reg or mask;
+end behav;
+)";
+
+    auto path = (std::filesystem::temp_directory_path() / "vlark_bench_input.vhdl").string();
+    std::ofstream out{path, std::ios::binary};
+    for (std::size_t written = 0; written < mbytes << 20; written += unit.size())
+    {
+        out << unit;
+    }
+    return path;
+}
+
+} // namespace vlark::bench
+
+int main(int argc, char* argv[])
+{
+    std::string_view which = argc > 1 ? argv[1] : "all";
+    auto path = vlark::bench::input_file(argc > 2 ? argv[2] : "");
+
+    struct entry
+    {
+        std::string_view name;
+        void (*run)(std::string const&);
+    };
+    static constexpr entry benches[] = {
+        {"tokens", vlark::bench::bench_tokens},
+        {"keywords", vlark::bench::bench_keywords},
+        {"symbols", vlark::bench::bench_symbols},
+        {"names", vlark::bench::bench_names},
+        {"exprs", vlark::bench::bench_exprs},
+        {"parse", vlark::bench::bench_parse},
+        {"json", vlark::bench::bench_json},
+        {"cache", vlark::bench::bench_cache},
+        {"reparse", vlark::bench::bench_reparse},
+    };
+
+    bool found = false;
+    for (auto& b : benches)
+    {
+        if (which == "all" || which == b.name)
+        {
+            std::cout << "== " << b.name << " (" << path << ")\n";
+            b.run(path);
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        std::cerr << "unknown benchmark: " << which << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
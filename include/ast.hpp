@@ -14,23 +14,553 @@
 // AST base code
 //===========================================================================
 
+#include "token.h"
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #ifndef AST_BASE_H
 #define AST_BASE_H
 
 namespace vlark
 {
-    class ast
+
+class work_pool;
+
+//-----------------------------------------------------------------------
+//
+//  arena: a bump allocator. Memory comes from big blocks and is never
+//  given back one by one, release() frees everything at once.
+//
+//-----------------------------------------------------------------------
+//
+class arena
+{
+public:
+    static constexpr std::size_t block_size = 256 * 1024;
+
+    arena() = default;
+    arena(arena&& other) noexcept
+        : blocks{std::move(other.blocks)}
+        , pos{std::exchange(other.pos, nullptr)}
+        , left{std::exchange(other.left, 0)}
+        , reserved{std::exchange(other.reserved, 0)}
+    {
+    }
+    arena& operator=(arena&& other) noexcept
+    {
+        blocks = std::move(other.blocks);
+        pos = std::exchange(other.pos, nullptr);
+        left = std::exchange(other.left, 0);
+        reserved = std::exchange(other.reserved, 0);
+        return *this;
+    }
+    arena(arena const&) = delete;
+    arena& operator=(arena const&) = delete;
+
+    // size bytes aligned to align (a power of two <= alignof(max_align_t))
+    void* allocate(std::size_t size, std::size_t align)
+    {
+        auto pad = (align - reinterpret_cast<std::uintptr_t>(pos) % align) % align;
+        if (pos == nullptr || pad + size > left)
+        {
+            grow(size);
+            pad = 0;
+        }
+        void* p = pos + pad;
+        pos += pad + size;
+        left -= pad + size;
+        return p;
+    }
+
+    template <class T>
+    T* allocate(std::size_t n)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "arena memory is never destructed");
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // free all blocks
+    void release()
     {
-    public:
-        ast() = default;
-        ast(const ast &) = delete;
-        ast &operator=(const ast &) = delete;
-        ast(ast &&) = delete;
-        ast &operator=(ast &&) = delete;
+        blocks.clear();
+        pos = nullptr;
+        left = 0;
+        reserved = 0;
+    }
+
+    // bytes taken from the system
+    std::size_t bytes() const { return reserved; }
+
+private:
+    void grow(std::size_t size);
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks{};
+    std::byte* pos = nullptr;
+    std::size_t left = 0;
+    std::size_t reserved = 0;
+};
+
+//-----------------------------------------------------------------------
+//
+//  ref<T>: a node by its 32-bit index in the pool of T. Index 0 is no
+//  node, so a default ref is empty.
+//  list<T>: a child list, the index of its length in the list storage,
+//  the refs follow it contiguously. 0 is the empty list.
+//
+//-----------------------------------------------------------------------
+//
+template <class T>
+struct ref
+{
+    std::uint32_t index = 0;
+
+    explicit operator bool() const { return index != 0; }
+    bool operator==(ref const&) const = default;
+};
+
+template <class T>
+struct list
+{
+    std::uint32_t at = 0;
+
+    bool operator==(list const&) const = default;
+};
+
+//-----------------------------------------------------------------------
+//
+//  pool<T>: one flat array of T in arena memory, addressed by index.
+//  When it is full it moves to a block twice as big, the old one stays
+//  in the arena until the whole AST is released.
+//
+//-----------------------------------------------------------------------
+//
+template <class T>
+class pool
+{
+    static_assert(std::is_trivially_copyable_v<T>, "pools are copied with memcpy");
+
+public:
+    pool() = default;
+    pool(pool&& other) noexcept
+        : items{std::exchange(other.items, nullptr)}
+        , count{std::exchange(other.count, 0)}
+        , capacity{std::exchange(other.capacity, 0)}
+    {
+    }
+    pool& operator=(pool&& other) noexcept
+    {
+        items = std::exchange(other.items, nullptr);
+        count = std::exchange(other.count, 0);
+        capacity = std::exchange(other.capacity, 0);
+        return *this;
+    }
+    pool(pool const&) = delete;
+    pool& operator=(pool const&) = delete;
+
+    // append v, returns its index
+    std::uint32_t push(arena& mem, T const& v)
+    {
+        if (count == capacity)
+        {
+            std::size_t grown = capacity == 0 ? 64 : 2 * capacity;
+            T* bigger = mem.allocate<T>(grown);
+            if (count != 0)
+            {
+                std::memcpy(bigger, items, count * sizeof(T));
+            }
+            items = bigger;
+            capacity = grown;
+        }
+        items[count] = v;
+        return static_cast<std::uint32_t>(count++);
+    }
+
+    // n more items, left to be written through operator[]
+    void extend(arena& mem, std::size_t n)
+    {
+        if (count + n > capacity)
+        {
+            T* bigger = mem.allocate<T>(count + n);
+            if (count != 0)
+            {
+                std::memcpy(bigger, items, count * sizeof(T));
+            }
+            items = bigger;
+            capacity = count + n;
+        }
+        count += n;
+    }
+
+    //  use items in memory owned elsewhere in place, the next push that
+    //  needs room moves them to the arena
+    void adopt(std::span<T> outside)
+    {
+        items = outside.data();
+        count = outside.size();
+        capacity = outside.size();
+    }
+
+    T& operator[](std::uint32_t i) { return items[i]; }
+    T const& operator[](std::uint32_t i) const { return items[i]; }
+
+    std::size_t size() const { return count; }
+    std::span<const T> all() const { return {items, count}; }
+
+    void clear()
+    {
+        items = nullptr;
+        count = 0;
+        capacity = 0;
+    }
+
+private:
+    T* items = nullptr;
+    std::size_t count = 0;
+    std::size_t capacity = 0;
+};
+
+//-----------------------------------------------------------------------
+//
+//  Node types. Every node is a small, trivially copyable struct in the
+//  pool of its type; pos is the source offset of its main token.
+//  The meaning of the fields a and b of expr depends on the kind, the
+//  accessors name it.
+//
+//-----------------------------------------------------------------------
+//
+enum class expr_kind : std::uint8_t
+{
+    name,        // a: symbol
+    character,   // a: the char
+    integer,     // a: literal index
+    real,        // a: literal index
+    string,      // a: literal index
+    bit_string,  // a: literal index
+    physical,    // a: the abstract literal, b: unit symbol
+    null,        //
+    others,      //
+    open,        //
+    unary,       // op, a: operand
+    binary,      // op, a: left, b: right
+    call,        // a: prefix, b: list of arguments (function call, index, slice)
+    select,      // a: prefix, b: suffix symbol, no_symbol for .all
+    attribute,   // a: prefix, b: attribute symbol
+    qualified,   // a: type mark, b: operand (an aggregate or parenthesized expr)
+    aggregate,   // b: list of elements (association for named ones); op Bar: choices,
+                 // Comma: waveform elements, Generic or Port: a map, All: process (all)
+    association, // a: formal or choice (empty for positional), b: actual
+    range,       // op: To or Downto, a: left, b: right
+    constraint,  // a: type mark, b: range constraint (integer range 0 to 7)
+};
+
+struct expr
+{
+    expr_kind kind;
+    token_type op = token_type::Invalid;
+    offset_t pos = 0;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+
+    symbol_id symbol() const { return a; }
+    std::uint32_t value() const { return a; }
+    ref<expr> left() const { return {a}; }
+    ref<expr> right() const { return {b}; }
+    list<expr> items() const { return {b}; }
+};
+
+enum class decl_kind : std::uint8_t
+{
+    library,   // library clause
+    use,       // use clause, type: the selected name
+    generic,
+    port,      // mode: In, Out, Inout, Buffer or Linkage
+    parameter, // of a subprogram
+    signal,
+    constant,
+    variable,
+    shared_variable,
+    file,
+    type,      // mode: Left_Paren (enumeration), Range, Array, Record, Access, File,
+               // Protected or Body; type: the definition, children: elements
+               // or the protected declarations, init: element type of an array
+    subtype,
+    component, // children: generics, then ports
+    function,  // children: parameters, type: return type, body: a block
+    procedure, // children: parameters, body: a block
+    alias,     // type: the subtype, init: the aliased name
+    attribute, // type: the type, or mode: Of, type: the entity, init: value
+    element,   // of a record type
+    package,   // declared in a declarative part (VHDL-2008), mode: Body for a package
+               // body, children: the declarations, or type: the package instantiated
+               // by is new, init: its generic map
+};
+
+struct stmt;
+
+struct decl
+{
+    decl_kind kind;
+    token_type mode = token_type::Invalid;
+    offset_t pos = 0;
+    symbol_id name = no_symbol;
+    ref<expr> type{};      // subtype indication
+    ref<expr> init{};      // default or initial value
+    list<decl> children{}; // ports, parameters, elements
+    ref<stmt> body{};      // of a subprogram body
+};
+
+enum class stmt_kind : std::uint8_t
+{
+    process,         // decls, body; cond: sensitivity list as aggregate
+    signal_assign,   // target, value; cond and alt: when ... else of a conditional one
+    variable_assign, // target, value
+    instance,        // target: the unit, cond: generic map, value: port map
+    block,           // decls, body
+    generate,        // for: target the parameter, cond the range; if: cond, alt; body
+    if_,             // cond, body, alt: elsif/else as another if_
+    case_,           // cond: selector, body: the whens; target for a selected assignment
+    when,            // cond: choices, body, or value: the waveform of a selected assignment
+    loop,            // cond: while condition or for range, target: the for parameter, body
+    wait,            // target: sensitivity, cond: until, value: for
+    assert,          // cond, value: report message, target: severity
+    report,          // value, target: severity
+    call,            // target: the procedure call
+    return_,         // value
+    exit,            // target: loop label, cond
+    next,            // target: loop label, cond
+    null,
+};
+
+struct stmt
+{
+    stmt_kind kind;
+    offset_t pos = 0;
+    symbol_id label = no_symbol;
+    ref<expr> target{};
+    ref<expr> cond{};
+    ref<expr> value{};
+    list<stmt> body{};
+    list<decl> decls{};
+    ref<stmt> alt{};
+};
+
+enum class unit_kind : std::uint8_t
+{
+    entity,
+    architecture,
+    package,
+    package_body,
+    configuration,
+    context,
+};
+
+struct design_unit
+{
+    unit_kind kind;
+    offset_t pos = 0;     // start of the context clause
+    offset_t end = 0;     // past the closing ';'
+    symbol_id name = no_symbol;
+    symbol_id of = no_symbol; // entity of an architecture or configuration
+    list<decl> context{}; // library and use clauses
+    list<decl> decls{};   // generics and ports of an entity come first
+    list<stmt> stmts{};
+};
+
+//  kept small, a 10M line project is millions of nodes
+//
+static_assert(sizeof(expr) == 16);
+static_assert(sizeof(decl) <= 28);
+static_assert(sizeof(stmt) <= 36);
+
+std::string_view kind_name(expr_kind kind);
+std::string_view kind_name(decl_kind kind);
+std::string_view kind_name(stmt_kind kind);
+std::string_view kind_name(unit_kind kind);
+
+//-----------------------------------------------------------------------
+//
+//  ast: the syntax tree of one source file. All nodes and child lists
+//  live in typed pools in one arena, nodes refer to each other by index
+//  so nothing is freed one by one and the tree can be moved around (and
+//  written out) as a few flat arrays.
+//
+//-----------------------------------------------------------------------
+//
+class ast
+{
+public:
+    ast()
+    {
+        //  index 0 is the empty ref and the empty list in every pool
+        //
+        reset_pools();
+    }
+
+    ast(ast&&) noexcept = default;
+    ast& operator=(ast&&) noexcept = default;
+    ast(const ast&) = delete;
+    ast& operator=(const ast&) = delete;
+
+    ref<expr> add(expr const& e) { return {exprs.push(mem, e)}; }
+    ref<decl> add(decl const& d) { return {decls.push(mem, d)}; }
+    ref<stmt> add(stmt const& s) { return {stmts.push(mem, s)}; }
+    ref<design_unit> add(design_unit const& u) { return {units.push(mem, u)}; }
+
+    //  Store a child list, the refs are copied next to each other
+    //
+    template <class T>
+    list<T> add_list(std::span<const ref<T>> items)
+    {
+        if (items.empty())
+        {
+            return {};
+        }
+        auto at = lists.push(mem, static_cast<std::uint32_t>(items.size()));
+        for (auto r : items)
+        {
+            lists.push(mem, r.index);
+        }
+        return {at};
+    }
+
+    expr const& operator[](ref<expr> r) const { return exprs[r.index]; }
+    decl const& operator[](ref<decl> r) const { return decls[r.index]; }
+    stmt const& operator[](ref<stmt> r) const { return stmts[r.index]; }
+    design_unit const& operator[](ref<design_unit> r) const { return units[r.index]; }
+
+    expr& operator[](ref<expr> r) { return exprs[r.index]; }
+    decl& operator[](ref<decl> r) { return decls[r.index]; }
+    stmt& operator[](ref<stmt> r) { return stmts[r.index]; }
+    design_unit& operator[](ref<design_unit> r) { return units[r.index]; }
+
+    // the refs of a child list, contiguous
+    template <class T>
+    std::span<const ref<T>> items(list<T> l) const
+    {
+        if (l.at == 0)
+        {
+            return {};
+        }
+        static_assert(sizeof(ref<T>) == sizeof(std::uint32_t));
+        auto all = lists.all();
+        return {reinterpret_cast<const ref<T>*>(all.data() + l.at + 1), all[l.at]};
+    }
+
+    // the design units of the file, in source order
+    std::span<const ref<design_unit>> design_units() const { return items(root); }
+    void set_design_units(std::span<const ref<design_unit>> all) { root = add_list(all); }
+
+    //  Append the nodes of parts, in order, with their refs, lists and
+    //  literal indices moved along; every list must belong to one node and
+    //  no tree may number its symbols by file (file_numbered()).
+    //  Room is made once for all of them, then the parts are copied at the
+    //  same time when a pool is given.
+    //  Returns the design units of the parts as refs into this tree.
+    //
+    std::vector<ref<design_unit>> merge(std::span<const ast> parts, work_pool* pool = nullptr);
+
+    //  Move every source offset at or past from by shift, after an edit of
+    //  the text in front of them; an end offset moves when it is past from
+    //
+    void shift_offsets(offset_t from, std::int64_t shift);
+
+    //  The symbol of a name field: decl name, stmt label, unit name and
+    //  of, the symbol of a name, select, attribute or physical expr. A
+    //  tree from the AST cache keeps the numbers of its file in the nodes
+    //  and maps them here; every other tree has the ids themselves.
+    //
+    symbol_id symbol(symbol_id id) const
+    {
+        if (file_symbols.empty())
+        {
+            return id;
+        }
+        return id < file_symbols.size() ? file_symbols[id] : no_symbol;
+    }
+
+    // true when the nodes number their symbols by file, see symbol()
+    bool file_numbered() const { return !file_symbols.empty(); }
+
+    // the values of the literal nodes
+    literal_table& literals() { return lits; }
+    literal_table const& literals() const { return lits; }
+
+    //  The flat arrays of the tree with their empty slot 0, as written to
+    //  the AST cache
+    //
+    struct image
+    {
+        std::span<const expr> exprs;
+        std::span<const decl> decls;
+        std::span<const stmt> stmts;
+        std::span<const design_unit> units;
+        std::span<const std::uint32_t> lists;
+        list<design_unit> root;
     };
+    image arrays() const { return {exprs.all(), decls.all(), stmts.all(), units.all(), lists.all(), root}; }
+
+    //  A tree over arrays laid out like arrays() in memory kept alive by
+    //  owner (a mapped cache file), used in place. The name fields hold
+    //  indices into symbols, see symbol(). Nodes and lists added later go
+    //  to the arena as usual.
+    //
+    static ast adopt(std::span<expr> e, std::span<decl> d, std::span<stmt> s, std::span<design_unit> u,
+                     std::span<std::uint32_t> l, list<design_unit> root, std::vector<symbol_id> symbols,
+                     std::shared_ptr<void> owner);
+
+    // number of nodes, the empty ones at index 0 not counted
+    std::size_t node_count() const { return exprs.size() + decls.size() + stmts.size() + units.size() - 4; }
+
+    // memory held by the nodes and lists
+    std::size_t bytes() const { return mem.bytes(); }
+
+    // drop the whole tree at once
+    void release()
+    {
+        mem.release();
+        lits.clear();
+        reset_pools();
+        file_symbols.clear();
+        borrowed.reset();
+    }
+
+private:
+    struct bases; // where the nodes of a merged part go
+    void relocate(ast const& other, bases const& at);
+
+    void reset_pools()
+    {
+        exprs.clear();
+        decls.clear();
+        stmts.clear();
+        units.clear();
+        lists.clear();
+        exprs.push(mem, {expr_kind::null});
+        decls.push(mem, {decl_kind::signal});
+        stmts.push(mem, {stmt_kind::null});
+        units.push(mem, {unit_kind::entity});
+        lists.push(mem, 0);
+        root = {};
+    }
+
+    arena mem{};
+    pool<expr> exprs{};
+    pool<decl> decls{};
+    pool<stmt> stmts{};
+    pool<design_unit> units{};
+    pool<std::uint32_t> lists{}; // child lists: length, then the indices
+    list<design_unit> root{};
+    literal_table lits{};
+    std::vector<symbol_id> file_symbols{}; // by the numbers in an adopted file, see symbol()
+    std::shared_ptr<void> borrowed{};      // holds the memory of adopted pools
+};
 
-}
+} // namespace vlark
 
-#endif // AST_BASE_H
\ No newline at end of file
+#endif // AST_BASE_H
@@ -0,0 +1,84 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  AST cache - parsed files kept on disk, keyed by their content
+//===========================================================================
+
+#include "ast.hpp"
+#include "diagnostics.h"
+#include "unit_parser.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+namespace vlark
+{
+
+// 64-bit hash of data, XXH64
+std::uint64_t content_hash(std::string_view data, std::uint64_t seed = 0);
+
+//-----------------------------------------------------------------------
+//
+//  ast_cache: a directory with the AST and the diagnostics of every file
+//  parsed, one cache file per content and parse mode. Its name is the
+//  content hash; the header repeats the hash, the text size, the parse
+//  mode, the vlark version and the node sizes, a file that does not
+//  match them is a miss and is overwritten by the next store.
+//
+//  The cache file is the image of the node pools and lists (indices, so
+//  nothing in them needs fixing up), the literal values, the names of the
+//  symbols it uses, the diagnostics and the token arrays. load() maps it
+//  copy-on-write and the tree uses the pools in place: the nodes keep the
+//  file's own symbol numbers and the tree maps them to the ids of this
+//  process (ast::symbol), so loading writes nothing into the mapping.
+//
+//  Stores write a temporary file and rename it, so readers never see
+//  half a file and many threads or processes can share the directory.
+//
+//-----------------------------------------------------------------------
+//
+class ast_cache
+{
+public:
+    explicit ast_cache(std::string directory)
+        : dir{std::move(directory)}
+    {
+    }
+
+    //  The tree of text parsed in mode if the cache has it, its diagnostics
+    //  are added to diags. tokens, when given, is set to the tokens of text.
+    //
+    std::optional<ast> load(std::string_view text, parse_mode mode, diagnostics& diags,
+                            token_stream* tokens = nullptr) const;
+
+    //  Keep tree, the tokens it was parsed from (without trivia) and diags
+    //  for text, false when the file cannot be written (or when diagnostics
+    //  were dropped, they could not be given back)
+    //
+    bool store(std::string_view text, parse_mode mode, ast const& tree, token_stream const& tokens,
+               diagnostics const& diags) const;
+
+    // the cache file of text
+    std::string path_of(std::string_view text, parse_mode mode) const;
+
+private:
+    std::string dir;
+};
+
+} // namespace vlark
+
+#endif // AST_CACHE_H
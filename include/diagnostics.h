@@ -0,0 +1,157 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Diagnostics - collected while scanning, rendered once at the end
+//===========================================================================
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+namespace vlark
+{
+
+enum class severity : std::uint8_t
+{
+    note,
+    warning,
+    error
+};
+
+enum class diag_code : std::uint16_t
+{
+    unknown_char,          // a char that starts no token
+    invalid_name,          // a name that is no identifier (leading '_' ...)
+    invalid_literal,       // malformed abstract literal
+    invalid_bit_string,    // malformed or unterminated bit string
+    unterminated_comment,  // /* without */
+    empty_source,          // nothing to tokenize
+    unterminated_string,   // no closing quote on the line
+    invalid_extended_name, // \ without closing \ on the line, or empty
+    expected_expression,   // no primary where one must start
+    expected_name,         // no identifier after '.' or '\''
+    expected_right_paren,  // list not closed
+    needs_parentheses,     // a nand b nand c, a and b or c, a = b = c
+    misplaced_sign,        // a * -b
+    expected_semicolon,    // declaration or statement not closed
+    expected_colon,        // no ':' after the names of a declaration
+    expected_keyword,      // a reserved word the construct needs (is, begin, end, then ...)
+    expected_design_unit,  // no library unit at the top level
+    expected_declaration,  // unknown declarative item
+    expected_statement,    // unknown statement
+    cannot_read,           // a project file that cannot be opened
+    duplicate_unit,        // a primary unit whose name is taken in the project
+    dependency_cycle,      // a design unit that depends on itself
+    token_too_long,        // a token the stream tokenizer cannot hold
+    nesting_too_deep,      // parentheses or statements nested past the parser's limit
+};
+
+std::string_view diag_message(diag_code code);
+
+std::string_view severity_name(severity sev);
+
+//-----------------------------------------------------------------------
+//
+//  diagnostic: one finding, the offending text is source[offset, +length].
+//  The offset is 64 bit, a stream goes on past 4 GB.
+//
+//-----------------------------------------------------------------------
+//
+struct diagnostic
+{
+    std::uint64_t offset;
+    std::uint32_t length;
+    diag_code code;
+    severity sev;
+};
+
+//-----------------------------------------------------------------------
+//
+//  diagnostics: an append-only collector. report() is a counter bump and
+//  a push_back, nothing is formatted or written until render(), so bad
+//  input costs no more than good input. Only the first max_entries are
+//  kept, the rest are counted.
+//
+//-----------------------------------------------------------------------
+//
+class diagnostics
+{
+public:
+    static constexpr std::size_t default_max_entries = 1000;
+
+    explicit diagnostics(std::size_t max = default_max_entries)
+        : max_entries{max}
+    {
+    }
+
+    void report(severity sev, diag_code code, std::uint64_t offset, std::size_t length = 0)
+    {
+        counts[static_cast<std::size_t>(sev)]++;
+        if (entries.size() < max_entries)
+        {
+            entries.push_back({offset, static_cast<std::uint32_t>(length), code, sev});
+        }
+    }
+
+    // add the diagnostics of other behind the own ones
+    void append(diagnostics const& other)
+    {
+        for (std::size_t i = 0; i < counts.size(); i++)
+        {
+            counts[i] += other.counts[i];
+        }
+        auto room = max_entries - std::min(max_entries, entries.size());
+        auto n = std::min(room, other.entries.size());
+        entries.insert(entries.end(), other.entries.begin(), other.entries.begin() + static_cast<std::ptrdiff_t>(n));
+    }
+
+    std::size_t count(severity sev) const { return counts[static_cast<std::size_t>(sev)]; }
+    std::size_t total() const { return counts[0] + counts[1] + counts[2]; }
+    bool has_errors() const { return count(severity::error) != 0; }
+
+    // kept diagnostics, in the order they were reported
+    std::span<const diagnostic> kept() const { return entries; }
+
+    // reported but not kept, beyond max_entries
+    std::size_t dropped() const { return total() - entries.size(); }
+
+    void set_max_entries(std::size_t max) { max_entries = max; }
+
+    void clear()
+    {
+        entries.clear();
+        counts = {};
+    }
+
+    //  Write every kept diagnostic as "name:line:col: severity: message: text",
+    //  line and column 1 based as editors count them. source is the text
+    //  the offsets refer to, without it only the offsets are shown.
+    //
+    void render(std::ostream& out, std::string_view source = {}, std::string_view name = {}) const;
+
+private:
+    std::vector<diagnostic> entries{};
+    std::array<std::size_t, 3> counts{};
+    std::size_t max_entries;
+};
+
+} // namespace vlark
+
+#endif // DIAGNOSTICS_H
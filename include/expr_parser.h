@@ -0,0 +1,220 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Expression parser - precedence climbing over the token stream
+//===========================================================================
+
+#include "ast.hpp"
+#include "diagnostics.h"
+#include "token.h"
+#include "token_source.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#ifndef EXPR_PARSER_H
+#define EXPR_PARSER_H
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//
+//  expr_parser: parses expressions, names and aggregates from a token
+//  stream into an ast, from token index pos up to (not with) index last.
+//  Or it pulls the tokens from a token_source as it goes, then only the
+//  source's lookahead window and the last few tokens are held.
+//
+//  All binary operators are handled by one loop that looks up their
+//  precedence in a table (see binary_precedence), so a primary costs a
+//  couple of calls whatever the number of precedence levels. Errors go
+//  to diags, the parser always returns (maybe an empty ref) and moves
+//  on. Nesting is bounded by max_nesting, deeper input is reported and
+//  skipped before it can run the stack out.
+//
+//-----------------------------------------------------------------------
+//
+class expr_parser
+{
+public:
+    static constexpr unsigned max_nesting = 256; // levels open at once
+
+    expr_parser(token_stream const& stream, std::string_view source, ast& out, diagnostics& errors,
+                std::size_t pos = 0, std::size_t last = std::numeric_limits<std::size_t>::max())
+        : tokens{stream}
+        , text{source}
+        , tree{out}
+        , diags{errors}
+        , i{pos}
+        , limit{std::min(last, stream.size())}
+    {
+    }
+
+    expr_parser(token_source& pull, ast& out, diagnostics& errors)
+        : tokens{no_tokens()}
+        , text{pull.source()}
+        , tree{out}
+        , diags{errors}
+        , i{0}
+        , limit{std::numeric_limits<std::size_t>::max()}
+        , puller{&pull}
+    {
+    }
+
+    // expression ::= ?? primary | logical_expression
+    ref<expr> expression();
+
+    //  element of an aggregate or association list:
+    //  [ choices => ] ( expression | discrete_range | open )
+    //
+    ref<expr> element();
+
+    // name ::= prefix { . suffix | ( elements ) | ' attribute | ' ( qualified ) }
+    ref<expr> name();
+
+    // index of the next token
+    std::size_t position() const { return i; }
+    void seek(std::size_t pos)
+    {
+        assert(puller == nullptr);
+        i = pos;
+    }
+
+    // type of the k-th token ahead, Eof past the end
+    token_type peek(std::size_t k = 0) const
+    {
+        if (puller != nullptr)
+        {
+            return pulled(i + k).type();
+        }
+        return i + k < limit ? tokens.type(i + k) : token_type::Eof;
+    }
+
+    //  No copying
+    //
+    expr_parser(expr_parser const&) = delete;
+    expr_parser& operator=(expr_parser const&) = delete;
+
+protected:
+    ref<expr> climb(unsigned min_prec);
+    ref<expr> unary(unsigned min_prec);
+    ref<expr> primary();
+    ref<expr> suffixes(ref<expr> prefix);
+    ref<expr> parenthesized();
+    ref<expr> literal();
+    list<expr> elements(); // ( element { , element } )
+    void collect_elements();
+    ref<expr> choice();
+
+    bool pulling() const { return puller != nullptr; }
+
+    // token k, from i - behind on
+    token at(std::size_t k) const { return puller != nullptr ? pulled(k) : tokens[k]; }
+
+    literal_table const& literals() const { return puller != nullptr ? puller->literals() : tokens.literals(); }
+
+    // offset of the next token, the end of the range past it
+    offset_t offset() const
+    {
+        if (puller != nullptr)
+        {
+            return pulled(i).offset(); // Eof is at the end of the text
+        }
+        return i < limit || limit < tokens.size() ? tokens.offset(std::min(i, limit))
+                                                   : static_cast<offset_t>(text.size());
+    }
+    ref<expr> add(expr_kind kind, token_type op, offset_t pos, std::uint32_t a = 0, std::uint32_t b = 0)
+    {
+        return tree.add(expr{kind, op, pos, a, b});
+    }
+    void error(diag_code code);
+    bool expect(token_type type, diag_code code);
+    void skip_parens(); // from ( up to and with the matching )
+
+    //  nesting: one more level open for its lifetime, up to max_nesting.
+    //  Parentheses, signs and (in unit_parser) statements and declarations
+    //  count, they are the constructs parsed by recursion.
+    //
+    class nesting
+    {
+    public:
+        explicit nesting(unsigned& level)
+            : open{level}
+        {
+            open++;
+        }
+        ~nesting() { open--; }
+
+        nesting(nesting const&) = delete;
+        nesting& operator=(nesting const&) = delete;
+
+        bool too_deep() const { return open > max_nesting; }
+
+    private:
+        unsigned& open;
+    };
+
+    token_stream const& tokens;
+    std::string_view text;
+    ast& tree;
+    diagnostics& diags;
+    std::size_t i;
+    std::size_t limit;
+    std::vector<ref<expr>> scratch{}; // items of the lists being parsed, nested ones on top
+    unsigned nested = 0;              // levels open, see nesting
+
+private:
+    static constexpr std::size_t behind = 4; // tokens kept before i in pull mode
+
+    static token_stream const& no_tokens()
+    {
+        static token_stream const none;
+        return none;
+    }
+
+    //  pull mode: the source is moved on up to i first, the tokens it
+    //  passes are kept in a ring of the last few. The parser looks no
+    //  further ahead than the source's window.
+    //
+    token pulled(std::size_t k) const
+    {
+        for (; taken < i; taken++)
+        {
+            passed[taken % behind] = puller->next();
+        }
+        if (k < taken)
+        {
+            assert(taken - k <= behind);
+            return passed[k % behind];
+        }
+        assert(k - taken < token_source::window);
+        return puller->peek(k - taken);
+    }
+
+    token_source* puller = nullptr;
+    mutable std::size_t taken = 0; // tokens taken from puller
+    mutable std::array<token, behind> passed{token{0, 0, token_type::Eof}, token{0, 0, token_type::Eof},
+                                             token{0, 0, token_type::Eof}, token{0, 0, token_type::Eof}};
+};
+
+//  Binding power of token type as a binary operator, 0 when it is none
+//
+//  logical 1 < relational 2 < shift 3 < adding 4 < multiplying 5 < ** 6
+//
+unsigned binary_precedence(token_type type);
+
+} // namespace vlark
+
+#endif // EXPR_PARSER_H
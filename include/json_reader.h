@@ -0,0 +1,100 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//===========================================================================
+//  JSON reader - parses a JSON document into a tree of values
+//===========================================================================
+
+#include "json_writer.h"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//
+//  json_value: one value of a parsed JSON document, arrays and objects
+//  own their elements. Meant for small documents such as the messages of
+//  a client (big output is streamed by json_writer); lookups of a member
+//  that is not there, or in a value that is no object, give a null value
+//  so a path can be followed without checks.
+//
+//-----------------------------------------------------------------------
+//
+class json_value
+{
+public:
+    enum class kind : std::uint8_t
+    {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object
+    };
+
+    json_value() = default;
+
+    //  The document in text, none when it is no valid JSON (or nested
+    //  deeper than max_depth)
+    //
+    static std::optional<json_value> parse(std::string_view text);
+    static constexpr unsigned max_depth = 256;
+
+    kind type() const { return k; }
+    bool is_null() const { return k == kind::null; }
+
+    bool boolean() const { return k == kind::boolean && flag; }
+    double number() const { return k == kind::number ? num : 0; }
+    // the number truncated and clamped to the int64 range
+    std::int64_t integer() const;
+    std::string_view string() const { return k == kind::string ? std::string_view{str} : std::string_view{}; }
+
+    // the elements of an array, the member values of an object
+    std::span<const json_value> elements() const { return items; }
+    std::size_t size() const { return items.size(); }
+    json_value const& operator[](std::size_t i) const { return i < items.size() ? items[i] : none(); }
+
+    // the member called name
+    json_value const& operator[](std::string_view name) const;
+    // member names of an object, in the order of elements()
+    std::span<const std::string> names() const { return keys; }
+
+private:
+    friend class json_parser;
+    static json_value const& none();
+
+    kind k = kind::null;
+    bool flag = false;
+    double num = 0;
+    std::string str{};
+    std::vector<json_value> items{};
+    std::vector<std::string> keys{};
+};
+
+//  value written as it is, a number without fraction as an integer
+//
+void write_json(json_value const& value, json_writer& out);
+
+} // namespace vlark
+
+#endif // JSON_READER_H
@@ -0,0 +1,117 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  JSON writer - streams JSON through one buffer, and the AST as JSON
+//===========================================================================
+
+#include "ast.hpp"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//
+//  json_writer: writes JSON values as they come into a buffer that goes
+//  to the sink whenever it is full, so there is no document in memory
+//  and the buffer is reused for the whole output.
+//  Strings are copied in runs found by simd::escape_free_run, bytes from
+//  0x80 up pass as they are (the sources are taken to be UTF-8). Numbers
+//  go through std::to_chars, a double that is no number is written as
+//  null. pretty puts every member and element on a line of its own,
+//  indented by two spaces a level.
+//
+//-----------------------------------------------------------------------
+//
+class json_writer
+{
+public:
+    explicit json_writer(std::ostream& sink, bool pretty = false, std::size_t capacity = 1 << 20);
+    ~json_writer() { flush(); }
+
+    void begin_object() { open('{'); }
+    void end_object() { close('}'); }
+    void begin_array() { open('['); }
+    void end_array() { close(']'); }
+
+    // member name, the next value is its value
+    void key(std::string_view name);
+
+    void string(std::string_view text);
+    void number(std::int64_t value);
+    void number(double value);
+    void boolean(bool value);
+    void null();
+
+    // a line break after a top level value, the next one starts a document of its own
+    void next_document();
+
+    // hand the buffer to the sink
+    void flush();
+
+    // bytes written so far, flushed or not
+    std::size_t size() const { return flushed + static_cast<std::size_t>(cur - buf.get()); }
+
+    json_writer(json_writer const&) = delete;
+    json_writer& operator=(json_writer const&) = delete;
+
+private:
+    void open(char bracket);
+    void close(char bracket);
+    void separate();
+    void newline();
+    void escaped(std::string_view text);
+
+    //  room for n more bytes, n must not exceed the capacity
+    //
+    char* room(std::size_t n)
+    {
+        if (static_cast<std::size_t>(last - cur) < n)
+        {
+            flush();
+        }
+        return cur;
+    }
+    void put(char c)
+    {
+        room(1);
+        *cur++ = c;
+    }
+
+    std::ostream& out;
+    bool pretty;
+    bool need_comma = false; // a value came before in the open object or array
+    bool after_key = false;  // the value of a member comes next
+    unsigned depth = 0;
+    std::size_t flushed = 0;
+    std::unique_ptr<char[]> buf;
+    char* cur;
+    char* last;
+};
+
+//  The tree as {"units": [...]} with file first if given. Every node is an
+//  object with its kind, pos and the fields it uses (see ast.hpp), empty
+//  refs and lists are left out; names are written as strings, literals
+//  as their values.
+//
+void write_json(ast const& tree, json_writer& out, std::string_view file = {});
+
+} // namespace vlark
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,169 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Literals - abstract literals and bit strings, decoded once
+//===========================================================================
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef LITERAL_H
+#define LITERAL_H
+
+namespace vlark
+{
+
+enum class literal_kind : std::uint8_t
+{
+    integer,
+    real,
+    bit_string,
+    string
+};
+
+//-----------------------------------------------------------------------
+//
+//  literal_table: decoded values of the literal tokens of a source.
+//  A literal token keeps the index of its value in its id, later stages
+//  read the value from here and never look at the text again.
+//
+//  integer:    universal integer, overflow is set when it did not fit
+//              in 64 bits
+//  real:       universal real, overflow is set when it is out of range
+//  bit_string: the expanded bit value, one char per element ('0', '1'
+//              or the graphic char given in the source, like 'X' or '-')
+//  string:     the chars between the quotes, a doubled quote as one
+//
+//-----------------------------------------------------------------------
+//
+class literal_table
+{
+public:
+    using kind = literal_kind;
+
+    struct value
+    {
+        std::uint64_t raw; // int64, double bits or chars offset<<32|length
+        kind k;
+        bool overflow;
+    };
+
+    std::uint32_t add_integer(std::int64_t v, bool overflow = false)
+    {
+        return add({static_cast<std::uint64_t>(v), kind::integer, overflow});
+    }
+
+    std::uint32_t add_real(double v, bool overflow = false)
+    {
+        return add({std::bit_cast<std::uint64_t>(v), kind::real, overflow});
+    }
+
+    std::uint32_t add_bits(std::string_view bits) { return add_chars(bits, kind::bit_string); }
+    std::uint32_t add_string(std::string_view str) { return add_chars(str, kind::string); }
+
+    kind kind_of(std::uint32_t i) const { return values[i].k; }
+    bool overflow(std::uint32_t i) const { return values[i].overflow; }
+
+    std::int64_t integer(std::uint32_t i) const { return static_cast<std::int64_t>(values[i].raw); }
+    double real(std::uint32_t i) const { return std::bit_cast<double>(values[i].raw); }
+    std::string_view bits(std::uint32_t i) const { return chars_of(i); }
+    std::string_view str(std::uint32_t i) const { return chars_of(i); }
+
+    std::size_t size() const { return values.size(); }
+
+    // add all values of other, value i of other becomes size() + i
+    void append(literal_table const& other)
+    {
+        std::uint64_t shift = chars.size();
+        shift <<= 32;
+        for (auto v : other.values)
+        {
+            v.raw += v.k == kind::bit_string || v.k == kind::string ? shift : 0;
+            values.push_back(v);
+        }
+        chars += other.chars;
+    }
+
+    void clear()
+    {
+        values.clear();
+        chars.clear();
+    }
+
+    //  the values and chars as they are kept, for the AST cache
+    //
+    std::span<const value> all_values() const { return values; }
+    std::string_view all_chars() const { return chars; }
+    void assign(std::span<const value> v, std::string_view c)
+    {
+        values.assign(v.begin(), v.end());
+        chars.assign(c);
+    }
+
+private:
+    std::uint32_t add(value v)
+    {
+        values.push_back(v);
+        return static_cast<std::uint32_t>(values.size() - 1);
+    }
+
+    std::uint32_t add_chars(std::string_view text, kind k)
+    {
+        std::uint64_t off = chars.size();
+        chars += text;
+        return add({off << 32 | text.size(), k, false});
+    }
+
+    std::string_view chars_of(std::uint32_t i) const
+    {
+        return std::string_view(chars).substr(values[i].raw >> 32, values[i].raw & 0xffff'ffffu);
+    }
+
+    std::vector<value> values{};
+    std::string chars{}; // bit strings and strings, one after the other
+};
+
+//-----------------------------------------------------------------------
+//
+//  literal_scan: result of scanning an abstract literal or a bit string.
+//  ok is false for a malformed literal, len then covers the bad text.
+//
+//-----------------------------------------------------------------------
+//
+struct literal_scan
+{
+    literal_kind kind;
+    std::size_t len;
+    bool ok;
+    std::uint32_t value; // index into the literal_table, when one was given
+};
+
+// Scan the decimal/based literal or sized bit string at the start of text (a digit)
+literal_scan scan_number(std::string_view text, literal_table* values = nullptr);
+
+// Scan the string literal at the start of text (a '"'), it ends at the line end
+literal_scan scan_string(std::string_view text, literal_table* values = nullptr);
+
+// Scan the bit string at the start of text, prefix_len is the length of its base specifier
+literal_scan scan_bit_string(std::string_view text, std::size_t prefix_len, literal_table* values = nullptr);
+
+// Length of the base specifier (b, o, x, d, ub, uo, ux, sb, so, sx) starting a bit string, 0 if none
+std::size_t bit_string_prefix(std::string_view text);
+
+} // namespace vlark
+
+#endif // LITERAL_H
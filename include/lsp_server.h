@@ -0,0 +1,111 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//===========================================================================
+//  Language server - LSP over JSON-RPC on a pair of streams
+//===========================================================================
+
+#include "json_reader.h"
+#include "work_pool.h"
+#include <condition_variable>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef LSP_SERVER_H
+#define LSP_SERVER_H
+
+namespace vlark
+{
+
+struct lsp_document; // lsp_server.cpp
+
+//-----------------------------------------------------------------------
+//
+//  lsp_server: the language server behind --lsp. Reads JSON-RPC messages
+//  with a Content-Length header from in and writes the responses and
+//  notifications to out, the way LSP has it over stdio.
+//  Open documents stay in memory with their tokens, tree and an index of
+//  their declarations; changes are applied incrementally (reparse), the
+//  parsing is done by a thread of its own on a work_pool, one document
+//  per task, and the diagnostics are published when a document is done.
+//  The reading thread answers requests from the indexes, after waiting
+//  for the parse of the version the request is about.
+//
+//  Supported: initialize, shutdown, exit, textDocument/didOpen,
+//  didChange (incremental or full), didClose, documentSymbol (a tree),
+//  definition, and publishDiagnostics going out. Positions are UTF-16
+//  based unless the client offers UTF-8.
+//
+//-----------------------------------------------------------------------
+//
+class lsp_server
+{
+public:
+    // jobs threads parse, 0 for one per core
+    lsp_server(std::istream& in, std::ostream& out, unsigned jobs = 0);
+    ~lsp_server();
+
+    //  Serve until exit or the end of the input, the exit code: 0 after a
+    //  shutdown request, else 1
+    //
+    int run();
+
+    lsp_server(lsp_server const&) = delete;
+    lsp_server& operator=(lsp_server const&) = delete;
+
+private:
+    bool read_message(std::string& body);
+    void send(std::string_view body);
+    void handle(json_value const& msg);
+    template <class Write>
+    void respond(json_value const& id, Write const& result);
+    void fail(json_value const& id, int code, std::string_view message);
+
+    void initialize(json_value const& id, json_value const& params);
+    void open(json_value const& params);
+    void change(json_value const& params);
+    void close(json_value const& params);
+    void document_symbols(json_value const& id, json_value const& params);
+    void definition(json_value const& id, json_value const& params);
+
+    std::shared_ptr<lsp_document> parsed(std::string_view uri);
+    void queue(std::shared_ptr<lsp_document> const& doc);
+    void parse_loop(std::stop_token stop);
+    void publish(lsp_document const& doc);
+
+    std::istream& in;
+    std::ostream& out;
+    std::mutex out_lock;
+    bool utf8 = false; // positions count bytes, not UTF-16 code units
+    bool shut_down = false;
+
+    std::mutex docs_lock; // guards docs, dirty and the versions of the documents
+    std::unordered_map<std::string, std::shared_ptr<lsp_document>> docs{};
+    std::vector<std::shared_ptr<lsp_document>> dirty{};
+    std::condition_variable_any wake;
+    std::condition_variable_any done;
+
+    work_pool pool;
+    std::jthread parser; // last, so it is stopped first
+};
+
+} // namespace vlark
+
+#endif // LSP_SERVER_H
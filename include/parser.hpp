@@ -14,7 +14,11 @@
 // All parse interface code
 //===========================================================================
 
+#include "ast.hpp"
+#include "diagnostics.h"
 #include "token.h"
+#include "unit_parser.h"
+#include <memory>
 
 #ifndef PARSER_H
 #define PARSER_H
@@ -22,13 +26,21 @@
 namespace vlark
 {
 
-    // Forward declaration of the ast class
-    class ast;
+    class ast_cache;
+    class work_pool;
 
+    //  parser: with one job the unit parser pulls the tokens from a
+    //  token_source as it goes, the first units are there before the file
+    //  is scanned to its end and only the lookahead is held. With more the
+    //  file is tokenized in parallel chunks and its design units are
+    //  parsed on a pool kept for all files of the parser.
+    //
     class parser
     {
     public:
-        parser() = default;
+        parser();
+        explicit parser(unsigned njobs, parse_mode m = parse_mode::full);
+        ~parser();
         parser(const parser &) = delete;
         parser &operator=(const parser &) = delete;
         parser(parser &&) = delete;
@@ -37,7 +49,24 @@ namespace vlark
         // Parse the code and return the abstract syntax tree
         [[nodiscard]] ast parse_code(const std::string_view code);
 
+        // Parse a file, its diagnostics are written to std::cerr
         [[nodiscard]] ast parse(const std::string_view filepath);
+
+        // diagnostics of the last parse, the offsets refer to its text
+        const diagnostics &diags() const { return issues; }
+
+        // look files up in cache before parsing them, and keep them there after
+        void set_cache(const ast_cache *c) { cache = c; }
+
+    private:
+        ast parse_text(std::string_view code);
+        ast parse_tokens(std::string_view code, token_stream &tokens); // the whole file tokenized first
+
+        unsigned jobs = 1; // tokenizer and parser threads, 0 for one per core
+        parse_mode mode = parse_mode::full;
+        diagnostics issues{};
+        const ast_cache *cache = nullptr;
+        std::unique_ptr<work_pool> pool{}; // none with one job
     };
 
 }
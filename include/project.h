@@ -0,0 +1,156 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Project - the design units of a file set and their analysis order
+//===========================================================================
+
+#include "ast.hpp"
+#include "ast_cache.h"
+#include "diagnostics.h"
+#include "utils.h"
+#include "work_pool.h"
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#ifndef PROJECT_H
+#define PROJECT_H
+
+namespace vlark
+{
+
+struct source_file
+{
+    std::string path;
+    std::string code{};                     // added from memory
+    bool from_memory = false;               // code is the text, even when empty
+    std::unique_ptr<sourceBuffer> mapped{}; // read by scan()
+    diagnostics diags{};
+    ast tree{}; // set by parse()
+
+    std::string_view text() const { return mapped ? mapped->text() : std::string_view{code}; }
+};
+
+struct project_unit
+{
+    std::uint32_t file;
+    unit_kind kind;
+    offset_t pos;
+    symbol_id name;
+    symbol_id of; // entity of an architecture or configuration
+};
+
+//-----------------------------------------------------------------------
+//
+//  project: scans a set of files (outline parse, one task per file on
+//  the pool) and links their design units into a dependency graph:
+//  - an architecture needs its entity, a package body its package and a
+//    configuration its entity with all of its architectures
+//  - a unit needs the primary units named by its use and context
+//    clauses, work.pkg.all or pkg.x, and by its instances, the entity
+//    of entity work.e(a) (and architecture a) or of a component c
+//  Names that are not in the project (ieee, std ...) are left out, all
+//  files are taken to be one library.
+//
+//  A unit that depends on itself is reported as dependency_cycle in its
+//  file. analyze() runs the others in dependency order on the pool, each
+//  as soon as the units it needs are done; parse() uses it to parse the
+//  files in full.
+//
+//-----------------------------------------------------------------------
+//
+class project
+{
+public:
+    explicit project(unsigned jobs = 1)
+        : pool{jobs}
+    {
+    }
+
+    void add_file(std::string path);
+    void add_source(std::string path, std::string text);
+
+    // keep the outlines of the files in cache, scan() then parses changed files only
+    void set_cache(ast_cache const* c) { cache = c; }
+
+    // parse the files and build the graph, can be called again after adding files
+    void scan();
+
+    std::span<const source_file> files() const { return sources; }
+    std::span<const project_unit> units() const { return nodes; }
+
+    // the units unit u needs, and the ones that need it
+    std::span<const std::uint32_t> needs(std::uint32_t u) const { return edges(need_start, need_list, u); }
+    std::span<const std::uint32_t> users(std::uint32_t u) const { return edges(user_start, user_list, u); }
+
+    // the units of every cycle, each one in a strongly connected component
+    std::vector<std::vector<std::uint32_t>> const& cycles() const { return loops; }
+
+    //  Units by analysis wave: the first wave needs nothing, every other
+    //  unit comes one wave after the last unit it needs. Units in or
+    //  behind a cycle are left out.
+    //
+    std::vector<std::vector<std::uint32_t>> waves() const;
+
+    //  Call task(u) for every unit not in or behind a cycle, after the
+    //  calls for all units it needs returned. Returns the units done.
+    //
+    std::size_t analyze(std::function<void(std::uint32_t)> const& task);
+
+    //  Parse every scanned file in mode into its tree, in the order of
+    //  analyze(): a file is parsed before the units of other files that
+    //  need one of its units. The diagnostics of the file are the ones
+    //  of this parse, plus the dependency findings of scan().
+    //
+    void parse(parse_mode mode = parse_mode::full);
+
+    project(project const&) = delete;
+    project& operator=(project const&) = delete;
+
+private:
+    struct reference
+    {
+        symbol_id name;
+        symbol_id secondary; // architecture of an entity instance
+    };
+    struct scanned_unit
+    {
+        project_unit unit;
+        std::vector<reference> refs;
+    };
+
+    static std::span<const std::uint32_t> edges(std::vector<std::uint32_t> const& start,
+                                                std::vector<std::uint32_t> const& list, std::uint32_t u)
+    {
+        return std::span(list).subspan(start[u], start[u + 1] - start[u]);
+    }
+
+    void scan_file(std::uint32_t k, std::vector<scanned_unit>& found);
+    void parse_file(std::uint32_t k, parse_mode mode);
+    void link(std::vector<std::vector<scanned_unit>> const& found);
+    void find_cycles();
+
+    work_pool pool;
+    ast_cache const* cache = nullptr;
+    std::vector<source_file> sources{};
+    std::vector<project_unit> nodes{};
+    std::vector<std::uint32_t> need_start{0}, need_list{}; // needs of unit u: need_list[need_start[u], [u + 1])
+    std::vector<std::uint32_t> user_start{0}, user_list{};
+    std::vector<std::vector<std::uint32_t>> loops{};
+};
+
+} // namespace vlark
+
+#endif // PROJECT_H
@@ -0,0 +1,73 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Reparse - bring tokens and tree up to date after an edit of the text
+//===========================================================================
+
+#include "ast.hpp"
+#include "diagnostics.h"
+#include "token.h"
+#include "unit_parser.h"
+#include <string>
+#include <string_view>
+
+#ifndef REPARSE_H
+#define REPARSE_H
+
+namespace vlark
+{
+
+struct text_edit
+{
+    offset_t begin = 0; // the bytes [begin, end) of the old text
+    offset_t end = 0;
+    std::string_view text{}; // go in their place
+};
+
+struct reparse_stats
+{
+    std::size_t relexed = 0;     // tokens scanned again
+    std::size_t reparsed = 0;    // tokens parsed again, 0 when no token changed
+    std::size_t replaced = 0;    // declarations, statements or design units given up
+    bool whole_units = false;    // design units were parsed again
+};
+
+//-----------------------------------------------------------------------
+//
+//  reparse: apply edit to text, then bring tokens, tree and diags (the
+//  tokenizer and parser diagnostics, as parser::parse gives them) up to
+//  date without starting over:
+//  - the text is scanned again from the token in front of the edit
+//    until a token comes out that the old stream has at the same place
+//    (moved by the edit), the old tokens from there on are kept
+//  - the innermost declaration or statement list range around the
+//    changed tokens, from the start of an item up to the start of a later
+//    one, is parsed again and put in place of its old items when it
+//    parses without error; else the design units around the changes are
+//  Every other node is kept, only the offsets behind the edit move. The
+//  replaced nodes stay in the arena until the text is parsed from scratch.
+//
+//  The result is the tree and the diagnostics of a full parse, with errors
+//  too: the design units parsed again run on to a clean cut, as in a
+//  parallel parse, so error recovery ends where a full parse has it end.
+//  Token streams with trivia and trees from the AST cache (which number
+//  their symbols by file) are tokenized and parsed again in full.
+//
+//-----------------------------------------------------------------------
+//
+reparse_stats reparse(std::string& text, token_stream& tokens, ast& tree, diagnostics& diags, text_edit const& edit,
+                      parse_mode mode = parse_mode::full);
+
+} // namespace vlark
+
+#endif // REPARSE_H
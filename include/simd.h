@@ -0,0 +1,135 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  SIMD kernels - byte scanning used by the source and token layers
+//===========================================================================
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#ifndef SIMD_H
+#define SIMD_H
+
+namespace vlark::simd
+{
+
+//-----------------------------------------------------------------------
+//
+//  isa: instruction set used by a kernel. Every kernel has a scalar
+//  version, the vector versions must give the very same results.
+//  SSE2 is part of every x86-64 cpu, AVX2 is detected at runtime.
+//
+//-----------------------------------------------------------------------
+//
+enum class isa : std::uint8_t
+{
+    scalar,
+    sse2,
+    avx2
+};
+
+// best instruction set supported by the running cpu
+isa best();
+
+std::string_view isa_name(isa level);
+
+//-----------------------------------------------------------------------
+//
+//  char_class: the classes of the run kernels, as bits of class_table.
+//  The scalar kernels (and the tails of the vector loops) look every
+//  byte up in the table, the vector loops test the same sets with range
+//  compares and a movemask, 16 or 32 bytes at a time.
+//
+//-----------------------------------------------------------------------
+//
+enum char_class : std::uint8_t
+{
+    space = 1 << 0, // whitespace as std::isspace sees it in the "C" locale
+    digit = 1 << 1, // decimal digit or '_', the chars of a digit run in an abstract literal
+    ident = 1 << 2, // letter, digit or '_', the chars of a basic identifier
+};
+
+inline constexpr auto class_table = [] {
+    std::array<std::uint8_t, 256> cls{};
+    for (unsigned c = '\t'; c <= '\r'; c++)
+    {
+        cls[c] = space;
+    }
+    cls[' '] = space;
+    for (unsigned c = 0; c < 26; c++)
+    {
+        cls['a' + c] = ident;
+        cls['A' + c] = ident;
+    }
+    for (unsigned c = '0'; c <= '9'; c++)
+    {
+        cls[c] = digit | ident;
+    }
+    cls['_'] = digit | ident;
+    return cls;
+}();
+
+constexpr bool is_space(char c)
+{
+    return (class_table[static_cast<unsigned char>(c)] & space) != 0;
+}
+
+constexpr bool is_digit_run(char c)
+{
+    return (class_table[static_cast<unsigned char>(c)] & digit) != 0;
+}
+
+constexpr bool is_ident(char c)
+{
+    return (class_table[static_cast<unsigned char>(c)] & ident) != 0;
+}
+
+// Append the offset following every '\n' in text (the next line start)
+void find_newlines(std::string_view text, std::vector<std::uint32_t>& starts, isa level = best());
+
+// Length of the leading run of chars of class cls, text.size() if all are
+std::size_t class_run(std::string_view text, char_class cls, isa level = best());
+
+// Index of the first non-space char, text.size() if there is none
+inline std::size_t skip_space(std::string_view text, isa level = best())
+{
+    return class_run(text, space, level);
+}
+
+// Length of the leading run of digits and '_'
+inline std::size_t digit_run(std::string_view text, isa level = best())
+{
+    return class_run(text, digit, level);
+}
+
+// Length of the leading run of identifier chars
+inline std::size_t ident_run(std::string_view text, isa level = best())
+{
+    return class_run(text, ident, level);
+}
+
+// Index of the first "ab" pair, std::string_view::npos if there is none
+std::size_t find_pair(std::string_view text, char a, char b, isa level = best());
+
+// Index of the first a or b, std::string_view::npos if there is none
+std::size_t find_either(std::string_view text, char a, char b, isa level = best());
+
+// Length of the leading run of chars a JSON string takes as they are (no '"', '\\' or control char)
+std::size_t escape_free_run(std::string_view text, isa level = best());
+
+} // namespace vlark::simd
+
+#endif // SIMD_H
@@ -0,0 +1,88 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Streaming tokenizer - bounded memory front end
+//===========================================================================
+
+#include "token.h"
+#include <functional>
+#include <istream>
+
+#ifndef STREAM_TOKENIZER_H
+#define STREAM_TOKENIZER_H
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//
+//  stream_token: a token handed out by the stream_tokenizer.
+//  text is a view into the current chunk and is only valid during the
+//  call of the token_sink.
+//
+//-----------------------------------------------------------------------
+//
+struct stream_token
+{
+    token_type type;
+    std::string_view text;
+    token_position pos;
+};
+
+using token_sink = std::function<void(stream_token const&)>;
+
+//-----------------------------------------------------------------------
+//
+//  stream_tokenizer: reads the source in fixed-size chunks and emits the
+//  tokens to a sink. Tokens crossing a chunk edge are carried over into
+//  the next chunk, up to max_carry bytes, so memory is bounded by the
+//  chunk size plus max_carry. A longer comment is skipped piece by piece,
+//  any other longer token is reported and skipped to the end of its line.
+//  Works on any std::istream (files, stdin, pipes) and gives the same
+//  tokens as tokenize() for tokens up to max_carry.
+//
+//-----------------------------------------------------------------------
+//
+class stream_tokenizer
+{
+public:
+    static constexpr std::size_t default_chunk_size = 64 * 1024;
+    static constexpr std::size_t max_carry = 64 * 1024;
+
+    explicit stream_tokenizer(std::size_t chunk = default_chunk_size)
+        : chunk_size{chunk == 0 ? default_chunk_size : chunk}
+    {
+    }
+
+    // Tokenize the complete stream, returns the number of emitted tokens
+    std::size_t run(std::istream& in, token_sink const& sink);
+
+    //  errors of the last run, the offsets are stream offsets. The text
+    //  is gone by then, render them without a source.
+    //
+    diagnostics const& diags() const { return issues; }
+
+    //  No copying
+    //
+    stream_tokenizer(stream_tokenizer const&) = delete;
+    stream_tokenizer& operator=(stream_tokenizer const&) = delete;
+
+private:
+    std::size_t chunk_size;
+    std::string buf{};
+    diagnostics issues{};
+};
+
+} // namespace vlark
+
+#endif // STREAM_TOKENIZER_H
@@ -0,0 +1,100 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Symbol table - interned, case folded identifiers
+//===========================================================================
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+namespace vlark
+{
+
+using symbol_id = std::uint32_t;
+
+inline constexpr symbol_id no_symbol = 0;
+
+//-----------------------------------------------------------------------
+//
+//  symbol_table: maps every identifier to a dense 32-bit id.
+//  Basic identifiers are case insensitive in VHDL, so CLK, clk and Clk
+//  share one id; extended identifiers (\Clk\) keep their case.
+//
+//  Inserts are sharded by hash, each shard has its own lock and string
+//  arena, so many tokenizer threads can intern at once. Ids are handed
+//  out from one atomic counter and name() is lock free.
+//
+//-----------------------------------------------------------------------
+//
+class symbol_table
+{
+public:
+    symbol_table();
+    ~symbol_table();
+
+    // the process wide table used by the tokenizer
+    static symbol_table& global();
+
+    // id of name, adding it on first use. fold: case insensitive name
+    symbol_id intern(std::string_view name, bool fold = true);
+
+    // the (case folded) spelling of id, empty for no_symbol
+    std::string_view name(symbol_id id) const;
+
+    // number of distinct symbols
+    std::size_t size() const { return next_id.load(std::memory_order_acquire) - 1; }
+
+    //  No copying
+    //
+    symbol_table(symbol_table const&) = delete;
+    symbol_table& operator=(symbol_table const&) = delete;
+
+private:
+    static constexpr std::size_t shard_count = 64;
+    static constexpr std::size_t page_bits = 12; // 4096 names per page
+    static constexpr std::size_t page_size = std::size_t{1} << page_bits;
+    static constexpr std::size_t max_pages = std::size_t{1} << 16;
+
+    struct shard
+    {
+        std::mutex lock;
+        std::unordered_map<std::string_view, symbol_id> ids;
+        std::vector<std::unique_ptr<char[]>> blocks; // string arena
+        std::size_t block_left = 0;
+        char* block_pos = nullptr;
+
+        std::string_view store(std::string_view s);
+    };
+
+    using page = std::array<std::string_view, page_size>;
+
+    std::array<shard, shard_count> shards;
+    std::unique_ptr<std::atomic<page*>[]> pages; // id -> name, grown page by page
+    std::mutex page_lock;
+    std::atomic<symbol_id> next_id{1};
+
+    void publish(symbol_id id, std::string_view s);
+};
+
+} // namespace vlark
+
+#endif // SYMBOLS_H
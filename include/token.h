@@ -14,9 +14,14 @@
 //  Token - Analyzer
 //===========================================================================
 
-#include "ast.hpp"
+#include "diagnostics.h"
+#include "literal.h"
+#include "symbols.h"
+#include "trivia.h"
 #include "utils.h"
 #include <cassert>
+#include <iterator>
+#include <span>
 
 #ifndef TOKEN_H
 #define TOKEN_H
@@ -40,7 +45,7 @@ enum class token_type : std::int16_t
     Block_Comment_Start, //--  Start of a block comment (/*)
     Block_Comment_End,   //--  End of a block comment (*/)
 
-    Block_Comment_Text, //--  Text within a block comment (no newline)
+    Block_Comment_Text, //--  A block comment, from /* to */
 
     // --- Source_type
     //   --  These tokens represent text in the source whose exact meaning needs
@@ -263,9 +268,11 @@ enum class token_type : std::int16_t
 
     //--  Added by vhdl 2008:
     Assume,
+    Assume_Guarantee,
     Context,
     Cover,
     Default,
+    Fairness,
     Force,
     Parameter,
     Property,
@@ -273,6 +280,7 @@ enum class token_type : std::int16_t
     Restrict,
     Restrict_Guarantee,
     Sequence,
+    Strong,
     Inherit,
     Vmode,
     Vprop,
@@ -281,61 +289,348 @@ enum class token_type : std::int16_t
     //--  Added by vhdl 2019
     Private,
     View,
+
+    //--  PSL key words, only reserved within PSL declarations and directives
+    Psl_Const,
+    Psl_Boolean,
+    Inf,
+
+    Within,
+    Abort,
+    Async_Abort,
+    Sync_Abort,
+    Before,
+    Before_Em,    //-- before!
+    Before_Un,    //-- before_
+    Before_Em_Un, //-- before!_
+    Always,
+    Never,
+    Eventually_Em, //-- eventually!
+    Next_A,
+    Next_A_Em, //-- next_a!
+    Next_E,
+    Next_E_Em, //-- next_e!
+    Next_Event,
+    Next_Event_A,
+    Next_Event_A_Em, //-- next_event_a!
+    Next_Event_E,
+    Next_Event_E_Em, //-- next_event_e!
+    Until_Em,        //-- until!
+    Until_Un,        //-- until_
+    Until_Em_Un,     //-- until!_
+    Prev,
+    Stable,
+    Fell,
+    Rose,
+    Onehot,
+    Onehot0,
+};
+
+//-----------------------------------------------------------------------
+//
+//  vhdl_std: language revision, decides which words are reserved
+//
+//-----------------------------------------------------------------------
+//
+enum class vhdl_std : std::uint8_t
+{
+    v87,
+    v93,
+    v00,
+    v08,
+    v19
 };
 
 //-----------------------------------------------------------------------
 //
 //  token: represents a single token
 //  every token has details meta-data to help letter with AST parser
+//  A token does not own its text, it is an offset+length view into the
+//  source it was scanned from, which must outlive it.
 //
 //-----------------------------------------------------------------------
 //
 class token
 {
 public:
-    [[nodiscard]] token(std::string_view sz, token_position p, token_type type)
-        : sv{sz}
-        , pos{p}
+    [[nodiscard]] token(offset_t offset, std::uint32_t length, token_type type, symbol_id id = no_symbol)
+        : off{offset}
+        , len{length}
+        , sym{id}
         , tok_type{type}
     {
     }
 
-    std::string as_string_view() const
+    // token spelling, source is the text the token was scanned from
+    std::string_view text(std::string_view source) const
     {
-        assert(sv.data());
-        return sv;
+        assert(std::size_t{off} + len <= source.size());
+        return source.substr(off, len);
     }
 
-    operator std::string() const { return as_string_view(); }
-
-    bool operator==(token const& t) const { return operator std::string() == t.operator std::string(); }
-
-    bool operator==(std::string_view s) const { return s == this->operator std::string(); }
+    bool operator==(token_type t) const { return tok_type == t; }
 
-    std::string to_string() const { return sv; }
+    // same type and the same id: for identifiers the same name (case folded),
+    // literals only compare equal to themselves, compare their values instead
+    bool operator==(token const& t) const { return tok_type == t.tok_type && sym == t.sym; }
 
-    friend auto& operator<<(auto& o, token const& t) { return o << t.as_string_view(); }
+    // same type and spelling, compared in place without any allocation
+    bool same_text(token const& t, std::string_view source) const
+    {
+        return tok_type == t.tok_type && text(source) == t.text(source);
+    }
 
-    token_position position() const { return pos; }
+    // byte offset into the source, see sourceBuffer::position_of
+    offset_t offset() const { return off; }
 
-    std::size_t length() const { return sv.size(); }
+    std::size_t length() const { return len; }
 
     token_type type() const { return tok_type; }
 
     void set_type(token_type l) { tok_type = l; }
 
+    // interned name of an identifier, the literal_table index of a literal,
+    // the char of a character literal, no_symbol for other tokens
+    symbol_id id() const { return sym; }
+
 private:
-    std::string sv;
-    token_position pos;
+    offset_t off;
+    std::uint32_t len;
+    symbol_id sym;
     token_type tok_type;
 };
 
+//-----------------------------------------------------------------------
+//
+//  token_stream: the tokens of a source as a struct of arrays.
+//  Type, offset, length, symbol id and flags live in separate contiguous
+//  arrays, so a parser that mostly looks at the type only walks 2 bytes
+//  per token.
+//  Elements are handed out by value as token. The decoded values of the
+//  literal tokens are kept in literals(), what was rejected while
+//  scanning in diags(), comments and blank lines in trivia() when they
+//  were asked for (trivia_mode::keep).
+//
+//-----------------------------------------------------------------------
+//
+class token_stream
+{
+public:
+    enum flag : std::uint8_t
+    {
+        none = 0,
+        line_start = 1 << 0, // first token on its line
+    };
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = token;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = token;
+
+        iterator() = default;
+        iterator(token_stream const* s, std::size_t i)
+            : ts{s}
+            , idx{i}
+        {
+        }
+
+        token operator*() const { return (*ts)[idx]; }
+        token operator[](difference_type n) const { return (*ts)[idx + static_cast<std::size_t>(n)]; }
+
+        iterator& operator++()
+        {
+            ++idx;
+            return *this;
+        }
+        iterator operator++(int)
+        {
+            auto it = *this;
+            ++idx;
+            return it;
+        }
+        iterator& operator--()
+        {
+            --idx;
+            return *this;
+        }
+        iterator operator--(int)
+        {
+            auto it = *this;
+            --idx;
+            return it;
+        }
+        iterator& operator+=(difference_type n)
+        {
+            idx += static_cast<std::size_t>(n);
+            return *this;
+        }
+        iterator& operator-=(difference_type n)
+        {
+            idx -= static_cast<std::size_t>(n);
+            return *this;
+        }
+        friend iterator operator+(iterator it, difference_type n) { return it += n; }
+        friend iterator operator+(difference_type n, iterator it) { return it += n; }
+        friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(iterator const& a, iterator const& b)
+        {
+            return static_cast<difference_type>(a.idx) - static_cast<difference_type>(b.idx);
+        }
+        bool operator==(iterator const& it) const { return idx == it.idx; }
+        auto operator<=>(iterator const& it) const { return idx <=> it.idx; }
+
+        std::size_t index() const { return idx; }
+
+    private:
+        token_stream const* ts = nullptr;
+        std::size_t idx = 0;
+    };
+
+    token_stream() = default;
+
+    // a guess of the token count of a source text, used to reserve
+    static std::size_t estimate(std::size_t source_size) { return source_size / 6 + 16; }
+
+    void reserve(std::size_t n)
+    {
+        tok_types.reserve(n);
+        tok_offsets.reserve(n);
+        tok_lengths.reserve(n);
+        tok_ids.reserve(n);
+        tok_flags.reserve(n);
+    }
+
+    void push_back(token_type type, offset_t offset, std::uint32_t length, std::uint8_t flags = none,
+                   symbol_id id = no_symbol)
+    {
+        tok_types.push_back(type);
+        tok_offsets.push_back(offset);
+        tok_lengths.push_back(length);
+        tok_ids.push_back(id);
+        tok_flags.push_back(flags);
+    }
+
+    void push_back(token const& tk, std::uint8_t flags = none)
+    {
+        push_back(tk.type(), tk.offset(), static_cast<std::uint32_t>(tk.length()), flags, tk.id());
+    }
+
+    // add all tokens, literal values, diagnostics and trivia of other behind the own ones
+    void append(token_stream const& other);
+
+    //  Replace tokens [first, last) by the tokens of other, ids taken as
+    //  they are, and move the offsets of the tokens behind them by shift,
+    //  after an edit of the text. Diagnostics and trivia are left alone.
+    //
+    void splice(std::size_t first, std::size_t last, token_stream const& other, std::int64_t shift);
+
+    //  Replace the tokens by the arrays given, all of one size, as read
+    //  back from the AST cache. Literals, diagnostics and trivia are left
+    //  alone.
+    //
+    void assign(std::span<const token_type> types, std::span<const offset_t> offsets,
+                std::span<const std::uint32_t> lengths, std::span<const symbol_id> ids,
+                std::span<const std::uint8_t> flags)
+    {
+        assert(offsets.size() == types.size() && lengths.size() == types.size() && ids.size() == types.size() &&
+               flags.size() == types.size());
+        tok_types.assign(types.begin(), types.end());
+        tok_offsets.assign(offsets.begin(), offsets.end());
+        tok_lengths.assign(lengths.begin(), lengths.end());
+        tok_ids.assign(ids.begin(), ids.end());
+        tok_flags.assign(flags.begin(), flags.end());
+    }
+
+    void clear()
+    {
+        tok_types.clear();
+        tok_offsets.clear();
+        tok_lengths.clear();
+        tok_ids.clear();
+        tok_flags.clear();
+        lits.clear();
+        issues.clear();
+        triv.clear();
+    }
+
+    std::size_t size() const { return tok_types.size(); }
+    bool empty() const { return tok_types.empty(); }
+
+    token operator[](std::size_t i) const { return {tok_offsets[i], tok_lengths[i], tok_types[i], tok_ids[i]}; }
+
+    token_type type(std::size_t i) const { return tok_types[i]; }
+    offset_t offset(std::size_t i) const { return tok_offsets[i]; }
+    std::uint32_t length(std::size_t i) const { return tok_lengths[i]; }
+    symbol_id id(std::size_t i) const { return tok_ids[i]; }
+    std::uint8_t flags(std::size_t i) const { return tok_flags[i]; }
+    void set_type(std::size_t i, token_type type) { tok_types[i] = type; }
+
+    //  direct access to the arrays
+    //
+    std::span<const token_type> types() const { return tok_types; }
+    std::span<const offset_t> offsets() const { return tok_offsets; }
+    std::span<const std::uint32_t> lengths() const { return tok_lengths; }
+    std::span<const symbol_id> ids() const { return tok_ids; }
+    std::span<const std::uint8_t> flags() const { return tok_flags; }
+
+    // values of the literal tokens, indexed by their id
+    literal_table& literals() { return lits; }
+    literal_table const& literals() const { return lits; }
+
+    // errors found while scanning, offsets are into the tokenized text
+    diagnostics& diags() { return issues; }
+    diagnostics const& diags() const { return issues; }
+
+    // comments and blank lines, keyed by the index of the token after them
+    trivia_table& trivia() { return triv; }
+    trivia_table const& trivia() const { return triv; }
+
+    iterator begin() const { return {this, 0}; }
+    iterator end() const { return {this, size()}; }
+
+private:
+    std::vector<token_type> tok_types{};
+    std::vector<offset_t> tok_offsets{};
+    std::vector<std::uint32_t> tok_lengths{};
+    std::vector<symbol_id> tok_ids{};
+    std::vector<std::uint8_t> tok_flags{};
+    literal_table lits{};
+    diagnostics issues{};
+    trivia_table triv{};
+};
+
+// result of scanning a single token, see scan_token
+struct scan_result
+{
+    token_type type;
+    std::size_t len;
+    std::uint32_t value = 0; // literal_table index of a literal
+};
+
+// chars scan_token may look at past the end of a token ("1.5", "1e+3", "12UX\"", "|->")
+inline constexpr std::size_t scan_lookahead = 3;
+
 token_type close_paren_type(token_type ttype);
-std::size_t get_name_len(const std::string& text);
-std::deque<token> tokenize_lines(sourceBuffer& sbfile);
+std::size_t get_name_len(std::string_view text);
+token_type keyword_lookup(std::string_view name, vhdl_std std = vhdl_std::v08, bool psl = false);
+token_type classify_name(std::string_view name);
+scan_result scan_token(std::string_view text, literal_table* literals = nullptr, token_type prev = token_type::Invalid);
+diag_code invalid_code(std::string_view text);
+token scan_next(std::string_view text, std::size_t& i, std::size_t end, std::uint8_t& flags, token_type& prev,
+                literal_table& literals, trivia_table* trivia = nullptr, std::uint32_t index = 0);
+void tokenize(std::string_view text, token_stream& tokens, unsigned threads = 1,
+              trivia_mode mode = trivia_mode::skip);
+token_stream tokenize_lines(sourceBuffer& sbfile, unsigned threads = 1, trivia_mode mode = trivia_mode::skip);
 
 std::string token_tostr(token_type token);
 
+// spelling of a delimiter or reserved word, <...> for the other types
+std::string_view token_spelling(token_type token);
+
 } // namespace vlark
 
 #endif // TOKEN_H
\ No newline at end of file
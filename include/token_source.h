@@ -0,0 +1,126 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Token source - lazy, pull based tokens with bounded lookahead
+//===========================================================================
+
+#include "token.h"
+#include <array>
+
+#ifndef TOKEN_SOURCE_H
+#define TOKEN_SOURCE_H
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//
+//  token_source: scans the tokens of a text on demand, the parser pulls
+//  them one by one with next() and looks ahead with peek(k).
+//  Only the lookahead window is kept, in a small ring buffer, so the
+//  first token is there right away and memory does not grow with the
+//  file (the literal values are the exception, they are kept for the
+//  AST).
+//  The tokens are the ones tokenize() gives, the end is an endless
+//  sequence of token_type::Eof.
+//
+//-----------------------------------------------------------------------
+//
+class token_source
+{
+public:
+    static constexpr std::size_t window = 16; // peek(k) is valid for k < window
+
+    explicit token_source(std::string_view source, trivia_mode mode = trivia_mode::skip)
+        : text{source}
+        , keep_trivia{mode == trivia_mode::keep}
+    {
+    }
+
+    // the k-th token ahead, peek(0) is the one next() returns
+    token peek(std::size_t k = 0)
+    {
+        assert(k < window);
+        fill(k + 1);
+        return ring[(head + k) & (window - 1)].tk;
+    }
+
+    // flags of peek(k), see token_stream::flag
+    std::uint8_t peek_flags(std::size_t k = 0)
+    {
+        assert(k < window);
+        fill(k + 1);
+        return ring[(head + k) & (window - 1)].flags;
+    }
+
+    // consume the next token
+    token next()
+    {
+        fill(1);
+        token tk = ring[head].tk;
+        if (tk.type() != token_type::Eof)
+        {
+            head = (head + 1) & (window - 1);
+            count--;
+        }
+        return tk;
+    }
+
+    bool at_end() { return peek().type() == token_type::Eof; }
+
+    std::string_view source() const { return text; }
+
+    // values of the literal tokens, indexed by their id
+    literal_table const& literals() const { return lits; }
+
+    // errors in the text scanned so far
+    diagnostics const& diags() const { return issues; }
+
+    //  comments and blank lines scanned so far, with trivia_mode::keep.
+    //  They are keyed by token number, the first token next() gives is 0.
+    //
+    trivia_table const& trivia() const { return triv; }
+
+    //  No copying, the tokens refer to literals
+    //
+    token_source(token_source const&) = delete;
+    token_source& operator=(token_source const&) = delete;
+
+private:
+    struct slot
+    {
+        token tk{0, 0, token_type::Eof};
+        std::uint8_t flags = token_stream::none;
+    };
+
+    static_assert((window & (window - 1)) == 0, "the ring index is masked");
+
+    void fill(std::size_t n);
+
+    std::string_view text;
+    std::size_t pos = 0;
+    std::uint8_t pending = token_stream::line_start; // flags for the next scanned token
+    token_type prev = token_type::Eof;               // the last scanned token
+    std::array<slot, window> ring{};
+    std::size_t head = 0;  // ring index of peek(0)
+    std::size_t count = 0; // scanned tokens not consumed yet
+    literal_table lits{};
+    diagnostics issues{};
+    trivia_table triv{};
+    bool keep_trivia;
+    std::uint32_t scanned = 0; // tokens scanned, the number of the next one
+};
+
+} // namespace vlark
+
+#endif // TOKEN_SOURCE_H
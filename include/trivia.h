@@ -0,0 +1,121 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Trivia - comments and blank lines kept beside the tokens
+//===========================================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#ifndef TRIVIA_H
+#define TRIVIA_H
+
+namespace vlark
+{
+
+//  skip: comments and white space are dropped, nothing is allocated
+//  keep: they are recorded in a trivia_table beside the tokens
+//
+enum class trivia_mode : std::uint8_t
+{
+    skip,
+    keep
+};
+
+enum class trivia_kind : std::uint8_t
+{
+    line_comment,  // -- up to the end of the line, without the newline
+    block_comment, // /* up to and with */
+    blank_lines    // whole lines of white space, with their newlines
+};
+
+//-----------------------------------------------------------------------
+//
+//  trivia_item: a comment or a run of blank lines in front of token number
+//  token (the token count for trivia after the last token).
+//
+//-----------------------------------------------------------------------
+//
+struct trivia_item
+{
+    std::uint32_t token;
+    std::uint32_t offset;
+    std::uint32_t length;
+    trivia_kind kind;
+};
+
+//-----------------------------------------------------------------------
+//
+//  trivia_table: the trivia of a token stream in source order, so a
+//  formatter or a doc extractor gets the comments back without the
+//  parser ever seeing them.
+//
+//-----------------------------------------------------------------------
+//
+class trivia_table
+{
+public:
+    //  Consecutive blank lines are one entry, also when they are added
+    //  in two parts
+    //
+    void add(std::uint32_t token, trivia_kind kind, std::uint32_t offset, std::size_t length)
+    {
+        if (kind == trivia_kind::blank_lines && !entries.empty())
+        {
+            auto& last = entries.back();
+            if (last.kind == trivia_kind::blank_lines && last.offset + last.length == offset)
+            {
+                last.length += static_cast<std::uint32_t>(length);
+                return;
+            }
+        }
+        entries.push_back({token, offset, static_cast<std::uint32_t>(length), kind});
+    }
+
+    // the trivia between token-1 and token
+    std::span<const trivia_item> before(std::uint32_t token) const
+    {
+        auto by_token = [](trivia_item const& t, std::uint32_t k) { return t.token < k; };
+        auto first = std::lower_bound(entries.begin(), entries.end(), token, by_token);
+        auto last = first;
+        while (last != entries.end() && last->token == token)
+        {
+            ++last;
+        }
+        return {first, last};
+    }
+
+    std::span<const trivia_item> all() const { return entries; }
+    std::size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    // add the trivia of other, its token numbers moved up by shift
+    void append(trivia_table const& other, std::uint32_t shift)
+    {
+        for (auto t : other.entries)
+        {
+            add(t.token + shift, t.kind, t.offset, t.length);
+        }
+    }
+
+    void clear() { entries.clear(); }
+
+private:
+    std::vector<trivia_item> entries{};
+};
+
+} // namespace vlark
+
+#endif // TRIVIA_H
@@ -0,0 +1,172 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Design unit parser - declarations, statements and library units
+//===========================================================================
+
+#include "expr_parser.h"
+#include "token_source.h"
+#include <utility>
+#include <vector>
+
+#ifndef UNIT_PARSER_H
+#define UNIT_PARSER_H
+
+namespace vlark
+{
+
+class work_pool;
+
+//  full: every declaration and statement becomes a node
+//  outline: design unit headers only, for dependency scanning. Names,
+//  generics and ports of entities and packages, architecture-of pairs
+//  and the context clauses are parsed in full; the declarations and
+//  statements of a unit are skipped but for use clauses and component
+//  instances, which end up flat in the unit's decls and stmts.
+//
+enum class parse_mode : std::uint8_t
+{
+    full,
+    outline
+};
+
+//-----------------------------------------------------------------------
+//
+//  unit_parser: recursive descent over the design units of a token
+//  range, the expressions are left to expr_parser.
+//  A construct it does not understand is reported and skipped up to
+//  the next ';', so one error costs one statement and not the file.
+//
+//-----------------------------------------------------------------------
+//
+class unit_parser : public expr_parser
+{
+public:
+    using expr_parser::expr_parser;
+
+    // all design units up to the end of the range, appended to units
+    void design_units(std::vector<ref<design_unit>>& units);
+
+    // one design unit with its context clause, empty at the end
+    ref<design_unit> unit();
+
+    void set_mode(parse_mode m) { detail = m; }
+
+    //  The items of one declaration or statement list up to the end of the
+    //  range, to parse part of a tree again. False when the list ends (at
+    //  begin, end, else ...) before the range does.
+    //
+    bool declaration_items(std::vector<ref<decl>>& items);
+    bool statement_items(bool sequential, std::vector<ref<stmt>>& items);
+
+private:
+    void context_items();
+    ref<design_unit> library_unit(design_unit u);
+
+    void interface_list(decl_kind kind);
+    void declarations();
+    bool declaration();
+    void use_clause();
+    void object_declaration(decl_kind kind);
+    void type_declaration();
+    ref<decl> subprogram();
+    ref<expr> subtype_indication();
+
+    void concurrent_statements();
+    ref<stmt> concurrent_statement();
+    ref<stmt> process_statement(stmt s);
+    ref<stmt> block_statement(stmt s);
+    ref<stmt> generate_statement(stmt s);
+    void generate_body(stmt& s);
+    ref<stmt> generate_else();
+    ref<stmt> chain(std::size_t mark);
+    ref<stmt> instance(stmt s);
+    ref<stmt> concurrent_assignment(stmt s);
+    ref<stmt> selected_assignment(stmt s);
+
+    void sequential_statements();
+    ref<stmt> sequential_statement();
+    ref<stmt> if_statement(stmt s);
+    ref<stmt> else_part();
+    ref<stmt> case_statement(stmt s);
+    ref<stmt> loop_statement(stmt s);
+    ref<stmt> assignment(stmt s);
+    ref<stmt> assertion(stmt s);
+
+    ref<expr> target();
+    ref<expr> waveform();
+    ref<expr> choices();
+    ref<expr> map_aspect(token_type keyword);
+    void delay_mechanism();
+    void conditional_waveforms(stmt& s);
+
+    bool too_deep(nesting const& level);
+    void skip_body();
+    void outline_instance();
+
+    // end [words] [name] ;
+    void end_of(std::initializer_list<token_type> words);
+    void semicolon();
+    void skip_statement();
+    bool accept(token_type type);
+    symbol_id identifier();
+
+    template <class T>
+    list<T> pop_list(std::vector<ref<T>>& stack, std::size_t mark)
+    {
+        auto l = tree.add_list<T>(std::span(stack).subspan(mark));
+        stack.resize(mark);
+        return l;
+    }
+
+    std::vector<ref<decl>> decl_stack{}; // open declaration lists
+    std::vector<ref<stmt>> stmt_stack{}; // open statement lists
+    std::vector<stmt> branches{};        // elsif and else branches of the open if chains
+    std::vector<std::pair<symbol_id, offset_t>> dotted{}; // parts of a component name and their '.'
+    parse_mode detail = parse_mode::full;
+};
+
+//  Token index of the start of every design unit: entity, architecture,
+//  package (body), configuration and context declarations that start a
+//  statement, moved back over the library, use and context clauses in
+//  front of them. The first entry is 0. A package declared inside a unit
+//  (VHDL-2008) looks like a unit of its own, the parse checks each cut.
+//
+std::vector<std::size_t> unit_starts(token_stream const& tokens);
+
+//  A parse of part of the stream into units (of tree) with the findings
+//  issues ends where a serial parse starts a unit too when its last unit
+//  came out without a finding: a cut inside a unit (at a package nested
+//  in an architecture, say) leaves the unit unfinished.
+//
+bool clean_end(ast const& tree, std::span<const ref<design_unit>> units, diagnostics const& issues);
+
+//  Parse the design units of tokens into one tree. With a pool of more
+//  than one thread the token stream is cut at unit_starts and the units
+//  are parsed on the pool, each in a tree of its own, which are merged
+//  in source order. A cut that lands inside a unit is found by the parse
+//  of the unit in front of it, the two are then parsed as one, so the
+//  result is the one of a serial parse.
+//
+ast parse_design_units(token_stream const& tokens, std::string_view text, diagnostics& errors,
+                       work_pool* pool = nullptr, parse_mode mode = parse_mode::full);
+
+//  Parse the design units the parser pulls from source, the tokens are
+//  scanned as it goes and only its lookahead is held. The scan errors
+//  come before the parse errors in errors, as with a token stream.
+//
+ast parse_design_units(token_source& source, diagnostics& errors, parse_mode mode = parse_mode::full);
+
+} // namespace vlark
+
+#endif // UNIT_PARSER_H
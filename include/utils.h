@@ -14,12 +14,15 @@
 // Common Utils used throughout the code
 //===========================================================================
 
+#include "simd.h"
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <cstdint>
 #include <deque>
 #include <iomanip>
 #include <iostream>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -33,9 +36,9 @@ namespace vlark
 
 struct source_line
 {
-    std::string text;
+    std::string_view text; // view into the sourceBuffer content, without the '\n'
 
-    enum class category
+    enum class category : std::uint8_t
     {
         empty,
         comment,      // --
@@ -55,12 +58,21 @@ struct source_line
     // ssize_t indent() const { return std::find_if_not(text.begin(), text.end(), &isspace) - text.begin(); }
 };
 
-using lineno_t = size_t;
-using colno_t = size_t;
+using lineno_t = std::uint32_t;
+using colno_t = std::uint32_t;
+using offset_t = std::uint32_t; // byte offset into the source file
 
+//-----------------------------------------------------------------------
+//
+//  token_position: line and column of a source offset. Tokens only keep
+//  the offset, the position is looked up on demand (see
+//  sourceBuffer::position_of).
+//
+//-----------------------------------------------------------------------
+//
 struct token_position
 {
-    lineno_t lineno; // offset into program source
+    lineno_t lineno; // line in the program source, starting at 1
     colno_t colno;   // offset into line column
 
     token_position(lineno_t l = 1, colno_t c = 1)
@@ -74,13 +86,57 @@ struct token_position
     auto to_string() const -> std::string { return "(" + std::to_string(lineno) + "," + std::to_string(colno) + ")"; }
 };
 
+//-----------------------------------------------------------------------
+//
+//  line_table: start offset and category of every line of a source text.
+//  Kept as two compact arrays, the line text is sliced out on demand.
+//
+//-----------------------------------------------------------------------
+//
+struct line_table
+{
+    std::vector<offset_t> starts;
+    std::vector<source_line::category> cats;
+
+    // text of line i without its '\n'
+    std::string_view line(std::string_view text, std::size_t i) const
+    {
+        std::size_t b = starts[i];
+        std::size_t e = i + 1 < starts.size() ? starts[i + 1] - 1 : text.size() - (text.ends_with('\n') ? 1 : 0);
+        return text.substr(b, e - b);
+    }
+};
+
+//  line (1 based) and column of offset, starts holds the start offset of
+//  every line in order - O(log n)
+inline token_position position_of(std::span<offset_t const> starts, offset_t offset)
+{
+    if (starts.empty())
+    {
+        return {1, offset};
+    }
+    auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+    auto idx = it == starts.begin() ? 0 : static_cast<std::size_t>(it - starts.begin()) - 1;
+    return {static_cast<lineno_t>(idx + 1), offset - starts[idx]};
+}
+
 bool is_empty_line(std::string_view line);
+void split_lines(std::string_view text, line_table& table, simd::isa level = simd::best());
+
+inline constexpr std::string_view vlark_version = "0.3.0";
 
 inline constexpr std::string_view help_string = R"(
 Usage: vlark [flags] <input>
     Flags:
-        -f,<file>:          specify the vhdl file you want to parse.
-        --print-ast:        print the AST before codegen, after transforms.
+        -f,<file>...:       specify the vhdl files you want to parse.
+        -j,<n>:             tokenize and parse with n threads, 0 for one per core (default 1).
+        --stdin:            tokenize vhdl source streamed from standard input.
+        --outline:          parse the design unit headers only, skip their bodies.
+        --order:            print the design units of the files in analysis order.
+        --print-ast:        print the AST of every file as JSON, one line each.
+        --pretty:           indent the printed JSON.
+        --cache <dir>:      keep the parsed files in dir and reuse them while they are unchanged.
+        --lsp:              serve the language server protocol on stdin and stdout.
         -h, --help:         print this help message.
         -v, --version:      print version and license information.
 )";
@@ -120,6 +176,50 @@ public:
                 gen_version();
                 return;
             }
+            else if (arg == "--stdin")
+            {
+                opt_stdin = true;
+            }
+            else if (arg == "--outline")
+            {
+                opt_outline = true;
+            }
+            else if (arg == "--order")
+            {
+                opt_order = true;
+            }
+            else if (arg == "--print-ast")
+            {
+                opt_print_ast = true;
+            }
+            else if (arg == "--pretty")
+            {
+                opt_pretty = true;
+            }
+            else if (arg == "--lsp")
+            {
+                opt_lsp = true;
+            }
+            else if (arg == "--cache")
+            {
+                if (opt.empty())
+                {
+                    std::cerr << "Error: --cache option requires a directory." << std::endl;
+                }
+                else
+                {
+                    opt_cache = opt[0];
+                }
+            }
+            else if (arg == "-j" || arg == "--jobs")
+            {
+                auto jobs = opt.empty() ? std::string_view{} : opt[0];
+                if (std::from_chars(jobs.data(), jobs.data() + jobs.size(), opt_jobs).ec != std::errc{})
+                {
+                    std::cerr << "Error: -j option requires a number of threads." << std::endl;
+                    opt_jobs = 1;
+                }
+            }
             else if (arg == "-f" || arg == "--file")
             {
                 // Check if the option has values
@@ -130,8 +230,8 @@ public:
                     return;
                 }
                 else
-                { // support multiple files later
-                    filename = opt[0];
+                {
+                    filenames.assign(opt.begin(), opt.end());
                 }
             }
             else
@@ -144,11 +244,20 @@ public:
     }
     bool opt_help = false;
     bool opt_version = false;
-
-    std::string_view geet_filename() const { return filename; }
+    bool opt_stdin = false;
+    bool opt_outline = false;
+    bool opt_order = false;
+    bool opt_print_ast = false;
+    bool opt_pretty = false;
+    bool opt_lsp = false;
+    unsigned opt_jobs = 1;
+    std::string opt_cache{};
+
+    std::string_view geet_filename() const { return filenames.empty() ? std::string_view{} : filenames[0]; }
+    std::vector<std::string> const& files() const { return filenames; }
 
 private:
-    std::string filename{};
+    std::vector<std::string> filenames{};
 
     std::vector<std::string_view> args; // Vector of string_view to store command-line arguments
     std::unordered_map<std::string_view, std::vector<std::string_view>> options;
@@ -197,7 +306,7 @@ private:
 
     void print_version()
     {
-        std::cout << "\nvlark version v0.3.0   Build ";
+        std::cout << "\nvlark version v" << vlark_version << "   Build ";
         gen_version();
 
         std::cout << "\nCopyright(c) Dennis Addo   All rights reserved\n"
@@ -211,40 +320,107 @@ private:
     CmdLine& operator=(const CmdLine&) = delete;
 };
 
+//
+//
+//-----------------------------------------------------------------------
+//
+//  mapped_file: read-only view over the complete content of a file.
+//  The file is mmap'ed where the platform supports it, otherwise it is
+//  read into memory once (buffered).
+//-----------------------------------------------------------------------
+//
+class mapped_file
+{
+public:
+    mapped_file() = default;
+    ~mapped_file() { close(); }
+
+    //  copy_on_write: the content can be changed through edit_view(), the
+    //  changes stay in this process
+    bool open(std::string const& path, bool use_mmap = true, bool copy_on_write = false);
+    void close();
+
+    std::string_view view() const { return {data, size}; }
+    std::span<char> edit_view() { return {data, size}; }
+
+    bool is_mapped() const { return mapped; }
+
+    //  No copying
+    //
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+    mapped_file(mapped_file&&) = delete;
+    mapped_file& operator=(mapped_file&&) = delete;
+
+private:
+    char* data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+    std::string buffered{}; // owns the content when not mapped
+};
+
 //
 //
 //-----------------------------------------------------------------------
 //
 //  sourceBuffer: Source_buffer is an in-memory of the complete source file.
-//  breaken down into lines
+//  breaken down into lines. Lines are views into the file content, so
+//  there is neither a copy per line nor a limit on the line length.
 //-----------------------------------------------------------------------
 //
 class sourceBuffer
 {
-    std::deque<source_line> lines{};
-    std::string filename;
+public:
+    enum class load_mode
+    {
+        mapped,  // mmap the file (default)
+        buffered // read the file into memory once
+    };
 
-    static const int max_line_len = 98'000;
+private:
+    line_table lines{};
+    std::string filename;
+    mapped_file content{};
+    bool loaded = false;
 
-    bool load(std::string const& filename);
+    bool load(std::string const& filename, load_mode mode);
 
 public:
     //-----------------------------------------------------------------------
     //  Constructor (maybe default will be better)
     //
     //
-    sourceBuffer(const std::string& file)
+    sourceBuffer(const std::string& file, load_mode mode = load_mode::mapped)
         : filename(file)
     {
-        load(filename);
+        loaded = load(filename, mode);
     }
 
-    std::deque<source_line>& get_lines() { return lines; }
+    // false when the file could not be read, the text is empty then
+    bool is_loaded() const { return loaded; }
+
+    std::size_t line_count() const { return lines.starts.size(); }
 
-    std::deque<source_line> const& get_lines() const { return lines; }
+    // line i (0 based) as a view without its '\n'
+    source_line get_line(std::size_t i) const { return {lines.line(text(), i), lines.cats[i]}; }
+
+    // start offset of every line, built once per file
+    std::vector<offset_t> const& line_starts() const { return lines.starts; }
+
+    // 0 based index of the line holding offset - O(log n)
+    std::size_t line_index(offset_t offset) const
+    {
+        auto it = std::upper_bound(lines.starts.begin(), lines.starts.end(), offset);
+        return it == lines.starts.begin() ? 0 : static_cast<std::size_t>(it - lines.starts.begin()) - 1;
+    }
+
+    token_position position_of(offset_t offset) const { return vlark::position_of(lines.starts, offset); }
 
     std::string_view get_fpath() const { return filename; }
 
+    // complete file content, all line views point into this
+    std::string_view text() const { return content.view(); }
+
     //  No copying
     //
     sourceBuffer(sourceBuffer const&) = delete;
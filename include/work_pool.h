@@ -0,0 +1,104 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Work pool - a fixed set of threads sharing tasks by work stealing
+//===========================================================================
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//
+//  work_pool: runs numbered tasks on its threads, the calling thread of
+//  run() being one of them. Every thread starts on a queue of its own
+//  holding a contiguous slice of the tasks, taken from the front in
+//  order; a thread out of work steals from the back of the others, so
+//  a few big tasks (a huge architecture between small entities) do not
+//  leave the other threads idle. A task may spawn() more tasks, which
+//  makes the pool run a task graph: a unit is queued by the last of
+//  the units it waits for.
+//  The threads stay for the life of the pool and sleep between runs.
+//
+//-----------------------------------------------------------------------
+//
+class work_pool
+{
+public:
+    // threads in all, 0 for one per core
+    explicit work_pool(unsigned nthreads = 0);
+    ~work_pool();
+
+    work_pool(work_pool const&) = delete;
+    work_pool& operator=(work_pool const&) = delete;
+
+    //  Call task(k) for every k < count and return when all are done,
+    //  task must not throw
+    //
+    void run(std::size_t count, std::function<void(std::size_t)> const& task);
+
+    //  Call task(k) for every k in first and for every task spawned by
+    //  them, return when all are done
+    //
+    void run(std::span<const std::size_t> first, std::function<void(std::size_t)> const& task);
+
+    //  Queue task k from a task of the running run(), in front of the
+    //  calling thread's queue, so it is taken next
+    //
+    void spawn(std::size_t task);
+
+    unsigned size() const { return static_cast<unsigned>(queues.size()); }
+
+    // tasks taken from another thread's queue so far
+    std::size_t steals() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct queue
+    {
+        std::mutex lock;
+        std::deque<std::size_t> tasks;
+    };
+
+    bool next(unsigned self, std::size_t& task);
+    void start();
+    void work(unsigned self);
+    void loop(std::stop_token stop, unsigned self);
+
+    std::vector<std::unique_ptr<queue>> queues{};
+    std::function<void(std::size_t)> const* job = nullptr;
+    std::mutex state;
+    std::condition_variable_any wake;
+    std::condition_variable done;
+    std::uint64_t round = 0;
+    std::atomic<std::size_t> left{0};
+    std::atomic<std::uint64_t> pushed{0}; // spawns so far, idle threads wait for a change
+    std::atomic<std::size_t> stolen{0};
+    std::vector<std::jthread> threads{}; // last, so they are joined first
+};
+
+} // namespace vlark
+
+#endif // WORK_POOL_H
@@ -0,0 +1,342 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+// AST base code
+//===========================================================================
+
+#include "ast.hpp"
+#include "work_pool.h"
+#include <algorithm>
+#include <cassert>
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//  grow: start a new block, a request bigger than a block gets a block
+//  of its own
+//
+void arena::grow(std::size_t size)
+{
+    std::size_t len = std::max(block_size, size);
+    blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(len));
+    pos = blocks.back().get();
+    left = len;
+    reserved += len;
+}
+
+ast ast::adopt(std::span<expr> e, std::span<decl> d, std::span<stmt> s, std::span<design_unit> u,
+                std::span<std::uint32_t> l, list<design_unit> root, std::vector<symbol_id> symbols,
+                std::shared_ptr<void> owner)
+{
+    ast tree;
+    tree.exprs.adopt(e);
+    tree.decls.adopt(d);
+    tree.stmts.adopt(s);
+    tree.units.adopt(u);
+    tree.lists.adopt(l);
+    tree.root = root;
+    tree.file_symbols = std::move(symbols);
+    tree.borrowed = std::move(owner);
+    return tree;
+}
+
+void ast::shift_offsets(offset_t from, std::int64_t shift)
+{
+    auto move = [from, shift](offset_t& at) {
+        if (at >= from)
+        {
+            at = static_cast<offset_t>(at + shift);
+        }
+    };
+    // an end is past the text it covers, text put in right there follows it
+    auto move_end = [from, shift](offset_t& at) {
+        if (at > from)
+        {
+            at = static_cast<offset_t>(at + shift);
+        }
+    };
+    for (std::uint32_t k = 1; k < exprs.size(); k++)
+    {
+        move(exprs[k].pos);
+    }
+    for (std::uint32_t k = 1; k < decls.size(); k++)
+    {
+        move(decls[k].pos);
+    }
+    for (std::uint32_t k = 1; k < stmts.size(); k++)
+    {
+        move(stmts[k].pos);
+    }
+    for (std::uint32_t k = 1; k < units.size(); k++)
+    {
+        move(units[k].pos);
+        move_end(units[k].end);
+    }
+}
+
+struct ast::bases
+{
+    std::uint32_t expr;
+    std::uint32_t decl;
+    std::uint32_t stmt;
+    std::uint32_t unit;
+    std::uint32_t list;
+    std::uint32_t lit;
+};
+
+//-----------------------------------------------------------------------
+//  merge: the pools of every part go behind the own ones (without their
+//  empty slot 0), so node k of a part becomes node base + k. As the
+//  bases are known up front, each part is copied into its own slice of
+//  the pools and the parts do not depend on each other.
+//
+std::vector<ref<design_unit>> ast::merge(std::span<const ast> parts, work_pool* pool)
+{
+    assert(!file_numbered());
+    auto size = [](auto const& p) { return static_cast<std::uint32_t>(p.size()); };
+    std::vector<bases> at;
+    bases next{size(exprs) - 1, size(decls) - 1, size(stmts) - 1, size(units) - 1, size(lists) - 1, size(lits)};
+    for (auto const& part : parts)
+    {
+        at.push_back(next);
+        next.expr += size(part.exprs) - 1;
+        next.decl += size(part.decls) - 1;
+        next.stmt += size(part.stmts) - 1;
+        next.unit += size(part.units) - 1;
+        next.list += size(part.lists) - 1;
+        next.lit += size(part.lits);
+        lits.append(part.lits);
+    }
+    exprs.extend(mem, next.expr + 1 - exprs.size());
+    decls.extend(mem, next.decl + 1 - decls.size());
+    stmts.extend(mem, next.stmt + 1 - stmts.size());
+    units.extend(mem, next.unit + 1 - units.size());
+    lists.extend(mem, next.list + 1 - lists.size());
+
+    if (pool != nullptr && parts.size() > 1)
+    {
+        pool->run(parts.size(), [&](std::size_t k) { relocate(parts[k], at[k]); });
+    }
+    else
+    {
+        for (std::size_t k = 0; k < parts.size(); k++)
+        {
+            relocate(parts[k], at[k]);
+        }
+    }
+
+    std::vector<ref<design_unit>> moved;
+    for (std::size_t k = 0; k < parts.size(); k++)
+    {
+        for (auto u : parts[k].design_units())
+        {
+            moved.push_back({u.index + at[k].unit});
+        }
+    }
+    return moved;
+}
+
+//  relocate: copy other to its slice. Lists are copied as they are, their
+//  items are moved when the one node holding the list is, as only the
+//  node knows the item type.
+//
+void ast::relocate(ast const& other, bases const& at)
+{
+    struct shift
+    {
+        std::uint32_t by;
+        std::uint32_t operator()(std::uint32_t index) const { return index == 0 ? 0 : index + by; }
+    };
+    const shift to_expr{at.expr}, to_decl{at.decl}, to_stmt{at.stmt}, to_list{at.list};
+
+    auto from_lists = other.lists.all();
+    for (std::uint32_t k = 1; k < from_lists.size(); k++)
+    {
+        lists[at.list + k] = from_lists[k];
+    }
+    auto move_items = [&](std::uint32_t to, shift by) {
+        if (to != 0)
+        {
+            for (std::uint32_t k = 1; k <= lists[to]; k++)
+            {
+                lists[to + k] = by(lists[to + k]);
+            }
+        }
+        return to;
+    };
+    auto move_list = [&](auto l, shift by) { return decltype(l){move_items(to_list(l.at), by)}; };
+
+    auto from_exprs = other.exprs.all();
+    for (std::uint32_t k = 1; k < from_exprs.size(); k++)
+    {
+        auto e = from_exprs[k];
+        switch (e.kind)
+        {
+        case expr_kind::integer:
+        case expr_kind::real:
+        case expr_kind::string:
+        case expr_kind::bit_string: e.a += at.lit; break;
+        case expr_kind::physical:
+        case expr_kind::unary:
+        case expr_kind::select:
+        case expr_kind::attribute: e.a = to_expr(e.a); break;
+        case expr_kind::binary:
+        case expr_kind::qualified:
+        case expr_kind::association:
+        case expr_kind::range:
+        case expr_kind::constraint:
+            e.a = to_expr(e.a);
+            e.b = to_expr(e.b);
+            break;
+        case expr_kind::call:
+            e.a = to_expr(e.a);
+            e.b = move_list(e.items(), to_expr).at;
+            break;
+        case expr_kind::aggregate: e.b = move_list(e.items(), to_expr).at; break;
+        default: break;
+        }
+        exprs[at.expr + k] = e;
+    }
+
+    auto from_decls = other.decls.all();
+    for (std::uint32_t k = 1; k < from_decls.size(); k++)
+    {
+        auto d = from_decls[k];
+        d.type = {to_expr(d.type.index)};
+        d.init = {to_expr(d.init.index)};
+        d.children = move_list(d.children, to_decl);
+        d.body = {to_stmt(d.body.index)};
+        decls[at.decl + k] = d;
+    }
+
+    auto from_stmts = other.stmts.all();
+    for (std::uint32_t k = 1; k < from_stmts.size(); k++)
+    {
+        auto s = from_stmts[k];
+        s.target = {to_expr(s.target.index)};
+        s.cond = {to_expr(s.cond.index)};
+        s.value = {to_expr(s.value.index)};
+        s.body = move_list(s.body, to_stmt);
+        s.decls = move_list(s.decls, to_decl);
+        s.alt = {to_stmt(s.alt.index)};
+        stmts[at.stmt + k] = s;
+    }
+
+    auto from_units = other.units.all();
+    for (std::uint32_t k = 1; k < from_units.size(); k++)
+    {
+        auto u = from_units[k];
+        u.context = move_list(u.context, to_decl);
+        u.decls = move_list(u.decls, to_decl);
+        u.stmts = move_list(u.stmts, to_stmt);
+        units[at.unit + k] = u;
+    }
+}
+
+std::string_view kind_name(expr_kind kind)
+{
+    switch (kind)
+    {
+    case expr_kind::name: return "name";
+    case expr_kind::character: return "character";
+    case expr_kind::integer: return "integer";
+    case expr_kind::real: return "real";
+    case expr_kind::string: return "string";
+    case expr_kind::bit_string: return "bit_string";
+    case expr_kind::physical: return "physical";
+    case expr_kind::null: return "null";
+    case expr_kind::others: return "others";
+    case expr_kind::open: return "open";
+    case expr_kind::unary: return "unary";
+    case expr_kind::binary: return "binary";
+    case expr_kind::call: return "call";
+    case expr_kind::select: return "select";
+    case expr_kind::attribute: return "attribute";
+    case expr_kind::qualified: return "qualified";
+    case expr_kind::aggregate: return "aggregate";
+    case expr_kind::association: return "association";
+    case expr_kind::range: return "range";
+    case expr_kind::constraint: return "constraint";
+    }
+    return "unknown";
+}
+
+std::string_view kind_name(decl_kind kind)
+{
+    switch (kind)
+    {
+    case decl_kind::library: return "library";
+    case decl_kind::use: return "use";
+    case decl_kind::generic: return "generic";
+    case decl_kind::port: return "port";
+    case decl_kind::parameter: return "parameter";
+    case decl_kind::signal: return "signal";
+    case decl_kind::constant: return "constant";
+    case decl_kind::variable: return "variable";
+    case decl_kind::shared_variable: return "shared_variable";
+    case decl_kind::file: return "file";
+    case decl_kind::type: return "type";
+    case decl_kind::subtype: return "subtype";
+    case decl_kind::component: return "component";
+    case decl_kind::function: return "function";
+    case decl_kind::procedure: return "procedure";
+    case decl_kind::alias: return "alias";
+    case decl_kind::attribute: return "attribute";
+    case decl_kind::element: return "element";
+    case decl_kind::package: return "package";
+    }
+    return "unknown";
+}
+
+std::string_view kind_name(stmt_kind kind)
+{
+    switch (kind)
+    {
+    case stmt_kind::process: return "process";
+    case stmt_kind::signal_assign: return "signal_assign";
+    case stmt_kind::variable_assign: return "variable_assign";
+    case stmt_kind::instance: return "instance";
+    case stmt_kind::block: return "block";
+    case stmt_kind::generate: return "generate";
+    case stmt_kind::if_: return "if";
+    case stmt_kind::case_: return "case";
+    case stmt_kind::when: return "when";
+    case stmt_kind::loop: return "loop";
+    case stmt_kind::wait: return "wait";
+    case stmt_kind::assert: return "assert";
+    case stmt_kind::report: return "report";
+    case stmt_kind::call: return "call";
+    case stmt_kind::return_: return "return";
+    case stmt_kind::exit: return "exit";
+    case stmt_kind::next: return "next";
+    case stmt_kind::null: return "null";
+    }
+    return "unknown";
+}
+
+std::string_view kind_name(unit_kind kind)
+{
+    switch (kind)
+    {
+    case unit_kind::entity: return "entity";
+    case unit_kind::architecture: return "architecture";
+    case unit_kind::package: return "package";
+    case unit_kind::package_body: return "package_body";
+    case unit_kind::configuration: return "configuration";
+    case unit_kind::context: return "context";
+    }
+    return "unknown";
+}
+
+} // namespace vlark
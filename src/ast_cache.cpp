@@ -0,0 +1,469 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  AST cache - parsed files kept on disk, keyed by their content
+//===========================================================================
+
+#include "ast_cache.h"
+#include "utils.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vlark
+{
+
+namespace
+{
+
+constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87;
+constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4F;
+constexpr std::uint64_t prime3 = 0x165667B19E3779F9;
+constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63;
+constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5;
+
+std::uint64_t read64(char const* p)
+{
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+std::uint32_t read32(char const* p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+std::uint64_t xxh_round(std::uint64_t acc, std::uint64_t input)
+{
+    acc += input * prime2;
+    return std::rotl(acc, 31) * prime1;
+}
+
+std::uint64_t xxh_merge(std::uint64_t h, std::uint64_t acc)
+{
+    h ^= xxh_round(0, acc);
+    return h * prime1 + prime4;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  content_hash: four lanes over 32 byte stripes, then the tail and the
+//  avalanche, as in the XXH64 reference
+//
+std::uint64_t content_hash(std::string_view data, std::uint64_t seed)
+{
+    char const* p = data.data();
+    char const* end = p + data.size();
+    std::uint64_t h;
+    if (data.size() >= 32)
+    {
+        std::uint64_t v1 = seed + prime1 + prime2;
+        std::uint64_t v2 = seed + prime2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - prime1;
+        for (; end - p >= 32; p += 32)
+        {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+        }
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    }
+    else
+    {
+        h = seed + prime5;
+    }
+
+    h += data.size();
+    for (; end - p >= 8; p += 8)
+    {
+        h ^= xxh_round(0, read64(p));
+        h = std::rotl(h, 27) * prime1 + prime4;
+    }
+    if (end - p >= 4)
+    {
+        h ^= std::uint64_t{read32(p)} * prime1;
+        h = std::rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p != end; p++)
+    {
+        h ^= std::uint64_t{static_cast<unsigned char>(*p)} * prime5;
+        h = std::rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+namespace
+{
+
+constexpr char cache_magic[8] = {'v', 'l', 'a', 'r', 'k', 'a', 's', 't'};
+constexpr std::uint32_t cache_format = 4; // bump when the layout below changes
+
+// sizes of the node types, a changed node struct makes every file a miss
+constexpr std::uint32_t node_sizes =
+    sizeof(expr) | sizeof(decl) << 8 | sizeof(stmt) << 16 | sizeof(design_unit) << 24;
+
+struct extent
+{
+    std::uint64_t at;    // offset in the file, aligned to 8
+    std::uint64_t count; // items
+};
+
+struct header
+{
+    char magic[8];
+    std::uint32_t format;
+    std::uint32_t mode;
+    char version[16];
+    std::uint32_t sizes;
+    std::uint32_t root;
+    std::uint64_t hash;
+    std::uint64_t text_size;
+    extent exprs, decls, stmts, units, lists;
+    extent literals, literal_chars;
+    extent symbol_starts, symbol_chars; // name k is symbol_chars[starts[k], starts[k + 1])
+    extent diags;
+    extent token_types, token_offsets, token_lengths, token_ids, token_flags;
+    extent token_literals, token_literal_chars, token_diags;
+    std::uint64_t check; // image_hash of the file
+};
+
+//  hash of the whole file but the check field, the sections are only
+//  bounds checked, so a damaged body must not get past the header
+//
+std::uint64_t image_hash(std::string_view image)
+{
+    constexpr auto check_at = offsetof(header, check);
+    return content_hash(image.substr(sizeof(header)), content_hash(image.substr(0, check_at)));
+}
+
+header key_of(std::string_view text, parse_mode mode)
+{
+    header h{};
+    std::memcpy(h.magic, cache_magic, sizeof(h.magic));
+    h.format = cache_format;
+    h.mode = static_cast<std::uint32_t>(mode);
+    std::memcpy(h.version, vlark_version.data(), std::min(vlark_version.size(), sizeof(h.version)));
+    h.sizes = node_sizes;
+    h.hash = content_hash(text, h.mode);
+    h.text_size = text.size();
+    return h;
+}
+
+bool same_key(header const& a, header const& b)
+{
+    return std::memcmp(a.magic, b.magic, sizeof(a.magic)) == 0 && a.format == b.format && a.mode == b.mode &&
+           std::memcmp(a.version, b.version, sizeof(a.version)) == 0 && a.sizes == b.sizes && a.hash == b.hash &&
+           a.text_size == b.text_size;
+}
+
+//  f(id) for every symbol field of the nodes
+//
+template <class F>
+void each_symbol(std::span<expr> exprs, std::span<decl> decls, std::span<stmt> stmts, std::span<design_unit> units,
+                 F const& f)
+{
+    for (auto& e : exprs)
+    {
+        switch (e.kind)
+        {
+        case expr_kind::name: f(e.a); break;
+        case expr_kind::physical:
+        case expr_kind::select:
+        case expr_kind::attribute: f(e.b); break;
+        default: break;
+        }
+    }
+    for (auto& d : decls)
+    {
+        f(d.name);
+    }
+    for (auto& s : stmts)
+    {
+        f(s.label);
+    }
+    for (auto& u : units)
+    {
+        f(u.name);
+        f(u.of);
+    }
+}
+
+//  the cache file in memory, sections appended at 8 byte boundaries
+//
+class image_writer
+{
+public:
+    image_writer() { bytes.resize(sizeof(header)); }
+
+    template <class T>
+    extent add(std::span<const T> items)
+    {
+        bytes.resize((bytes.size() + 7) & ~std::size_t{7});
+        extent e{bytes.size(), items.size()};
+        bytes.append(reinterpret_cast<char const*>(items.data()), items.size_bytes());
+        return e;
+    }
+
+    std::string bytes{};
+};
+
+//  items of section e, none when it is not inside the file
+//
+template <class T>
+std::optional<std::span<T>> section(std::span<char> file, extent e)
+{
+    if (e.at % alignof(T) != 0 || e.at > file.size() || e.count > (file.size() - e.at) / sizeof(T))
+    {
+        return std::nullopt;
+    }
+    return std::span<T>{reinterpret_cast<T*>(file.data() + e.at), e.count};
+}
+
+} // namespace
+
+std::string ast_cache::path_of(std::string_view text, parse_mode mode) const
+{
+    char name[24];
+    char* end = std::to_chars(name, name + 16, content_hash(text, static_cast<std::uint64_t>(mode)), 16).ptr;
+    std::memcpy(end, ".ast", 4);
+    return (std::filesystem::path{dir} / std::string_view{name, static_cast<std::size_t>(end + 4 - name)}).string();
+}
+
+//-----------------------------------------------------------------------
+//  store: copies of the nodes and of the token ids with the symbols
+//  numbered by first use, as the file is read by another process whose
+//  ids differ
+//
+bool ast_cache::store(std::string_view text, parse_mode mode, ast const& tree, token_stream const& tokens,
+                      diagnostics const& diags) const
+{
+    if (diags.dropped() != 0 || tokens.diags().dropped() != 0)
+    {
+        return false;
+    }
+
+    auto all = tree.arrays();
+    std::vector<expr> exprs(all.exprs.begin(), all.exprs.end());
+    std::vector<decl> decls(all.decls.begin(), all.decls.end());
+    std::vector<stmt> stmts(all.stmts.begin(), all.stmts.end());
+    std::vector<design_unit> units(all.units.begin(), all.units.end());
+
+    std::unordered_map<symbol_id, std::uint32_t> local;
+    std::vector<symbol_id> used{no_symbol};
+    auto number = [&](symbol_id& id) {
+        id = tree.symbol(id);
+        if (id != no_symbol)
+        {
+            auto [it, added] = local.try_emplace(id, static_cast<std::uint32_t>(used.size()));
+            if (added)
+            {
+                used.push_back(id);
+            }
+            id = it->second;
+        }
+    };
+    each_symbol(std::span(exprs), std::span(decls), std::span(stmts), std::span(units), number);
+    std::vector<symbol_id> token_ids(tokens.ids().begin(), tokens.ids().end());
+    for (std::size_t k = 0; k < token_ids.size(); k++)
+    {
+        if (tokens.type(k) == token_type::Identifier)
+        {
+            number(token_ids[k]);
+        }
+    }
+    std::vector<std::uint32_t> starts{0};
+    std::string names;
+    for (auto id : used)
+    {
+        names += symbol_table::global().name(id);
+        starts.push_back(static_cast<std::uint32_t>(names.size()));
+    }
+
+    image_writer out;
+    header h = key_of(text, mode);
+    h.root = all.root.at;
+    h.exprs = out.add(std::span<const expr>(exprs));
+    h.decls = out.add(std::span<const decl>(decls));
+    h.stmts = out.add(std::span<const stmt>(stmts));
+    h.units = out.add(std::span<const design_unit>(units));
+    h.lists = out.add(all.lists);
+    h.literals = out.add(tree.literals().all_values());
+    h.literal_chars = out.add(std::span(tree.literals().all_chars()));
+    h.symbol_starts = out.add(std::span<const std::uint32_t>(starts));
+    h.symbol_chars = out.add(std::span<const char>(names));
+    h.diags = out.add(diags.kept());
+    h.token_types = out.add(tokens.types());
+    h.token_offsets = out.add(tokens.offsets());
+    h.token_lengths = out.add(tokens.lengths());
+    h.token_ids = out.add(std::span<const symbol_id>(token_ids));
+    h.token_flags = out.add(tokens.flags());
+    h.token_literals = out.add(tokens.literals().all_values());
+    h.token_literal_chars = out.add(std::span(tokens.literals().all_chars()));
+    h.token_diags = out.add(tokens.diags().kept());
+    std::memcpy(out.bytes.data(), &h, sizeof(h));
+    h.check = image_hash(out.bytes);
+    std::memcpy(out.bytes.data(), &h, sizeof(h));
+
+    //  a name no other writer uses, then one rename
+    //
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    auto path = path_of(text, mode);
+    auto unique = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                  static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    auto temp = path + "." + std::to_string(unique) + ".tmp";
+    bool written = false;
+    {
+        std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+        written = file && file.write(out.bytes.data(), static_cast<std::streamsize>(out.bytes.size())) && file.flush();
+    }
+    if (written)
+    {
+        std::filesystem::rename(temp, path, ec);
+        written = !ec;
+    }
+    if (!written)
+    {
+        std::filesystem::remove(temp, ec);
+    }
+    return written;
+}
+
+//-----------------------------------------------------------------------
+//  load: check the header, the hash of the file and that every section is
+//  inside the file, intern the names, then hand the pools to the tree as they are. The
+//  nodes keep the symbol numbers of the file, the tree maps them (see
+//  ast::symbol), so nothing in the mapping is written and its pages stay
+//  shared with the page cache. Only the tokens asked for are copied out,
+//  with the identifier ids mapped on the way.
+//
+std::optional<ast> ast_cache::load(std::string_view text, parse_mode mode, diagnostics& diags,
+                                   token_stream* tokens) const
+{
+    auto file = std::make_shared<mapped_file>();
+    if (!file->open(path_of(text, mode), true, true))
+    {
+        return std::nullopt;
+    }
+    auto bytes = file->edit_view();
+    header h;
+    if (bytes.size() < sizeof(h))
+    {
+        return std::nullopt;
+    }
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    if (!same_key(h, key_of(text, mode)) || h.check != image_hash({bytes.data(), bytes.size()}))
+    {
+        return std::nullopt;
+    }
+
+    auto exprs = section<expr>(bytes, h.exprs);
+    auto decls = section<decl>(bytes, h.decls);
+    auto stmts = section<stmt>(bytes, h.stmts);
+    auto units = section<design_unit>(bytes, h.units);
+    auto lists = section<std::uint32_t>(bytes, h.lists);
+    auto literals = section<literal_table::value const>(bytes, h.literals);
+    auto literal_chars = section<char const>(bytes, h.literal_chars);
+    auto starts = section<std::uint32_t const>(bytes, h.symbol_starts);
+    auto names = section<char const>(bytes, h.symbol_chars);
+    auto kept = section<diagnostic const>(bytes, h.diags);
+    if (!exprs || !decls || !stmts || !units || !lists || !literals || !literal_chars || !starts || !names || !kept ||
+        exprs->empty() || decls->empty() || stmts->empty() || units->empty() || lists->empty() ||
+        h.root >= lists->size() || starts->size() < 2 || starts->back() > names->size() ||
+        !std::is_sorted(starts->begin(), starts->end()))
+    {
+        return std::nullopt;
+    }
+
+    std::vector<symbol_id> ids(starts->size() - 1, no_symbol);
+    for (std::size_t k = 1; k < ids.size(); k++)
+    {
+        auto name = std::string_view{names->data() + (*starts)[k], (*starts)[k + 1] - (*starts)[k]};
+        ids[k] = symbol_table::global().intern(name, false);
+    }
+
+    if (tokens != nullptr)
+    {
+        auto types = section<token_type const>(bytes, h.token_types);
+        auto offsets = section<offset_t const>(bytes, h.token_offsets);
+        auto lengths = section<std::uint32_t const>(bytes, h.token_lengths);
+        auto token_ids = section<symbol_id const>(bytes, h.token_ids);
+        auto flags = section<std::uint8_t const>(bytes, h.token_flags);
+        auto token_literals = section<literal_table::value const>(bytes, h.token_literals);
+        auto token_literal_chars = section<char const>(bytes, h.token_literal_chars);
+        auto token_kept = section<diagnostic const>(bytes, h.token_diags);
+        if (!types || !offsets || !lengths || !token_ids || !flags || !token_literals || !token_literal_chars ||
+            !token_kept || offsets->size() != types->size() || lengths->size() != types->size() ||
+            token_ids->size() != types->size() || flags->size() != types->size())
+        {
+            return std::nullopt;
+        }
+        std::vector<symbol_id> mapped(token_ids->begin(), token_ids->end());
+        for (std::size_t k = 0; k < mapped.size(); k++)
+        {
+            if ((*types)[k] == token_type::Identifier)
+            {
+                if (mapped[k] >= ids.size())
+                {
+                    return std::nullopt;
+                }
+                mapped[k] = ids[mapped[k]];
+            }
+        }
+        tokens->clear();
+        tokens->assign(*types, *offsets, *lengths, mapped, *flags);
+        tokens->literals().assign(*token_literals, {token_literal_chars->data(), token_literal_chars->size()});
+        for (auto const& d : *token_kept)
+        {
+            tokens->diags().report(d.sev, d.code, d.offset, d.length);
+        }
+    }
+
+    auto tree = ast::adopt(*exprs, *decls, *stmts, *units, *lists, list<design_unit>{h.root}, std::move(ids),
+                           std::move(file));
+    tree.literals().assign(*literals, {literal_chars->data(), literal_chars->size()});
+    for (auto const& d : *kept)
+    {
+        diags.report(d.sev, d.code, d.offset, d.length);
+    }
+    return tree;
+}
+
+} // namespace vlark
@@ -0,0 +1,123 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Diagnostics - collected while scanning, rendered once at the end
+//===========================================================================
+
+#include "diagnostics.h"
+#include "utils.h"
+#include <algorithm>
+#include <string>
+
+namespace vlark
+{
+
+std::string_view diag_message(diag_code code)
+{
+    switch (code)
+    {
+    case diag_code::unknown_char: return "unknown character";
+    case diag_code::invalid_name: return "invalid identifier";
+    case diag_code::invalid_literal: return "invalid abstract literal";
+    case diag_code::invalid_bit_string: return "invalid bit string literal";
+    case diag_code::unterminated_comment: return "block comment not closed";
+    case diag_code::empty_source: return "empty source file";
+    case diag_code::unterminated_string: return "string literal not closed";
+    case diag_code::invalid_extended_name: return "invalid extended identifier";
+    case diag_code::expected_expression: return "expression expected";
+    case diag_code::expected_name: return "name expected";
+    case diag_code::expected_right_paren: return "')' expected";
+    case diag_code::needs_parentheses: return "these operators need parentheses";
+    case diag_code::misplaced_sign: return "a sign is only allowed at the start of a simple expression";
+    case diag_code::expected_semicolon: return "expected ';'";
+    case diag_code::expected_colon: return "expected ':'";
+    case diag_code::expected_keyword: return "expected a reserved word here";
+    case diag_code::expected_design_unit: return "expected entity, architecture, package, configuration or context";
+    case diag_code::expected_declaration: return "expected a declaration";
+    case diag_code::expected_statement: return "expected a statement";
+    case diag_code::cannot_read: return "cannot read the file";
+    case diag_code::duplicate_unit: return "a design unit of this name is already in the project";
+    case diag_code::dependency_cycle: return "design unit depends on itself through the units it uses";
+    case diag_code::token_too_long: return "token too long, skipped to the end of the line";
+    case diag_code::nesting_too_deep: return "nested too deep, skipped";
+    }
+    return "unknown diagnostic";
+}
+
+std::string_view severity_name(severity sev)
+{
+    switch (sev)
+    {
+    case severity::note: return "note";
+    case severity::warning: return "warning";
+    case severity::error: return "error";
+    }
+    return "unknown";
+}
+
+//-----------------------------------------------------------------------
+//  render: the line starts of the source are found once, in one vector
+//  pass, then each diagnostic is placed with a binary search.
+//
+void diagnostics::render(std::ostream& out, std::string_view source, std::string_view name) const
+{
+    std::vector<offset_t> starts;
+    if (!source.empty() && !entries.empty())
+    {
+        starts.push_back(0);
+        simd::find_newlines(source, starts);
+    }
+
+    std::string rendered;
+    for (auto const& d : entries)
+    {
+        rendered.clear();
+        if (!name.empty())
+        {
+            rendered += name;
+            rendered += ':';
+        }
+
+        if (!source.empty() && d.offset <= source.size())
+        {
+            auto pos = position_of(starts, static_cast<offset_t>(d.offset));
+            rendered += std::to_string(pos.lineno) + ':' + std::to_string(pos.colno + 1) + ": ";
+        }
+        else
+        {
+            rendered += "offset " + std::to_string(d.offset) + ": ";
+        }
+
+        rendered += severity_name(d.sev);
+        rendered += ": ";
+        rendered += diag_message(d.code);
+
+        //  the offending text, up to the end of its line
+        //
+        if (d.length != 0 && d.offset < source.size())
+        {
+            auto text = source.substr(d.offset, std::min<std::size_t>(d.length, 80));
+            rendered += ": ";
+            rendered += text.substr(0, text.find('\n'));
+        }
+        rendered += '\n';
+        out << rendered;
+    }
+
+    if (dropped() != 0)
+    {
+        out << dropped() << " more diagnostics not shown\n";
+    }
+}
+
+} // namespace vlark
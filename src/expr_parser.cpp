@@ -0,0 +1,446 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Expression parser - precedence climbing over the token stream
+//===========================================================================
+
+#include "expr_parser.h"
+#include <array>
+
+namespace vlark
+{
+
+namespace
+{
+
+//-----------------------------------------------------------------------
+//
+//  Operator table, indexed by token_type.
+//  grouping tells what may follow an operator at its own level without
+//  parentheses: a + b - c (any), a and b and c but not a and b or c
+//  (same), nothing after a nand b, a = b or a sll b (none).
+//
+//-----------------------------------------------------------------------
+//
+enum class grouping : std::uint8_t
+{
+    any,
+    same,
+    none
+};
+
+struct binary_op
+{
+    std::uint8_t prec = 0;
+    grouping group = grouping::any;
+};
+
+constexpr unsigned logical_prec = 1;
+constexpr unsigned relational_prec = 2;
+constexpr unsigned shift_prec = 3;
+constexpr unsigned adding_prec = 4;
+constexpr unsigned multiplying_prec = 5;
+constexpr unsigned power_prec = 6;
+
+constexpr std::size_t type_count = static_cast<std::size_t>(token_type::Onehot0) + 1;
+
+constexpr std::size_t index_of(token_type type)
+{
+    return static_cast<std::size_t>(type);
+}
+
+constexpr auto binary_ops = [] {
+    std::array<binary_op, type_count> ops{};
+    auto set = [&ops](std::initializer_list<token_type> types, unsigned prec, grouping group) {
+        for (auto t : types)
+        {
+            ops[index_of(t)] = {static_cast<std::uint8_t>(prec), group};
+        }
+    };
+    using tt = token_type;
+    set({tt::And, tt::Or, tt::Xor, tt::Xnor}, logical_prec, grouping::same);
+    set({tt::Nand, tt::Nor}, logical_prec, grouping::none);
+    set({tt::Equal, tt::Not_Equal, tt::Less, tt::Less_Equal, tt::Greater, tt::Greater_Equal, tt::Match_Equal,
+         tt::Match_Not_Equal, tt::Match_Less, tt::Match_Less_Equal, tt::Match_Greater, tt::Match_Greater_Equal},
+        relational_prec, grouping::none);
+    set({tt::Sll, tt::Srl, tt::Sla, tt::Sra, tt::Rol, tt::Ror}, shift_prec, grouping::none);
+    set({tt::Plus, tt::Minus, tt::Ampersand}, adding_prec, grouping::any);
+    set({tt::Star, tt::Slash, tt::Mod, tt::Rem}, multiplying_prec, grouping::any);
+    set({tt::Double_Star}, power_prec, grouping::none);
+    return ops;
+}();
+
+static_assert(binary_ops[index_of(token_type::Star)].prec > binary_ops[index_of(token_type::Plus)].prec);
+static_assert(binary_ops[index_of(token_type::Identifier)].prec == 0);
+
+} // namespace
+
+unsigned binary_precedence(token_type type)
+{
+    return binary_ops[index_of(type)].prec;
+}
+
+void expr_parser::error(diag_code code)
+{
+    diags.report(severity::error, code, offset(), peek() != token_type::Eof ? at(i).length() : 0);
+}
+
+bool expr_parser::expect(token_type type, diag_code code)
+{
+    if (peek() == type)
+    {
+        i++;
+        return true;
+    }
+    error(code);
+    return false;
+}
+
+void expr_parser::skip_parens()
+{
+    std::size_t depth = 0;
+    do
+    {
+        switch (peek())
+        {
+        case token_type::Left_Paren: depth++; break;
+        case token_type::Right_Paren: depth--; break;
+        case token_type::Eof: return;
+        default: break;
+        }
+        i++;
+    } while (depth != 0);
+}
+
+ref<expr> expr_parser::expression()
+{
+    return climb(logical_prec);
+}
+
+//-----------------------------------------------------------------------
+//  climb: the operand and all binary operators binding at least as
+//  strong as min_prec. The right operand of an operator only takes
+//  stronger operators, so every level is left associative.
+//
+ref<expr> expr_parser::climb(unsigned min_prec)
+{
+    ref<expr> lhs = unary(min_prec);
+    for (;;)
+    {
+        token_type op = peek();
+        auto info = binary_ops[index_of(op)];
+        if (info.prec == 0 || info.prec < min_prec)
+        {
+            return lhs;
+        }
+
+        offset_t pos = offset();
+        i++;
+        ref<expr> rhs = climb(info.prec + 1u);
+        lhs = add(expr_kind::binary, op, pos, lhs.index, rhs.index);
+
+        token_type next = peek();
+        if (info.group != grouping::any && binary_ops[index_of(next)].prec == info.prec &&
+            (info.group == grouping::none || next != op))
+        {
+            error(diag_code::needs_parentheses);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+//  unary: a sign applies to the term after it (-a * b is -(a * b)) and
+//  only starts a simple expression; abs, not, ?? and the unary logical
+//  operators take a primary.
+//
+ref<expr> expr_parser::unary(unsigned min_prec)
+{
+    token_type op = peek();
+    offset_t pos = offset();
+    switch (op)
+    {
+    case token_type::Plus:
+    case token_type::Minus:
+    {
+        if (min_prec > adding_prec)
+        {
+            error(diag_code::misplaced_sign);
+        }
+        i++;
+        nesting level{nested};
+        if (level.too_deep())
+        {
+            error(diag_code::nesting_too_deep);
+            while (peek() == token_type::Plus || peek() == token_type::Minus)
+            {
+                i++;
+            }
+        }
+        return add(expr_kind::unary, op, pos, climb(multiplying_prec).index);
+    }
+
+    case token_type::Condition:
+    case token_type::Abs:
+    case token_type::Not:
+    case token_type::And:
+    case token_type::Or:
+    case token_type::Nand:
+    case token_type::Nor:
+    case token_type::Xor:
+    case token_type::Xnor: i++; return add(expr_kind::unary, op, pos, primary().index);
+
+    default: return primary();
+    }
+}
+
+ref<expr> expr_parser::primary()
+{
+    offset_t pos = offset();
+    switch (peek())
+    {
+    case token_type::Identifier: return name();
+
+    case token_type::String:
+        if (peek(1) == token_type::Left_Paren)
+        {
+            return name(); // operator symbol: "and"(a, b)
+        }
+        return literal();
+
+    case token_type::Integer:
+    case token_type::Real:
+        if (auto value = literal(); peek() == token_type::Identifier)
+        {
+            auto unit = at(i++).id();
+            return add(expr_kind::physical, token_type::Invalid, pos, value.index, unit);
+        }
+        else
+        {
+            return value;
+        }
+
+    case token_type::Bit_String:
+    case token_type::Character: return literal();
+
+    case token_type::Null: i++; return add(expr_kind::null, token_type::Invalid, pos);
+
+    case token_type::Left_Paren: return parenthesized();
+
+    default: error(diag_code::expected_expression); return {};
+    }
+}
+
+ref<expr> expr_parser::literal()
+{
+    token_type type = peek();
+    offset_t pos = offset();
+    std::uint32_t id = at(i++).id();
+
+    //  the values move from the token stream to the tree
+    //
+    auto const& from = literals();
+    auto& to = tree.literals();
+    switch (type)
+    {
+    case token_type::Integer:
+        return add(expr_kind::integer, type, pos, to.add_integer(from.integer(id), from.overflow(id)));
+    case token_type::Real: return add(expr_kind::real, type, pos, to.add_real(from.real(id), from.overflow(id)));
+    case token_type::String: return add(expr_kind::string, type, pos, to.add_string(from.str(id)));
+    case token_type::Bit_String: return add(expr_kind::bit_string, type, pos, to.add_bits(from.bits(id)));
+    default: return add(expr_kind::character, type, pos, id);
+    }
+}
+
+ref<expr> expr_parser::name()
+{
+    offset_t pos = offset();
+    switch (peek())
+    {
+    case token_type::Identifier:
+        i++;
+        return suffixes(add(expr_kind::name, token_type::Invalid, pos, at(i - 1).id()));
+    case token_type::String: return suffixes(literal());
+    default: error(diag_code::expected_name); return {};
+    }
+}
+
+ref<expr> expr_parser::suffixes(ref<expr> prefix)
+{
+    for (;;)
+    {
+        offset_t pos = offset();
+        switch (peek())
+        {
+        case token_type::Dot:
+            i++;
+            switch (peek())
+            {
+            case token_type::Identifier: prefix = add(expr_kind::select, {}, pos, prefix.index, at(i).id()); break;
+            case token_type::All: prefix = add(expr_kind::select, {}, pos, prefix.index, no_symbol); break;
+            case token_type::Character:
+            case token_type::String:
+            {
+                // an enumeration char or an operator symbol, by its spelling
+                auto sym = symbol_table::global().intern(at(i).text(text), false);
+                prefix = add(expr_kind::select, {}, pos, prefix.index, sym);
+                break;
+            }
+            default: error(diag_code::expected_name); return prefix;
+            }
+            i++;
+            break;
+
+        case token_type::Left_Paren: prefix = add(expr_kind::call, {}, pos, prefix.index, elements().at); break;
+
+        case token_type::Tick:
+            switch (peek(1))
+            {
+            case token_type::Left_Paren:
+                i++;
+                prefix = add(expr_kind::qualified, {}, pos, prefix.index, parenthesized().index);
+                break;
+            case token_type::Identifier:
+                prefix = add(expr_kind::attribute, {}, pos, prefix.index, at(i + 1).id());
+                i += 2;
+                break;
+            case token_type::Range:
+            case token_type::Subtype:
+            {
+                // the attributes named by a reserved word
+                auto sym = symbol_table::global().intern(at(i + 1).text(text));
+                prefix = add(expr_kind::attribute, {}, pos, prefix.index, sym);
+                i += 2;
+                break;
+            }
+            default: i++; error(diag_code::expected_name); return prefix;
+            }
+            break;
+
+        default: return prefix;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+//  parenthesized: ( expression ) is the expression itself, anything
+//  else is an aggregate
+//
+ref<expr> expr_parser::parenthesized()
+{
+    offset_t pos = offset();
+    auto mark = scratch.size();
+    collect_elements();
+
+    if (scratch.size() == mark + 1)
+    {
+        auto kind = tree[scratch[mark]].kind;
+        if (kind != expr_kind::association && kind != expr_kind::range && kind != expr_kind::others)
+        {
+            auto inner = scratch[mark];
+            scratch.resize(mark);
+            return inner;
+        }
+    }
+    auto items = tree.add_list<expr>(std::span(scratch).subspan(mark));
+    scratch.resize(mark);
+    return add(expr_kind::aggregate, token_type::Invalid, pos, 0, items.at);
+}
+
+list<expr> expr_parser::elements()
+{
+    auto mark = scratch.size();
+    collect_elements();
+    auto items = tree.add_list<expr>(std::span(scratch).subspan(mark));
+    scratch.resize(mark);
+    return items;
+}
+
+//  ( element { , element } ), the elements are pushed on scratch. Too
+//  deep a list is skipped and stands for one empty element.
+//
+void expr_parser::collect_elements()
+{
+    nesting level{nested};
+    if (level.too_deep())
+    {
+        error(diag_code::nesting_too_deep);
+        skip_parens();
+        scratch.push_back({});
+        return;
+    }
+
+    i++; // (
+    for (;;)
+    {
+        scratch.push_back(element());
+        if (peek() != token_type::Comma)
+        {
+            break;
+        }
+        i++;
+    }
+    expect(token_type::Right_Paren, diag_code::expected_right_paren);
+}
+
+ref<expr> expr_parser::element()
+{
+    offset_t pos = offset();
+    ref<expr> first = choice();
+
+    if (peek() == token_type::Bar)
+    {
+        auto mark = scratch.size();
+        scratch.push_back(first);
+        while (peek() == token_type::Bar)
+        {
+            i++;
+            scratch.push_back(choice());
+        }
+        auto choices = tree.add_list<expr>(std::span(scratch).subspan(mark));
+        scratch.resize(mark);
+        first = add(expr_kind::aggregate, token_type::Bar, pos, 0, choices.at);
+    }
+
+    if (peek() == token_type::Double_Arrow)
+    {
+        i++;
+        ref<expr> actual = choice();
+        return add(expr_kind::association, token_type::Invalid, pos, first.index, actual.index);
+    }
+    return first;
+}
+
+//  choice ::= expression | discrete_range | others, and open as actual
+//
+ref<expr> expr_parser::choice()
+{
+    offset_t pos = offset();
+    switch (peek())
+    {
+    case token_type::Others: i++; return add(expr_kind::others, token_type::Invalid, pos);
+    case token_type::Open: i++; return add(expr_kind::open, token_type::Invalid, pos);
+    default: break;
+    }
+
+    ref<expr> left = expression();
+    token_type dir = peek();
+    if (dir == token_type::To || dir == token_type::Downto)
+    {
+        i++;
+        ref<expr> right = expression();
+        return add(expr_kind::range, dir, pos, left.index, right.index);
+    }
+    return left;
+}
+
+} // namespace vlark
@@ -0,0 +1,328 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//===========================================================================
+//  JSON reader - parses a JSON document into a tree of values
+//===========================================================================
+
+#include "json_reader.h"
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//  json_parser: recursive descent over the text, white space as RFC 8259
+//  has it. \u escapes are turned into UTF-8, a surrogate pair into one
+//  code point.
+//
+class json_parser
+{
+public:
+    explicit json_parser(std::string_view t)
+        : text{t}
+    {
+    }
+
+    bool document(json_value& v)
+    {
+        return value(v, 0) && (skip_space(), at == text.size());
+    }
+
+private:
+    bool value(json_value& v, unsigned depth);
+    bool string(std::string& out);
+    bool number(json_value& v);
+    bool hex4(std::uint32_t& code);
+    bool word(std::string_view w)
+    {
+        if (text.substr(at, w.size()) != w)
+        {
+            return false;
+        }
+        at += w.size();
+        return true;
+    }
+    void skip_space()
+    {
+        while (at < text.size() && (text[at] == ' ' || text[at] == '\t' || text[at] == '\n' || text[at] == '\r'))
+        {
+            at++;
+        }
+    }
+    bool next_is(char c)
+    {
+        skip_space();
+        if (at < text.size() && text[at] == c)
+        {
+            at++;
+            return true;
+        }
+        return false;
+    }
+
+    std::string_view text;
+    std::size_t at = 0;
+};
+
+bool json_parser::value(json_value& v, unsigned depth)
+{
+    if (depth > json_value::max_depth)
+    {
+        return false;
+    }
+    skip_space();
+    if (at == text.size())
+    {
+        return false;
+    }
+    switch (text[at])
+    {
+    case 'n': return word("null");
+    case 't':
+        v.k = json_value::kind::boolean;
+        v.flag = true;
+        return word("true");
+    case 'f':
+        v.k = json_value::kind::boolean;
+        return word("false");
+    case '"': v.k = json_value::kind::string; return string(v.str);
+    case '[':
+        at++;
+        v.k = json_value::kind::array;
+        if (next_is(']'))
+        {
+            return true;
+        }
+        do
+        {
+            if (!value(v.items.emplace_back(), depth + 1))
+            {
+                return false;
+            }
+        } while (next_is(','));
+        return next_is(']');
+    case '{':
+        at++;
+        v.k = json_value::kind::object;
+        if (next_is('}'))
+        {
+            return true;
+        }
+        do
+        {
+            skip_space();
+            if (at == text.size() || text[at] != '"' || !string(v.keys.emplace_back()) || !next_is(':') ||
+                !value(v.items.emplace_back(), depth + 1))
+            {
+                return false;
+            }
+        } while (next_is(','));
+        return next_is('}');
+    default: return number(v);
+    }
+}
+
+bool json_parser::hex4(std::uint32_t& code)
+{
+    if (text.size() - at < 4)
+    {
+        return false;
+    }
+    auto r = std::from_chars(text.data() + at, text.data() + at + 4, code, 16);
+    if (r.ptr != text.data() + at + 4)
+    {
+        return false;
+    }
+    at += 4;
+    return true;
+}
+
+bool json_parser::string(std::string& out)
+{
+    at++; // "
+    for (;;)
+    {
+        auto stop = text.find_first_of("\"\\", at);
+        if (stop == std::string_view::npos)
+        {
+            return false;
+        }
+        out.append(text.substr(at, stop - at));
+        at = stop + 1;
+        if (text[stop] == '"')
+        {
+            return true;
+        }
+        if (at == text.size())
+        {
+            return false;
+        }
+        char c = text[at++];
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/': out += c; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u':
+        {
+            std::uint32_t code = 0;
+            if (!hex4(code))
+            {
+                return false;
+            }
+            if (code >= 0xD800 && code < 0xDC00 && text.substr(at, 2) == "\\u")
+            {
+                at += 2;
+                std::uint32_t low = 0;
+                if (!hex4(low) || low < 0xDC00 || low >= 0xE000)
+                {
+                    return false;
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            if (code < 0x80)
+            {
+                out += static_cast<char>(code);
+            }
+            else if (code < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            break;
+        }
+        default: return false;
+        }
+    }
+}
+
+bool json_parser::number(json_value& v)
+{
+    v.k = json_value::kind::number;
+    auto first = text.data() + at;
+    auto last = text.data() + text.size();
+    if (*first != '-' && (*first < '0' || *first > '9'))
+    {
+        return false; // from_chars takes inf and nan
+    }
+    auto r = std::from_chars(first, last, v.num);
+    if (r.ec != std::errc{} || r.ptr == first)
+    {
+        return false;
+    }
+    at += static_cast<std::size_t>(r.ptr - first);
+    return true;
+}
+
+std::optional<json_value> json_value::parse(std::string_view text)
+{
+    json_value v;
+    json_parser p{text};
+    if (!p.document(v))
+    {
+        return std::nullopt;
+    }
+    return v;
+}
+
+json_value const& json_value::none()
+{
+    static json_value const null_value{};
+    return null_value;
+}
+
+json_value const& json_value::operator[](std::string_view name) const
+{
+    for (std::size_t i = 0; i < keys.size(); i++)
+    {
+        if (keys[i] == name)
+        {
+            return items[i];
+        }
+    }
+    return none();
+}
+
+std::int64_t json_value::integer() const
+{
+    constexpr double limit = 9223372036854775808.0; // 2^63, the first double past the range
+    if (k != kind::number || std::isnan(num))
+    {
+        return 0;
+    }
+    if (num >= limit)
+    {
+        return std::numeric_limits<std::int64_t>::max();
+    }
+    return num < -limit ? std::numeric_limits<std::int64_t>::min() : static_cast<std::int64_t>(num);
+}
+
+void write_json(json_value const& value, json_writer& out)
+{
+    switch (value.type())
+    {
+    case json_value::kind::null: out.null(); break;
+    case json_value::kind::boolean: out.boolean(value.boolean()); break;
+    case json_value::kind::number:
+        if (value.number() == std::trunc(value.number()) && std::abs(value.number()) < 9.0e15)
+        {
+            out.number(value.integer());
+        }
+        else
+        {
+            out.number(value.number());
+        }
+        break;
+    case json_value::kind::string: out.string(value.string()); break;
+    case json_value::kind::array:
+        out.begin_array();
+        for (auto const& e : value.elements())
+        {
+            write_json(e, out);
+        }
+        out.end_array();
+        break;
+    case json_value::kind::object:
+        out.begin_object();
+        for (std::size_t i = 0; i < value.size(); i++)
+        {
+            out.key(value.names()[i]);
+            write_json(value[i], out);
+        }
+        out.end_object();
+        break;
+    }
+}
+
+} // namespace vlark
@@ -0,0 +1,528 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  JSON writer - streams JSON through one buffer, and the AST as JSON
+//===========================================================================
+
+#include "json_writer.h"
+#include "simd.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace vlark
+{
+
+namespace
+{
+
+constexpr std::size_t min_capacity = 64; // a number, an escape and an indent step fit
+
+constexpr char hex_digits[] = "0123456789abcdef";
+
+} // namespace
+
+json_writer::json_writer(std::ostream& sink, bool pretty_print, std::size_t capacity)
+    : out{sink}
+    , pretty{pretty_print}
+    , buf{new char[std::max(capacity, min_capacity)]}
+    , cur{buf.get()}
+    , last{buf.get() + std::max(capacity, min_capacity)}
+{
+}
+
+void json_writer::flush()
+{
+    auto n = static_cast<std::size_t>(cur - buf.get());
+    if (n != 0)
+    {
+        out.write(buf.get(), static_cast<std::streamsize>(n));
+        flushed += n;
+        cur = buf.get();
+    }
+}
+
+void json_writer::next_document()
+{
+    put('\n');
+    need_comma = false;
+}
+
+void json_writer::newline()
+{
+    put('\n');
+    for (std::size_t left = 2 * std::size_t{depth}; left != 0;)
+    {
+        auto n = std::min(left, min_capacity);
+        std::memset(room(n), ' ', n);
+        cur += n;
+        left -= n;
+    }
+}
+
+//  before a value or a key: the comma after the one before, and in
+//  pretty mode the line break
+//
+void json_writer::separate()
+{
+    if (after_key)
+    {
+        after_key = false;
+        return;
+    }
+    if (need_comma)
+    {
+        put(',');
+    }
+    if (pretty && depth != 0)
+    {
+        newline();
+    }
+}
+
+void json_writer::open(char bracket)
+{
+    separate();
+    put(bracket);
+    depth++;
+    need_comma = false;
+}
+
+void json_writer::close(char bracket)
+{
+    depth--;
+    if (pretty && need_comma)
+    {
+        newline();
+    }
+    put(bracket);
+    need_comma = true;
+}
+
+void json_writer::key(std::string_view name)
+{
+    separate();
+    escaped(name);
+    put(':');
+    if (pretty)
+    {
+        put(' ');
+    }
+    after_key = true;
+}
+
+void json_writer::string(std::string_view text)
+{
+    separate();
+    escaped(text);
+    need_comma = true;
+}
+
+void json_writer::number(std::int64_t value)
+{
+    separate();
+    char* p = room(24);
+    cur = std::to_chars(p, last, value).ptr;
+    need_comma = true;
+}
+
+void json_writer::number(double value)
+{
+    if (!std::isfinite(value))
+    {
+        null();
+        return;
+    }
+    separate();
+    char* p = room(32);
+    cur = std::to_chars(p, last, value).ptr;
+    need_comma = true;
+}
+
+void json_writer::boolean(bool value)
+{
+    separate();
+    std::string_view word = value ? "true" : "false";
+    std::memcpy(room(word.size()), word.data(), word.size());
+    cur += word.size();
+    need_comma = true;
+}
+
+void json_writer::null()
+{
+    separate();
+    std::memcpy(room(4), "null", 4);
+    cur += 4;
+    need_comma = true;
+}
+
+//-----------------------------------------------------------------------
+//  escaped: the quoted string. Runs without a char to escape are found
+//  16 or 32 bytes at a time and copied as one block, a run longer than
+//  the free room goes out in pieces.
+//
+void json_writer::escaped(std::string_view text)
+{
+    put('"');
+    while (!text.empty())
+    {
+        auto run = simd::escape_free_run(text);
+        while (run != 0)
+        {
+            auto free = static_cast<std::size_t>(last - cur);
+            if (free == 0)
+            {
+                flush();
+                free = static_cast<std::size_t>(last - cur);
+            }
+            auto n = std::min(run, free);
+            std::memcpy(cur, text.data(), n);
+            cur += n;
+            text.remove_prefix(n);
+            run -= n;
+        }
+        if (text.empty())
+        {
+            break;
+        }
+
+        char c = text.front();
+        text.remove_prefix(1);
+        char* p = room(6);
+        *p++ = '\\';
+        switch (c)
+        {
+        case '"': *p++ = '"'; break;
+        case '\\': *p++ = '\\'; break;
+        case '\n': *p++ = 'n'; break;
+        case '\r': *p++ = 'r'; break;
+        case '\t': *p++ = 't'; break;
+        case '\b': *p++ = 'b'; break;
+        case '\f': *p++ = 'f'; break;
+        default:
+        {
+            auto u = static_cast<unsigned char>(c);
+            std::memcpy(p, "u00", 3);
+            p[3] = hex_digits[u >> 4];
+            p[4] = hex_digits[u & 0xf];
+            p += 5;
+            break;
+        }
+        }
+        cur = p;
+    }
+    put('"');
+}
+
+//-----------------------------------------------------------------------
+//  AST
+//-----------------------------------------------------------------------
+
+namespace
+{
+
+//  ast_emitter: a node writes its own fields and leaves its children to
+//  the work stack, so a tree as deep as a long a + b + c chain or elsif
+//  chain costs heap and not native stack. A field that follows a child
+//  in the output waits on the stack too.
+//
+class ast_emitter
+{
+public:
+    ast_emitter(ast const& t, json_writer& w)
+        : tree{t}
+        , out{w}
+    {
+    }
+
+    void unit(ref<design_unit> r);
+
+private:
+    enum class step : std::uint8_t
+    {
+        expr,
+        decl,
+        stmt,
+        expr_list,
+        decl_list,
+        stmt_list,
+        name,
+        all,
+        end_object,
+        end_array
+    };
+
+    struct task
+    {
+        step what;
+        std::string_view key; // empty in an array
+        std::uint32_t index = 0;
+    };
+
+    void run();
+    void expression(ref<expr> r);
+    void declaration(ref<decl> r);
+    void statement(ref<stmt> r);
+
+    // the children taken by member, and the end of the object, to the stack
+    void close()
+    {
+        todo.push_back({step::end_object, {}});
+        todo.insert(todo.end(), children.rbegin(), children.rend());
+        children.clear();
+    }
+
+    void name(std::string_view member, symbol_id id)
+    {
+        if (id == no_symbol)
+        {
+            return;
+        }
+        if (!children.empty())
+        {
+            children.push_back({step::name, member, id});
+            return;
+        }
+        out.key(member);
+        out.string(symbols.name(tree.symbol(id)));
+    }
+    void op(std::string_view member, token_type type)
+    {
+        if (type != token_type::Invalid)
+        {
+            out.key(member);
+            out.string(token_spelling(type));
+        }
+    }
+    void head(std::string_view kind, offset_t pos)
+    {
+        out.key("kind");
+        out.string(kind);
+        out.key("pos");
+        out.number(std::int64_t{pos});
+    }
+
+    static constexpr step node_step(ref<expr>) { return step::expr; }
+    static constexpr step node_step(ref<decl>) { return step::decl; }
+    static constexpr step node_step(ref<stmt>) { return step::stmt; }
+    static constexpr step list_step(list<expr>) { return step::expr_list; }
+    static constexpr step list_step(list<decl>) { return step::decl_list; }
+    static constexpr step list_step(list<stmt>) { return step::stmt_list; }
+
+    template <class T>
+    void member(std::string_view key, ref<T> r)
+    {
+        if (r)
+        {
+            children.push_back({node_step(r), key, r.index});
+        }
+    }
+    template <class T>
+    void member(std::string_view key, list<T> l)
+    {
+        if (l.at)
+        {
+            children.push_back({list_step(l), key, l.at});
+        }
+    }
+    template <class T>
+    void items(list<T> l)
+    {
+        out.begin_array();
+        todo.push_back({step::end_array, {}});
+        auto refs = tree.items(l);
+        for (auto it = refs.rbegin(); it != refs.rend(); ++it)
+        {
+            todo.push_back({node_step(*it), {}, it->index});
+        }
+    }
+
+    ast const& tree;
+    json_writer& out;
+    symbol_table const& symbols = symbol_table::global();
+    std::vector<task> todo{};     // innermost last
+    std::vector<task> children{}; // of the node being written, in order
+};
+
+void ast_emitter::unit(ref<design_unit> r)
+{
+    auto const& u = tree[r];
+    out.begin_object();
+    head(kind_name(u.kind), u.pos);
+    out.key("end");
+    out.number(std::int64_t{u.end});
+    name("name", u.name);
+    name("of", u.of);
+    member("context", u.context);
+    member("decls", u.decls);
+    member("stmts", u.stmts);
+    close();
+    run();
+}
+
+void ast_emitter::run()
+{
+    while (!todo.empty())
+    {
+        task t = todo.back();
+        todo.pop_back();
+        if (!t.key.empty())
+        {
+            out.key(t.key);
+        }
+        switch (t.what)
+        {
+        case step::expr: expression(ref<expr>{t.index}); break;
+        case step::decl: declaration(ref<decl>{t.index}); break;
+        case step::stmt: statement(ref<stmt>{t.index}); break;
+        case step::expr_list: items(list<expr>{t.index}); break;
+        case step::decl_list: items(list<decl>{t.index}); break;
+        case step::stmt_list: items(list<stmt>{t.index}); break;
+        case step::name: out.string(symbols.name(tree.symbol(t.index))); break;
+        case step::all: out.string("all"); break;
+        case step::end_object: out.end_object(); break;
+        case step::end_array: out.end_array(); break;
+        }
+    }
+}
+
+void ast_emitter::expression(ref<expr> r)
+{
+    auto const& e = tree[r];
+    auto const& lits = tree.literals();
+    out.begin_object();
+    head(kind_name(e.kind), e.pos);
+    op("op", e.op);
+    switch (e.kind)
+    {
+    case expr_kind::name: name("name", e.a); break;
+    case expr_kind::character:
+    {
+        char c = static_cast<char>(e.a);
+        out.key("value");
+        out.string({&c, 1});
+        break;
+    }
+    case expr_kind::integer:
+        out.key("value");
+        out.number(lits.integer(e.a));
+        break;
+    case expr_kind::real:
+        out.key("value");
+        out.number(lits.real(e.a));
+        break;
+    case expr_kind::string:
+        out.key("value");
+        out.string(lits.str(e.a));
+        break;
+    case expr_kind::bit_string:
+        out.key("value");
+        out.string(lits.bits(e.a));
+        break;
+    case expr_kind::physical:
+        member("value", e.left());
+        name("unit", e.b);
+        break;
+    case expr_kind::unary: member("operand", e.left()); break;
+    case expr_kind::binary:
+    case expr_kind::range:
+        member("left", e.left());
+        member("right", e.right());
+        break;
+    case expr_kind::call:
+        member("prefix", e.left());
+        member("args", e.items());
+        break;
+    case expr_kind::select:
+        member("prefix", e.left());
+        if (e.b == no_symbol)
+        {
+            children.push_back({step::all, "suffix"});
+        }
+        name("suffix", e.b);
+        break;
+    case expr_kind::attribute:
+        member("prefix", e.left());
+        name("attribute", e.b);
+        break;
+    case expr_kind::qualified:
+        member("type", e.left());
+        member("operand", e.right());
+        break;
+    case expr_kind::aggregate: member("elements", e.items()); break;
+    case expr_kind::association:
+        member("formal", e.left());
+        member("actual", e.right());
+        break;
+    case expr_kind::constraint:
+        member("type", e.left());
+        member("range", e.right());
+        break;
+    default: break;
+    }
+    close();
+}
+
+void ast_emitter::declaration(ref<decl> r)
+{
+    auto const& d = tree[r];
+    out.begin_object();
+    head(kind_name(d.kind), d.pos);
+    name("name", d.name);
+    op("mode", d.mode);
+    member("type", d.type);
+    member("init", d.init);
+    member("children", d.children);
+    member("body", d.body);
+    close();
+}
+
+void ast_emitter::statement(ref<stmt> r)
+{
+    auto const& s = tree[r];
+    out.begin_object();
+    head(kind_name(s.kind), s.pos);
+    name("label", s.label);
+    member("target", s.target);
+    member("cond", s.cond);
+    member("value", s.value);
+    member("decls", s.decls);
+    member("body", s.body);
+    member("alt", s.alt);
+    close();
+}
+
+} // namespace
+
+void write_json(ast const& tree, json_writer& out, std::string_view file)
+{
+    ast_emitter emit{tree, out};
+    out.begin_object();
+    if (!file.empty())
+    {
+        out.key("file");
+        out.string(file);
+    }
+    out.key("units");
+    out.begin_array();
+    for (auto u : tree.design_units())
+    {
+        emit.unit(u);
+    }
+    out.end_array();
+    out.end_object();
+}
+
+} // namespace vlark
@@ -0,0 +1,536 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Literals - abstract literals and bit strings, decoded once
+//===========================================================================
+
+#include "literal.h"
+#include "simd.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+namespace vlark
+{
+
+namespace
+{
+
+// longest bit string we expand, the size of a sized bit string is user data
+constexpr std::uint64_t max_bit_string = std::uint64_t{1} << 24;
+
+// longest D bit string body in digits, the conversion is quadratic in it
+constexpr std::size_t max_decimal_digits = std::size_t{1} << 14;
+
+constexpr bool is_digit(char c)
+{
+    return '0' <= c && c <= '9';
+}
+
+constexpr char lower(char c)
+{
+    return ('A' <= c && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+// value of an extended digit (0-9, a-f), 99 for any other char
+constexpr unsigned digit_value(char c)
+{
+    if (is_digit(c))
+    {
+        return static_cast<unsigned>(c - '0');
+    }
+    c = lower(c);
+    return ('a' <= c && c <= 'f') ? static_cast<unsigned>(c - 'a' + 10) : 99u;
+}
+
+//-----------------------------------------------------------------------
+//  digits_end: end of the run of digits and '_' starting at i.
+//  Constants in port maps are mostly short, the vector kernel only pays
+//  off once the first few chars did not end the run.
+//
+std::size_t digits_end(std::string_view text, std::size_t i)
+{
+    std::size_t stop = std::min(text.size(), i + 8);
+    while (i < stop && simd::is_digit_run(text[i]))
+    {
+        i++;
+    }
+    if (i == stop && i < text.size())
+    {
+        i += simd::digit_run(text.substr(i));
+    }
+    return i;
+}
+
+// end of the run of extended digits and '_' starting at i
+std::size_t extended_digits_end(std::string_view text, std::size_t i)
+{
+    while (i < text.size() && (text[i] == '_' || digit_value(text[i]) < 16))
+    {
+        i++;
+    }
+    return i;
+}
+
+// digit { [ underline ] digit }: no leading, trailing or double '_'
+bool well_formed(std::string_view run)
+{
+    return !run.empty() && run.front() != '_' && run.back() != '_' && run.find("__") == std::string_view::npos;
+}
+
+bool digits_below(std::string_view run, unsigned base)
+{
+    return std::all_of(run.begin(), run.end(), [base](char c) { return c == '_' || digit_value(c) < base; });
+}
+
+// v = value of run in base, underscores skipped. false on overflow
+bool accumulate(std::string_view run, std::uint64_t base, std::uint64_t& v)
+{
+    constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+    v = 0;
+    for (char c : run)
+    {
+        if (c == '_')
+        {
+            continue;
+        }
+        std::uint64_t d = digit_value(c);
+        if (v > (max - d) / base)
+        {
+            return false;
+        }
+        v = v * base + d;
+    }
+    return true;
+}
+
+// v *= base ** exp, false on overflow
+bool scale(std::uint64_t& v, std::uint64_t base, std::int64_t exp)
+{
+    for (; exp > 0 && v != 0; exp--)
+    {
+        if (v > std::numeric_limits<std::uint64_t>::max() / base)
+        {
+            return false;
+        }
+        v *= base;
+    }
+    return true;
+}
+
+std::uint32_t add_integer(literal_table* values, std::uint64_t v, bool fits)
+{
+    constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+    fits = fits && v <= max;
+    return values->add_integer(static_cast<std::int64_t>(fits ? v : max), !fits);
+}
+
+//-----------------------------------------------------------------------
+//  exponent: the optional E [+|-] integer at text[i]. An 'e' that is not
+//  followed by digits is left alone, it is the start of the next token.
+//
+struct exponent_part
+{
+    std::size_t end;
+    std::int64_t value;
+    bool ok;
+};
+
+exponent_part exponent(std::string_view text, std::size_t i)
+{
+    if (i >= text.size() || lower(text[i]) != 'e')
+    {
+        return {i, 0, true};
+    }
+
+    std::size_t j = i + 1;
+    bool negative = false;
+    if (j < text.size() && (text[j] == '+' || text[j] == '-'))
+    {
+        negative = text[j] == '-';
+        j++;
+    }
+    if (j >= text.size() || !is_digit(text[j]))
+    {
+        return {i, 0, true};
+    }
+
+    std::size_t end = digits_end(text, j);
+    auto run = text.substr(j, end - j);
+    std::uint64_t v = 0;
+    bool ok = well_formed(run) && accumulate(run, 10, v) && v <= 100'000;
+    auto value = static_cast<std::int64_t>(std::min<std::uint64_t>(v, 100'000));
+    return {end, negative ? -value : value, ok};
+}
+
+//-----------------------------------------------------------------------
+//  based: base # based_integer [ . based_integer ] # [ exponent ]
+//  text[hash] is the first '#'
+//
+literal_scan based(std::string_view text, std::size_t hash, literal_table* values)
+{
+    std::uint64_t base = 0;
+    bool ok = well_formed(text.substr(0, hash)) && accumulate(text.substr(0, hash), 10, base) && 2 <= base &&
+              base <= 16;
+
+    std::size_t i = extended_digits_end(text, hash + 1);
+    auto whole = text.substr(hash + 1, i - hash - 1);
+    std::string_view frac;
+    bool real = i < text.size() && text[i] == '.';
+    if (real)
+    {
+        std::size_t j = extended_digits_end(text, i + 1);
+        frac = text.substr(i + 1, j - i - 1);
+        i = j;
+    }
+
+    auto kind = real ? literal_kind::real : literal_kind::integer;
+    if (i >= text.size() || text[i] != '#')
+    {
+        return {kind, i, false, 0}; // no closing '#'
+    }
+
+    auto exp = exponent(text, i + 1);
+    auto digits = static_cast<unsigned>(base);
+    ok = ok && exp.ok && well_formed(whole) && digits_below(whole, digits) &&
+         (!real || (well_formed(frac) && digits_below(frac, digits))) && (real || exp.value >= 0);
+    if (!ok || values == nullptr)
+    {
+        return {kind, exp.end, ok, 0};
+    }
+
+    if (!real)
+    {
+        std::uint64_t v = 0;
+        bool fits = accumulate(whole, base, v) && scale(v, base, exp.value);
+        return {kind, exp.end, true, add_integer(values, v, fits)};
+    }
+
+    double mantissa = 0.0;
+    for (char c : whole)
+    {
+        if (c != '_')
+        {
+            mantissa = mantissa * static_cast<double>(base) + digit_value(c);
+        }
+    }
+    double weight = 1.0;
+    for (char c : frac)
+    {
+        if (c != '_')
+        {
+            weight /= static_cast<double>(base);
+            mantissa += digit_value(c) * weight;
+        }
+    }
+    double v = mantissa * std::pow(static_cast<double>(base), static_cast<double>(exp.value));
+    return {kind, exp.end, true, values->add_real(v, std::isinf(v))};
+}
+
+//  decimal_bits: binary value of a D bit string, the minimal number of bits
+//  The digits are packed into base 10^9 limbs and divided by 2^32, each
+//  pass yields 32 bits. A body longer than max_decimal_digits is refused,
+//  the conversion stays quadratic in the digit count.
+//
+bool decimal_bits(std::string_view body, std::string& bits)
+{
+    std::string dec;
+    for (char c : body)
+    {
+        if (c == '_')
+        {
+            continue;
+        }
+        if (!is_digit(c) || dec.size() == max_decimal_digits)
+        {
+            return false;
+        }
+        dec += c;
+    }
+
+    //  limbs most significant first, the first one takes the odd digits
+    //
+    std::vector<std::uint32_t> limbs;
+    limbs.reserve(dec.size() / 9 + 1);
+    std::size_t head = dec.size() % 9 != 0 ? dec.size() % 9 : 9;
+    for (std::size_t i = 0; i < dec.size(); i += head, head = 9)
+    {
+        std::uint32_t limb = 0;
+        std::from_chars(dec.data() + i, dec.data() + i + head, limb);
+        limbs.push_back(limb);
+    }
+
+    //  long division by 2^32, the remainders are the bits from the right
+    //
+    std::size_t first = 0;
+    while (first < limbs.size() && limbs[first] == 0)
+    {
+        first++;
+    }
+    while (first < limbs.size())
+    {
+        std::uint64_t rem = 0;
+        for (std::size_t i = first; i < limbs.size(); i++)
+        {
+            std::uint64_t cur = rem * 1'000'000'000u + limbs[i];
+            limbs[i] = static_cast<std::uint32_t>(cur >> 32);
+            rem = cur & 0xffff'ffffu;
+        }
+        for (unsigned k = 0; k < 32; k++)
+        {
+            bits += ((rem >> k) & 1u) != 0 ? '1' : '0';
+        }
+        while (first < limbs.size() && limbs[first] == 0)
+        {
+            first++;
+        }
+    }
+    while (!bits.empty() && bits.back() == '0')
+    {
+        bits.pop_back();
+    }
+    if (bits.empty() && !body.empty())
+    {
+        bits.push_back('0');
+    }
+    std::reverse(bits.begin(), bits.end());
+    return true;
+}
+
+//-----------------------------------------------------------------------
+//  bit_string: [ integer ] base_specifier " [ bit_value ] "
+//  text[spec] is the base specifier, size the optional length before it.
+//
+literal_scan bit_string(std::string_view text, std::size_t spec, std::size_t spec_len, std::string_view size,
+                        literal_table* values)
+{
+    std::size_t open = spec + spec_len;
+    std::size_t close = simd::find_either(text.substr(open + 1), '"', '\n');
+    if (close == std::string_view::npos)
+    {
+        return {literal_kind::bit_string, text.size(), false, 0};
+    }
+    close += open + 1;
+    if (text[close] != '"')
+    {
+        return {literal_kind::bit_string, close, false, 0};
+    }
+    auto body = text.substr(open + 1, close - open - 1);
+
+    thread_local std::string bits;
+    bits.clear();
+    bool ok = body.empty() || well_formed(body);
+
+    char base = lower(text[open - 1]);
+    if (base == 'd')
+    {
+        ok = ok && decimal_bits(body, bits);
+    }
+    else
+    {
+        //  extended digits expand to their bits, other graphic chars
+        //  ('X', 'Z', '-' ...) are repeated as many times
+        //
+        unsigned width = base == 'b' ? 1 : (base == 'o' ? 3 : 4);
+        for (char c : body)
+        {
+            unsigned d = digit_value(c);
+            if (c == '_')
+            {
+                continue;
+            }
+            if (d < (1u << width))
+            {
+                for (unsigned k = width; k-- > 0;)
+                {
+                    bits += ((d >> k) & 1u) != 0 ? '1' : '0';
+                }
+            }
+            else if (d < 16)
+            {
+                ok = false; // an extended digit too big for the base
+            }
+            else
+            {
+                bits.append(width, c);
+            }
+        }
+    }
+
+    //  a sized string is extended or truncated on the left: unsigned ones
+    //  with '0', signed ones with their sign char
+    //
+    if (ok && !size.empty())
+    {
+        std::uint64_t n = 0;
+        ok = well_formed(size) && accumulate(size, 10, n) && n <= max_bit_string;
+        bool is_signed = spec_len == 2 && lower(text[spec]) == 's';
+        if (ok && n > bits.size())
+        {
+            bits.insert(0, n - bits.size(), is_signed && !bits.empty() ? bits.front() : '0');
+        }
+        else if (ok)
+        {
+            auto drop = bits.size() - n;
+            char fill = is_signed ? (n != 0 ? bits[drop] : '\0') : '0';
+            ok = std::string_view(bits).substr(0, drop).find_first_not_of(fill) == std::string_view::npos;
+            bits.erase(0, drop);
+        }
+    }
+
+    std::uint32_t value = ok && values != nullptr ? values->add_bits(bits) : 0;
+    return {literal_kind::bit_string, close + 1, ok, value};
+}
+
+} // namespace
+
+std::size_t bit_string_prefix(std::string_view text)
+{
+    std::size_t n = 0;
+    if (!text.empty() && (lower(text[0]) == 'u' || lower(text[0]) == 's'))
+    {
+        n = 1;
+    }
+    if (n + 1 >= text.size() || text[n + 1] != '"')
+    {
+        return 0;
+    }
+    char base = lower(text[n]);
+    return (base == 'b' || base == 'o' || base == 'x' || (base == 'd' && n == 0)) ? n + 1 : 0;
+}
+
+//-----------------------------------------------------------------------
+//  scan_string: string_literal ::= " { graphic_character } "
+//  A quote in the string is written twice. The closing quote is found
+//  with a vector search for '"' or '\n', a newline first means the
+//  string is not closed.
+//
+literal_scan scan_string(std::string_view text, literal_table* values)
+{
+    std::size_t i = 1;
+    bool doubled = false;
+    for (;;)
+    {
+        auto k = simd::find_either(text.substr(i), '"', '\n');
+        if (k == std::string_view::npos || text[i + k] == '\n')
+        {
+            return {literal_kind::string, k == std::string_view::npos ? text.size() : i + k, false, 0};
+        }
+        i += k + 1;
+        if (i == text.size() || text[i] != '"')
+        {
+            break;
+        }
+        doubled = true;
+        i++;
+    }
+
+    if (values == nullptr)
+    {
+        return {literal_kind::string, i, true, 0};
+    }
+    auto body = text.substr(1, i - 2);
+    if (!doubled)
+    {
+        return {literal_kind::string, i, true, values->add_string(body)};
+    }
+
+    thread_local std::string str;
+    str.clear();
+    for (std::size_t j = 0; j < body.size(); j++)
+    {
+        str += body[j];
+        if (body[j] == '"')
+        {
+            j++; // the second one of the pair
+        }
+    }
+    return {literal_kind::string, i, true, values->add_string(str)};
+}
+
+literal_scan scan_bit_string(std::string_view text, std::size_t prefix_len, literal_table* values)
+{
+    return bit_string(text, 0, prefix_len, {}, values);
+}
+
+//-----------------------------------------------------------------------
+//  scan_number: decimal literal, based literal or sized bit string
+//
+//  decimal_literal ::= integer [ . integer ] [ exponent ]
+//  integer ::= digit { [ underline ] digit }
+//
+literal_scan scan_number(std::string_view text, literal_table* values)
+{
+    std::size_t i = digits_end(text, 0);
+    auto whole = text.substr(0, i);
+
+    if (i < text.size() && text[i] == '#')
+    {
+        return based(text, i, values);
+    }
+    if (auto spec_len = bit_string_prefix(text.substr(i)); spec_len != 0)
+    {
+        return bit_string(text, i, spec_len, whole, values);
+    }
+
+    std::string_view frac;
+    bool real = i + 1 < text.size() && text[i] == '.' && is_digit(text[i + 1]);
+    if (real)
+    {
+        std::size_t j = digits_end(text, i + 1);
+        frac = text.substr(i + 1, j - i - 1);
+        i = j;
+    }
+
+    auto exp = exponent(text, i);
+    auto kind = real ? literal_kind::real : literal_kind::integer;
+
+    //  the exponent of an integer literal must not be negative
+    //
+    bool ok = exp.ok && well_formed(whole) && (!real || well_formed(frac)) && (real || exp.value >= 0);
+    if (!ok || values == nullptr)
+    {
+        return {kind, exp.end, ok, 0};
+    }
+
+    if (!real)
+    {
+        std::uint64_t v = 0;
+        bool fits = accumulate(whole, 10, v) && scale(v, 10, exp.value);
+        return {kind, exp.end, true, add_integer(values, v, fits)};
+    }
+
+    //  from_chars reads the literal as is once the underscores are gone
+    //
+    auto spelling = text.substr(0, exp.end);
+    std::string plain;
+    if (spelling.find('_') != std::string_view::npos)
+    {
+        std::copy_if(spelling.begin(), spelling.end(), std::back_inserter(plain), [](char c) { return c != '_'; });
+        spelling = plain;
+    }
+    double v = 0.0;
+    auto [end, ec] = std::from_chars(spelling.data(), spelling.data() + spelling.size(), v);
+    bool overflow = false;
+    if (ec == std::errc::result_out_of_range)
+    {
+        overflow = exp.value > 0;
+        v = overflow ? std::numeric_limits<double>::infinity() : 0.0;
+    }
+    return {kind, exp.end, true, values->add_real(v, overflow)};
+}
+
+} // namespace vlark
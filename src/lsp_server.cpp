@@ -0,0 +1,1198 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//===========================================================================
+//  Language server - LSP over JSON-RPC on a pair of streams
+//===========================================================================
+
+#include "lsp_server.h"
+#include "reparse.h"
+#include "utils.h"
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <sstream>
+
+namespace vlark
+{
+
+namespace
+{
+
+// JSON-RPC error codes
+constexpr int parse_error = -32700;
+constexpr int method_not_found = -32601;
+
+// bigger bodies are skipped unread, the header is most likely broken
+constexpr std::size_t max_message = std::size_t{64} << 20;
+
+// LSP SymbolKind
+enum class symbol_kind : std::int64_t
+{
+    file = 1,
+    module = 2,
+    namespace_ = 3,
+    package = 4,
+    class_ = 5,
+    property = 7,
+    field = 8,
+    enum_ = 10,
+    interface = 11,
+    function = 12,
+    variable = 13,
+    constant = 14,
+    object = 19,
+    struct_ = 23,
+    event = 24,
+    type_parameter = 26,
+};
+
+struct lsp_position
+{
+    std::uint32_t line;
+    std::uint32_t character;
+};
+
+//  code units of s in the position encoding: bytes, or UTF-16 code units
+//  (a 4 byte UTF-8 sequence is a surrogate pair)
+//
+std::uint32_t code_units(std::string_view s, bool utf8)
+{
+    if (utf8)
+    {
+        return static_cast<std::uint32_t>(s.size());
+    }
+    std::uint32_t n = 0;
+    for (auto c : s)
+    {
+        auto b = static_cast<unsigned char>(c);
+        if ((b & 0xC0) != 0x80)
+        {
+            n += b >= 0xF0 ? 2 : 1;
+        }
+    }
+    return n;
+}
+
+//  offset of an LSP position {line, character} in text, clamped to the
+//  end of the line and of the text
+//
+std::size_t offset_of(std::string_view text, json_value const& pos, bool utf8)
+{
+    std::size_t begin = 0;
+    for (auto line = pos["line"].integer(); line > 0; line--)
+    {
+        auto nl = text.find('\n', begin);
+        if (nl == std::string_view::npos)
+        {
+            return text.size();
+        }
+        begin = nl + 1;
+    }
+    auto end = std::min(text.find('\n', begin), text.size());
+    auto character = static_cast<std::size_t>(std::max<std::int64_t>(0, pos["character"].integer()));
+    if (utf8)
+    {
+        return std::min(begin + character, end);
+    }
+    auto at = begin;
+    for (std::size_t n = 0; at < end && n < character;)
+    {
+        n += static_cast<unsigned char>(text[at]) >= 0xF0 ? 2u : 1u;
+        at++;
+        while (at < end && (static_cast<unsigned char>(text[at]) & 0xC0) == 0x80)
+        {
+            at++;
+        }
+    }
+    return at;
+}
+
+lsp_position position_of(std::string_view text, line_table const& lines, std::size_t offset, bool utf8)
+{
+    auto it = std::upper_bound(lines.starts.begin(), lines.starts.end(), offset);
+    auto line = it == lines.starts.begin() ? 0 : static_cast<std::size_t>(it - lines.starts.begin()) - 1;
+    std::size_t begin = lines.starts.empty() ? 0 : lines.starts[line];
+    return {static_cast<std::uint32_t>(line), code_units(text.substr(begin, offset - begin), utf8)};
+}
+
+void write_position(json_writer& out, lsp_position p)
+{
+    out.begin_object();
+    out.key("line");
+    out.number(std::int64_t{p.line});
+    out.key("character");
+    out.number(std::int64_t{p.character});
+    out.end_object();
+}
+
+void write_range(json_writer& out, lsp_position start, lsp_position end)
+{
+    out.begin_object();
+    out.key("start");
+    write_position(out, start);
+    out.key("end");
+    write_position(out, end);
+    out.end_object();
+}
+
+//  one message: {"jsonrpc": "2.0", ...} with the members written by fill
+//
+template <class Fill>
+std::string message(Fill const& fill)
+{
+    std::ostringstream body;
+    {
+        json_writer out{body, false, 1 << 16};
+        out.begin_object();
+        out.key("jsonrpc");
+        out.string("2.0");
+        fill(out);
+        out.end_object();
+    }
+    return std::move(body).str();
+}
+
+//-----------------------------------------------------------------------
+//  index: the declarations of a document with the part of the text they
+//  are seen in, sorted by name
+//
+enum class reach : std::uint8_t
+{
+    local,  // in [scope_begin, scope_end)
+    unit,   // in its design unit, for an entity also in its architectures,
+            // for a package everywhere
+    global, // everywhere, the name of a design unit
+};
+
+struct declared
+{
+    symbol_id name;
+    reach seen;
+    std::uint32_t unit; // in lsp_index::units
+    offset_t at;        // the name
+    offset_t scope_begin;
+    offset_t scope_end;
+    lsp_position start;
+    lsp_position end;
+};
+
+struct unit_entry
+{
+    unit_kind kind;
+    symbol_id name;
+    symbol_id of;
+    offset_t begin;
+    offset_t end;
+};
+
+} // namespace
+
+struct lsp_index
+{
+    std::string uri;
+    std::vector<declared> defs{};
+    std::vector<unit_entry> units{};
+
+    std::span<const declared> named(symbol_id name) const
+    {
+        auto r = std::equal_range(defs.begin(), defs.end(), name, by_name{});
+        return {r.first, r.second};
+    }
+
+    struct by_name
+    {
+        bool operator()(declared const& d, symbol_id n) const { return d.name < n; }
+        bool operator()(symbol_id n, declared const& d) const { return n < d.name; }
+    };
+};
+
+//  an edit for the parser: text in place of [begin, end), or the whole text
+//
+struct pending_edit
+{
+    offset_t begin;
+    offset_t end;
+    std::string text;
+    bool whole;
+};
+
+struct lsp_document
+{
+    std::string uri;
+
+    // the reading thread's: the latest text
+    std::string text{};
+    std::int64_t version = 0;
+
+    // under docs_lock
+    std::vector<pending_edit> edits{}; // not parsed yet
+    std::int64_t queued_version = 0;   // with them
+    std::int64_t parsed_version = -1;
+    bool queued = false; // in dirty
+    bool closed = false;
+    std::shared_ptr<const lsp_index> index{};
+
+    //  the parser's, the reading thread's too once parsed_version is version
+    //
+    std::string parsed_text{};
+    token_stream tokens{};
+    ast tree{};
+    diagnostics diags{};
+    line_table lines{};
+    std::shared_ptr<const lsp_index> fresh_index{};
+};
+
+namespace
+{
+
+//  the token at or right before offset (a cursor at the end of a name)
+//
+std::size_t token_around(token_stream const& tokens, std::size_t offset)
+{
+    auto offs = tokens.offsets();
+    auto it = std::upper_bound(offs.begin(), offs.end(), offset);
+    if (it == offs.begin())
+    {
+        return tokens.size();
+    }
+    auto t = static_cast<std::size_t>(it - offs.begin()) - 1;
+    return offset <= std::size_t{tokens.offset(t)} + tokens.length(t) ? t : tokens.size();
+}
+
+//-----------------------------------------------------------------------
+//  names: where the names of the nodes are. Declarations and labels sit
+//  at or a few tokens in front of their name, a design unit at its
+//  context clause.
+//
+class names
+{
+public:
+    names(token_stream const& t, std::string_view s, line_table const& l, bool u)
+        : tokens{t}
+        , text{s}
+        , lines{l}
+        , utf8{u}
+    {
+    }
+
+    //  token of name at or after pos, tokens.size() when there is none in
+    //  reach
+    //
+    std::size_t find(offset_t pos, symbol_id name, bool unit = false) const
+    {
+        auto t = first_at(pos);
+        if (unit)
+        {
+            while (t < tokens.size() && !is_unit_keyword(tokens.type(t)))
+            {
+                t++;
+            }
+        }
+        for (auto last = std::min(tokens.size(), t + 64); t < last; t++)
+        {
+            if (tokens.type(t) == token_type::Identifier && tokens.id(t) == name)
+            {
+                return t;
+            }
+        }
+        return tokens.size();
+    }
+
+    lsp_position start(std::size_t t) const { return at(tokens.offset(t)); }
+
+    //  an identifier never spans lines
+    lsp_position end(std::size_t t) const
+    {
+        auto p = start(t);
+        p.character += code_units(text.substr(tokens.offset(t), tokens.length(t)), utf8);
+        return p;
+    }
+
+    lsp_position at(std::size_t offset) const
+    {
+        auto const& starts = lines.starts;
+        if (starts.empty() || offset < starts[line])
+        {
+            return position_of(text, lines, offset, utf8);
+        }
+        while (line + 1 < starts.size() && starts[line + 1] <= offset)
+        {
+            line++;
+        }
+        return {static_cast<std::uint32_t>(line), code_units(text.substr(starts[line], offset - starts[line]), utf8)};
+    }
+
+    token_stream const& tokens;
+
+private:
+    static bool is_unit_keyword(token_type type)
+    {
+        return type == token_type::Entity || type == token_type::Architecture || type == token_type::Package ||
+               type == token_type::Configuration || type == token_type::Context;
+    }
+
+    //  the lookups mostly come in text order: both cursors step forward
+    //  from the last answer and only search when sent back
+    std::size_t first_at(offset_t pos) const
+    {
+        auto offs = tokens.offsets();
+        if (token > offs.size() || (token != 0 && offs[token - 1] >= pos))
+        {
+            token = static_cast<std::size_t>(std::lower_bound(offs.begin(), offs.end(), pos) - offs.begin());
+        }
+        while (token < offs.size() && offs[token] < pos)
+        {
+            token++;
+        }
+        return token;
+    }
+
+    std::string_view text;
+    line_table const& lines;
+    bool utf8;
+    mutable std::size_t token = 0;
+    mutable std::size_t line = 0;
+};
+
+//-----------------------------------------------------------------------
+//  index_builder: walks a tree for its declarations, labels and loop
+//  parameters. A node's part of the text runs to the start of the next
+//  node of its list, the last one to the end of its parent's part.
+//
+class index_builder
+{
+public:
+    index_builder(ast const& t, names const& n, lsp_index& i)
+        : tree{t}
+        , where{n}
+        , index{i}
+    {
+    }
+
+    void build()
+    {
+        for (auto r : tree.design_units())
+        {
+            unit(tree[r]);
+        }
+        std::stable_sort(index.defs.begin(), index.defs.end(),
+                         [](auto const& a, auto const& b) { return a.name < b.name; });
+    }
+
+private:
+    void unit(design_unit const& u)
+    {
+        current = static_cast<std::uint32_t>(index.units.size());
+        index.units.push_back({u.kind, u.name, u.of, u.pos, u.end});
+        if (u.kind != unit_kind::package_body)
+        {
+            add(u.name, where.find(u.pos, u.name, true), reach::global, 0, 0);
+        }
+        decls(u.decls, reach::unit, u.pos, u.end);
+        stmts(u.stmts, u.pos, u.end);
+    }
+
+    void add(symbol_id name, std::size_t t, reach seen, offset_t begin, offset_t end)
+    {
+        if (name != no_symbol && t < where.tokens.size())
+        {
+            index.defs.push_back(
+                {name, seen, current, where.tokens.offset(t), begin, end, where.start(t), where.end(t)});
+        }
+    }
+
+    void decls(list<decl> l, reach seen, offset_t begin, offset_t end)
+    {
+        auto items = tree.items(l);
+        for (std::size_t k = 0; k < items.size(); k++)
+        {
+            auto const& d = tree[items[k]];
+            auto next = k + 1 < items.size() ? tree[items[k + 1]].pos : end;
+            if (d.kind == decl_kind::library || d.kind == decl_kind::use)
+            {
+                continue;
+            }
+            add(d.name, where.find(d.pos, d.name), seen, begin, end);
+            switch (d.kind)
+            {
+            case decl_kind::function:
+            case decl_kind::procedure:
+                decls(d.children, reach::local, d.pos, next);
+                if (d.body)
+                {
+                    auto const& body = tree[d.body];
+                    decls(body.decls, reach::local, d.pos, next);
+                    stmts(body.body, d.pos, next);
+                }
+                break;
+            case decl_kind::component:
+            case decl_kind::package: decls(d.children, reach::local, d.pos, next); break;
+            case decl_kind::type:
+                decls(d.children, seen, begin, end);
+                if (d.mode == token_type::Left_Paren && d.type)
+                {
+                    literals(d.type, seen, begin, end);
+                }
+                break;
+            default: break;
+            }
+        }
+    }
+
+    // the names of an enumeration
+    void literals(ref<expr> r, reach seen, offset_t begin, offset_t end)
+    {
+        auto const& e = tree[r];
+        if (e.kind == expr_kind::name)
+        {
+            add(e.symbol(), where.find(e.pos, e.symbol()), seen, begin, end);
+        }
+        else if (e.kind == expr_kind::aggregate)
+        {
+            for (auto item : tree.items(e.items()))
+            {
+                literals(item, seen, begin, end);
+            }
+        }
+    }
+
+    void stmts(list<stmt> l, offset_t begin, offset_t end)
+    {
+        auto items = tree.items(l);
+        for (std::size_t k = 0; k < items.size(); k++)
+        {
+            auto const& s = tree[items[k]];
+            add(s.label, where.find(s.pos, s.label), reach::local, begin, end);
+            statement(s, k + 1 < items.size() ? tree[items[k + 1]].pos : end);
+        }
+    }
+
+    void statement(stmt const& s, offset_t end)
+    {
+        switch (s.kind)
+        {
+        case stmt_kind::generate:
+        case stmt_kind::loop:
+            if (s.target && tree[s.target].kind == expr_kind::name) // the for parameter
+            {
+                auto name = tree[s.target].symbol();
+                add(name, where.find(tree[s.target].pos, name), reach::local, s.pos, end);
+            }
+            break;
+        default: break;
+        }
+        decls(s.decls, reach::local, s.pos, end);
+        stmts(s.body, s.pos, end);
+        if (s.alt)
+        {
+            statement(tree[s.alt], end);
+        }
+    }
+
+    ast const& tree;
+    names const& where;
+    lsp_index& index;
+    std::uint32_t current = 0;
+};
+
+//-----------------------------------------------------------------------
+//  symbol_writer: the DocumentSymbol tree of a document, design units with
+//  their declarations, processes, blocks, generates and instances
+//
+class symbol_writer
+{
+public:
+    symbol_writer(ast const& t, names const& n, json_writer& w)
+        : tree{t}
+        , where{n}
+        , out{w}
+    {
+    }
+
+    void units()
+    {
+        out.begin_array();
+        for (auto r : tree.design_units())
+        {
+            auto const& u = tree[r];
+            symbol_kind kind = symbol_kind::class_;
+            switch (u.kind)
+            {
+            case unit_kind::entity: kind = symbol_kind::class_; break;
+            case unit_kind::architecture:
+            case unit_kind::configuration: kind = symbol_kind::module; break;
+            case unit_kind::package:
+            case unit_kind::package_body: kind = symbol_kind::package; break;
+            case unit_kind::context: kind = symbol_kind::namespace_; break;
+            }
+            symbol(u.name, kind, kind_name(u.kind), u.pos, u.end, where.find(u.pos, u.name, true), [&] {
+                decls(u.decls, u.end);
+                stmts(u.stmts, u.end);
+            });
+        }
+        out.end_array();
+    }
+
+private:
+    template <class Children>
+    void symbol(symbol_id name, symbol_kind kind, std::string_view detail, offset_t begin, offset_t end,
+                std::size_t name_token, Children const& children)
+    {
+        auto shown = name == no_symbol ? detail : symbol_table::global().name(name);
+        auto first = where.at(begin);
+        auto last = where.at(std::max(begin, end));
+        auto name_start = name_token < where.tokens.size() ? where.start(name_token) : first;
+        auto name_end = name_token < where.tokens.size() ? where.end(name_token) : first;
+
+        out.begin_object();
+        out.key("name");
+        out.string(shown);
+        out.key("detail");
+        out.string(detail);
+        out.key("kind");
+        out.number(static_cast<std::int64_t>(kind));
+        out.key("range");
+        write_range(out, first, last);
+        out.key("selectionRange");
+        write_range(out, name_start, name_end);
+        out.key("children");
+        out.begin_array();
+        children();
+        out.end_array();
+        out.end_object();
+    }
+
+    void decls(list<decl> l, offset_t end)
+    {
+        auto items = tree.items(l);
+        for (std::size_t k = 0; k < items.size(); k++)
+        {
+            auto const& d = tree[items[k]];
+            auto next = k + 1 < items.size() ? tree[items[k + 1]].pos : end;
+            symbol_kind kind;
+            switch (d.kind)
+            {
+            case decl_kind::generic: kind = symbol_kind::type_parameter; break;
+            case decl_kind::port:
+            case decl_kind::attribute: kind = symbol_kind::property; break;
+            case decl_kind::signal:
+            case decl_kind::variable:
+            case decl_kind::shared_variable:
+            case decl_kind::alias: kind = symbol_kind::variable; break;
+            case decl_kind::constant: kind = symbol_kind::constant; break;
+            case decl_kind::file: kind = symbol_kind::file; break;
+            case decl_kind::type:
+                kind = d.mode == token_type::Record       ? symbol_kind::struct_
+                       : d.mode == token_type::Left_Paren ? symbol_kind::enum_
+                                                          : symbol_kind::class_;
+                break;
+            case decl_kind::subtype: kind = symbol_kind::class_; break;
+            case decl_kind::component: kind = symbol_kind::interface; break;
+            case decl_kind::function:
+            case decl_kind::procedure: kind = symbol_kind::function; break;
+            case decl_kind::element: kind = symbol_kind::field; break;
+            case decl_kind::package: kind = symbol_kind::package; break;
+            default: continue;
+            }
+            symbol(d.name, kind, kind_name(d.kind), d.pos, next, where.find(d.pos, d.name), [&] {
+                if (d.kind == decl_kind::component || d.kind == decl_kind::type || d.kind == decl_kind::package)
+                {
+                    decls(d.children, next);
+                }
+            });
+        }
+    }
+
+    void stmts(list<stmt> l, offset_t end)
+    {
+        auto items = tree.items(l);
+        for (std::size_t k = 0; k < items.size(); k++)
+        {
+            auto const& s = tree[items[k]];
+            auto next = k + 1 < items.size() ? tree[items[k + 1]].pos : end;
+            symbol_kind kind;
+            switch (s.kind)
+            {
+            case stmt_kind::process: kind = symbol_kind::event; break;
+            case stmt_kind::block:
+            case stmt_kind::generate: kind = symbol_kind::namespace_; break;
+            case stmt_kind::instance: kind = symbol_kind::object; break;
+            default: continue;
+            }
+            if (s.label == no_symbol && s.kind != stmt_kind::process)
+            {
+                continue;
+            }
+            symbol(s.label, kind, kind_name(s.kind), s.pos, next, where.find(s.pos, s.label), [&] {
+                for (auto const* part = &s; part != nullptr; part = part->alt ? &tree[part->alt] : nullptr)
+                {
+                    decls(part->decls, next);
+                    if (s.kind != stmt_kind::process)
+                    {
+                        stmts(part->body, next);
+                    }
+                }
+            });
+        }
+    }
+
+    ast const& tree;
+    names const& where;
+    json_writer& out;
+};
+
+//  the definition of name seen at offset in the unit of index; the
+//  innermost one whose part of the text holds offset, the last one in
+//  front of it when there are more
+//
+declared const* innermost(lsp_index const& index, symbol_id name, std::size_t offset)
+{
+    declared const* best = nullptr;
+    for (auto const& d : index.named(name))
+    {
+        if (d.seen == reach::global || offset < d.scope_begin || offset >= d.scope_end)
+        {
+            continue;
+        }
+        if (best == nullptr || d.scope_end - d.scope_begin < best->scope_end - best->scope_begin ||
+            (d.scope_end - d.scope_begin == best->scope_end - best->scope_begin && d.at <= offset))
+        {
+            best = &d;
+        }
+    }
+    return best;
+}
+
+//  the unit declaration name of the design unit called unit of kind
+//
+declared const* in_unit(lsp_index const& index, symbol_id name, unit_kind kind, symbol_id unit)
+{
+    for (auto const& d : index.named(name))
+    {
+        auto const& u = index.units[d.unit];
+        if (d.seen == reach::unit && u.kind == kind && u.name == unit)
+        {
+            return &d;
+        }
+    }
+    return nullptr;
+}
+
+declared const* anywhere(lsp_index const& index, symbol_id name)
+{
+    for (auto const& d : index.named(name))
+    {
+        if (d.seen == reach::global || (d.seen == reach::unit && index.units[d.unit].kind == unit_kind::package))
+        {
+            return &d;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+lsp_server::lsp_server(std::istream& input, std::ostream& output, unsigned jobs)
+    : in{input}
+    , out{output}
+    , pool{jobs}
+    , parser{[this](std::stop_token stop) { parse_loop(stop); }}
+{
+}
+
+lsp_server::~lsp_server() = default;
+
+//-----------------------------------------------------------------------
+//  read_message: the headers up to an empty line, then Content-Length
+//  bytes of body. A body over max_message comes back empty, to be
+//  answered as a parse error
+//
+bool lsp_server::read_message(std::string& body)
+{
+    std::size_t length = 0;
+    bool sized = false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty())
+        {
+            if (!sized)
+            {
+                continue;
+            }
+            if (length > max_message)
+            {
+                in.ignore(static_cast<std::streamsize>(
+                    std::min<std::size_t>(length, std::numeric_limits<std::streamsize>::max())));
+                body.clear();
+                return true;
+            }
+            body.resize(length);
+            in.read(body.data(), static_cast<std::streamsize>(length));
+            return static_cast<std::size_t>(in.gcount()) == length;
+        }
+        constexpr std::string_view header = "Content-Length:";
+        if (line.size() > header.size() && std::equal(header.begin(), header.end(), line.begin(), [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            }))
+        {
+            auto value = std::string_view{line}.substr(header.size());
+            value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+            sized = std::from_chars(value.data(), value.data() + value.size(), length).ec == std::errc{};
+        }
+    }
+    return false;
+}
+
+void lsp_server::send(std::string_view body)
+{
+    std::lock_guard lock{out_lock};
+    out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    out.flush();
+}
+
+template <class Write>
+void lsp_server::respond(json_value const& id, Write const& result)
+{
+    send(message([&](json_writer& w) {
+        w.key("id");
+        write_json(id, w);
+        w.key("result");
+        result(w);
+    }));
+}
+
+void lsp_server::fail(json_value const& id, int code, std::string_view text)
+{
+    send(message([&](json_writer& w) {
+        w.key("id");
+        write_json(id, w);
+        w.key("error");
+        w.begin_object();
+        w.key("code");
+        w.number(std::int64_t{code});
+        w.key("message");
+        w.string(text);
+        w.end_object();
+    }));
+}
+
+int lsp_server::run()
+{
+    std::string body;
+    while (read_message(body))
+    {
+        auto msg = json_value::parse(body);
+        if (!msg)
+        {
+            fail({}, parse_error, "invalid JSON");
+            continue;
+        }
+        if ((*msg)["method"].string() == "exit")
+        {
+            break;
+        }
+        handle(*msg);
+    }
+    return shut_down ? 0 : 1;
+}
+
+void lsp_server::handle(json_value const& msg)
+{
+    auto const& method = msg["method"];
+    auto const& id = msg["id"];
+    auto const& params = msg["params"];
+    if (method.type() != json_value::kind::string)
+    {
+        return; // a response
+    }
+
+    auto name = method.string();
+    if (name == "initialize")
+    {
+        initialize(id, params);
+    }
+    else if (name == "shutdown")
+    {
+        shut_down = true;
+        respond(id, [](json_writer& w) { w.null(); });
+    }
+    else if (name == "textDocument/didOpen")
+    {
+        open(params);
+    }
+    else if (name == "textDocument/didChange")
+    {
+        change(params);
+    }
+    else if (name == "textDocument/didClose")
+    {
+        close(params);
+    }
+    else if (name == "textDocument/documentSymbol")
+    {
+        document_symbols(id, params);
+    }
+    else if (name == "textDocument/definition")
+    {
+        definition(id, params);
+    }
+    else if (!id.is_null())
+    {
+        fail(id, method_not_found, name);
+    }
+}
+
+void lsp_server::initialize(json_value const& id, json_value const& params)
+{
+    for (auto const& encoding : params["capabilities"]["general"]["positionEncodings"].elements())
+    {
+        utf8 = utf8 || encoding.string() == "utf-8";
+    }
+    respond(id, [&](json_writer& w) {
+        w.begin_object();
+        w.key("capabilities");
+        w.begin_object();
+        w.key("positionEncoding");
+        w.string(utf8 ? "utf-8" : "utf-16");
+        w.key("textDocumentSync");
+        w.begin_object();
+        w.key("openClose");
+        w.boolean(true);
+        w.key("change");
+        w.number(std::int64_t{2}); // incremental
+        w.end_object();
+        w.key("documentSymbolProvider");
+        w.boolean(true);
+        w.key("definitionProvider");
+        w.boolean(true);
+        w.end_object();
+        w.key("serverInfo");
+        w.begin_object();
+        w.key("name");
+        w.string("vlark");
+        w.key("version");
+        w.string(vlark_version);
+        w.end_object();
+        w.end_object();
+    });
+}
+
+void lsp_server::open(json_value const& params)
+{
+    auto const& item = params["textDocument"];
+    auto doc = std::make_shared<lsp_document>();
+    doc->uri = item["uri"].string();
+    doc->text = item["text"].string();
+    doc->version = item["version"].integer();
+
+    std::lock_guard lock{docs_lock};
+    docs[doc->uri] = doc;
+    doc->edits.push_back({0, 0, doc->text, true});
+    queue(doc);
+}
+
+//  the changes apply one after the other, the range of each is into the
+//  text the one before left
+//
+void lsp_server::change(json_value const& params)
+{
+    std::lock_guard lock{docs_lock};
+    auto it = docs.find(std::string{params["textDocument"]["uri"].string()});
+    if (it == docs.end())
+    {
+        return;
+    }
+    auto& doc = it->second;
+    for (auto const& c : params["contentChanges"].elements())
+    {
+        auto const& range = c["range"];
+        if (range.is_null())
+        {
+            doc->text = c["text"].string();
+            doc->edits.push_back({0, 0, doc->text, true});
+            continue;
+        }
+        auto begin = offset_of(doc->text, range["start"], utf8);
+        auto end = std::max(begin, offset_of(doc->text, range["end"], utf8));
+        doc->text.replace(begin, end - begin, c["text"].string());
+        doc->edits.push_back(
+            {static_cast<offset_t>(begin), static_cast<offset_t>(end), std::string{c["text"].string()}, false});
+    }
+    doc->version = params["textDocument"]["version"].integer();
+    queue(doc);
+}
+
+void lsp_server::close(json_value const& params)
+{
+    std::string uri{params["textDocument"]["uri"].string()};
+    {
+        std::lock_guard lock{docs_lock};
+        auto it = docs.find(uri);
+        if (it == docs.end())
+        {
+            return;
+        }
+        it->second->closed = true;
+        docs.erase(it);
+    }
+    send(message([&](json_writer& w) {
+        w.key("method");
+        w.string("textDocument/publishDiagnostics");
+        w.key("params");
+        w.begin_object();
+        w.key("uri");
+        w.string(uri);
+        w.key("diagnostics");
+        w.begin_array();
+        w.end_array();
+        w.end_object();
+    }));
+}
+
+//  under docs_lock: hand the edits of doc to the parse thread
+//
+void lsp_server::queue(std::shared_ptr<lsp_document> const& doc)
+{
+    doc->queued_version = doc->version;
+    if (!doc->queued)
+    {
+        doc->queued = true;
+        dirty.push_back(doc);
+        wake.notify_one();
+    }
+}
+
+//  the document at uri once its latest version is parsed, null when it
+//  is not open
+//
+std::shared_ptr<lsp_document> lsp_server::parsed(std::string_view uri)
+{
+    std::unique_lock lock{docs_lock};
+    auto it = docs.find(std::string{uri});
+    if (it == docs.end())
+    {
+        return {};
+    }
+    auto doc = it->second;
+    done.wait(lock, [&] { return doc->parsed_version == doc->version; });
+    return doc;
+}
+
+namespace
+{
+
+//  bring the parser's side of doc up to date with edits: a whole text is
+//  parsed from scratch, the edits after it are reparsed one by one
+//
+void update(lsp_document& doc, std::vector<pending_edit>& edits, bool utf8)
+{
+    auto whole = std::find_if(edits.rbegin(), edits.rend(), [](auto const& e) { return e.whole; });
+    auto first = edits.begin();
+    if (whole != edits.rend())
+    {
+        first = whole.base();
+        doc.parsed_text = std::move(whole->text);
+        doc.tokens.clear();
+        tokenize(doc.parsed_text, doc.tokens);
+        doc.diags.clear();
+        doc.diags.append(doc.tokens.diags());
+        doc.tree = parse_design_units(doc.tokens, doc.parsed_text, doc.diags);
+    }
+    for (auto e = first; e != edits.end(); e++)
+    {
+        reparse(doc.parsed_text, doc.tokens, doc.tree, doc.diags, {e->begin, e->end, e->text});
+    }
+
+    doc.lines = {};
+    split_lines(doc.parsed_text, doc.lines);
+    auto index = std::make_shared<lsp_index>();
+    index->uri = doc.uri;
+    names where{doc.tokens, doc.parsed_text, doc.lines, utf8};
+    index_builder{doc.tree, where, *index}.build();
+    doc.fresh_index = std::move(index);
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  parse_loop: the parse thread. Takes the documents with edits, brings
+//  them up to date on the pool, one task each, then publishes their
+//  diagnostics and wakes the requests waiting for them.
+//
+void lsp_server::parse_loop(std::stop_token stop)
+{
+    for (;;)
+    {
+        std::vector<std::shared_ptr<lsp_document>> work;
+        std::vector<std::vector<pending_edit>> edits;
+        std::vector<std::int64_t> versions;
+        {
+            std::unique_lock lock{docs_lock};
+            if (!wake.wait(lock, stop, [this] { return !dirty.empty(); }))
+            {
+                return;
+            }
+            work.swap(dirty);
+            for (auto const& doc : work)
+            {
+                edits.push_back(std::move(doc->edits));
+                doc->edits.clear();
+                versions.push_back(doc->queued_version);
+                doc->queued = false;
+            }
+        }
+
+        pool.run(work.size(), [&](std::size_t k) { update(*work[k], edits[k], utf8); });
+
+        {
+            std::lock_guard lock{docs_lock};
+            for (std::size_t k = 0; k < work.size(); k++)
+            {
+                auto& doc = *work[k];
+                doc.index = std::move(doc.fresh_index);
+                doc.parsed_version = versions[k];
+                if (!doc.closed && doc.edits.empty())
+                {
+                    publish(doc);
+                }
+            }
+        }
+        done.notify_all();
+    }
+}
+
+void lsp_server::publish(lsp_document const& doc)
+{
+    send(message([&](json_writer& w) {
+        w.key("method");
+        w.string("textDocument/publishDiagnostics");
+        w.key("params");
+        w.begin_object();
+        w.key("uri");
+        w.string(doc.uri);
+        w.key("version");
+        w.number(doc.parsed_version);
+        w.key("diagnostics");
+        w.begin_array();
+        for (auto const& e : doc.diags.kept())
+        {
+            auto start = position_of(doc.parsed_text, doc.lines, e.offset, utf8);
+            auto end = position_of(doc.parsed_text, doc.lines,
+                                   std::min(std::size_t{e.offset} + e.length, doc.parsed_text.size()), utf8);
+            w.begin_object();
+            w.key("range");
+            write_range(w, start, end);
+            w.key("severity");
+            w.number(std::int64_t{e.sev == severity::error ? 1 : e.sev == severity::warning ? 2 : 3});
+            w.key("source");
+            w.string("vlark");
+            w.key("message");
+            w.string(diag_message(e.code));
+            w.end_object();
+        }
+        w.end_array();
+        w.end_object();
+    }));
+}
+
+void lsp_server::document_symbols(json_value const& id, json_value const& params)
+{
+    auto doc = parsed(params["textDocument"]["uri"].string());
+    if (!doc)
+    {
+        respond(id, [](json_writer& w) { w.null(); });
+        return;
+    }
+    names where{doc->tokens, doc->parsed_text, doc->lines, utf8};
+    respond(id, [&](json_writer& w) { symbol_writer{doc->tree, where, w}.units(); });
+}
+
+//-----------------------------------------------------------------------
+//  definition: the declaration of the name under the cursor. Looked for
+//  in the scopes around it, then in the entity of an architecture (or
+//  the package of a package body), then among the design units and the
+//  package declarations of all open documents.
+//
+void lsp_server::definition(json_value const& id, json_value const& params)
+{
+    auto doc = parsed(params["textDocument"]["uri"].string());
+    declared const* found = nullptr;
+    std::vector<std::shared_ptr<const lsp_index>> all; // the own one first
+    std::size_t owner = 0;                              // the one of found
+    if (doc)
+    {
+        auto offset = offset_of(doc->parsed_text, params["position"], utf8);
+        auto t = token_around(doc->tokens, offset);
+        if (t < doc->tokens.size() && doc->tokens.type(t) == token_type::Identifier)
+        {
+            auto name = doc->tokens.id(t);
+            {
+                std::lock_guard lock{docs_lock};
+                all.push_back(doc->index);
+                for (auto const& [uri, other] : docs)
+                {
+                    if (other != doc && other->index)
+                    {
+                        all.push_back(other->index);
+                    }
+                }
+            }
+
+            auto const& own = *all.front();
+            found = innermost(own, name, offset);
+            auto unit = std::find_if(own.units.begin(), own.units.end(),
+                                     [&](auto const& u) { return u.begin <= offset && offset < u.end; });
+            if (found == nullptr && unit != own.units.end())
+            {
+                bool architecture = unit->kind == unit_kind::architecture;
+                if (architecture || unit->kind == unit_kind::package_body)
+                {
+                    auto kind = architecture ? unit_kind::entity : unit_kind::package;
+                    auto of = architecture ? unit->of : unit->name;
+                    for (std::size_t k = 0; k < all.size() && found == nullptr; k++)
+                    {
+                        found = in_unit(*all[k], name, kind, of);
+                        owner = k;
+                    }
+                }
+            }
+            for (std::size_t k = 0; k < all.size() && found == nullptr; k++)
+            {
+                found = anywhere(*all[k], name);
+                owner = k;
+            }
+        }
+    }
+
+    respond(id, [&](json_writer& w) {
+        if (found == nullptr)
+        {
+            w.null();
+            return;
+        }
+        w.begin_object();
+        w.key("uri");
+        w.string(all[owner]->uri);
+        w.key("range");
+        write_range(w, found->start, found->end);
+        w.end_object();
+    });
+}
+
+} // namespace vlark
@@ -10,7 +10,86 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "ast_cache.h"
+#include "json_writer.h"
+#include "lsp_server.h"
 #include "parser.hpp"
+#include "project.h"
+#include "stream_tokenizer.h"
+#include <optional>
+
+namespace
+{
+
+//  --order: one line per design unit, wave by wave, a unit after all it needs
+//
+int print_order(vlark::CmdLine const& cmdline, vlark::ast_cache const* cache)
+{
+    vlark::project proj(cmdline.opt_jobs);
+    proj.set_cache(cache);
+    for (auto const& f : cmdline.files())
+    {
+        proj.add_file(f);
+    }
+    proj.scan();
+
+    bool failed = false;
+    for (auto const& f : proj.files())
+    {
+        f.diags.render(std::cerr, f.text(), f.path);
+        failed = failed || f.diags.has_errors();
+    }
+
+    auto units = proj.units();
+    auto waves = proj.waves();
+    auto& symbols = vlark::symbol_table::global();
+    for (std::size_t w = 0; w < waves.size(); w++)
+    {
+        for (auto u : waves[w])
+        {
+            auto const& unit = units[u];
+            std::cout << w << " " << vlark::kind_name(unit.kind) << " " << symbols.name(unit.name);
+            if (unit.of != vlark::no_symbol)
+            {
+                std::cout << " of " << symbols.name(unit.of);
+            }
+            std::cout << " " << proj.files()[unit.file].path << "\n";
+        }
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//  more than one file: the files are parsed on the pool in dependency
+//  order, each one as a whole, and printed in command line order
+//
+int parse_project(vlark::CmdLine const& cmdline, vlark::ast_cache const* cache, vlark::parse_mode mode)
+{
+    vlark::project proj(cmdline.opt_jobs);
+    proj.set_cache(cache);
+    for (auto const& f : cmdline.files())
+    {
+        proj.add_file(f);
+    }
+    proj.scan();
+    proj.parse(mode);
+
+    std::ios::sync_with_stdio(false);
+    vlark::json_writer json(std::cout, cmdline.opt_pretty);
+    bool failed = false;
+    for (auto const& f : proj.files())
+    {
+        f.diags.render(std::cerr, f.text(), f.path);
+        failed = failed || f.diags.has_errors();
+        if (cmdline.opt_print_ast)
+        {
+            vlark::write_json(f.tree, json, f.path);
+            json.next_document();
+        }
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+} // namespace
 
 int main(int argc, char* argv[])
 {
@@ -26,10 +105,56 @@ int main(int argc, char* argv[])
         return EXIT_SUCCESS;
     }
 
-    vlark::parser parser;
+    if (cmdline.opt_stdin)
+    {
+        std::ios::sync_with_stdio(false);
+        vlark::stream_tokenizer stream;
+        stream.run(std::cin, [](vlark::stream_token const& tk) { std::cout << tk.text << "\n"; });
+        std::cout.flush();
+        stream.diags().render(std::cerr, {}, "<stdin>");
+        return stream.diags().has_errors() ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    if (cmdline.opt_lsp)
+    {
+        std::ios::sync_with_stdio(false);
+        vlark::lsp_server server{std::cin, std::cout, cmdline.opt_jobs};
+        return server.run();
+    }
+
+    std::optional<vlark::ast_cache> cache;
+    if (!cmdline.opt_cache.empty())
+    {
+        cache.emplace(cmdline.opt_cache);
+    }
+
+    if (cmdline.opt_order)
+    {
+        return print_order(cmdline, cache ? &*cache : nullptr);
+    }
 
-    vlark::ast astV = parser.parse(cmdline.geet_filename());
-    (void)astV;
+    auto mode = cmdline.opt_outline ? vlark::parse_mode::outline : vlark::parse_mode::full;
+    if (cmdline.files().size() > 1)
+    {
+        return parse_project(cmdline, cache ? &*cache : nullptr, mode);
+    }
+
+    vlark::parser parser(cmdline.opt_jobs, mode);
+    parser.set_cache(cache ? &*cache : nullptr);
+
+    std::ios::sync_with_stdio(false);
+    vlark::json_writer json(std::cout, cmdline.opt_pretty);
+    bool failed = false;
+    for (auto const& f : cmdline.files())
+    {
+        vlark::ast astV = parser.parse(f);
+        failed = failed || parser.diags().has_errors();
+        if (cmdline.opt_print_ast)
+        {
+            vlark::write_json(astV, json, f);
+            json.next_document();
+        }
+    }
 
-    return 0;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
\ No newline at end of file
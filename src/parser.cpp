@@ -16,39 +16,93 @@
 
 #include "parser.hpp"
 #include "ast.hpp"
-#include <ranges>
+#include "ast_cache.h"
+#include "token_source.h"
+#include "work_pool.h"
 
 namespace vlark
 {
 
+parser::parser() = default;
+
+parser::parser(unsigned njobs, parse_mode m)
+    : jobs{njobs}
+    , mode{m}
+{
+    if (jobs != 1)
+    {
+        pool = std::make_unique<work_pool>(jobs);
+    }
+}
+
+parser::~parser() = default;
+
+ast parser::parse_text(std::string_view code)
+{
+    if (!pool)
+    {
+        token_source source{code};
+        return parse_design_units(source, issues, mode);
+    }
+    token_stream tokens;
+    return parse_tokens(code, tokens);
+}
+
+ast parser::parse_tokens(std::string_view code, token_stream& tokens)
+{
+    tokenize(code, tokens, jobs);
+    issues.append(tokens.diags());
+    return parse_design_units(tokens, code, issues, pool.get(), mode);
+}
+
+ast parser::parse_code(const std::string_view code)
+{
+    issues.clear();
+    return parse_text(code);
+}
+
+//-----------------------------------------------------------------------
+//  parse: tokenize and parse the file, see parse_text. A file found in
+//  the cache is not tokenized at all; one that is not is tokenized in
+//  full, the cache keeps its tokens next to the tree. A file that cannot
+//  be read or is empty gives an empty tree and an error.
+//
 ast parser::parse(const std::string_view filepath)
 {
     std::string fpath(filepath);
     vlark::sourceBuffer sbufferFile(fpath);
 
-    int count = 0;
-    for (auto& line : sbufferFile.get_lines())
+    issues.clear();
+    if (!sbufferFile.is_loaded() || sbufferFile.text().empty())
     {
-        std::cout << "Line " << count << ": [ " << static_cast<int>(line.cat) << " ]  " << line.text << std::endl;
-        count++;
+        issues.report(severity::error, sbufferFile.is_loaded() ? diag_code::empty_source : diag_code::cannot_read, 0);
+        issues.render(std::cerr, {}, filepath);
+        return {};
     }
 
-    auto tokenList = tokenize_lines(sbufferFile);
-
-    // Implement the parsing logic here
-    // This is just a placeholder
-    std::cout << "Parsing code: " << filepath << std::endl;
-    std::cout << "--------tokens-------------- \n";
+    if (cache != nullptr)
+    {
+        if (auto hit = cache->load(sbufferFile.text(), mode, issues))
+        {
+            issues.render(std::cerr, sbufferFile.text(), filepath);
+            return std::move(*hit);
+        }
+    }
 
-    for (auto tk : tokenList)
+    ast tree;
+    if (cache != nullptr)
+    {
+        token_stream tokens;
+        tree = parse_tokens(sbufferFile.text(), tokens);
+        cache->store(sbufferFile.text(), mode, tree, tokens, issues);
+    }
+    else
     {
-        std::cout << tk << "\n";
-        // std::cout << tk.as_string_view() << " -> " << token_tostr(tk.type()) << " line: " << tk.position().lineno <<
-        // " col: " << tk.position().colno << "\n";
+        tree = parse_text(sbufferFile.text());
     }
 
-    // Return a placeholder ast for demonstration purposes
-    return ast();
+    issues.render(std::cerr, sbufferFile.text(), filepath);
+    return tree;
 }
 
 } // namespace vlark
@@ -0,0 +1,508 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Project - the design units of a file set and their analysis order
+//===========================================================================
+
+#include "project.h"
+#include "unit_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+namespace vlark
+{
+
+namespace
+{
+
+//  the tree of src in mode, from cache when it is there
+//
+ast parsed(source_file const& src, parse_mode mode, ast_cache const* cache, diagnostics& found)
+{
+    if (auto hit = cache ? cache->load(src.text(), mode, found) : std::nullopt)
+    {
+        return std::move(*hit);
+    }
+    token_stream tokens;
+    tokenize(src.text(), tokens);
+    found.append(tokens.diags());
+    auto tree = parse_design_units(tokens, src.text(), found, nullptr, mode);
+    if (cache)
+    {
+        cache->store(src.text(), mode, tree, tokens, found);
+    }
+    return tree;
+}
+
+//  the identifiers of a name, outermost first (work.pkg.all: work pkg),
+//  arch is set to a of e(a)
+//
+void name_parts(ast const& tree, ref<expr> e, std::vector<symbol_id>& parts, symbol_id& arch)
+{
+    parts.clear();
+    while (e)
+    {
+        auto const& x = tree[e];
+        switch (x.kind)
+        {
+        case expr_kind::call:
+            if (auto args = tree.items(x.items()); args.size() == 1 && tree[args[0]].kind == expr_kind::name)
+            {
+                arch = tree.symbol(tree[args[0]].a);
+            }
+            e = {x.a};
+            break;
+        case expr_kind::select:
+            if (x.b != no_symbol)
+            {
+                parts.push_back(tree.symbol(x.b));
+            }
+            e = {x.a};
+            break;
+        case expr_kind::name: parts.push_back(tree.symbol(x.a)); e = {}; break;
+        default: e = {}; break;
+        }
+    }
+    std::reverse(parts.begin(), parts.end());
+}
+
+} // namespace
+
+void project::add_file(std::string path)
+{
+    sources.push_back({std::move(path)});
+}
+
+void project::add_source(std::string path, std::string text)
+{
+    sources.push_back({std::move(path), std::move(text), true});
+}
+
+//-----------------------------------------------------------------------
+//  scan: every file is read, tokenized and outline parsed in a task of
+//  its own, only its units and their references are kept. The graph is
+//  linked serially afterwards, it is small next to the sources.
+//
+void project::scan()
+{
+    std::vector<std::vector<scanned_unit>> found(sources.size());
+    pool.run(sources.size(), [&](std::size_t k) { scan_file(static_cast<std::uint32_t>(k), found[k]); });
+    link(found);
+    find_cycles();
+}
+
+void project::scan_file(std::uint32_t k, std::vector<scanned_unit>& found)
+{
+    auto& src = sources[k];
+    src.diags.clear();
+    if (src.from_memory && src.code.empty())
+    {
+        src.diags.report(severity::error, diag_code::empty_source, 0);
+        return;
+    }
+    if (!src.from_memory)
+    {
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(src.path, ec))
+        {
+            src.diags.report(severity::error, diag_code::cannot_read, 0);
+            return;
+        }
+        src.mapped = std::make_unique<sourceBuffer>(src.path);
+        if (!src.mapped->is_loaded() || src.mapped->text().empty())
+        {
+            src.diags.report(severity::error,
+                             src.mapped->is_loaded() ? diag_code::empty_source : diag_code::cannot_read, 0);
+            return;
+        }
+    }
+
+    auto tree = parsed(src, parse_mode::outline, cache, src.diags);
+
+    const symbol_id work = symbol_table::global().intern("work");
+    const symbol_id std_lib = symbol_table::global().intern("std");
+    std::vector<symbol_id> libraries;
+    std::vector<symbol_id> parts;
+
+    //  lib.pkg... names package pkg, any other name its first part
+    //
+    auto use = [&](scanned_unit& s, decl const& d) {
+        symbol_id arch = no_symbol;
+        name_parts(tree, d.type, parts, arch);
+        if (parts.empty())
+        {
+            return;
+        }
+        bool library = parts[0] == work || parts[0] == std_lib ||
+                       std::find(libraries.begin(), libraries.end(), parts[0]) != libraries.end();
+        if (library && parts.size() == 1)
+        {
+            return;
+        }
+        s.refs.push_back({library ? parts[1] : parts[0], no_symbol});
+    };
+
+    for (auto u : tree.design_units())
+    {
+        auto const& du = tree[u];
+        scanned_unit s{{k, du.kind, du.pos, tree.symbol(du.name), tree.symbol(du.of)}, {}};
+        libraries.clear();
+        for (auto c : tree.items(du.context))
+        {
+            if (tree[c].kind == decl_kind::library)
+            {
+                libraries.push_back(tree.symbol(tree[c].name));
+            }
+            else
+            {
+                use(s, tree[c]);
+            }
+        }
+        for (auto d : tree.items(du.decls))
+        {
+            if (tree[d].kind == decl_kind::use)
+            {
+                use(s, tree[d]);
+            }
+        }
+        for (auto st : tree.items(du.stmts))
+        {
+            if (tree[st].kind == stmt_kind::instance)
+            {
+                symbol_id arch = no_symbol;
+                name_parts(tree, tree[st].target, parts, arch);
+                if (!parts.empty())
+                {
+                    s.refs.push_back({parts.back(), arch});
+                }
+            }
+        }
+        found.push_back(std::move(s));
+    }
+}
+
+//-----------------------------------------------------------------------
+//  link: look the references up by name. Primary units share one name
+//  space per library, the first of a name wins. The edges are kept as
+//  two flat lists, needs and users, indexed by unit.
+//
+void project::link(std::vector<std::vector<scanned_unit>> const& found)
+{
+    nodes.clear();
+    for (auto const& file : found)
+    {
+        for (auto const& s : file)
+        {
+            nodes.push_back(s.unit);
+        }
+    }
+
+    std::unordered_map<symbol_id, std::uint32_t> primary;
+    std::unordered_map<symbol_id, std::vector<std::uint32_t>> architectures; // by entity
+    for (std::uint32_t u = 0; u < nodes.size(); u++)
+    {
+        auto const& n = nodes[u];
+        switch (n.kind)
+        {
+        case unit_kind::architecture: architectures[n.of].push_back(u); break;
+        case unit_kind::package_body: break;
+        default:
+            if (!primary.try_emplace(n.name, u).second)
+            {
+                sources[n.file].diags.report(severity::warning, diag_code::duplicate_unit, n.pos);
+            }
+            break;
+        }
+    }
+    auto find = [&](symbol_id name, unit_kind kind) {
+        auto it = primary.find(name);
+        return it != primary.end() && nodes[it->second].kind == kind ? it->second : ~0u;
+    };
+
+    need_start.assign(1, 0);
+    need_list.clear();
+    std::vector<std::uint32_t> wanted;
+    std::uint32_t u = 0;
+    for (auto const& file : found)
+    {
+        for (auto const& s : file)
+        {
+            auto const& n = nodes[u];
+            wanted.clear();
+            switch (n.kind)
+            {
+            case unit_kind::architecture: wanted.push_back(find(n.of, unit_kind::entity)); break;
+            case unit_kind::package_body: wanted.push_back(find(n.name, unit_kind::package)); break;
+            case unit_kind::configuration:
+                wanted.push_back(find(n.of, unit_kind::entity));
+                if (auto it = architectures.find(n.of); it != architectures.end())
+                {
+                    wanted.insert(wanted.end(), it->second.begin(), it->second.end());
+                }
+                break;
+            default: break;
+            }
+            for (auto r : s.refs)
+            {
+                auto it = primary.find(r.name);
+                if (it == primary.end())
+                {
+                    continue;
+                }
+                wanted.push_back(it->second);
+                if (auto arch = architectures.find(r.name); r.secondary != no_symbol && arch != architectures.end())
+                {
+                    for (auto a : arch->second)
+                    {
+                        if (nodes[a].name == r.secondary)
+                        {
+                            wanted.push_back(a);
+                        }
+                    }
+                }
+            }
+
+            std::sort(wanted.begin(), wanted.end());
+            wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+            for (auto d : wanted)
+            {
+                if (d != ~0u && d != u)
+                {
+                    need_list.push_back(d);
+                }
+            }
+            need_start.push_back(static_cast<std::uint32_t>(need_list.size()));
+            u++;
+        }
+    }
+
+    //  users: the needs turned around, counted first
+    //
+    user_start.assign(nodes.size() + 1, 0);
+    for (auto d : need_list)
+    {
+        user_start[d + 1]++;
+    }
+    for (std::size_t k = 1; k < user_start.size(); k++)
+    {
+        user_start[k] += user_start[k - 1];
+    }
+    user_list.resize(need_list.size());
+    auto fill = user_start;
+    for (std::uint32_t v = 0; v < nodes.size(); v++)
+    {
+        for (auto d : needs(v))
+        {
+            user_list[fill[d]++] = v;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+//  find_cycles: Tarjan's strongly connected components, with an explicit
+//  stack as a chain of packages can be deep. A component of more than
+//  one unit is a cycle (there are no self edges).
+//
+void project::find_cycles()
+{
+    constexpr std::uint32_t unvisited = ~0u;
+    const auto n = static_cast<std::uint32_t>(nodes.size());
+    std::vector<std::uint32_t> index(n, unvisited), low(n, 0);
+    std::vector<bool> on_stack(n, false);
+    std::vector<std::uint32_t> stack;
+    struct frame
+    {
+        std::uint32_t unit;
+        std::uint32_t edge;
+    };
+    std::vector<frame> calls;
+    std::uint32_t counter = 0;
+
+    loops.clear();
+    for (std::uint32_t root = 0; root < n; root++)
+    {
+        if (index[root] != unvisited)
+        {
+            continue;
+        }
+        calls.push_back({root, 0});
+        while (!calls.empty())
+        {
+            auto& f = calls.back();
+            const auto v = f.unit;
+            if (f.edge == 0)
+            {
+                index[v] = low[v] = counter++;
+                stack.push_back(v);
+                on_stack[v] = true;
+            }
+
+            auto out = needs(v);
+            if (f.edge < out.size())
+            {
+                auto w = out[f.edge++];
+                if (index[w] == unvisited)
+                {
+                    calls.push_back({w, 0});
+                }
+                else if (on_stack[w])
+                {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            if (low[v] == index[v])
+            {
+                std::vector<std::uint32_t> component;
+                std::uint32_t w = 0;
+                do
+                {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = false;
+                    component.push_back(w);
+                } while (w != v);
+                if (component.size() > 1)
+                {
+                    std::reverse(component.begin(), component.end());
+                    loops.push_back(std::move(component));
+                }
+            }
+            calls.pop_back();
+            if (!calls.empty())
+            {
+                auto p = calls.back().unit;
+                low[p] = std::min(low[p], low[v]);
+            }
+        }
+    }
+
+    for (auto const& loop : loops)
+    {
+        for (auto v : loop)
+        {
+            sources[nodes[v].file].diags.report(severity::error, diag_code::dependency_cycle, nodes[v].pos);
+        }
+    }
+}
+
+std::vector<std::vector<std::uint32_t>> project::waves() const
+{
+    std::vector<std::uint32_t> pending(nodes.size());
+    std::vector<std::uint32_t> ready;
+    for (std::uint32_t u = 0; u < nodes.size(); u++)
+    {
+        pending[u] = static_cast<std::uint32_t>(needs(u).size());
+        if (pending[u] == 0)
+        {
+            ready.push_back(u);
+        }
+    }
+
+    std::vector<std::vector<std::uint32_t>> result;
+    while (!ready.empty())
+    {
+        std::vector<std::uint32_t> next;
+        for (auto u : ready)
+        {
+            for (auto v : users(u))
+            {
+                if (--pending[v] == 0)
+                {
+                    next.push_back(v);
+                }
+            }
+        }
+        result.push_back(std::move(ready));
+        ready = std::move(next);
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------
+//  analyze: the units that need nothing start, every unit counts down
+//  the units it waits for and is spawned by the one finishing last.
+//
+std::size_t project::analyze(std::function<void(std::uint32_t)> const& task)
+{
+    std::vector<std::atomic<std::uint32_t>> pending(nodes.size());
+    std::vector<std::size_t> first;
+    for (std::uint32_t u = 0; u < nodes.size(); u++)
+    {
+        pending[u].store(static_cast<std::uint32_t>(needs(u).size()), std::memory_order_relaxed);
+        if (needs(u).empty())
+        {
+            first.push_back(u);
+        }
+    }
+
+    std::atomic<std::size_t> done{0};
+    pool.run(first, [&](std::size_t k) {
+        auto u = static_cast<std::uint32_t>(k);
+        task(u);
+        done.fetch_add(1, std::memory_order_relaxed);
+        for (auto v : users(u))
+        {
+            if (pending[v].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                pool.spawn(v);
+            }
+        }
+    });
+    return done.load();
+}
+
+//-----------------------------------------------------------------------
+//  parse: analyze() with the parse of its file as the task of a unit.
+//  The first unit of a file to come up parses it, the other units of the
+//  file wait for that. Files the schedule does not reach (no units, or
+//  only units in or behind a cycle) are parsed after.
+//
+void project::parse(parse_mode mode)
+{
+    std::vector<std::once_flag> once(sources.size());
+    auto parse_once = [&](std::size_t k) {
+        std::call_once(once[k], [&] { parse_file(static_cast<std::uint32_t>(k), mode); });
+    };
+    analyze([&](std::uint32_t u) { parse_once(nodes[u].file); });
+    pool.run(sources.size(), parse_once);
+}
+
+void project::parse_file(std::uint32_t k, parse_mode mode)
+{
+    auto& src = sources[k];
+    if (src.text().empty())
+    {
+        return; // not read or empty, scan() reported it
+    }
+    diagnostics found;
+    src.tree = parsed(src, mode, cache, found);
+
+    //  the findings of scan() on the graph stay, the ones of its outline
+    //  parse are replaced
+    //
+    for (auto const& d : src.diags.kept())
+    {
+        if (d.code == diag_code::duplicate_unit || d.code == diag_code::dependency_cycle)
+        {
+            found.report(d.sev, d.code, d.offset, d.length);
+        }
+    }
+    src.diags = std::move(found);
+}
+
+} // namespace vlark
@@ -0,0 +1,638 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Reparse - bring tokens and tree up to date after an edit of the text
+//===========================================================================
+
+#include "reparse.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+namespace vlark
+{
+
+namespace
+{
+
+using tt = token_type;
+
+enum class list_kind : std::uint8_t
+{
+    none, // the whens of a case, only looked into
+    declarations,
+    concurrent,
+    sequential,
+    units
+};
+
+constexpr std::size_t unknown = std::numeric_limits<std::size_t>::max();
+
+//  a range that can be parsed again: the old tokens [first, last), which
+//  are the items [from, to) of the kind list of owner (a design unit or a
+//  statement), or design units; text [lo, hi] holds them
+//
+struct region
+{
+    std::size_t first;
+    std::size_t last;
+    list_kind kind;
+    bool in_unit;
+    std::uint32_t owner;
+    std::size_t from;
+    std::size_t to;
+    offset_t lo;
+    offset_t hi;
+};
+
+bool error_in(std::span<const diagnostic> found, offset_t lo, offset_t hi)
+{
+    return std::any_of(found.begin(), found.end(), [=](auto const& e) { return lo <= e.offset && e.offset <= hi; });
+}
+
+//-----------------------------------------------------------------------
+//  region_finder: the regions around the old tokens [first_changed,
+//  last_changed), innermost first. A region runs from the start of an
+//  item to the start of a later one of the same list, so that the tokens
+//  after it are known to begin the next item; the last item of a list
+//  goes with the item around it.
+//
+class region_finder
+{
+public:
+    region_finder(token_stream const& t, ast const& a, std::size_t text_size, std::size_t s, std::size_t j)
+        : tokens{t}
+        , tree{a}
+        , end_offset{static_cast<offset_t>(text_size)}
+        , first_changed{s}
+        , last_changed{j}
+    {
+    }
+
+    std::vector<region> find(parse_mode mode, std::span<const diagnostic> errors);
+
+private:
+    template <class T>
+    void items(list<T> l, list_kind kind, bool sequential, bool in_unit, std::uint32_t owner);
+    void look_into(ref<decl> r, bool sequential);
+    void look_into(ref<stmt> r, bool sequential);
+
+    std::size_t token_at(offset_t pos) const;
+    std::size_t start_of(decl const& d) const;
+    std::size_t start_of(stmt const& s) const { return token_at(s.pos); }
+    std::size_t start_of(design_unit const& u) const { return token_at(u.pos); }
+    offset_t offset_of(std::size_t t) const { return t < tokens.size() ? tokens.offset(t) : end_offset; }
+
+    token_stream const& tokens;
+    ast const& tree;
+    offset_t end_offset;
+    std::size_t first_changed;
+    std::size_t last_changed;
+    std::vector<region> found{};
+};
+
+//  the token starting at pos, unknown when there is none
+//
+std::size_t region_finder::token_at(offset_t pos) const
+{
+    auto offs = tokens.offsets();
+    auto it = std::lower_bound(offs.begin(), offs.end(), pos);
+    return it != offs.end() && *it == pos ? static_cast<std::size_t>(it - offs.begin()) : unknown;
+}
+
+//  first token of a declaration. An object declaration sits at its name,
+//  the names of "signal a, b : bit;" all start at the keyword; interface
+//  elements have no start of their own
+//
+std::size_t region_finder::start_of(decl const& d) const
+{
+    auto t = token_at(d.pos);
+    if (t == unknown)
+    {
+        return unknown;
+    }
+    auto keyword = tt::Invalid;
+    switch (d.kind)
+    {
+    case decl_kind::signal: keyword = tt::Signal; break;
+    case decl_kind::constant: keyword = tt::Constant; break;
+    case decl_kind::variable:
+    case decl_kind::shared_variable: keyword = tt::Variable; break;
+    case decl_kind::file: keyword = tt::File; break;
+    case decl_kind::use:
+        while (t > 0 && tokens.type(t) != tt::Use && tokens.type(t) != tt::Context)
+        {
+            if (tokens.type(--t) == tt::Semi_Colon)
+            {
+                return unknown;
+            }
+        }
+        return t;
+    case decl_kind::type:
+    case decl_kind::subtype:
+    case decl_kind::component:
+    case decl_kind::function:
+    case decl_kind::procedure:
+    case decl_kind::alias:
+    case decl_kind::attribute:
+    case decl_kind::package: return t;
+    default: return unknown;
+    }
+
+    while (t > 0 && (tokens.type(t - 1) == tt::Identifier || tokens.type(t - 1) == tt::Comma))
+    {
+        t--;
+    }
+    if (t == 0 || tokens.type(t - 1) != keyword)
+    {
+        return unknown;
+    }
+    t--;
+    if (d.kind == decl_kind::shared_variable)
+    {
+        return t > 0 && tokens.type(t - 1) == tt::Shared ? t - 1 : unknown;
+    }
+    return t;
+}
+
+template <class T>
+void region_finder::items(list<T> l, list_kind kind, bool sequential, bool in_unit, std::uint32_t owner)
+{
+    auto refs = tree.items(l);
+    auto key = [&](std::size_t k) {
+        auto t = start_of(tree[refs[k]]);
+        return t != unknown ? t : token_at(tree[refs[k]].pos);
+    };
+
+    //  the last item that starts at or before the first changed token,
+    //  with the items that share its start
+    //
+    std::size_t lo = 0;
+    std::size_t hi = refs.size();
+    while (lo < hi)
+    {
+        auto mid = lo + (hi - lo) / 2;
+        if (key(mid) <= first_changed)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (lo == 0)
+    {
+        return;
+    }
+    auto from = lo - 1;
+    auto to = lo;
+    auto start = start_of(tree[refs[from]]);
+    if (start != unknown)
+    {
+        while (from > 0 && start_of(tree[refs[from - 1]]) == start)
+        {
+            from--;
+        }
+        while (to < refs.size() && start_of(tree[refs[to]]) == start)
+        {
+            to++;
+        }
+    }
+
+    for (auto k = from; k < to; k++)
+    {
+        look_into(refs[k], sequential);
+    }
+    if (kind == list_kind::none || start == unknown)
+    {
+        return;
+    }
+
+    //  up to the first item behind the changed tokens
+    //
+    auto next = unknown;
+    for (; to < refs.size(); to++)
+    {
+        next = start_of(tree[refs[to]]);
+        if (next == unknown || next >= last_changed)
+        {
+            break;
+        }
+    }
+    if (to == refs.size())
+    {
+        return;
+    }
+    if (next != unknown)
+    {
+        found.push_back({start, next, kind, in_unit, owner, from, to, offset_of(start), offset_of(next)});
+    }
+}
+
+void region_finder::look_into(ref<decl> r, bool)
+{
+    auto const& d = tree[r];
+    if ((d.kind == decl_kind::function || d.kind == decl_kind::procedure) && d.body)
+    {
+        look_into(d.body, true);
+    }
+}
+
+void region_finder::look_into(ref<stmt> r, bool sequential)
+{
+    auto const& s = tree[r];
+    auto body = sequential ? list_kind::sequential : list_kind::concurrent;
+    switch (s.kind)
+    {
+    case stmt_kind::process:
+        items(s.decls, list_kind::declarations, true, false, r.index);
+        items(s.body, list_kind::sequential, true, false, r.index);
+        break;
+    case stmt_kind::block:
+    case stmt_kind::when:
+        items(s.decls, list_kind::declarations, sequential, false, r.index);
+        items(s.body, body, sequential, false, r.index);
+        break;
+    case stmt_kind::generate:
+        items(s.decls, list_kind::declarations, false, false, r.index);
+        items(s.body, list_kind::concurrent, false, false, r.index);
+        if (s.alt)
+        {
+            look_into(s.alt, false);
+        }
+        break;
+    case stmt_kind::if_:
+        items(s.body, list_kind::sequential, true, false, r.index);
+        if (s.alt)
+        {
+            look_into(s.alt, true);
+        }
+        break;
+    case stmt_kind::case_: items(s.body, list_kind::none, sequential, false, r.index); break;
+    case stmt_kind::loop: items(s.body, list_kind::sequential, true, false, r.index); break;
+    default: break;
+    }
+}
+
+//  The design units around the changes come last, they always take: the
+//  first from token 0 on, the last up to the end. A unit with an error
+//  right at the start of the next one may have run into it, it is taken
+//  along.
+//
+std::vector<region> region_finder::find(parse_mode mode, std::span<const diagnostic> errors)
+{
+    auto units = tree.design_units();
+    std::size_t lo = 0;
+    std::size_t hi = units.size();
+    while (lo < hi)
+    {
+        auto mid = lo + (hi - lo) / 2;
+        if (start_of(tree[units[mid]]) <= first_changed)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if (lo != 0 && mode == parse_mode::full)
+    {
+        auto r = units[lo - 1];
+        auto const& u = tree[r];
+        switch (u.kind)
+        {
+        case unit_kind::entity:
+        case unit_kind::architecture:
+        case unit_kind::package:
+        case unit_kind::package_body:
+            items(u.decls, list_kind::declarations, false, true, r.index);
+            items(u.stmts, list_kind::concurrent, false, true, r.index);
+            break;
+        default: break;
+        }
+    }
+
+    auto from = lo == 0 ? 0 : lo - 1;
+    while (from > 0 && error_in(errors, tree[units[from]].pos, tree[units[from]].pos))
+    {
+        from--;
+    }
+    auto to = lo;
+    while (to < units.size() && start_of(tree[units[to]]) < last_changed)
+    {
+        to++;
+    }
+    auto first = from == 0 ? 0 : start_of(tree[units[from]]);
+    auto last = to < units.size() ? start_of(tree[units[to]]) : tokens.size();
+    found.push_back({first, last, list_kind::units, true, 0, from, to, offset_of(first), offset_of(last)});
+    return std::move(found);
+}
+
+//  the entries of found outside [lo, hi) (old offsets), moved like the
+//  text behind the edit, with added, in order of their offsets
+//
+struct old_range
+{
+    std::size_t lo;
+    std::size_t hi;
+};
+
+void update(diagnostics& found, std::initializer_list<old_range> gone, offset_t moved_from, std::int64_t shift,
+            std::span<const diagnostic> added)
+{
+    std::vector<diagnostic> all;
+    for (auto e : found.kept())
+    {
+        if (std::any_of(gone.begin(), gone.end(), [&](auto g) { return g.lo <= e.offset && e.offset < g.hi; }))
+        {
+            continue;
+        }
+        if (e.offset >= moved_from)
+        {
+            e.offset = static_cast<std::uint64_t>(static_cast<std::int64_t>(e.offset) + shift);
+        }
+        all.push_back(e);
+    }
+    all.insert(all.end(), added.begin(), added.end());
+    std::stable_sort(all.begin(), all.end(), [](auto const& a, auto const& b) { return a.offset < b.offset; });
+
+    found.clear();
+    for (auto const& e : all)
+    {
+        found.report(e.sev, e.code, e.offset, e.length);
+    }
+}
+
+//  the entries of found that are not in scanned, scanned holds a part of
+//  found
+//
+diagnostics parser_findings(diagnostics const& found, diagnostics const& scanned)
+{
+    auto key = [](diagnostic const& e) { return std::tuple{e.offset, e.code, e.length, e.sev}; };
+    auto less = [&](diagnostic const& a, diagnostic const& b) { return key(a) < key(b); };
+    std::vector<diagnostic> left(scanned.kept().begin(), scanned.kept().end());
+    std::sort(left.begin(), left.end(), less);
+
+    diagnostics parser;
+    for (auto const& e : found.kept())
+    {
+        auto it = std::lower_bound(left.begin(), left.end(), e, less);
+        if (it != left.end() && key(*it) == key(e))
+        {
+            left.erase(it);
+            continue;
+        }
+        parser.report(e.sev, e.code, e.offset, e.length);
+    }
+    return parser;
+}
+
+//  found as the entries of both, in order of their offsets
+//
+void merge(diagnostics& found, diagnostics const& a, diagnostics const& b)
+{
+    found.clear();
+    std::vector<diagnostic> all(a.kept().begin(), a.kept().end());
+    all.insert(all.end(), b.kept().begin(), b.kept().end());
+    update(found, {}, 0, 0, all);
+}
+
+//  old list l with its items [from, to) replaced by with
+//
+template <class T>
+list<T> replaced(ast& tree, list<T> l, std::size_t from, std::size_t to, std::span<const ref<T>> with)
+{
+    auto old = tree.items(l);
+    std::vector<ref<T>> all(old.begin(), old.begin() + static_cast<std::ptrdiff_t>(from));
+    all.insert(all.end(), with.begin(), with.end());
+    all.insert(all.end(), old.begin() + static_cast<std::ptrdiff_t>(to), old.end());
+    return tree.add_list<T>(all);
+}
+
+//  parse the items of r, in the new token range [first, last), again and
+//  put them in the tree when they come out without error. Design units
+//  always take; as in parse_design_units their range ends at a clean cut
+//  only, while it does not the next unit is taken along (r and last grow,
+//  shift is the one of the edit).
+//
+bool take(region& r, std::size_t first, std::size_t& last, std::int64_t shift, std::string_view text,
+          token_stream const& tokens, ast& tree, diagnostics& issues, parse_mode mode)
+{
+    if (r.kind == list_kind::units)
+    {
+        auto old = tree.design_units();
+        std::vector<ref<design_unit>> found;
+        for (;;)
+        {
+            unit_parser p{tokens, text, tree, issues, first, last};
+            p.set_mode(mode);
+            p.design_units(found);
+            if (r.to == old.size() || clean_end(tree, found, issues))
+            {
+                break;
+            }
+            r.to++;
+            auto offs = tokens.offsets();
+            auto at = r.to < old.size() ? tree[old[r.to]].pos : static_cast<offset_t>(text.size());
+            last = static_cast<std::size_t>(std::lower_bound(offs.begin(), offs.end(), at) - offs.begin());
+            r.hi = static_cast<offset_t>(static_cast<std::int64_t>(at) - shift);
+            found.clear();
+            issues.clear();
+        }
+        std::vector<ref<design_unit>> all(old.begin(), old.begin() + static_cast<std::ptrdiff_t>(r.from));
+        all.insert(all.end(), found.begin(), found.end());
+        all.insert(all.end(), old.begin() + static_cast<std::ptrdiff_t>(r.to), old.end());
+        tree.set_design_units(all);
+        return true;
+    }
+
+    unit_parser p{tokens, text, tree, issues, first, last};
+    p.set_mode(mode);
+    if (r.kind == list_kind::declarations)
+    {
+        std::vector<ref<decl>> found;
+        if (!p.declaration_items(found) || issues.total() != 0)
+        {
+            return false;
+        }
+        auto old = r.in_unit ? tree[ref<design_unit>{r.owner}].decls : tree[ref<stmt>{r.owner}].decls;
+        auto l = replaced(tree, old, r.from, r.to, std::span<const ref<decl>>(found));
+        (r.in_unit ? tree[ref<design_unit>{r.owner}].decls : tree[ref<stmt>{r.owner}].decls) = l;
+        return true;
+    }
+
+    std::vector<ref<stmt>> found;
+    if (!p.statement_items(r.kind == list_kind::sequential, found) || issues.total() != 0)
+    {
+        return false;
+    }
+    auto old = r.in_unit ? tree[ref<design_unit>{r.owner}].stmts : tree[ref<stmt>{r.owner}].body;
+    auto l = replaced(tree, old, r.from, r.to, std::span<const ref<stmt>>(found));
+    (r.in_unit ? tree[ref<design_unit>{r.owner}].stmts : tree[ref<stmt>{r.owner}].body) = l;
+    return true;
+}
+
+reparse_stats parse_again(std::string& text, token_stream& tokens, ast& tree, diagnostics& diags,
+                          text_edit const& edit, parse_mode mode)
+{
+    auto keep = tokens.trivia().empty() ? trivia_mode::skip : trivia_mode::keep;
+    text.replace(edit.begin, edit.end - edit.begin, edit.text);
+    tokens.clear();
+    tokenize(text, tokens, 1, keep);
+    diags.clear();
+    diags.append(tokens.diags());
+    auto units = tree.design_units().size();
+    tree = parse_design_units(tokens, text, diags, nullptr, mode);
+    return {tokens.size(), tokens.size(), units, true};
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  The scan starts behind the token before the first one the edit can
+//  change (scan_lookahead), with the type of that token as prev. A new
+//  token behind the edit that has the type, length and flags of the old
+//  token at its (moved) offset is scanned from the same text in the same
+//  way, and so are all after it: the old stream is taken up again there.
+//
+reparse_stats reparse(std::string& text, token_stream& tokens, ast& tree, diagnostics& diags, text_edit const& edit,
+                      parse_mode mode)
+{
+    assert(edit.begin <= edit.end && edit.end <= text.size());
+    if (!tokens.trivia().empty() || diags.dropped() != 0 || tokens.diags().dropped() != 0 || tree.file_numbered())
+    {
+        return parse_again(text, tokens, tree, diags, edit, mode);
+    }
+
+    auto const n = tokens.size();
+    auto const old_size = text.size();
+    auto const shift = static_cast<std::int64_t>(edit.text.size()) - static_cast<std::int64_t>(edit.end - edit.begin);
+
+    std::size_t s = 0;
+    std::size_t hi = n;
+    while (s < hi)
+    {
+        auto mid = s + (hi - s) / 2;
+        if (std::size_t{tokens.offset(mid)} + tokens.length(mid) + scan_lookahead < edit.begin)
+        {
+            s = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    std::size_t at = s == 0 ? 0 : std::size_t{tokens.offset(s - 1)} + tokens.length(s - 1);
+    auto const scan_from = at;
+    auto prev = s == 0 ? tt::Eof : tokens.type(s - 1);
+    std::uint8_t flags = s == 0 ? token_stream::line_start : token_stream::none;
+
+    text.replace(edit.begin, edit.end - edit.begin, edit.text);
+    auto const changed_end = std::size_t{edit.begin} + edit.text.size();
+
+    token_stream fresh;
+    diagnostics relexed;
+    auto j = s;
+    for (;;)
+    {
+        token tk = scan_next(text, at, text.size(), flags, prev, tokens.literals(), nullptr, 0);
+        if (tk.type() == tt::Eof)
+        {
+            j = n;
+            break;
+        }
+        if (tk.offset() >= changed_end)
+        {
+            auto old_at = static_cast<offset_t>(tk.offset() - shift);
+            while (j < n && tokens.offset(j) < old_at)
+            {
+                j++;
+            }
+            if (j < n && tokens.offset(j) == old_at && tokens.type(j) == tk.type() &&
+                tokens.length(j) == tk.length() && tokens.flags(j) == flags)
+            {
+                break;
+            }
+        }
+        if (tk.type() == tt::Invalid)
+        {
+            relexed.report(severity::error, invalid_code(tk.text(text)), tk.offset(), tk.length());
+            continue;
+        }
+        fresh.push_back(tk, flags);
+        flags = token_stream::none;
+    }
+
+    //  the tokens in front of the edit that came out as they were
+    //
+    auto same = s;
+    while (same < j && same - s < fresh.size() && tokens.offset(same) + tokens.length(same) <= edit.begin &&
+           tokens.type(same) == fresh.type(same - s) && tokens.offset(same) == fresh.offset(same - s) &&
+           tokens.length(same) == fresh.length(same - s) && tokens.flags(same) == fresh.flags(same - s))
+    {
+        same++;
+    }
+
+    reparse_stats stats{fresh.size()};
+    old_range scanned{scan_from, j < n ? std::size_t{tokens.offset(j)} : old_size};
+    bool changed = same != j || fresh.size() != j - s;
+    std::vector<region> regions;
+    if (changed)
+    {
+        regions = region_finder{tokens, tree, old_size, same, j}.find(mode, diags.kept());
+    }
+
+    //  diags are the scanner findings, tokens keeps them up to date, and the
+    //  parser ones: they move with the text, those of a region parsed again
+    //  are replaced
+    //
+    auto parsed = parser_findings(diags, tokens.diags());
+    tokens.splice(s, j, fresh, shift);
+    tree.shift_offsets(edit.end, shift);
+    update(tokens.diags(), {scanned}, edit.end, shift, relexed.kept());
+    if (!changed)
+    {
+        update(parsed, {}, edit.end, shift, {});
+        merge(diags, tokens.diags(), parsed);
+        return stats;
+    }
+
+    auto grow = static_cast<std::ptrdiff_t>(fresh.size()) - static_cast<std::ptrdiff_t>(j - s);
+    for (auto& r : regions)
+    {
+        if (r.kind != list_kind::units && error_in(diags.kept(), r.lo, r.hi))
+        {
+            continue;
+        }
+        auto last = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(r.last) + grow);
+        diagnostics issues;
+        if (take(r, r.first, last, shift, text, tokens, tree, issues, mode))
+        {
+            stats.reparsed = last - r.first;
+            stats.replaced = r.to - r.from;
+            stats.whole_units = r.kind == list_kind::units;
+
+            update(parsed, {{r.lo, std::size_t{r.hi} + 1}}, edit.end, shift, issues.kept());
+            break;
+        }
+    }
+    merge(diags, tokens.diags(), parsed);
+    return stats;
+}
+
+} // namespace vlark
@@ -0,0 +1,513 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  SIMD kernels - byte scanning used by the source and token layers
+//===========================================================================
+
+#include "simd.h"
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define VLARK_SIMD_X86 1
+#else
+#define VLARK_SIMD_X86 0
+#endif
+
+//  AVX2 kernels are compiled with a target attribute and picked at runtime,
+//  the rest of the code stays baseline x86-64
+//
+#if VLARK_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define VLARK_SIMD_AVX2 1
+#define VLARK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define VLARK_SIMD_AVX2 0
+#endif
+
+namespace vlark::simd
+{
+
+isa best()
+{
+#if VLARK_SIMD_AVX2
+    static const isa level = __builtin_cpu_supports("avx2") ? isa::avx2 : isa::sse2;
+    return level;
+#elif VLARK_SIMD_X86
+    return isa::sse2;
+#else
+    return isa::scalar;
+#endif
+}
+
+std::string_view isa_name(isa level)
+{
+    switch (level)
+    {
+    case isa::scalar: return "scalar";
+    case isa::sse2: return "sse2";
+    case isa::avx2: return "avx2";
+    }
+    return "unknown";
+}
+
+namespace
+{
+
+//-----------------------------------------------------------------------
+//  scalar kernels, also used for the tails of the vector loops
+//
+void find_newlines_scalar(std::string_view text, std::size_t i, std::vector<std::uint32_t>& starts)
+{
+    for (; i < text.size(); i++)
+    {
+        if (text[i] == '\n')
+        {
+            starts.push_back(static_cast<std::uint32_t>(i + 1));
+        }
+    }
+}
+
+std::size_t class_run_scalar(std::string_view text, std::size_t i, char_class cls)
+{
+    while (i < text.size() && (class_table[static_cast<unsigned char>(text[i])] & cls) != 0)
+    {
+        i++;
+    }
+    return i;
+}
+
+std::size_t find_pair_scalar(std::string_view text, std::size_t i, char a, char b)
+{
+    for (; i + 1 < text.size(); i++)
+    {
+        if (text[i] == a && text[i + 1] == b)
+        {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+std::size_t find_either_scalar(std::string_view text, std::size_t i, char a, char b)
+{
+    for (; i < text.size(); i++)
+    {
+        if (text[i] == a || text[i] == b)
+        {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+constexpr bool needs_escape(char c)
+{
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+std::size_t escape_free_run_scalar(std::string_view text, std::size_t i)
+{
+    while (i < text.size() && !needs_escape(text[i]))
+    {
+        i++;
+    }
+    return i;
+}
+
+#if VLARK_SIMD_X86
+
+//-----------------------------------------------------------------------
+//  SSE2 kernels, 16 bytes per step
+//
+inline __m128i load16(const char* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline unsigned mask16(__m128i v)
+{
+    return static_cast<unsigned>(_mm_movemask_epi8(v));
+}
+
+// 0xff for every byte in lo ... lo + n
+inline __m128i range16(__m128i x, char lo, char n)
+{
+    __m128i d = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(n)), d);
+}
+
+// 0xff for every byte of class C, the sets of class_table
+template <char_class C>
+inline __m128i class16(__m128i x)
+{
+    if constexpr (C == space)
+    {
+        return _mm_or_si128(range16(x, '\t', 4), _mm_cmpeq_epi8(x, _mm_set1_epi8(' ')));
+    }
+    else if constexpr (C == digit)
+    {
+        return _mm_or_si128(range16(x, '0', 9), _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+    }
+    else
+    {
+        return _mm_or_si128(range16(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 25), class16<digit>(x));
+    }
+}
+
+void find_newlines_sse2(std::string_view text, std::vector<std::uint32_t>& starts)
+{
+    const char* p = text.data();
+    const __m128i nl = _mm_set1_epi8('\n');
+    std::size_t i = 0;
+    for (; i + 16 <= text.size(); i += 16)
+    {
+        for (auto m = mask16(_mm_cmpeq_epi8(load16(p + i), nl)); m != 0; m &= m - 1)
+        {
+            starts.push_back(static_cast<std::uint32_t>(i + static_cast<std::size_t>(std::countr_zero(m)) + 1));
+        }
+    }
+    find_newlines_scalar(text, i, starts);
+}
+
+template <char_class C>
+std::size_t class_run_sse2(std::string_view text)
+{
+    const char* p = text.data();
+    std::size_t i = 0;
+    for (; i + 16 <= text.size(); i += 16)
+    {
+        auto m = ~mask16(class16<C>(load16(p + i))) & 0xffffu;
+        if (m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+    }
+    return class_run_scalar(text, i, C);
+}
+
+std::size_t find_pair_sse2(std::string_view text, char a, char b)
+{
+    const char* p = text.data();
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    std::size_t i = 0;
+    for (; i + 17 <= text.size(); i += 16)
+    {
+        auto m = mask16(_mm_and_si128(_mm_cmpeq_epi8(load16(p + i), va), _mm_cmpeq_epi8(load16(p + i + 1), vb)));
+        if (m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+    }
+    return find_pair_scalar(text, i, a, b);
+}
+
+inline unsigned either16(const char* p, __m128i va, __m128i vb)
+{
+    __m128i x = load16(p);
+    return mask16(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)));
+}
+
+std::size_t find_either_sse2(std::string_view text, char a, char b)
+{
+    const char* p = text.data();
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    std::size_t i = 0;
+    for (; i + 16 <= text.size(); i += 16)
+    {
+        if (auto m = either16(p + i, va, vb); m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+    }
+    return find_either_scalar(text, i, a, b);
+}
+
+//  '"', '\\' or a control char: min(x, 0x1f) == x is an unsigned x <= 0x1f
+//
+inline unsigned escape16(__m128i x)
+{
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1f)), x);
+    __m128i quote = _mm_cmpeq_epi8(x, _mm_set1_epi8('"'));
+    __m128i slash = _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'));
+    return mask16(_mm_or_si128(ctl, _mm_or_si128(quote, slash)));
+}
+
+std::size_t escape_free_run_sse2(std::string_view text)
+{
+    const char* p = text.data();
+    std::size_t i = 0;
+    for (; i + 16 <= text.size(); i += 16)
+    {
+        if (auto m = escape16(load16(p + i)); m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+    }
+    return escape_free_run_scalar(text, i);
+}
+
+#endif // VLARK_SIMD_X86
+
+#if VLARK_SIMD_AVX2
+
+//-----------------------------------------------------------------------
+//  AVX2 kernels, 32 bytes per step
+//
+VLARK_TARGET_AVX2 inline __m256i load32(const char* p)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+VLARK_TARGET_AVX2 inline std::uint32_t mask32(__m256i v)
+{
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(v));
+}
+
+VLARK_TARGET_AVX2 inline __m256i range32(__m256i x, char lo, char n)
+{
+    __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(n)), d);
+}
+
+template <char_class C>
+VLARK_TARGET_AVX2 inline __m256i class32(__m256i x)
+{
+    if constexpr (C == space)
+    {
+        return _mm256_or_si256(range32(x, '\t', 4), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')));
+    }
+    else if constexpr (C == digit)
+    {
+        return _mm256_or_si256(range32(x, '0', 9), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')));
+    }
+    else
+    {
+        return _mm256_or_si256(range32(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 25), class32<digit>(x));
+    }
+}
+
+VLARK_TARGET_AVX2 void find_newlines_avx2(std::string_view text, std::vector<std::uint32_t>& starts)
+{
+    const char* p = text.data();
+    const __m256i nl = _mm256_set1_epi8('\n');
+    std::size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32)
+    {
+        for (auto m = mask32(_mm256_cmpeq_epi8(load32(p + i), nl)); m != 0; m &= m - 1)
+        {
+            starts.push_back(static_cast<std::uint32_t>(i + static_cast<std::size_t>(std::countr_zero(m)) + 1));
+        }
+    }
+    find_newlines_scalar(text, i, starts);
+}
+
+template <char_class C>
+VLARK_TARGET_AVX2 std::size_t class_run_avx2(std::string_view text)
+{
+    const char* p = text.data();
+    std::size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32)
+    {
+        auto m = ~mask32(class32<C>(load32(p + i)));
+        if (m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+    }
+
+    //  most names and constants are short, give the tail a 16 byte step
+    //
+    if (i + 16 <= text.size())
+    {
+        auto m = ~mask16(class16<C>(load16(p + i))) & 0xffffu;
+        if (m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+        i += 16;
+    }
+    return class_run_scalar(text, i, C);
+}
+
+VLARK_TARGET_AVX2 std::size_t find_pair_avx2(std::string_view text, char a, char b)
+{
+    const char* p = text.data();
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    std::size_t i = 0;
+    for (; i + 33 <= text.size(); i += 32)
+    {
+        auto m = mask32(
+            _mm256_and_si256(_mm256_cmpeq_epi8(load32(p + i), va), _mm256_cmpeq_epi8(load32(p + i + 1), vb)));
+        if (m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+    }
+    return find_pair_scalar(text, i, a, b);
+}
+
+VLARK_TARGET_AVX2 std::size_t find_either_avx2(std::string_view text, char a, char b)
+{
+    const char* p = text.data();
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    std::size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32)
+    {
+        __m256i x = load32(p + i);
+        auto m = mask32(_mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb)));
+        if (m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+    }
+
+    //  strings are mostly short, as for class_run_avx2
+    //
+    if (i + 16 <= text.size())
+    {
+        if (auto m = either16(p + i, _mm_set1_epi8(a), _mm_set1_epi8(b)); m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+        i += 16;
+    }
+    return find_either_scalar(text, i, a, b);
+}
+
+VLARK_TARGET_AVX2 std::size_t escape_free_run_avx2(std::string_view text)
+{
+    const char* p = text.data();
+    const __m256i ctl = _mm256_set1_epi8(0x1f);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i slash = _mm256_set1_epi8('\\');
+    std::size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32)
+    {
+        __m256i x = load32(p + i);
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(x, ctl), x),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, slash)));
+        if (auto m = mask32(hit); m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+    }
+    if (i + 16 <= text.size())
+    {
+        if (auto m = escape16(load16(p + i)); m != 0)
+        {
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+        }
+        i += 16;
+    }
+    return escape_free_run_scalar(text, i);
+}
+
+#endif // VLARK_SIMD_AVX2
+
+} // namespace
+
+void find_newlines(std::string_view text, std::vector<std::uint32_t>& starts, isa level)
+{
+    switch (level)
+    {
+#if VLARK_SIMD_AVX2
+    case isa::avx2: return find_newlines_avx2(text, starts);
+#endif
+#if VLARK_SIMD_X86
+    case isa::sse2: return find_newlines_sse2(text, starts);
+#endif
+    default: return find_newlines_scalar(text, 0, starts);
+    }
+}
+
+//-----------------------------------------------------------------------
+//  class_run: one kernel per class, so the class tests fold into the loop
+//
+namespace
+{
+
+template <char_class C>
+std::size_t class_run(std::string_view text, isa level)
+{
+    switch (level)
+    {
+#if VLARK_SIMD_AVX2
+    case isa::avx2: return class_run_avx2<C>(text);
+#endif
+#if VLARK_SIMD_X86
+    case isa::sse2: return class_run_sse2<C>(text);
+#endif
+    default: return class_run_scalar(text, 0, C);
+    }
+}
+
+} // namespace
+
+std::size_t class_run(std::string_view text, char_class cls, isa level)
+{
+    switch (cls)
+    {
+    case space: return class_run<space>(text, level);
+    case digit: return class_run<digit>(text, level);
+    case ident: return class_run<ident>(text, level);
+    }
+    return class_run_scalar(text, 0, cls);
+}
+
+std::size_t find_pair(std::string_view text, char a, char b, isa level)
+{
+    switch (level)
+    {
+#if VLARK_SIMD_AVX2
+    case isa::avx2: return find_pair_avx2(text, a, b);
+#endif
+#if VLARK_SIMD_X86
+    case isa::sse2: return find_pair_sse2(text, a, b);
+#endif
+    default: return find_pair_scalar(text, 0, a, b);
+    }
+}
+
+std::size_t find_either(std::string_view text, char a, char b, isa level)
+{
+    switch (level)
+    {
+#if VLARK_SIMD_AVX2
+    case isa::avx2: return find_either_avx2(text, a, b);
+#endif
+#if VLARK_SIMD_X86
+    case isa::sse2: return find_either_sse2(text, a, b);
+#endif
+    default: return find_either_scalar(text, 0, a, b);
+    }
+}
+
+std::size_t escape_free_run(std::string_view text, isa level)
+{
+    switch (level)
+    {
+#if VLARK_SIMD_AVX2
+    case isa::avx2: return escape_free_run_avx2(text);
+#endif
+#if VLARK_SIMD_X86
+    case isa::sse2: return escape_free_run_sse2(text);
+#endif
+    default: return escape_free_run_scalar(text, 0);
+    }
+}
+
+} // namespace vlark::simd
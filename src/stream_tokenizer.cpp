@@ -0,0 +1,183 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Streaming tokenizer - bounded memory front end
+//===========================================================================
+
+#include "stream_tokenizer.h"
+#include "simd.h"
+#include <limits>
+
+namespace vlark
+{
+
+namespace
+{
+
+//  the part of a token longer than max_carry that is still to be skipped
+enum class skipping : std::uint8_t
+{
+    none,
+    line,         // up to the next '\n'
+    block_comment // up to and with the next "*/"
+};
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  run: read chunk after chunk and tokenize what is complete.
+//  Whenever a token (or comment) may go on past the end of the chunk the
+//  remaining bytes are carried to the front of the next chunk, see
+//  scan_lookahead. Once the carry reaches max_carry the token is skipped
+//  instead, as the chunks come in.
+//
+std::size_t stream_tokenizer::run(std::istream& in, token_sink const& sink)
+{
+    lineno_t lineno = 1;
+    std::size_t line_begin = 0; // stream offset of the current line
+    std::size_t base = 0;       // stream offset of buf[0]
+    std::size_t keep = 0;       // bytes carried over from the last chunk
+    std::size_t ntokens = 0;
+    token_type prev = token_type::Eof; // tells a tick from a character literal
+    bool eof = false;
+    skipping skip = skipping::none;
+    std::size_t skip_from = 0; // stream offset of the skipped block comment
+
+    buf.clear();
+    issues.clear();
+    while (!eof)
+    {
+        buf.resize(keep + chunk_size);
+        in.read(buf.data() + keep, static_cast<std::streamsize>(chunk_size));
+        auto got = static_cast<std::size_t>(in.gcount());
+        eof = got < chunk_size;
+        buf.resize(keep + got);
+
+        std::string_view data(buf);
+        std::size_t pos = 0;
+
+        //  data[pos, stop) is skipped, the lines in it are counted
+        //
+        auto skip_to = [&](std::size_t stop) {
+            for (auto nl = data.find('\n', pos); nl < stop; nl = data.find('\n', nl + 1))
+            {
+                lineno++;
+                line_begin = base + nl + 1;
+            }
+            pos = stop;
+        };
+
+        while (pos < data.size())
+        {
+            if (skip == skipping::line)
+            {
+                auto nl = std::min(data.find('\n', pos), data.size());
+                skip_to(nl);
+                if (nl == data.size())
+                {
+                    break; // goes on in the next chunk
+                }
+                skip = skipping::none;
+                continue;
+            }
+            if (skip == skipping::block_comment)
+            {
+                auto end = data.find("*/", pos);
+                if (end == std::string_view::npos && !eof)
+                {
+                    skip_to(data.size() - (data.ends_with('*') ? 1 : 0)); // the '*' may start the "*/"
+                    break;
+                }
+                skip_to(end == std::string_view::npos ? data.size() : end + 2);
+                if (end == std::string_view::npos)
+                {
+                    issues.report(severity::error, diag_code::unterminated_comment, skip_from,
+                                  std::min<std::size_t>(base + pos - skip_from, std::numeric_limits<std::uint32_t>::max()));
+                }
+                skip = skipping::none;
+                continue;
+            }
+
+            char ch = data[pos];
+            if (simd::is_space(ch))
+            {
+                if (ch == '\n')
+                {
+                    lineno++;
+                    line_begin = base + pos + 1;
+                }
+                pos++;
+                continue;
+            }
+
+            auto rest = data.substr(pos);
+            auto tk = scan_token(rest, nullptr, prev);
+            if (tk.len + scan_lookahead > rest.size() && !eof)
+            {
+                if (rest.size() < max_carry)
+                {
+                    break; // the token may continue in the next chunk
+                }
+                if (rest.starts_with("/*"))
+                {
+                    skip = skipping::block_comment;
+                    skip_from = base + pos;
+                    pos += 2;
+                }
+                else
+                {
+                    if (!rest.starts_with("--"))
+                    {
+                        issues.report(severity::error, diag_code::token_too_long, base + pos, rest.size());
+                        prev = tk.type; // the dropped token still precedes the next one
+                    }
+                    skip = skipping::line;
+                }
+                continue;
+            }
+
+            auto text = rest.substr(0, tk.len);
+            if (tk.type != token_type::Line_Comment && tk.type != token_type::Block_Comment_Text)
+            {
+                prev = tk.type;
+            }
+            if (tk.type == token_type::Invalid)
+            {
+                issues.report(severity::error, invalid_code(text), base + pos, tk.len);
+            }
+            else if (tk.type != token_type::Line_Comment && tk.type != token_type::Block_Comment_Text)
+            {
+                auto col = static_cast<colno_t>(base + pos - line_begin);
+                sink(stream_token{tk.type, text, token_position(lineno, col)});
+                ntokens++;
+            }
+
+            //  block comments span lines
+            //
+            for (auto nl = text.find('\n'); nl != std::string_view::npos; nl = text.find('\n', nl + 1))
+            {
+                lineno++;
+                line_begin = base + pos + nl + 1;
+            }
+            pos += tk.len;
+        }
+
+        keep = data.size() - pos;
+        buf.erase(0, pos);
+        base += pos;
+    }
+
+    return ntokens;
+}
+
+} // namespace vlark
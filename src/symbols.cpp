@@ -0,0 +1,136 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Symbol table - interned, case folded identifiers
+//===========================================================================
+
+#include "symbols.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace vlark
+{
+
+symbol_table::symbol_table()
+    : pages{std::make_unique<std::atomic<page*>[]>(max_pages)}
+{
+}
+
+symbol_table::~symbol_table()
+{
+    for (std::size_t i = 0; i < max_pages; i++)
+    {
+        delete pages[i].load(std::memory_order_relaxed);
+    }
+}
+
+symbol_table& symbol_table::global()
+{
+    static symbol_table table;
+    return table;
+}
+
+//-----------------------------------------------------------------------
+//  store: copy s into the shard arena, the copy lives as long as the table
+//
+std::string_view symbol_table::shard::store(std::string_view s)
+{
+    static constexpr std::size_t block_size = 64 * 1024;
+
+    if (s.size() > block_left)
+    {
+        std::size_t len = std::max(block_size, s.size());
+        blocks.push_back(std::make_unique<char[]>(len));
+        block_pos = blocks.back().get();
+        block_left = len;
+    }
+
+    char* p = block_pos;
+    std::memcpy(p, s.data(), s.size());
+    block_pos += s.size();
+    block_left -= s.size();
+    return {p, s.size()};
+}
+
+//  make the spelling of id visible to name()
+//
+void symbol_table::publish(symbol_id id, std::string_view s)
+{
+    std::size_t pg = id >> page_bits;
+    if (pg >= max_pages)
+    {
+        throw std::length_error("symbol table full");
+    }
+
+    page* p = pages[pg].load(std::memory_order_acquire);
+    if (p == nullptr)
+    {
+        std::lock_guard guard(page_lock);
+        p = pages[pg].load(std::memory_order_relaxed);
+        if (p == nullptr)
+        {
+            p = new page{};
+            pages[pg].store(p, std::memory_order_release);
+        }
+    }
+    (*p)[id & (page_size - 1)] = s;
+}
+
+symbol_id symbol_table::intern(std::string_view name, bool fold)
+{
+    //  fold into a stack buffer, identifiers longer than that are rare
+    //
+    char buf[128];
+    std::string big;
+    std::string_view key = name;
+    if (fold)
+    {
+        char* out = buf;
+        if (name.size() > sizeof(buf))
+        {
+            big.resize(name.size());
+            out = big.data();
+        }
+        std::transform(name.begin(), name.end(), out,
+                       [](char c) { return ('A' <= c && c <= 'Z') ? static_cast<char>(c | 0x20) : c; });
+        key = {out, name.size()};
+    }
+
+    auto& sh = shards[std::hash<std::string_view>{}(key) % shard_count];
+    std::lock_guard guard(sh.lock);
+
+    if (auto it = sh.ids.find(key); it != sh.ids.end())
+    {
+        return it->second;
+    }
+
+    std::string_view stored = sh.store(key);
+    symbol_id id = next_id.fetch_add(1, std::memory_order_acq_rel);
+    publish(id, stored);
+    sh.ids.emplace(stored, id);
+    return id;
+}
+
+std::string_view symbol_table::name(symbol_id id) const
+{
+    if (id == no_symbol || (id >> page_bits) >= max_pages)
+    {
+        return {};
+    }
+    page const* p = pages[id >> page_bits].load(std::memory_order_acquire);
+    return p != nullptr ? (*p)[id & (page_size - 1)] : std::string_view{};
+}
+
+} // namespace vlark
@@ -14,14 +14,16 @@
 //  Token - Analyzer
 //===========================================================================
 #include "token.h"
+#include "simd.h"
+#include <algorithm>
+#include <array>
+#include <thread>
 
 namespace vlark
 {
 
 // Return the name of the token.
-template <typename T>
-    requires std::is_same_v<T, std::string>
-std::string _asstr(token_type Token)
+constexpr std::string_view _asstr(token_type Token)
 {
 
     switch (Token)
@@ -175,9 +177,11 @@ std::string _asstr(token_type Token)
     case token_type::Ror: return "ror";
     case token_type::Protected: return "protected";
     case token_type::Assume: return "assume";
+    case token_type::Assume_Guarantee: return "assume_guarantee";
     case token_type::Context: return "context";
     case token_type::Cover: return "cover";
     case token_type::Default: return "default";
+    case token_type::Fairness: return "fairness";
     case token_type::Force: return "force";
     case token_type::Parameter: return "parameter";
     case token_type::Property: return "property";
@@ -185,6 +189,7 @@ std::string _asstr(token_type Token)
     case token_type::Restrict: return "restrict";
     case token_type::Restrict_Guarantee: return "restrict_guarantee";
     case token_type::Sequence: return "sequence";
+    case token_type::Strong: return "strong";
     case token_type::Inherit: return "inherit";
     case token_type::Vmode: return "vmode";
     case token_type::Vprop: return "vprop";
@@ -205,13 +210,50 @@ std::string _asstr(token_type Token)
     case token_type::Arobase: return "@";
     case token_type::Private: return "private";
     case token_type::View: return "view";
+    case token_type::Psl_Const: return "const";
+    case token_type::Psl_Boolean: return "boolean";
+    case token_type::Inf: return "inf";
+    case token_type::Within: return "within";
+    case token_type::Abort: return "abort";
+    case token_type::Async_Abort: return "async_abort";
+    case token_type::Sync_Abort: return "sync_abort";
+    case token_type::Before: return "before";
+    case token_type::Before_Em: return "before!";
+    case token_type::Before_Un: return "before_";
+    case token_type::Before_Em_Un: return "before!_";
+    case token_type::Always: return "always";
+    case token_type::Never: return "never";
+    case token_type::Eventually_Em: return "eventually!";
+    case token_type::Next_A: return "next_a";
+    case token_type::Next_A_Em: return "next_a!";
+    case token_type::Next_E: return "next_e";
+    case token_type::Next_E_Em: return "next_e!";
+    case token_type::Next_Event: return "next_event";
+    case token_type::Next_Event_A: return "next_event_a";
+    case token_type::Next_Event_A_Em: return "next_event_a!";
+    case token_type::Next_Event_E: return "next_event_e";
+    case token_type::Next_Event_E_Em: return "next_event_e!";
+    case token_type::Until_Em: return "until!";
+    case token_type::Until_Un: return "until_";
+    case token_type::Until_Em_Un: return "until!_";
+    case token_type::Prev: return "prev";
+    case token_type::Stable: return "stable";
+    case token_type::Fell: return "fell";
+    case token_type::Rose: return "rose";
+    case token_type::Onehot: return "onehot";
+    case token_type::Onehot0: return "onehot0";
     default: return "Unknown Token";
     }
 }
 
 std::string token_tostr(token_type token)
 {
-    return _asstr<std::string>(token);
+    return std::string(_asstr(token));
+}
+
+std::string_view token_spelling(token_type token)
+{
+    return _asstr(token);
 }
 
 token_type close_paren_type(token_type ttype)
@@ -226,14 +268,9 @@ token_type close_paren_type(token_type ttype)
 }
 
 // Return the length of the substring matching [a-zA-Z0-9_]
-std::size_t get_name_len(const std::string& text)
+std::size_t get_name_len(std::string_view text)
 {
-    auto nonMatchingCharPos =
-        std::find_if_not(text.begin(), text.end(), [](char c) { return std::isalnum(c) || c == '_'; });
-
-    return (nonMatchingCharPos != text.end())
-               ? static_cast<std::size_t>(std::distance(text.begin(), nonMatchingCharPos))
-               : text.size();
+    return simd::ident_run(text);
 }
 
 bool is_valid_identifier(std::string_view token)
@@ -247,159 +284,888 @@ bool is_valid_identifier(std::string_view token)
     return !st;
 }
 
+//-----------------------------------------------------------------------
+//
+//  Key words: a perfect hash built at compile time from the key word
+//  range of token_type. The hash only looks at the length and the first
+//  and last two chars (case folded), so a lookup is a handful of
+//  instructions, one table load and one compare - no probing.
+//
+//-----------------------------------------------------------------------
+//
+namespace
+{
+
+constexpr auto first_keyword = token_type::Mod;
+constexpr auto last_vhdl_keyword = token_type::View;
+constexpr auto last_keyword = token_type::Onehot0;
+
+constexpr std::size_t keyword_count =
+    static_cast<std::size_t>(last_keyword) - static_cast<std::size_t>(first_keyword) + 1;
+constexpr std::size_t keyword_slots = 2048; // power of two
+constexpr std::size_t max_keyword_len = 18; // restrict_guarantee
+
+// first standard that reserves the key word
+constexpr vhdl_std keyword_since(token_type t)
+{
+    if (t >= token_type::Private)
+    {
+        return vhdl_std::v19;
+    }
+    if (t >= token_type::Assume)
+    {
+        return vhdl_std::v08;
+    }
+    if (t >= token_type::Protected)
+    {
+        return vhdl_std::v00;
+    }
+    if (t >= token_type::Xnor)
+    {
+        return vhdl_std::v93;
+    }
+    return vhdl_std::v87;
+}
+
+//  Lower cases A-Z and keeps every other byte as it is, so no char of a key
+//  word ('_', '!' in the PSL spellings before!, until!_ ...) folds onto
+//  one that cannot be in a name. The '!' forms are only reachable through
+//  keyword_lookup: the scanner ends a name before '!'
+//
+constexpr std::uint32_t fold(char c)
+{
+    std::uint32_t u = static_cast<unsigned char>(c);
+    return u - 'A' < 26u ? u | 0x20u : u;
+}
+
+constexpr std::size_t keyword_hash(std::string_view s, std::uint32_t seed)
+{
+    std::size_t n = s.size();
+    std::uint32_t h = seed ^ (static_cast<std::uint32_t>(n) * 0x9e3779b1u);
+    h = (h ^ fold(s[0])) * 0x01000193u;
+    h = (h ^ fold(s[1])) * 0x01000193u;
+    h = (h ^ fold(s[n - 2])) * 0x01000193u;
+    h = (h ^ fold(s[n - 1])) * 0x01000193u;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h & (keyword_slots - 1);
+}
+
+struct keyword_table
+{
+    std::uint32_t seed = 0;
+    std::array<token_type, keyword_slots> slots{}; // Invalid marks an empty slot
+};
+
+//  Try seeds until every key word has a slot of its own
+//
+consteval keyword_table build_keyword_table()
+{
+    keyword_table table;
+    for (std::uint32_t seed = 1; seed < 100'000; seed++)
+    {
+        table.seed = seed;
+        table.slots.fill(token_type::Invalid);
+        bool perfect = true;
+        for (std::size_t i = 0; i < keyword_count && perfect; i++)
+        {
+            auto t = static_cast<token_type>(static_cast<std::size_t>(first_keyword) + i);
+            auto& slot = table.slots[keyword_hash(_asstr(t), seed)];
+            perfect = slot == token_type::Invalid;
+            slot = t;
+        }
+        if (perfect)
+        {
+            return table;
+        }
+    }
+    throw "no perfect hash seed for the key words";
+}
+
+constexpr keyword_table keywords = build_keyword_table();
+
+//  spelling of every key word, indexed from first_keyword
+//
+constexpr auto keyword_spellings = [] {
+    std::array<std::string_view, keyword_count> sp{};
+    for (std::size_t i = 0; i < keyword_count; i++)
+    {
+        sp[i] = _asstr(static_cast<token_type>(static_cast<std::size_t>(first_keyword) + i));
+    }
+    return sp;
+}();
+
+static_assert(std::ranges::all_of(keyword_spellings, [](std::string_view sp) {
+    return sp.size() >= 2 && sp.size() <= max_keyword_len && sp != "Unknown Token";
+}));
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  keyword_lookup: key word spelled by name, in any letter case.
+//  token_type::Invalid if name is no reserved word of std (PSL key words
+//  only count with psl set).
+//
+token_type keyword_lookup(std::string_view name, vhdl_std std, bool psl)
+{
+    if (name.size() < 2 || name.size() > max_keyword_len)
+    {
+        return token_type::Invalid;
+    }
+
+    token_type t = keywords.slots[keyword_hash(name, keywords.seed)];
+    if (t == token_type::Invalid)
+    {
+        return t;
+    }
+
+    std::string_view kw = keyword_spellings[static_cast<std::size_t>(t) - static_cast<std::size_t>(first_keyword)];
+    if (kw.size() != name.size())
+    {
+        return token_type::Invalid;
+    }
+    for (std::size_t i = 0; i < kw.size(); i++)
+    {
+        if (fold(name[i]) != fold(kw[i]))
+        {
+            return token_type::Invalid;
+        }
+    }
+
+    if (t > last_vhdl_keyword ? !psl : keyword_since(t) > std)
+    {
+        return token_type::Invalid;
+    }
+    return t;
+}
+
 // This handles are reserved names and also identifiers
 // Identifiers are the last option checked here if all reserved names are exhausted
 //
-bool handle_names(std::deque<token>& tokens, std::string_view sbstr, size_t lineno, size_t col_no)
+token_type classify_name(std::string_view sbstr)
 {
     if (sbstr.empty())
     {
-        return false;
+        return token_type::Invalid;
     }
 
-    static const std::unordered_map<std::string_view, token_type> keyword_map = {
-        {"use", token_type::Use},
-        {"alias", token_type::Alias},
-        {"architecture", token_type::Architecture},
-        {"begin", token_type::Begin},
-        {"body", token_type::Body},
-        {"constant", token_type::Constant},
-        {"downto", token_type::Downto},
-        {"if", token_type::If},
-        {"else", token_type::Else},
-        {"elsif", token_type::Elsif},
-        {"end", token_type::End},
-        {"entity", token_type::Entity},
-        {"generate", token_type::Generate},
-        {"in", token_type::In},
-        {"library", token_type::Library},
-        {"out", token_type::Out},
-        {"port", token_type::Port},
-        {"of", token_type::Of},
-        {"is", token_type::Is},
-        {"others", token_type::Others},
-        {"package", token_type::Package},
-        {"procedure", token_type::Procedure},
-        {"process", token_type::Process},
-        {"return", token_type::Return},
-        {"signal", token_type::Signal},
-        {"then", token_type::Then},
-        {"to", token_type::To},
-        {"variable", token_type::Variable},
-        {"default", token_type::Default},
-        {"parameter", token_type::Parameter},
-        {"and", token_type::And},
-        {"or", token_type::Or},
-        {"xor", token_type::Xor},
-        // Add more keywords and token types as needed
-    };
-
-    auto it = keyword_map.find(sbstr);
-    if (it != keyword_map.end())
-    {
-        tokens.emplace_back(sbstr, token_position(lineno, col_no), it->second);
-        return true;
+    if (auto kw = keyword_lookup(sbstr); kw != token_type::Invalid)
+    {
+        return kw;
     }
-    else
+
+    return is_valid_identifier(sbstr) ? token_type::Identifier : token_type::Invalid;
+}
+
+namespace
+{
+
+//-----------------------------------------------------------------------
+//
+//  Scanner tables: every byte maps to a char class and scan_token makes
+//  a single switch (jump table) on it. Chars that always are a token of
+//  their own are resolved through single_delims, only the lead chars of
+//  multi-char delimiters look at the following chars.
+//
+//-----------------------------------------------------------------------
+//
+enum class char_class : std::uint8_t
+{
+    invalid,
+    single, // one char delimiter, see single_delims
+    space,
+    letter,
+    digit,
+    equal,     // = =>
+    colon,     // : :=
+    slash,     // / /= /*
+    star,      // * **
+    less,      // < <= <> << <->
+    greater,   // > >= >>
+    question,  // ? ?? ?= ?/= ?< ?<= ?> ?>=
+    minus,     // - -> --
+    bar,       // | || |-> |=>
+    bracket,   // [ [* [+] [-> [=
+    ampersand, // & &&
+    tick,      // ' or a character literal
+    quote,     // string literal
+    backslash, // extended identifier
+};
+
+constexpr auto char_classes = [] {
+    std::array<char_class, 256> cls{};
+    for (unsigned c = 0; c < 26; c++)
+    {
+        cls['a' + c] = char_class::letter;
+        cls['A' + c] = char_class::letter;
+    }
+    for (unsigned c = '0'; c <= '9'; c++)
+    {
+        cls[c] = char_class::digit;
+    }
+    for (char c : std::string_view(" \t\n\v\f\r"))
+    {
+        cls[static_cast<unsigned char>(c)] = char_class::space;
+    }
+    for (char c : std::string_view("()];,.+^{}!@"))
+    {
+        cls[static_cast<unsigned char>(c)] = char_class::single;
+    }
+    cls['_'] = char_class::letter;
+    cls['='] = char_class::equal;
+    cls[':'] = char_class::colon;
+    cls['/'] = char_class::slash;
+    cls['*'] = char_class::star;
+    cls['<'] = char_class::less;
+    cls['>'] = char_class::greater;
+    cls['?'] = char_class::question;
+    cls['-'] = char_class::minus;
+    cls['|'] = char_class::bar;
+    cls['['] = char_class::bracket;
+    cls['&'] = char_class::ampersand;
+    cls['\''] = char_class::tick;
+    cls['"'] = char_class::quote;
+    cls['\\'] = char_class::backslash;
+    return cls;
+}();
+
+constexpr auto single_delims = [] {
+    std::array<token_type, 256> tt{};
+    tt['('] = token_type::Left_Paren;
+    tt[')'] = token_type::Right_Paren;
+    tt[']'] = token_type::Right_Bracket;
+    tt[';'] = token_type::Semi_Colon;
+    tt[','] = token_type::Comma;
+    tt['.'] = token_type::Dot;
+    tt['+'] = token_type::Plus;
+    tt['^'] = token_type::Caret;
+    tt['{'] = token_type::Left_Curly;
+    tt['}'] = token_type::Right_Curly;
+    tt['!'] = token_type::Exclam_Mark;
+    tt['@'] = token_type::Arobase;
+    return tt;
+}();
+
+static_assert(std::ranges::all_of(std::string_view("()];,.+^{}!@"), [](char c) {
+    return single_delims[static_cast<unsigned char>(c)] != token_type::Invalid;
+}));
+
+// text[i] or '\0' past the end
+constexpr char at(std::string_view text, std::size_t i)
+{
+    return i < text.size() ? text[i] : '\0';
+}
+
+scan_result literal_result(literal_scan const& lit)
+{
+    if (!lit.ok)
+    {
+        return {token_type::Invalid, lit.len};
+    }
+    switch (lit.kind)
+    {
+    case literal_kind::integer: return {token_type::Integer, lit.len, lit.value};
+    case literal_kind::real: return {token_type::Real, lit.len, lit.value};
+    case literal_kind::string: return {token_type::String, lit.len, lit.value};
+    case literal_kind::bit_string: break;
+    }
+    return {token_type::Bit_String, lit.len, lit.value};
+}
+
+//  a ' right after these starts an attribute name: a'length, f(x)'image,
+//  t'('a') is a qualified expression and not the literal '('
+//
+constexpr bool tick_follows(token_type prev)
+{
+    return prev == token_type::Identifier || prev == token_type::Right_Paren || prev == token_type::Right_Bracket ||
+           prev == token_type::All;
+}
+
+//  graphic_character, what a character literal may hold
+//
+constexpr bool is_graphic(char c)
+{
+    auto u = static_cast<unsigned char>(c);
+    return (u >= 0x20 && u < 0x7f) || u >= 0xa0;
+}
+
+scan_result tick_or_character(std::string_view text, token_type prev)
+{
+    if (text.size() >= 3 && text[2] == '\'' && is_graphic(text[1]) && !tick_follows(prev))
+    {
+        return {token_type::Character, 3, static_cast<unsigned char>(text[1])};
+    }
+    return {token_type::Tick, 1};
+}
+
+//  extended_identifier ::= \ graphic_character { graphic_character } \ (a
+//  backslash inside is written twice), the name is case sensitive
+//
+scan_result extended_identifier(std::string_view text)
+{
+    std::size_t i = 1;
+    for (;;)
+    {
+        auto k = simd::find_either(text.substr(i), '\\', '\n');
+        if (k == std::string_view::npos || text[i + k] == '\n')
+        {
+            return {token_type::Invalid, k == std::string_view::npos ? text.size() : i + k};
+        }
+        i += k + 1;
+        if (i == text.size() || text[i] != '\\')
+        {
+            break;
+        }
+        i++;
+    }
+    return {i > 2 ? token_type::Identifier : token_type::Invalid, i};
+}
+
+//  comments, their text is skipped by the caller
+//
+scan_result line_comment(std::string_view text)
+{
+    return {token_type::Line_Comment, std::min(text.find('\n'), text.size())};
+}
+
+scan_result block_comment(std::string_view text)
+{
+    auto end = simd::find_pair(text.substr(2), '*', '/');
+    if (end == std::string_view::npos)
+    {
+        return {token_type::Invalid, text.size()}; // not closed
+    }
+    return {token_type::Block_Comment_Text, end + 4};
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  scan_token: scan the single token at the start of text, by maximal
+//  munch. text must not start with a space. Comments come back as
+//  Line_Comment or Block_Comment_Text. Unsupported input is returned as
+//  token_type::Invalid, the length is always at least one char.
+//  The values of literals are decoded into literals when it is given.
+//  prev is the token before, it tells a tick from a character literal.
+//
+scan_result scan_token(std::string_view text, literal_table* literals, token_type prev)
+{
+    assert(!text.empty());
+    char ch = text[0];
+    char next = at(text, 1);
+
+    switch (char_classes[static_cast<unsigned char>(ch)])
     {
-        if (is_valid_identifier(sbstr))
+    case char_class::single: return {single_delims[static_cast<unsigned char>(ch)], 1};
+
+    case char_class::letter:
+        if (auto prefix = bit_string_prefix(text); prefix != 0)
         {
-            tokens.emplace_back(sbstr, token_position(lineno, col_no), token_type::Identifier);
+            return literal_result(scan_bit_string(text, prefix, literals));
+        }
+        else
+        {
+            // let extract the reserved keywords and identifiers
+            auto tk_len = get_name_len(text);
+            return {classify_name(text.substr(0, tk_len)), tk_len};
+        }
 
-            return true;
+    case char_class::digit: return literal_result(scan_number(text, literals));
+
+    case char_class::equal:
+        if (next == '>')
+        {
+            return {token_type::Double_Arrow, 2};
         }
-        std::cerr << "token not valid keyword: " << sbstr << " \n";
+        return {token_type::Equal, 1};
+
+    case char_class::colon:
+        if (next == '=')
+        {
+            return {token_type::Assign, 2};
+        }
+        return {token_type::Colon, 1};
+
+    case char_class::slash:
+        if (next == '=')
+        {
+            return {token_type::Not_Equal, 2};
+        }
+        if (next == '*')
+        {
+            return block_comment(text);
+        }
+        return {token_type::Slash, 1};
+
+    case char_class::star:
+        if (next == '*')
+        {
+            return {token_type::Double_Star, 2};
+        }
+        return {token_type::Star, 1};
+
+    case char_class::less:
+        switch (next)
+        {
+        case '=': return {token_type::Less_Equal, 2};
+        case '>': return {token_type::Box, 2};
+        case '<': return {token_type::Double_Less, 2};
+        case '-':
+            if (at(text, 2) == '>')
+            {
+                return {token_type::Equiv_Arrow, 3};
+            }
+            break;
+        default: break;
+        }
+        return {token_type::Less, 1};
+
+    case char_class::greater:
+        switch (next)
+        {
+        case '=': return {token_type::Greater_Equal, 2};
+        case '>': return {token_type::Double_Greater, 2};
+        default: return {token_type::Greater, 1};
+        }
+
+    case char_class::question:
+        switch (next)
+        {
+        case '?': return {token_type::Condition, 2};
+        case '=': return {token_type::Match_Equal, 2};
+        case '/':
+            if (at(text, 2) == '=')
+            {
+                return {token_type::Match_Not_Equal, 3};
+            }
+            break;
+        case '<':
+            if (at(text, 2) == '=')
+            {
+                return {token_type::Match_Less_Equal, 3};
+            }
+            return {token_type::Match_Less, 2};
+        case '>':
+            if (at(text, 2) == '=')
+            {
+                return {token_type::Match_Greater_Equal, 3};
+            }
+            return {token_type::Match_Greater, 2};
+        default: break;
+        }
+        return {token_type::Question_Mark, 1};
+
+    case char_class::minus:
+        if (next == '-')
+        {
+            return line_comment(text);
+        }
+        if (next == '>')
+        {
+            return {token_type::Minus_Greater, 2};
+        }
+        return {token_type::Minus, 1};
+
+    case char_class::bar:
+        if (next == '|')
+        {
+            return {token_type::Bar_Bar, 2};
+        }
+        if ((next == '-' || next == '=') && at(text, 2) == '>')
+        {
+            return {next == '-' ? token_type::Bar_Arrow : token_type::Bar_Double_Arrow, 3};
+        }
+        return {token_type::Bar, 1};
+
+    case char_class::bracket:
+        switch (next)
+        {
+        case '*': return {token_type::Brack_Star, 2};
+        case '=': return {token_type::Brack_Equal, 2};
+        case '+':
+            if (at(text, 2) == ']')
+            {
+                return {token_type::Brack_Plus_Brack, 3};
+            }
+            break;
+        case '-':
+            if (at(text, 2) == '>')
+            {
+                return {token_type::Brack_Arrow, 3};
+            }
+            break;
+        default: break;
+        }
+        return {token_type::Left_Bracket, 1};
+
+    case char_class::ampersand:
+        if (next == '&')
+        {
+            return {token_type::And_And, 2};
+        }
+        return {token_type::Ampersand, 1};
+
+    case char_class::tick: return tick_or_character(text, prev);
+
+    case char_class::quote: return literal_result(scan_string(text, literals));
+
+    case char_class::backslash: return extended_identifier(text);
+
+    case char_class::space:
+    case char_class::invalid: break;
     }
+    return {token_type::Invalid, 1};
+}
 
-    return false;
+// Why the scanned text was rejected
+diag_code invalid_code(std::string_view text)
+{
+    char ch = text[0];
+    bool digit = '0' <= ch && ch <= '9';
+    if (text.starts_with("/*"))
+    {
+        return diag_code::unterminated_comment;
+    }
+    if (ch == '"')
+    {
+        return diag_code::unterminated_string;
+    }
+    if (ch == '\\')
+    {
+        return diag_code::invalid_extended_name;
+    }
+    if ((digit || bit_string_prefix(text) != 0) && text.find('"') != std::string_view::npos)
+    {
+        return diag_code::invalid_bit_string;
+    }
+    if (digit)
+    {
+        return diag_code::invalid_literal;
+    }
+    if (ch == '_' || std::isalpha(static_cast<unsigned char>(ch)))
+    {
+        return diag_code::invalid_name;
+    }
+    return diag_code::unknown_char;
 }
 
-void find_add_tokens(std::deque<token>& tokens, source_line& line, size_t lineno)
+//-----------------------------------------------------------------------
+//  scan_next: the next token starting at or after text[i] and before
+//  end, white space and comments are skipped. i is moved past the token.
+//  flags gets line_start when a newline is crossed, the caller hands it
+//  to the token and clears it. Rejected text comes back as an Invalid
+//  token, token_type::Eof when no token starts before end. prev is the
+//  type of the token returned last, it is updated.
+//  With a trivia table the skipped comments and blank lines are added
+//  to it, keyed by index, the index the returned token will get.
+//
+token scan_next(std::string_view text, std::size_t& i, std::size_t end, std::uint8_t& flags, token_type& prev,
+                literal_table& literals, trivia_table* trivia, std::uint32_t index)
 {
-    std::string_view carr(line.text);
-    size_t ori_len = line.text.size();
-    size_t lo = 0;
+    constexpr auto no_line = std::string_view::npos;
 
-    while ((ori_len > lo) && (carr[lo] != '\n'))
+    // start of the current line while it only had white space, with trivia
+    std::size_t line_begin = no_line;
+    if (trivia != nullptr && (i == 0 || text[i - 1] == '\n'))
     {
-        /* code */
-        char ch = carr[lo];
-        if (std::isspace(ch) || ch == '\r')
+        line_begin = i;
+    }
+
+    while (i < end)
+    {
+        char ch = text[i];
+        if (simd::is_space(ch))
         {
-            lo++;
+            if (ch == '\n')
+            {
+                flags = token_stream::line_start;
+                if (trivia != nullptr)
+                {
+                    if (line_begin != no_line)
+                    {
+                        trivia->add(index, trivia_kind::blank_lines, static_cast<offset_t>(line_begin),
+                                    i + 1 - line_begin);
+                    }
+                    line_begin = i + 1;
+                }
+            }
+            i++;
             continue;
         }
 
-        switch (ch)
+        auto at = static_cast<offset_t>(i);
+        auto rest = text.substr(i);
+        auto [type, len, value] = scan_token(rest, &literals, prev);
+        i += len;
+
+        switch (type)
         {
-            // clang-format off
-            case '0':
-            case '1': case '2': case '3': 
-            case '4': case '5': case '6': 
-            case '7': case '8': case '9':
-            // clang-format on
-            // Handle numeric characters
-            std::cerr << ch << " -> Sorry, Integers not implemented yet.\n";
+        case token_type::Line_Comment:
+            if (trivia != nullptr)
+            {
+                trivia->add(index, trivia_kind::line_comment, at, len);
+                line_begin = no_line;
+            }
             break;
 
-        case ':': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Colon); break;
-        case '=': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Equal); break;
-        case '.': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Dot); break;
-        case ';': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Semi_Colon); break;
-        case ',': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Comma); break;
-
-        case '|': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Bar); break;
-        case ')': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Right_Paren); break;
-        case '(': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Left_Paren); break;
-        case '[': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Left_Bracket); break;
-        case ']': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Right_Bracket); break;
-        case '\'':
-            tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Right_Bracket);
+        case token_type::Block_Comment_Text:
+            if (rest.substr(0, len).find('\n') != std::string_view::npos)
+            {
+                flags = token_stream::line_start;
+            }
+            if (trivia != nullptr)
+            {
+                trivia->add(index, trivia_kind::block_comment, at, len);
+                line_begin = no_line;
+            }
             break;
-        case '+': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Plus); break;
-        case '-': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Minus); break;
-        case '^': tokens.emplace_back(carr.substr(lo, 1), token_position(lineno, lo), token_type::Caret); break;
+
+        case token_type::Identifier:
+            prev = type;
+            return {at, static_cast<std::uint32_t>(len), type,
+                    symbol_table::global().intern(rest.substr(0, len), rest[0] != '\\')};
 
         default:
-            if (('A' <= ch && ch <= 'Z') || (('a' <= ch && ch <= 'z')) || (ch == '_'))
+            prev = type;
+            return {at, static_cast<std::uint32_t>(len), type, value};
+        }
+    }
+    return {static_cast<offset_t>(std::min(i, text.size())), 0, token_type::Eof};
+}
+
+namespace
+{
+
+template <class T>
+void replace_range(std::vector<T>& v, std::size_t first, std::size_t last, std::span<const T> with)
+{
+    auto at = v.begin() + static_cast<std::ptrdiff_t>(first);
+    auto common = std::min(last - first, with.size());
+    std::copy_n(with.begin(), common, at);
+    at += static_cast<std::ptrdiff_t>(common);
+    if (common < with.size())
+    {
+        v.insert(at, with.begin() + static_cast<std::ptrdiff_t>(common), with.end());
+    }
+    else
+    {
+        v.erase(at, at + static_cast<std::ptrdiff_t>(last - first - common));
+    }
+}
+
+} // namespace
+
+void token_stream::splice(std::size_t first, std::size_t last, token_stream const& other, std::int64_t shift)
+{
+    replace_range(tok_types, first, last, other.types());
+    replace_range(tok_offsets, first, last, other.offsets());
+    replace_range(tok_lengths, first, last, other.lengths());
+    replace_range(tok_ids, first, last, other.ids());
+    replace_range(tok_flags, first, last, other.flags());
+    for (auto k = first + other.size(); k < tok_offsets.size(); k++)
+    {
+        tok_offsets[k] = static_cast<offset_t>(tok_offsets[k] + shift);
+    }
+}
+
+void token_stream::append(token_stream const& other)
+{
+    auto shift = static_cast<std::uint32_t>(lits.size());
+    triv.append(other.trivia(), static_cast<std::uint32_t>(size()));
+    reserve(size() + other.size());
+    for (std::size_t i = 0; i < other.size(); i++)
+    {
+        auto type = other.type(i);
+        bool literal = type == token_type::Integer || type == token_type::Real || type == token_type::Bit_String ||
+                       type == token_type::String;
+        push_back(type, other.offset(i), other.length(i), other.flags(i), other.id(i) + (literal ? shift : 0));
+    }
+    lits.append(other.literals());
+    issues.append(other.diags());
+}
+
+namespace
+{
+
+//  where a tokenize_range stopped and the flags for the token after it
+//
+struct range_end
+{
+    std::size_t stop;
+    std::uint8_t flags;
+    token_type prev; // the last token, Eof when there was none
+};
+
+//-----------------------------------------------------------------------
+//  tokenize_range: scan_next from text[i] until no token starts before
+//  end. The last token (or comment) may run past end, it is scanned on
+//  the complete text. Rejected text goes to tokens.diags() and trivia
+//  to tokens.trivia(), so what a chunk that is scanned again found is
+//  dropped with it.
+//
+range_end tokenize_range(std::string_view text, std::size_t i, std::size_t end, std::uint8_t flags,
+                         token_type prev, token_stream& tokens, trivia_mode mode)
+{
+    trivia_table* trivia = mode == trivia_mode::keep ? &tokens.trivia() : nullptr;
+    for (;;)
+    {
+        auto index = static_cast<std::uint32_t>(tokens.size());
+        token tk = scan_next(text, i, end, flags, prev, tokens.literals(), trivia, index);
+        if (tk.type() == token_type::Eof)
+        {
+            break;
+        }
+        if (tk.type() == token_type::Invalid)
+        {
+            tokens.diags().report(severity::error, invalid_code(tk.text(text)), tk.offset(), tk.length());
+            continue;
+        }
+        tokens.push_back(tk, flags);
+        flags = token_stream::none;
+    }
+    return {i, flags, prev};
+}
+
+//  smallest chunk worth a thread of its own
+//
+constexpr std::size_t min_chunk_size = 256 * 1024;
+
+//-----------------------------------------------------------------------
+//  block_comments: [begin, end) of every "/*" up to its "*/", found with
+//  plain searches. A "/*" in a string or a line comment is taken too, so
+//  the extents hold every real block comment and maybe more. Nothing else
+//  goes on past a newline, a newline outside them is a safe cut.
+//
+std::vector<std::pair<std::size_t, std::size_t>> block_comments(std::string_view text)
+{
+    std::vector<std::pair<std::size_t, std::size_t>> spans;
+    for (auto open = text.find("/*"); open != std::string_view::npos;)
+    {
+        auto close = text.find("*/", open + 2);
+        if (close == std::string_view::npos)
+        {
+            spans.emplace_back(open, text.size());
+            break;
+        }
+        spans.emplace_back(open, close + 2);
+        open = text.find("/*", close + 1); // "*/*" may open the next one
+    }
+    return spans;
+}
+
+//  split_points: the chunk bounds, each the first safe newline at or
+//  after an even share of the text
+//
+std::vector<std::size_t> split_points(std::string_view text, std::size_t nchunks)
+{
+    std::vector<std::size_t> bounds{0};
+    auto spans = block_comments(text);
+    auto span = spans.begin();
+    for (std::size_t k = 1; k < nchunks; k++)
+    {
+        auto nl = text.find('\n', std::max(k * text.size() / nchunks, bounds.back()));
+        for (;;)
+        {
+            while (span != spans.end() && span->second <= nl)
             {
-                // let extract the reserved keywords and identifiers
-                auto tk_len = get_name_len(&carr[lo]);
-                auto status = handle_names(tokens, carr.substr(lo, tk_len), lineno, lo);
-                lo += status ? tk_len - 1 : 0;
+                span++;
             }
-            else
+            if (nl == std::string_view::npos || span == spans.end() || span->first > nl)
             {
-                std::cerr << "Token Unknown " << ch << " \n";
+                break;
             }
+            nl = text.find('\n', span->second);
+        }
+        if (nl == std::string_view::npos || nl + 1 >= text.size())
+        {
             break;
         }
-
-        lo++; // next char
+        if (nl + 1 > bounds.back())
+        {
+            bounds.push_back(nl + 1);
+        }
     }
+    bounds.push_back(text.size());
+    return bounds;
 }
 
-std::deque<token> tokenize_lines(sourceBuffer& sbfile)
+} // namespace
+
+//-----------------------------------------------------------------------
+//  tokenize: a single pass of scan_token over the complete text.
+//  Comments and white space are skipped wherever they are, nothing is
+//  kept per line; a token gets the line_start flag when a newline was
+//  crossed since the previous token. With trivia_mode::keep they go to
+//  tokens.trivia() instead of nowhere.
+//
+//  With more than one thread (0: one per core) the text is cut at safe
+//  newlines (see split_points) into chunks that are tokenized at the
+//  same time, each as if it started a line of code. Chunk k is only
+//  taken as it is when the scan of chunk k-1 stopped right at its start
+//  and it does not open with a tick, else it is scanned again from
+//  there. So the types, offsets and lengths are the same as the serial
+//  ones; the symbol ids are not, they depend on the order names are
+//  first interned (blank lines cut by a chunk edge are joined again by
+//  trivia_table::add).
+//
+void tokenize(std::string_view text, token_stream& tokens, unsigned threads, trivia_mode mode)
 {
-    auto lines = sbfile.get_lines();
-    std::deque<token> tokenlist;
-    if (lines.empty())
+    if (threads == 0)
     {
-        std::cerr << "[error]: sourceBufferFile has empty lines of raw data: " << sbfile.get_fpath() << " \n";
-        exit(EXIT_FAILURE);
+        threads = std::max(1u, std::thread::hardware_concurrency());
     }
+    std::size_t nchunks = std::min<std::size_t>(threads, text.size() / min_chunk_size + 1);
+    auto bounds = nchunks > 1 ? split_points(text, nchunks) : std::vector<std::size_t>{0, text.size()};
+    nchunks = bounds.size() - 1;
 
-    size_t count_line = 1;
-    for (auto& line : lines)
+    std::vector<token_stream> parts(nchunks);
+    std::vector<range_end> ends(nchunks);
     {
-        if (line.cat == source_line::category::raw)
+        std::vector<std::jthread> workers;
+        for (std::size_t k = 1; k < nchunks; k++)
         {
-            find_add_tokens(tokenlist, line, count_line);
+            workers.emplace_back([&, k] {
+                parts[k].reserve(token_stream::estimate(bounds[k + 1] - bounds[k]));
+                ends[k] = tokenize_range(text, bounds[k], bounds[k + 1], token_stream::line_start, token_type::Eof,
+                                         parts[k], mode);
+            });
         }
-        count_line++;
+        ends[0] = tokenize_range(text, 0, bounds[1], token_stream::line_start, token_type::Eof, tokens, mode);
+    }
+
+    //  stitch the chunks in order. A chunk did not know the token before
+    //  it, which only matters when it starts with a ' that is a tick
+    //
+    range_end last = ends[0];
+    for (std::size_t k = 1; k < nchunks; k++)
+    {
+        bool tick = !parts[k].empty() && text[parts[k].offset(0)] == '\'' && tick_follows(last.prev);
+        if (last.stop == bounds[k] && !tick)
+        {
+            assert(last.flags == token_stream::line_start);
+            tokens.append(parts[k]);
+            last = {ends[k].stop, ends[k].flags, ends[k].prev == token_type::Eof ? last.prev : ends[k].prev};
+        }
+        else
+        {
+            last = tokenize_range(text, last.stop, bounds[k + 1], last.flags, last.prev, tokens, mode);
+        }
+    }
+}
+
+token_stream tokenize_lines(sourceBuffer& sbfile, unsigned threads, trivia_mode mode)
+{
+    token_stream tokenlist;
+    tokenlist.reserve(token_stream::estimate(sbfile.text().size()));
+    if (sbfile.line_count() == 0)
+    {
+        tokenlist.diags().report(severity::error, diag_code::empty_source, 0);
+        return tokenlist;
     }
 
+    tokenize(sbfile.text(), tokenlist, threads, mode);
     return tokenlist;
 }
 
-} // namespace vlark
\ No newline at end of file
+} // namespace vlark
@@ -0,0 +1,54 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Token source - lazy, pull based tokens with bounded lookahead
+//===========================================================================
+
+#include "token_source.h"
+
+namespace vlark
+{
+
+//-----------------------------------------------------------------------
+//  fill: scan until n tokens are waiting in the ring. Once the text is
+//  exhausted the Eof token is repeated.
+//
+void token_source::fill(std::size_t n)
+{
+    while (count < n)
+    {
+        auto& s = ring[(head + count) & (window - 1)];
+        if (count > 0 && ring[(head + count - 1) & (window - 1)].tk.type() == token_type::Eof)
+        {
+            s = ring[(head + count - 1) & (window - 1)];
+            count++;
+            continue;
+        }
+
+        token tk = scan_next(text, pos, text.size(), pending, prev, lits, keep_trivia ? &triv : nullptr, scanned);
+        if (tk.type() == token_type::Invalid)
+        {
+            issues.report(severity::error, invalid_code(tk.text(text)), tk.offset(), tk.length());
+            continue;
+        }
+        s = slot{tk, pending};
+        pending = token_stream::none;
+        count++;
+        if (tk.type() != token_type::Eof)
+        {
+            scanned++;
+        }
+    }
+}
+
+} // namespace vlark
@@ -0,0 +1,2023 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Design unit parser - declarations, statements and library units
+//===========================================================================
+
+#include "unit_parser.h"
+#include "work_pool.h"
+#include <array>
+
+namespace vlark
+{
+
+using tt = token_type;
+
+bool unit_parser::accept(token_type type)
+{
+    if (peek() == type)
+    {
+        i++;
+        return true;
+    }
+    return false;
+}
+
+symbol_id unit_parser::identifier()
+{
+    if (peek() == tt::Identifier)
+    {
+        return at(i++).id();
+    }
+    error(diag_code::expected_name);
+    return no_symbol;
+}
+
+//  too_deep: a declaration or statement list nested past max_nesting is
+//  reported and skipped up to the end that closes it, like a unit body
+//  in outline mode. What the skip keeps of the outline is dropped.
+//
+bool unit_parser::too_deep(nesting const& level)
+{
+    if (!level.too_deep())
+    {
+        return false;
+    }
+    error(diag_code::nesting_too_deep);
+    auto dmark = decl_stack.size();
+    auto smark = stmt_stack.size();
+    skip_body();
+    decl_stack.resize(dmark);
+    stmt_stack.resize(smark);
+    return true;
+}
+
+//  skip_statement: error recovery, up to and with the next ';'
+//
+void unit_parser::skip_statement()
+{
+    while (peek() != tt::Semi_Colon && peek() != tt::Eof)
+    {
+        i++;
+    }
+    accept(tt::Semi_Colon);
+}
+
+void unit_parser::semicolon()
+{
+    if (!accept(tt::Semi_Colon))
+    {
+        error(diag_code::expected_semicolon);
+        skip_statement();
+    }
+}
+
+void unit_parser::end_of(std::initializer_list<token_type> words)
+{
+    if (!expect(tt::End, diag_code::expected_keyword))
+    {
+        skip_statement();
+        return;
+    }
+    for (auto w : words)
+    {
+        accept(w);
+    }
+    if (peek() == tt::Identifier || peek() == tt::String)
+    {
+        i++;
+    }
+    semicolon();
+}
+
+//-----------------------------------------------------------------------
+//  Design units
+//-----------------------------------------------------------------------
+
+void unit_parser::design_units(std::vector<ref<design_unit>>& units)
+{
+    while (peek() != tt::Eof)
+    {
+        if (auto u = unit())
+        {
+            units.push_back(u);
+        }
+    }
+}
+
+ref<design_unit> unit_parser::unit()
+{
+    design_unit u{unit_kind::entity, offset()};
+    auto mark = decl_stack.size();
+    context_items();
+    u.context = pop_list(decl_stack, mark);
+
+    switch (peek())
+    {
+    case tt::Entity:
+    case tt::Architecture:
+    case tt::Package:
+    case tt::Configuration:
+    case tt::Context: return library_unit(u);
+    case tt::Eof:
+        if (!u.context.at)
+        {
+            return {};
+        }
+        [[fallthrough]];
+    default:
+        error(diag_code::expected_design_unit);
+        skip_statement();
+        return {};
+    }
+}
+
+//  library, use and context clauses (not context declarations)
+//
+void unit_parser::context_items()
+{
+    for (;;)
+    {
+        switch (peek())
+        {
+        case tt::Library:
+            i++;
+            do
+            {
+                offset_t pos = offset();
+                decl_stack.push_back(tree.add(decl{decl_kind::library, tt::Invalid, pos, identifier()}));
+            } while (accept(tt::Comma));
+            semicolon();
+            break;
+        case tt::Use: use_clause(); break;
+        case tt::Context:
+            if (peek(2) == tt::Is)
+            {
+                return;
+            }
+            use_clause();
+            break;
+        default: return;
+        }
+    }
+}
+
+//  use a.b.all, c.d; and context a.b; (mode Context)
+//
+void unit_parser::use_clause()
+{
+    token_type mode = peek() == tt::Context ? tt::Context : tt::Invalid;
+    i++;
+    do
+    {
+        offset_t pos = offset();
+        decl_stack.push_back(tree.add(decl{decl_kind::use, mode, pos, no_symbol, name()}));
+    } while (accept(tt::Comma));
+    semicolon();
+}
+
+ref<design_unit> unit_parser::library_unit(design_unit u)
+{
+    auto dmark = decl_stack.size();
+    auto smark = stmt_stack.size();
+    switch (peek())
+    {
+    case tt::Entity:
+        i++;
+        u.kind = unit_kind::entity;
+        u.name = identifier();
+        expect(tt::Is, diag_code::expected_keyword);
+        if (accept(tt::Generic))
+        {
+            interface_list(decl_kind::generic);
+            semicolon();
+        }
+        if (accept(tt::Port))
+        {
+            interface_list(decl_kind::port);
+            semicolon();
+        }
+        if (detail == parse_mode::outline)
+        {
+            skip_body();
+        }
+        else
+        {
+            declarations();
+            if (accept(tt::Begin))
+            {
+                concurrent_statements();
+            }
+        }
+        end_of({tt::Entity});
+        break;
+
+    case tt::Architecture:
+        i++;
+        u.kind = unit_kind::architecture;
+        u.name = identifier();
+        expect(tt::Of, diag_code::expected_keyword);
+        u.of = identifier();
+        expect(tt::Is, diag_code::expected_keyword);
+        if (detail == parse_mode::outline)
+        {
+            skip_body();
+        }
+        else
+        {
+            declarations();
+            expect(tt::Begin, diag_code::expected_keyword);
+            concurrent_statements();
+        }
+        end_of({tt::Architecture});
+        break;
+
+    case tt::Package:
+        i++;
+        u.kind = accept(tt::Body) ? unit_kind::package_body : unit_kind::package;
+        u.name = identifier();
+        expect(tt::Is, diag_code::expected_keyword);
+        if (u.kind == unit_kind::package && peek() == tt::New)
+        {
+            skip_statement(); // an instance of a generic package
+            break;
+        }
+        if (u.kind == unit_kind::package && peek() == tt::Generic && peek(1) != tt::Map)
+        {
+            i++;
+            interface_list(decl_kind::generic);
+            semicolon();
+        }
+        if (map_aspect(tt::Generic))
+        {
+            semicolon();
+        }
+        if (detail == parse_mode::outline)
+        {
+            skip_body();
+        }
+        else
+        {
+            declarations();
+        }
+        end_of({tt::Package, tt::Body});
+        break;
+
+    case tt::Configuration:
+    {
+        i++;
+        u.kind = unit_kind::configuration;
+        u.name = identifier();
+        expect(tt::Of, diag_code::expected_keyword);
+        u.of = identifier();
+        expect(tt::Is, diag_code::expected_keyword);
+
+        //  the block configuration is skipped, every for has its end for
+        //
+        std::size_t depth = 0;
+        while (peek() != tt::Eof && !(peek() == tt::End && peek(1) != tt::For && depth == 0))
+        {
+            if (peek() == tt::For)
+            {
+                depth++;
+            }
+            else if (peek() == tt::End && depth != 0)
+            {
+                depth--;
+                i++;
+            }
+            i++;
+        }
+        end_of({tt::Configuration});
+        break;
+    }
+
+    default: // context declaration
+        i++;
+        u.kind = unit_kind::context;
+        u.name = identifier();
+        expect(tt::Is, diag_code::expected_keyword);
+        context_items();
+        end_of({tt::Context});
+        break;
+    }
+
+    u.decls = pop_list(decl_stack, dmark);
+    u.stmts = pop_list(stmt_stack, smark);
+    auto last = at(i - 1);
+    u.end = static_cast<offset_t>(last.offset() + last.length());
+    return tree.add(u);
+}
+
+namespace
+{
+
+constexpr std::size_t index_of(token_type type)
+{
+    return static_cast<std::size_t>(type);
+}
+
+//  the tokens skip_body stops at, the rest is passed over in a tight loop
+//
+constexpr auto skip_stops = [] {
+    std::array<bool, index_of(tt::Onehot0) + 1> stops{};
+    for (auto t : {tt::Left_Paren, tt::Right_Paren, tt::Semi_Colon, tt::Colon, tt::End, tt::If, tt::Case, tt::For,
+                   tt::Elsif, tt::Else, tt::When, tt::Generate, tt::Process, tt::Loop, tt::Block, tt::Record,
+                   tt::Units, tt::Protected, tt::Component, tt::Function, tt::Procedure, tt::Is, tt::Use,
+                   tt::Package})
+    {
+        stops[index_of(t)] = true;
+    }
+    return stops;
+}();
+
+} // namespace
+
+//-----------------------------------------------------------------------
+//  skip_body: outline mode, from the declarations of a unit up to the
+//  end that closes it. The constructs that have an end of their own are
+//  counted by the word that opens them: if, case, loop, process, block,
+//  record, units, protected, component declarations, for ... generate,
+//  subprograms with a body (is not followed by new) and packages declared
+//  in the unit. The end and whatever follows it up to ';' close the
+//  innermost one.
+//
+void unit_parser::skip_body()
+{
+    std::vector<token_type> open;  // innermost last, an if or case generate is kept as Generate
+    std::size_t code = 0;          // open processes and subprogram bodies, no instances in there
+    std::size_t parens = 0;        // nothing inside parentheses opens or closes
+    bool spec = false;             // in a subprogram specification, a body if is follows
+    token_type lead = tt::Invalid; // the last of for, if, case, elsif, else and when
+
+    auto types = tokens.types();
+    auto stops = [&](token_type type) {
+        return parens != 0 ? type == tt::Left_Paren || type == tt::Right_Paren : skip_stops[index_of(type)];
+    };
+    for (;;)
+    {
+        if (pulling())
+        {
+            while (peek() != tt::Eof && !stops(peek()))
+            {
+                i++;
+            }
+        }
+        else if (parens != 0)
+        {
+            while (i < limit && types[i] != tt::Left_Paren && types[i] != tt::Right_Paren)
+            {
+                i++;
+            }
+        }
+        else
+        {
+            while (i < limit && !skip_stops[index_of(types[i])])
+            {
+                i++;
+            }
+        }
+        token_type t = peek();
+        token_type prev = at(i - 1).type(); // there is at least the is of the unit
+
+        switch (t)
+        {
+        case tt::Eof: return;
+        case tt::Left_Paren: parens++; break;
+        case tt::Right_Paren:
+            if (parens != 0)
+            {
+                parens--;
+            }
+            break;
+        case tt::Semi_Colon:
+            spec = false;
+            lead = tt::Invalid;
+            break;
+
+        case tt::End:
+            lead = tt::Invalid;
+            if (open.empty())
+            {
+                return;
+            }
+            //  end [alternative_label]; of a generate body (VHDL-2008) does not close the generate
+            //
+            if (open.back() != tt::Generate || peek(1) == tt::Generate)
+            {
+                if (open.back() == tt::Process || open.back() == tt::Function)
+                {
+                    code--;
+                }
+                open.pop_back();
+            }
+            while (peek() != tt::Semi_Colon && peek() != tt::Eof)
+            {
+                i++;
+            }
+            continue;
+
+        case tt::If:
+        case tt::Case:
+            lead = t;
+            open.push_back(t);
+            break;
+        case tt::For:
+        case tt::Elsif:
+        case tt::Else:
+        case tt::When: lead = t; break;
+        case tt::Generate:
+            if (lead == tt::For)
+            {
+                open.push_back(tt::Generate);
+            }
+            else if ((lead == tt::If || lead == tt::Case) && !open.empty() && open.back() == lead)
+            {
+                open.back() = tt::Generate;
+            }
+            lead = tt::Invalid;
+            break;
+
+        case tt::Process: code++; [[fallthrough]];
+        case tt::Loop:
+        case tt::Block:
+        case tt::Record:
+        case tt::Units:
+        case tt::Protected: open.push_back(t); break;
+        case tt::Component:
+            if (prev != tt::Colon)
+            {
+                open.push_back(t);
+            }
+            break;
+
+        case tt::Package:
+            if (peek(1) == tt::Body || (peek(2) == tt::Is && peek(3) != tt::New))
+            {
+                open.push_back(t);
+            }
+            break;
+        case tt::Function:
+        case tt::Procedure: spec = prev != tt::Colon; break; // not in an attribute specification
+        case tt::Is:
+            if (spec && peek(1) != tt::New)
+            {
+                open.push_back(tt::Function);
+                code++;
+            }
+            spec = false;
+            break;
+
+        case tt::Use:
+            if (prev == tt::Semi_Colon || prev == tt::Is || prev == tt::Begin)
+            {
+                use_clause();
+                continue;
+            }
+            break;
+        case tt::Colon:
+            if (code == 0 && prev == tt::Identifier)
+            {
+                switch (at(i - 2).type())
+                {
+                case tt::Semi_Colon:
+                case tt::Begin:
+                case tt::Generate:
+                case tt::Double_Arrow: outline_instance(); continue;
+                default: break;
+                }
+            }
+            break;
+        default: break;
+        }
+        i++;
+    }
+}
+
+//  label : after a statement start, an instance is kept with its target,
+//  the maps are skipped. Anything else goes on after the token after ':',
+//  or after the dotted prefix of a name there.
+//
+void unit_parser::outline_instance()
+{
+    stmt s{stmt_kind::instance, at(i - 1).offset(), at(i - 1).id()};
+    i++;
+    switch (peek())
+    {
+    case tt::Entity:
+    case tt::Component:
+    case tt::Configuration:
+        i++;
+        s.target = name();
+        break;
+    case tt::Identifier:
+    {
+        //  a component name, made a name only when a map follows. Its
+        //  parts are taken as they come, the lookahead of a pulled
+        //  source ends long before a dotted name may
+        //
+        dotted.clear();
+        offset_t pos = offset();
+        while (peek() == tt::Identifier && peek(1) == tt::Dot)
+        {
+            dotted.emplace_back(at(i).id(), at(i + 1).offset());
+            i += 2;
+        }
+        if (peek() != tt::Identifier || (peek(1) != tt::Generic && peek(1) != tt::Port))
+        {
+            return;
+        }
+        dotted.emplace_back(at(i++).id(), 0);
+        s.target = add(expr_kind::name, tt::Invalid, pos, dotted[0].first);
+        for (std::size_t k = 1; k < dotted.size(); k++)
+        {
+            s.target = add(expr_kind::select, {}, dotted[k - 1].second, s.target.index, dotted[k].first);
+        }
+        break;
+    }
+    default: return;
+    }
+
+    while ((peek() == tt::Generic || peek() == tt::Port) && peek(1) == tt::Map)
+    {
+        i += 2;
+        skip_parens();
+    }
+    stmt_stack.push_back(tree.add(s));
+}
+
+//-----------------------------------------------------------------------
+//  Declarations
+//-----------------------------------------------------------------------
+
+//  ( [class] names : [mode] subtype [:= default] { ; ... } ), also the
+//  generic types and subprograms of VHDL-2008
+//
+void unit_parser::interface_list(decl_kind kind)
+{
+    if (peek() != tt::Left_Paren)
+    {
+        error(diag_code::expected_declaration);
+        return;
+    }
+    do
+    {
+        i++; // ( or ;
+        switch (peek())
+        {
+        case tt::Type:
+        {
+            offset_t pos = offset();
+            i++;
+            decl_stack.push_back(tree.add(decl{decl_kind::type, tt::Invalid, pos, identifier()}));
+            continue;
+        }
+        case tt::Function:
+        case tt::Procedure:
+        case tt::Pure:
+        case tt::Impure: decl_stack.push_back(subprogram()); continue;
+        case tt::Package:
+            while (peek() != tt::Semi_Colon && peek() != tt::Right_Paren && peek() != tt::Eof)
+            {
+                if (peek() == tt::Left_Paren)
+                {
+                    elements(); // generic map (<>)
+                }
+                else
+                {
+                    i++;
+                }
+            }
+            continue;
+        case tt::Signal:
+        case tt::Constant:
+        case tt::Variable:
+        case tt::File: i++; break;
+        default: break;
+        }
+
+        auto mark = decl_stack.size();
+        do
+        {
+            offset_t pos = offset();
+            decl_stack.push_back(tree.add(decl{kind, tt::Invalid, pos, identifier()}));
+        } while (accept(tt::Comma));
+        if (!expect(tt::Colon, diag_code::expected_colon))
+        {
+            while (peek() != tt::Semi_Colon && peek() != tt::Right_Paren && peek() != tt::Eof)
+            {
+                i++;
+            }
+            continue;
+        }
+
+        token_type mode = tt::Invalid;
+        switch (peek())
+        {
+        case tt::In:
+        case tt::Out:
+        case tt::Inout:
+        case tt::Buffer:
+        case tt::Linkage: mode = at(i++).type(); break;
+        default: break;
+        }
+        ref<expr> type = subtype_indication();
+        accept(tt::Bus);
+        ref<expr> init = accept(tt::Assign) ? expression() : ref<expr>{};
+
+        for (auto k = mark; k < decl_stack.size(); k++)
+        {
+            auto& d = tree[decl_stack[k]];
+            d.mode = mode;
+            d.type = type;
+            d.init = init;
+        }
+    } while (peek() == tt::Semi_Colon);
+    expect(tt::Right_Paren, diag_code::expected_right_paren);
+}
+
+void unit_parser::declarations()
+{
+    nesting level{nested};
+    if (too_deep(level))
+    {
+        return;
+    }
+    while (declaration())
+    {
+    }
+}
+
+bool unit_parser::declaration_items(std::vector<ref<decl>>& items)
+{
+    auto mark = decl_stack.size();
+    declarations();
+    items.assign(decl_stack.begin() + static_cast<std::ptrdiff_t>(mark), decl_stack.end());
+    decl_stack.resize(mark);
+    return peek() == tt::Eof;
+}
+
+//  one declarative item, false at begin, end and the end of the range
+//
+bool unit_parser::declaration()
+{
+    offset_t pos = offset();
+    switch (peek())
+    {
+    case tt::Begin:
+    case tt::End:
+    case tt::Eof: return false;
+
+    case tt::Signal: i++; object_declaration(decl_kind::signal); break;
+    case tt::Constant: i++; object_declaration(decl_kind::constant); break;
+    case tt::Variable: i++; object_declaration(decl_kind::variable); break;
+    case tt::File: i++; object_declaration(decl_kind::file); break;
+    case tt::Shared:
+        i++;
+        expect(tt::Variable, diag_code::expected_keyword);
+        object_declaration(decl_kind::shared_variable);
+        break;
+
+    case tt::Type: type_declaration(); break;
+
+    case tt::Subtype:
+    {
+        i++;
+        decl d{decl_kind::subtype, tt::Invalid, pos, identifier()};
+        expect(tt::Is, diag_code::expected_keyword);
+        d.type = subtype_indication();
+        decl_stack.push_back(tree.add(d));
+        semicolon();
+        break;
+    }
+
+    case tt::Component:
+    {
+        i++;
+        decl d{decl_kind::component, tt::Invalid, pos, identifier()};
+        accept(tt::Is);
+        auto mark = decl_stack.size();
+        if (accept(tt::Generic))
+        {
+            interface_list(decl_kind::generic);
+            semicolon();
+        }
+        if (accept(tt::Port))
+        {
+            interface_list(decl_kind::port);
+            semicolon();
+        }
+        d.children = pop_list(decl_stack, mark);
+        decl_stack.push_back(tree.add(d));
+        end_of({tt::Component});
+        break;
+    }
+
+    case tt::Function:
+    case tt::Procedure:
+    case tt::Pure:
+    case tt::Impure:
+        decl_stack.push_back(subprogram());
+        semicolon();
+        break;
+
+    case tt::Package:
+    {
+        i++;
+        bool body = accept(tt::Body);
+        decl d{decl_kind::package, body ? tt::Body : tt::Invalid, pos, identifier()};
+        expect(tt::Is, diag_code::expected_keyword);
+        if (!body && accept(tt::New))
+        {
+            d.type = name();
+            d.init = map_aspect(tt::Generic);
+            decl_stack.push_back(tree.add(d));
+            semicolon();
+            break;
+        }
+        auto mark = decl_stack.size();
+        declarations();
+        d.children = pop_list(decl_stack, mark);
+        decl_stack.push_back(tree.add(d));
+        end_of({tt::Package, tt::Body});
+        break;
+    }
+
+    case tt::Alias:
+    {
+        i++;
+        decl d{decl_kind::alias, tt::Invalid, pos};
+        if (peek() == tt::Character || peek() == tt::String)
+        {
+            d.name = symbol_table::global().intern(at(i++).text(text), false);
+        }
+        else
+        {
+            d.name = identifier();
+        }
+        if (accept(tt::Colon))
+        {
+            d.type = subtype_indication();
+        }
+        expect(tt::Is, diag_code::expected_keyword);
+        d.init = name();
+        if (accept(tt::Left_Bracket)) // signature
+        {
+            while (peek() != tt::Right_Bracket && peek() != tt::Eof)
+            {
+                i++;
+            }
+            accept(tt::Right_Bracket);
+        }
+        decl_stack.push_back(tree.add(d));
+        semicolon();
+        break;
+    }
+
+    case tt::Attribute:
+    {
+        i++;
+        decl d{decl_kind::attribute, tt::Invalid, pos, identifier()};
+        if (accept(tt::Of))
+        {
+            //  specification: attribute a of x, y : signal is value;
+            //
+            d.mode = tt::Of;
+            do
+            {
+                if (accept(tt::Others) || accept(tt::All))
+                {
+                    continue;
+                }
+                auto entity = name();
+                d.type = d.type ? d.type : entity;
+            } while (accept(tt::Comma));
+            expect(tt::Colon, diag_code::expected_colon);
+            i++; // entity class
+            expect(tt::Is, diag_code::expected_keyword);
+            d.init = expression();
+        }
+        else if (expect(tt::Colon, diag_code::expected_colon))
+        {
+            d.type = name();
+        }
+        decl_stack.push_back(tree.add(d));
+        semicolon();
+        break;
+    }
+
+    case tt::Use: use_clause(); break;
+
+    case tt::For: // configuration specification
+    case tt::Disconnect:
+    case tt::Group: skip_statement(); break;
+
+    default:
+        error(diag_code::expected_declaration);
+        skip_statement();
+        break;
+    }
+    return true;
+}
+
+//  names : subtype [:= value]; the class word is already taken
+//
+void unit_parser::object_declaration(decl_kind kind)
+{
+    auto mark = decl_stack.size();
+    do
+    {
+        offset_t pos = offset();
+        decl_stack.push_back(tree.add(decl{kind, tt::Invalid, pos, identifier()}));
+    } while (accept(tt::Comma));
+    if (!expect(tt::Colon, diag_code::expected_colon))
+    {
+        skip_statement();
+        return;
+    }
+
+    ref<expr> type = subtype_indication();
+    ref<expr> init;
+    if (!accept(tt::Register))
+    {
+        accept(tt::Bus);
+    }
+    if (kind == decl_kind::file)
+    {
+        if (accept(tt::Open))
+        {
+            expression();
+        }
+        if (accept(tt::Is))
+        {
+            init = expression();
+        }
+    }
+    else if (accept(tt::Assign))
+    {
+        init = expression();
+    }
+
+    for (auto k = mark; k < decl_stack.size(); k++)
+    {
+        tree[decl_stack[k]].type = type;
+        tree[decl_stack[k]].init = init;
+    }
+    semicolon();
+}
+
+void unit_parser::type_declaration()
+{
+    offset_t pos = offset();
+    i++;
+    decl d{decl_kind::type, tt::Invalid, pos, identifier()};
+    if (peek() == tt::Semi_Colon) // incomplete type
+    {
+        decl_stack.push_back(tree.add(d));
+        i++;
+        return;
+    }
+    expect(tt::Is, diag_code::expected_keyword);
+
+    d.mode = peek();
+    switch (d.mode)
+    {
+    case tt::Left_Paren: d.type = parenthesized(); break;
+
+    case tt::Range:
+        i++;
+        d.type = subtype_indication();
+        if (accept(tt::Units))
+        {
+            //  primary unit, then secondary ones: ns; us = 1000 ns;
+            //
+            auto mark = decl_stack.size();
+            while (peek() == tt::Identifier)
+            {
+                decl unit{decl_kind::element, tt::Invalid, offset(), identifier()};
+                if (accept(tt::Equal))
+                {
+                    unit.init = expression();
+                }
+                decl_stack.push_back(tree.add(unit));
+                semicolon();
+            }
+            d.children = pop_list(decl_stack, mark);
+            expect(tt::End, diag_code::expected_keyword);
+            expect(tt::Units, diag_code::expected_keyword);
+            accept(tt::Identifier);
+        }
+        break;
+
+    case tt::Array:
+    {
+        i++;
+        offset_t at = offset();
+        auto mark = scratch.size();
+        if (expect(tt::Left_Paren, diag_code::expected_declaration))
+        {
+            do
+            {
+                scratch.push_back(subtype_indication());
+            } while (accept(tt::Comma));
+            expect(tt::Right_Paren, diag_code::expected_right_paren);
+        }
+        auto items = tree.add_list<expr>(std::span(scratch).subspan(mark));
+        scratch.resize(mark);
+        d.type = add(expr_kind::aggregate, tt::Array, at, 0, items.at);
+        expect(tt::Of, diag_code::expected_keyword);
+        d.init = subtype_indication();
+        break;
+    }
+
+    case tt::Record:
+    {
+        i++;
+        auto mark = decl_stack.size();
+        while (peek() == tt::Identifier)
+        {
+            object_declaration(decl_kind::element);
+        }
+        d.children = pop_list(decl_stack, mark);
+        expect(tt::End, diag_code::expected_keyword);
+        expect(tt::Record, diag_code::expected_keyword);
+        accept(tt::Identifier);
+        break;
+    }
+
+    case tt::Access: i++; d.type = subtype_indication(); break;
+
+    case tt::File:
+        i++;
+        expect(tt::Of, diag_code::expected_keyword);
+        d.type = name();
+        break;
+
+    case tt::Protected:
+    {
+        i++;
+        if (accept(tt::Body))
+        {
+            d.mode = tt::Body;
+        }
+        auto mark = decl_stack.size();
+        declarations();
+        d.children = pop_list(decl_stack, mark);
+        expect(tt::End, diag_code::expected_keyword);
+        expect(tt::Protected, diag_code::expected_keyword);
+        accept(tt::Body);
+        accept(tt::Identifier);
+        break;
+    }
+
+    default:
+        error(diag_code::expected_declaration);
+        skip_statement();
+        return;
+    }
+    decl_stack.push_back(tree.add(d));
+    semicolon();
+}
+
+//  [pure | impure] function name [parameter] (list) return type [is body]
+//  without the closing ';'. In a generic list "is <>" or "is name" is
+//  the default.
+//
+ref<decl> unit_parser::subprogram()
+{
+    offset_t pos = offset();
+    if (!accept(tt::Pure))
+    {
+        accept(tt::Impure);
+    }
+    bool function = peek() == tt::Function;
+    i++;
+
+    decl d{function ? decl_kind::function : decl_kind::procedure, tt::Invalid, pos};
+    if (peek() == tt::String) // operator symbol
+    {
+        d.name = symbol_table::global().intern(at(i++).text(text), false);
+    }
+    else
+    {
+        d.name = identifier();
+    }
+
+    auto mark = decl_stack.size();
+    if (accept(tt::Generic))
+    {
+        interface_list(decl_kind::generic);
+    }
+    accept(tt::Parameter);
+    if (peek() == tt::Left_Paren)
+    {
+        interface_list(decl_kind::parameter);
+    }
+    d.children = pop_list(decl_stack, mark);
+    if (function && expect(tt::Return, diag_code::expected_keyword))
+    {
+        d.type = name();
+    }
+
+    if (accept(tt::Is))
+    {
+        switch (peek())
+        {
+        case tt::Box: i++; break;
+        case tt::Identifier: name(); break;
+        case tt::New:
+            while (peek() != tt::Semi_Colon && peek() != tt::Eof)
+            {
+                i++;
+            }
+            break;
+        default:
+        {
+            stmt body{stmt_kind::block, offset()};
+            auto dmark = decl_stack.size();
+            declarations();
+            body.decls = pop_list(decl_stack, dmark);
+            expect(tt::Begin, diag_code::expected_keyword);
+            auto smark = stmt_stack.size();
+            sequential_statements();
+            body.body = pop_list(stmt_stack, smark);
+            if (expect(tt::End, diag_code::expected_keyword))
+            {
+                accept(function ? tt::Function : tt::Procedure);
+                if (peek() == tt::Identifier || peek() == tt::String)
+                {
+                    i++;
+                }
+            }
+            d.body = tree.add(body);
+            break;
+        }
+        }
+    }
+    return tree.add(d);
+}
+
+//  [resolution] type_mark [constraint], also a discrete range: with a
+//  range constraint it is a constraint node, a to b is a range node
+//
+ref<expr> unit_parser::subtype_indication()
+{
+    offset_t pos = offset();
+    if (peek() == tt::Left_Paren) // element resolution, not kept
+    {
+        parenthesized();
+    }
+    else if (peek() == tt::Identifier && peek(1) == tt::Identifier) // resolution function
+    {
+        i++;
+    }
+
+    ref<expr> mark = expression();
+    switch (peek())
+    {
+    case tt::To:
+    case tt::Downto:
+    {
+        token_type dir = at(i++).type();
+        return add(expr_kind::range, dir, pos, mark.index, expression().index);
+    }
+    case tt::Range:
+    {
+        i++;
+        ref<expr> range = accept(tt::Box) ? ref<expr>{} : choice();
+        return add(expr_kind::constraint, tt::Range, pos, mark.index, range.index);
+    }
+    default: return mark;
+    }
+}
+
+//-----------------------------------------------------------------------
+//  Concurrent statements
+//-----------------------------------------------------------------------
+
+void unit_parser::concurrent_statements()
+{
+    nesting level{nested};
+    if (too_deep(level))
+    {
+        return;
+    }
+    for (;;)
+    {
+        switch (peek())
+        {
+        case tt::End:
+        case tt::Eof:
+        case tt::Elsif:
+        case tt::Else:
+        case tt::When: return;
+        default: break;
+        }
+        auto before = i;
+        if (auto s = concurrent_statement())
+        {
+            stmt_stack.push_back(s);
+        }
+        if (i == before)
+        {
+            i++;
+        }
+    }
+}
+
+bool unit_parser::statement_items(bool sequential, std::vector<ref<stmt>>& items)
+{
+    auto mark = stmt_stack.size();
+    if (sequential)
+    {
+        sequential_statements();
+    }
+    else
+    {
+        concurrent_statements();
+    }
+    items.assign(stmt_stack.begin() + static_cast<std::ptrdiff_t>(mark), stmt_stack.end());
+    stmt_stack.resize(mark);
+    return peek() == tt::Eof;
+}
+
+ref<stmt> unit_parser::concurrent_statement()
+{
+    stmt s{stmt_kind::null, offset()};
+    if (peek() == tt::Identifier && peek(1) == tt::Colon)
+    {
+        s.label = at(i).id();
+        i += 2;
+    }
+    accept(tt::Postponed);
+
+    switch (peek())
+    {
+    case tt::Process: return process_statement(s);
+    case tt::Block: return block_statement(s);
+    case tt::For:
+    case tt::If:
+    case tt::Case: return generate_statement(s);
+    case tt::Entity:
+    case tt::Component:
+    case tt::Configuration: return instance(s);
+    case tt::Assert: return assertion(s);
+    case tt::With: return selected_assignment(s);
+    case tt::Identifier:
+    case tt::Left_Paren:
+    case tt::String: return concurrent_assignment(s);
+    default:
+        error(diag_code::expected_statement);
+        skip_statement();
+        return {};
+    }
+}
+
+ref<stmt> unit_parser::process_statement(stmt s)
+{
+    s.kind = stmt_kind::process;
+    i++;
+    if (peek() == tt::Left_Paren)
+    {
+        offset_t pos = offset();
+        if (peek(1) == tt::All && peek(2) == tt::Right_Paren)
+        {
+            i += 3;
+            s.cond = add(expr_kind::aggregate, tt::All, pos);
+        }
+        else
+        {
+            s.cond = add(expr_kind::aggregate, tt::Invalid, pos, 0, elements().at);
+        }
+    }
+    accept(tt::Is);
+
+    auto dmark = decl_stack.size();
+    declarations();
+    s.decls = pop_list(decl_stack, dmark);
+    expect(tt::Begin, diag_code::expected_keyword);
+    auto smark = stmt_stack.size();
+    sequential_statements();
+    s.body = pop_list(stmt_stack, smark);
+    end_of({tt::Postponed, tt::Process});
+    return tree.add(s);
+}
+
+ref<stmt> unit_parser::block_statement(stmt s)
+{
+    s.kind = stmt_kind::block;
+    i++;
+    if (accept(tt::Left_Paren)) // guard
+    {
+        s.cond = expression();
+        expect(tt::Right_Paren, diag_code::expected_right_paren);
+    }
+    accept(tt::Is);
+
+    auto dmark = decl_stack.size();
+    for (auto header : {tt::Generic, tt::Port})
+    {
+        if (peek() == header && peek(1) != tt::Map)
+        {
+            i++;
+            interface_list(header == tt::Generic ? decl_kind::generic : decl_kind::port);
+            semicolon();
+        }
+        if (map_aspect(header))
+        {
+            semicolon();
+        }
+    }
+    declarations();
+    s.decls = pop_list(decl_stack, dmark);
+    expect(tt::Begin, diag_code::expected_keyword);
+    auto smark = stmt_stack.size();
+    concurrent_statements();
+    s.body = pop_list(stmt_stack, smark);
+    end_of({tt::Block});
+    return tree.add(s);
+}
+
+ref<stmt> unit_parser::generate_statement(stmt s)
+{
+    s.kind = stmt_kind::generate;
+    switch (peek())
+    {
+    case tt::For:
+    {
+        i++;
+        offset_t pos = offset();
+        s.target = add(expr_kind::name, tt::Invalid, pos, identifier());
+        expect(tt::In, diag_code::expected_keyword);
+        s.cond = subtype_indication();
+        expect(tt::Generate, diag_code::expected_keyword);
+        generate_body(s);
+        break;
+    }
+
+    case tt::If:
+        i++;
+        if (peek() == tt::Identifier && peek(1) == tt::Colon) // alternative label
+        {
+            i += 2;
+        }
+        s.cond = expression();
+        expect(tt::Generate, diag_code::expected_keyword);
+        generate_body(s);
+        s.alt = generate_else();
+        break;
+
+    default: // case
+    {
+        i++;
+        s.kind = stmt_kind::case_;
+        s.cond = expression();
+        expect(tt::Generate, diag_code::expected_keyword);
+        auto mark = stmt_stack.size();
+        while (peek() == tt::When)
+        {
+            stmt w{stmt_kind::when, offset()};
+            i++;
+            if (peek() == tt::Identifier && peek(1) == tt::Colon)
+            {
+                i += 2;
+            }
+            w.cond = choices();
+            expect(tt::Double_Arrow, diag_code::expected_keyword);
+            generate_body(w);
+            stmt_stack.push_back(tree.add(w));
+        }
+        s.body = pop_list(stmt_stack, mark);
+        break;
+    }
+    }
+    end_of({tt::Generate});
+    return tree.add(s);
+}
+
+//  [declarations begin] statements [end [label];]
+//
+void unit_parser::generate_body(stmt& s)
+{
+    auto dmark = decl_stack.size();
+    switch (peek())
+    {
+    case tt::Begin:
+    case tt::Signal:
+    case tt::Constant:
+    case tt::Variable:
+    case tt::Shared:
+    case tt::File:
+    case tt::Type:
+    case tt::Subtype:
+    case tt::Component:
+    case tt::Function:
+    case tt::Procedure:
+    case tt::Pure:
+    case tt::Impure:
+    case tt::Alias:
+    case tt::Attribute:
+    case tt::Use:
+        declarations();
+        expect(tt::Begin, diag_code::expected_keyword);
+        break;
+    default: break;
+    }
+    s.decls = pop_list(decl_stack, dmark);
+
+    auto smark = stmt_stack.size();
+    concurrent_statements();
+    s.body = pop_list(stmt_stack, smark);
+
+    if (peek() == tt::End && peek(1) != tt::Generate)
+    {
+        i++;
+        accept(tt::Identifier);
+        semicolon();
+    }
+}
+
+ref<stmt> unit_parser::generate_else()
+{
+    auto mark = branches.size();
+    while (peek() == tt::Elsif || peek() == tt::Else)
+    {
+        stmt s{stmt_kind::generate, offset()};
+        bool elsif = at(i++).type() == tt::Elsif;
+        if (peek() == tt::Identifier && peek(1) == tt::Colon)
+        {
+            i += 2;
+        }
+        if (elsif)
+        {
+            s.cond = expression();
+        }
+        expect(tt::Generate, diag_code::expected_keyword);
+        generate_body(s);
+        branches.push_back(s);
+    }
+    return chain(mark);
+}
+
+//  The branches from mark on as a chain through alt, added last first
+//
+ref<stmt> unit_parser::chain(std::size_t mark)
+{
+    ref<stmt> alt;
+    while (branches.size() > mark)
+    {
+        branches.back().alt = alt;
+        alt = tree.add(branches.back());
+        branches.pop_back();
+    }
+    return alt;
+}
+
+//  [entity | component | configuration] name [generic map] [port map];
+//  s.target is set already when the name came first
+//
+ref<stmt> unit_parser::instance(stmt s)
+{
+    s.kind = stmt_kind::instance;
+    if (!s.target)
+    {
+        i++;
+        s.target = name();
+    }
+    s.cond = map_aspect(tt::Generic);
+    s.value = map_aspect(tt::Port);
+    semicolon();
+    return tree.add(s);
+}
+
+ref<expr> unit_parser::map_aspect(token_type keyword)
+{
+    if (peek() != keyword || peek(1) != tt::Map)
+    {
+        return {};
+    }
+    offset_t pos = offset();
+    i += 2;
+    if (peek() != tt::Left_Paren)
+    {
+        error(diag_code::expected_expression);
+        return {};
+    }
+    return add(expr_kind::aggregate, keyword, pos, 0, elements().at);
+}
+
+ref<stmt> unit_parser::concurrent_assignment(stmt s)
+{
+    s.target = target();
+    switch (peek())
+    {
+    case tt::Generic:
+    case tt::Port: return instance(s);
+    case tt::Less_Equal:
+        i++;
+        s.kind = stmt_kind::signal_assign;
+        accept(tt::Guarded);
+        conditional_waveforms(s);
+        semicolon();
+        return tree.add(s);
+    case tt::Semi_Colon: // procedure call
+        i++;
+        s.kind = stmt_kind::call;
+        return tree.add(s);
+    default:
+        error(diag_code::expected_statement);
+        skip_statement();
+        return {};
+    }
+}
+
+//  with sel select target <= w1 when c1, w2 when others;
+//
+ref<stmt> unit_parser::selected_assignment(stmt s)
+{
+    i++;
+    s.kind = stmt_kind::case_;
+    s.cond = expression();
+    expect(tt::Select, diag_code::expected_keyword);
+    accept(tt::Question_Mark);
+    s.target = target();
+    expect(tt::Less_Equal, diag_code::expected_keyword);
+    accept(tt::Guarded);
+    delay_mechanism();
+
+    auto mark = stmt_stack.size();
+    do
+    {
+        stmt w{stmt_kind::when, offset()};
+        w.value = waveform();
+        expect(tt::When, diag_code::expected_keyword);
+        w.cond = choices();
+        stmt_stack.push_back(tree.add(w));
+    } while (accept(tt::Comma));
+    s.body = pop_list(stmt_stack, mark);
+    semicolon();
+    return tree.add(s);
+}
+
+//-----------------------------------------------------------------------
+//  Sequential statements
+//-----------------------------------------------------------------------
+
+void unit_parser::sequential_statements()
+{
+    nesting level{nested};
+    if (too_deep(level))
+    {
+        return;
+    }
+    for (;;)
+    {
+        switch (peek())
+        {
+        case tt::End:
+        case tt::Eof:
+        case tt::Elsif:
+        case tt::Else:
+        case tt::When: return;
+        default: break;
+        }
+        auto before = i;
+        if (auto s = sequential_statement())
+        {
+            stmt_stack.push_back(s);
+        }
+        if (i == before)
+        {
+            i++;
+        }
+    }
+}
+
+ref<stmt> unit_parser::sequential_statement()
+{
+    stmt s{stmt_kind::null, offset()};
+    if (peek() == tt::Identifier && peek(1) == tt::Colon)
+    {
+        s.label = at(i).id();
+        i += 2;
+    }
+
+    switch (peek())
+    {
+    case tt::If: return if_statement(s);
+    case tt::Case: return case_statement(s);
+    case tt::For:
+    case tt::While:
+    case tt::Loop: return loop_statement(s);
+    case tt::Assert: return assertion(s);
+
+    case tt::Wait:
+        i++;
+        s.kind = stmt_kind::wait;
+        if (accept(tt::On))
+        {
+            offset_t pos = offset();
+            auto mark = scratch.size();
+            do
+            {
+                scratch.push_back(name());
+            } while (accept(tt::Comma));
+            auto items = tree.add_list<expr>(std::span(scratch).subspan(mark));
+            scratch.resize(mark);
+            s.target = add(expr_kind::aggregate, tt::Invalid, pos, 0, items.at);
+        }
+        if (accept(tt::Until))
+        {
+            s.cond = expression();
+        }
+        if (accept(tt::For))
+        {
+            s.value = expression();
+        }
+        break;
+
+    case tt::Report:
+        i++;
+        s.kind = stmt_kind::report;
+        s.value = expression();
+        if (accept(tt::Severity))
+        {
+            s.target = expression();
+        }
+        break;
+
+    case tt::Return:
+        i++;
+        s.kind = stmt_kind::return_;
+        if (peek() != tt::Semi_Colon)
+        {
+            s.value = expression();
+        }
+        break;
+
+    case tt::Exit:
+    case tt::Next:
+        s.kind = at(i++).type() == tt::Exit ? stmt_kind::exit : stmt_kind::next;
+        if (peek() == tt::Identifier)
+        {
+            offset_t pos = offset();
+            s.target = add(expr_kind::name, tt::Invalid, pos, at(i++).id());
+        }
+        if (accept(tt::When))
+        {
+            s.cond = expression();
+        }
+        break;
+
+    case tt::Null: i++; break;
+
+    case tt::Identifier:
+    case tt::Left_Paren:
+    case tt::String: return assignment(s);
+
+    default:
+        error(diag_code::expected_statement);
+        skip_statement();
+        return {};
+    }
+    semicolon();
+    return tree.add(s);
+}
+
+ref<stmt> unit_parser::if_statement(stmt s)
+{
+    i++;
+    s.kind = stmt_kind::if_;
+    s.cond = expression();
+    expect(tt::Then, diag_code::expected_keyword);
+    auto mark = stmt_stack.size();
+    sequential_statements();
+    s.body = pop_list(stmt_stack, mark);
+    s.alt = else_part();
+    end_of({tt::If});
+    return tree.add(s);
+}
+
+//  elsif and else as a chain of if_ nodes, else has no condition
+//
+ref<stmt> unit_parser::else_part()
+{
+    auto mark = branches.size();
+    while (peek() == tt::Elsif || peek() == tt::Else)
+    {
+        stmt s{stmt_kind::if_, offset()};
+        if (at(i++).type() == tt::Elsif)
+        {
+            s.cond = expression();
+            expect(tt::Then, diag_code::expected_keyword);
+        }
+        auto smark = stmt_stack.size();
+        sequential_statements();
+        s.body = pop_list(stmt_stack, smark);
+        branches.push_back(s);
+    }
+    return chain(mark);
+}
+
+ref<stmt> unit_parser::case_statement(stmt s)
+{
+    i++;
+    s.kind = stmt_kind::case_;
+    accept(tt::Question_Mark);
+    s.cond = expression();
+    expect(tt::Is, diag_code::expected_keyword);
+
+    auto mark = stmt_stack.size();
+    while (peek() == tt::When)
+    {
+        stmt w{stmt_kind::when, offset()};
+        i++;
+        w.cond = choices();
+        expect(tt::Double_Arrow, diag_code::expected_keyword);
+        auto body = stmt_stack.size();
+        sequential_statements();
+        w.body = pop_list(stmt_stack, body);
+        stmt_stack.push_back(tree.add(w));
+    }
+    s.body = pop_list(stmt_stack, mark);
+    end_of({tt::Case, tt::Question_Mark});
+    return tree.add(s);
+}
+
+ref<stmt> unit_parser::loop_statement(stmt s)
+{
+    s.kind = stmt_kind::loop;
+    if (accept(tt::While))
+    {
+        s.cond = expression();
+    }
+    else if (accept(tt::For))
+    {
+        offset_t pos = offset();
+        s.target = add(expr_kind::name, tt::Invalid, pos, identifier());
+        expect(tt::In, diag_code::expected_keyword);
+        s.cond = subtype_indication();
+    }
+    expect(tt::Loop, diag_code::expected_keyword);
+    auto mark = stmt_stack.size();
+    sequential_statements();
+    s.body = pop_list(stmt_stack, mark);
+    end_of({tt::Loop});
+    return tree.add(s);
+}
+
+//  target <= waveform; target := value; or a procedure call
+//
+ref<stmt> unit_parser::assignment(stmt s)
+{
+    s.target = target();
+    switch (peek())
+    {
+    case tt::Less_Equal: s.kind = stmt_kind::signal_assign; break;
+    case tt::Assign: s.kind = stmt_kind::variable_assign; break;
+    case tt::Semi_Colon: s.kind = stmt_kind::call; break;
+    default:
+        error(diag_code::expected_statement);
+        skip_statement();
+        return {};
+    }
+    if (s.kind != stmt_kind::call)
+    {
+        i++;
+        conditional_waveforms(s);
+    }
+    semicolon();
+    return tree.add(s);
+}
+
+//  assert cond [report message] [severity level];
+//
+ref<stmt> unit_parser::assertion(stmt s)
+{
+    i++;
+    s.kind = stmt_kind::assert;
+    s.cond = expression();
+    if (accept(tt::Report))
+    {
+        s.value = expression();
+    }
+    if (accept(tt::Severity))
+    {
+        s.target = expression();
+    }
+    semicolon();
+    return tree.add(s);
+}
+
+//-----------------------------------------------------------------------
+//  Parts of statements
+//-----------------------------------------------------------------------
+
+//  a name, or an aggregate of names: (a, b) <= v
+//
+ref<expr> unit_parser::target()
+{
+    return peek() == tt::Left_Paren ? parenthesized() : name();
+}
+
+void unit_parser::delay_mechanism()
+{
+    if (accept(tt::Transport))
+    {
+        return;
+    }
+    if (accept(tt::Reject))
+    {
+        expression();
+        expect(tt::Inertial, diag_code::expected_keyword);
+        return;
+    }
+    accept(tt::Inertial);
+}
+
+//  value [after delay] {, ...}, a single element is the element itself
+//
+ref<expr> unit_parser::waveform()
+{
+    offset_t pos = offset();
+    auto mark = scratch.size();
+    do
+    {
+        offset_t at = offset();
+        ref<expr> e;
+        if (accept(tt::Unaffected))
+        {
+            e = add(expr_kind::null, tt::Unaffected, at);
+        }
+        else
+        {
+            e = expression();
+            if (peek() == tt::After)
+            {
+                offset_t after = offset();
+                i++;
+                e = add(expr_kind::binary, tt::After, after, e.index, expression().index);
+            }
+        }
+        scratch.push_back(e);
+    } while (accept(tt::Comma));
+
+    if (scratch.size() == mark + 1)
+    {
+        auto e = scratch[mark];
+        scratch.resize(mark);
+        return e;
+    }
+    auto items = tree.add_list<expr>(std::span(scratch).subspan(mark));
+    scratch.resize(mark);
+    return add(expr_kind::aggregate, tt::Comma, pos, 0, items.at);
+}
+
+//  [delay] waveform [when cond [else ...]], each else part is the alt
+//  of the one before it
+//
+void unit_parser::conditional_waveforms(stmt& s)
+{
+    delay_mechanism();
+    s.value = waveform();
+    if (accept(tt::When))
+    {
+        s.cond = expression();
+        if (peek() == tt::Else)
+        {
+            stmt alt{s.kind, offset()};
+            i++;
+            conditional_waveforms(alt);
+            s.alt = tree.add(alt);
+        }
+    }
+}
+
+//  choice { | choice }, more than one is an aggregate with op Bar
+//
+ref<expr> unit_parser::choices()
+{
+    offset_t pos = offset();
+    auto mark = scratch.size();
+    do
+    {
+        scratch.push_back(choice());
+    } while (accept(tt::Bar));
+
+    if (scratch.size() == mark + 1)
+    {
+        auto c = scratch[mark];
+        scratch.resize(mark);
+        return c;
+    }
+    auto items = tree.add_list<expr>(std::span(scratch).subspan(mark));
+    scratch.resize(mark);
+    return add(expr_kind::aggregate, tt::Bar, pos, 0, items.at);
+}
+
+//-----------------------------------------------------------------------
+//  Splitting and the parallel parse
+//-----------------------------------------------------------------------
+
+std::vector<std::size_t> unit_starts(token_stream const& tokens)
+{
+    constexpr auto none = std::numeric_limits<std::size_t>::max();
+    auto types = tokens.types();
+    auto type = [&types](std::size_t k) { return k < types.size() ? types[k] : tt::Eof; };
+
+    std::vector<std::size_t> starts{0};
+    std::size_t context = none; // first context clause in front of the current statement
+    for (std::size_t k = 0; k < types.size(); k++)
+    {
+        if (k != 0 && types[k - 1] != tt::Semi_Colon)
+        {
+            continue;
+        }
+
+        bool unit = false;
+        switch (types[k])
+        {
+        case tt::Library:
+        case tt::Use:
+            context = context == none ? k : context;
+            continue;
+        case tt::Context:
+            if (type(k + 2) != tt::Is)
+            {
+                context = context == none ? k : context;
+                continue;
+            }
+            unit = type(k + 1) == tt::Identifier;
+            break;
+        case tt::Entity: unit = type(k + 1) == tt::Identifier && type(k + 2) == tt::Is; break;
+        case tt::Architecture:
+        case tt::Configuration: unit = type(k + 1) == tt::Identifier && type(k + 2) == tt::Of; break;
+        case tt::Package:
+            unit = type(k + 1) == tt::Body ||
+                   (type(k + 1) == tt::Identifier && type(k + 2) == tt::Is && type(k + 3) != tt::New);
+            break;
+        default: break;
+        }
+
+        auto start = context != none ? context : k;
+        if (unit && start > starts.back())
+        {
+            starts.push_back(start);
+        }
+        context = none;
+    }
+    return starts;
+}
+
+namespace
+{
+
+//  units smaller than this are parsed together, a task costs an ast
+//
+constexpr std::size_t min_task_tokens = 4096;
+
+struct unit_task
+{
+    std::size_t first;
+    std::size_t last;
+    ast part{};
+    diagnostics issues{};
+    bool done = false;
+};
+
+} // namespace
+
+bool clean_end(ast const& tree, std::span<const ref<design_unit>> units, diagnostics const& issues)
+{
+    if (units.empty() || issues.dropped() != 0)
+    {
+        return false;
+    }
+    auto from = tree[units.back()].pos;
+    auto kept = issues.kept();
+    return std::none_of(kept.begin(), kept.end(), [from](auto const& d) { return d.offset >= from; });
+}
+
+//-----------------------------------------------------------------------
+//  parse_design_units: with a pool the stream is cut at unit_starts into
+//  tasks of min_task_tokens or more. A task whose cut turns out not to be
+//  clean is joined with the one after it and the two are parsed again,
+//  until every cut is.
+//
+ast parse_design_units(token_stream const& tokens, std::string_view text, diagnostics& errors, work_pool* pool,
+                       parse_mode mode)
+{
+    ast tree;
+    std::vector<ref<design_unit>> units;
+
+    std::vector<unit_task> tasks;
+    std::size_t first = 0;
+    if (pool != nullptr && pool->size() > 1)
+    {
+        for (auto start : unit_starts(tokens))
+        {
+            if (start - first >= min_task_tokens)
+            {
+                tasks.push_back({first, start});
+                first = start;
+            }
+        }
+    }
+
+    if (tasks.empty())
+    {
+        unit_parser p{tokens, text, tree, errors};
+        p.set_mode(mode);
+        p.design_units(units);
+        tree.set_design_units(units);
+        return tree;
+    }
+    tasks.push_back({first, tokens.size()});
+
+    for (;;)
+    {
+        std::vector<std::size_t> todo;
+        for (std::size_t k = 0; k < tasks.size(); k++)
+        {
+            if (!tasks[k].done)
+            {
+                todo.push_back(k);
+            }
+        }
+        pool->run(todo.size(), [&](std::size_t n) {
+            auto& t = tasks[todo[n]];
+            std::vector<ref<design_unit>> found;
+            unit_parser p{tokens, text, t.part, t.issues, t.first, t.last};
+            p.set_mode(mode);
+            p.design_units(found);
+            t.part.set_design_units(found);
+            t.done = true;
+        });
+
+        std::vector<bool> clean(tasks.size());
+        for (std::size_t k = 0; k < tasks.size(); k++)
+        {
+            clean[k] = clean_end(tasks[k].part, tasks[k].part.design_units(), tasks[k].issues);
+        }
+        std::vector<unit_task> joined;
+        for (std::size_t k = 0; k < tasks.size(); k++)
+        {
+            if (k != 0 && !clean[k - 1])
+            {
+                auto& t = joined.back();
+                t.last = tasks[k].last;
+                t.part = ast{};
+                t.issues.clear();
+                t.done = false;
+                continue;
+            }
+            joined.push_back(std::move(tasks[k]));
+        }
+        bool again = joined.size() != tasks.size();
+        tasks = std::move(joined);
+        if (!again)
+        {
+            break;
+        }
+    }
+
+    std::vector<ast> parts;
+    parts.reserve(tasks.size());
+    for (auto& t : tasks)
+    {
+        parts.push_back(std::move(t.part));
+    }
+    units = tree.merge(parts, pool);
+    for (auto const& t : tasks)
+    {
+        errors.append(t.issues);
+    }
+    tree.set_design_units(units);
+    return tree;
+}
+
+ast parse_design_units(token_source& source, diagnostics& errors, parse_mode mode)
+{
+    ast tree;
+    diagnostics found;
+    std::vector<ref<design_unit>> units;
+    unit_parser p{source, tree, found};
+    p.set_mode(mode);
+    p.design_units(units);
+    tree.set_design_units(units);
+    errors.append(source.diags());
+    errors.append(found);
+    return tree;
+}
+
+} // namespace vlark
@@ -18,87 +18,221 @@
 #include <cassert>
 #include <fstream>
 #include <iterator>
+#include <limits>
 #include <ostream>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VLARK_HAS_MMAP 1
+#else
+#define VLARK_HAS_MMAP 0
+#endif
+
 namespace vlark
 {
 
 //-----------------------------------------------------------------------
-//  load: extract line-by-line file content
+//  mapped_file: map (or read) the complete file content
 //
-bool sourceBuffer::load(std::string const& fname)
+bool mapped_file::open(std::string const& path, bool use_mmap, bool copy_on_write)
 {
-    std::ifstream in{fname};
-    if (!in.is_open())
-    {
-        return false;
-    }
-    // use c++ string later if possible
-    char buf[max_line_len];
+    close();
 
-    auto skip_space = [&](std::string_view v) -> size_t {
-        auto cl_in = std::ranges::find_if(v.begin(), v.end(), [](char ch) { return !std::isspace(ch); });
-        return std::distance(v.begin(), cl_in);
-    };
-
-    while (in.getline(&buf[0], max_line_len))
+#if VLARK_HAS_MMAP
+    if (use_mmap)
     {
-        std::string_view nstr(&buf[skip_space(buf)]);
-
-        //  Handle preprocessor source separately, they're outside the language
-        //
-        if (is_empty_line(buf))
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
         {
-            lines.emplace_back(&buf[0], source_line::category::empty);
+            return false;
         }
-        else if (nstr.starts_with('-') && nstr.starts_with("--"))
+
+        struct stat st
         {
-            lines.emplace_back(&buf[0], source_line::category::comment);
+        };
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            ::close(fd);
+            return false;
         }
-        else if (nstr.starts_with('/') && nstr.starts_with("/*"))
+
+        //  mmap of a zero length file is not allowed, an empty view is fine
+        //
+        if (st.st_size == 0)
         {
-            lines.emplace_back(&buf[0], source_line::category::multii_com_s);
-            auto cmult = false;
-            while (!cmult && in.getline(&buf[0], max_line_len))
-            {
-                std::string_view str(&buf[0]);
-                cmult = str.find("*/") != std::string_view::npos;
-                if (cmult)
-                {
-                    lines.emplace_back(&buf[0], source_line::category::multi_com_e);
-                    break;
-                }
-                lines.emplace_back(&buf[0], source_line::category::multii_com);
-            }
+            ::close(fd);
+            return true;
         }
-        else
+
+        auto len = static_cast<std::size_t>(st.st_size);
+        int prot = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* addr = ::mmap(nullptr, len, prot, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps its own reference
+        if (addr == MAP_FAILED)
         {
-            lines.emplace_back(&buf[0], source_line::category::raw);
+            return false;
         }
+        ::madvise(addr, len, MADV_SEQUENTIAL);
+
+        data = static_cast<char*>(addr);
+        size = len;
+        mapped = true;
+        return true;
+    }
+#else
+    (void)use_mmap;
+    (void)copy_on_write;
+#endif
+
+    std::ifstream in{path, std::ios::binary | std::ios::ate};
+    if (!in.is_open())
+    {
+        return false;
+    }
+    buffered.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    if (!in.read(buffered.data(), static_cast<std::streamsize>(buffered.size())))
+    {
+        buffered.clear();
+        return false;
+    }
+    data = buffered.data();
+    size = buffered.size();
+    return true;
+}
+
+void mapped_file::close()
+{
+#if VLARK_HAS_MMAP
+    if (mapped)
+    {
+        ::munmap(data, size);
     }
+#endif
+    buffered.clear();
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
 
-    //   prevent buffer overflow
-    //  Make sure we are safe
-    if (in.gcount() >= max_line_len - 1)
+//-----------------------------------------------------------------------
+//  load: map the file and index its lines (offsets, no copies)
+//
+bool sourceBuffer::load(std::string const& fname, load_mode mode)
+{
+    if (!content.open(fname, mode == load_mode::mapped))
     {
-        std::cerr << "source line too long - length must be less than ";
         return false;
     }
 
-    //  This shouldn't be possible, so check it anyway
+    //  token and line offsets are 32 bit
     //
-    if (!in.eof())
+    if (content.view().size() > std::numeric_limits<std::uint32_t>::max())
     {
-        std::cerr << "unexpected error reading source lines - did not reach EOF";
+        std::cerr << "source file too large - use the stream tokenizer: " << fname << "\n";
+        content.close();
         return false;
     }
 
+    split_lines(content.view(), lines);
     return true;
 }
 
+//-----------------------------------------------------------------------
+//  split_lines: find all lines and classify them in bulk
+//
+//  empty:        only spaces
+//  comment:      starts with -- after the indentation
+//  multii_com_s: starts with /* after the indentation, the following
+//                lines are multii_com up to the line holding the next */
+//                which is multi_com_e
+//  raw:          source code
+//
+void split_lines(std::string_view text, line_table& table, simd::isa level)
+{
+    using category = source_line::category;
+    auto& starts = table.starts;
+    auto& cats = table.cats;
+
+    starts.clear();
+    cats.clear();
+    if (text.empty())
+    {
+        return;
+    }
+
+    starts.reserve(text.size() / 32);
+    starts.push_back(0);
+    simd::find_newlines(text, starts, level);
+    if (starts.back() == text.size())
+    {
+        starts.pop_back(); // a trailing newline does not open a new line
+    }
+
+    const std::size_t nlines = starts.size();
+    cats.resize(nlines);
+
+    for (std::size_t i = 0; i < nlines; i++)
+    {
+        std::string_view line = table.line(text, i);
+
+        //  indentation is mostly short, the kernel only pays off on long runs
+        //
+        std::size_t first = 0;
+        while (first < line.size() && first < 16 && simd::is_space(line[first]))
+        {
+            first++;
+        }
+        if (first == 16)
+        {
+            first += simd::skip_space(line.substr(first), level);
+        }
+        std::string_view nstr = line.substr(first);
+
+        if (nstr.empty())
+        {
+            cats[i] = category::empty;
+        }
+        else if (nstr.starts_with("--"))
+        {
+            cats[i] = category::comment;
+        }
+        else if (nstr.starts_with("/*"))
+        {
+            cats[i] = category::multii_com_s;
+            if (i + 1 == nlines)
+            {
+                break;
+            }
+
+            //  one search over the rest of the text, then mark the lines in between
+            //
+            std::size_t from = starts[i + 1];
+            std::size_t end = simd::find_pair(text.substr(from), '*', '/', level);
+            std::size_t last = nlines;
+            if (end != std::string_view::npos)
+            {
+                auto it = std::upper_bound(starts.begin() + static_cast<std::ptrdiff_t>(i + 1), starts.end(), from + end);
+                last = static_cast<std::size_t>(it - starts.begin()) - 1;
+                cats[last] = category::multi_com_e;
+            }
+            std::fill(cats.begin() + static_cast<std::ptrdiff_t>(i + 1), cats.begin() + static_cast<std::ptrdiff_t>(last),
+                      category::multii_com);
+            i = last;
+        }
+        else
+        {
+            cats[i] = category::raw;
+        }
+    }
+}
+
 bool is_empty_line(std::string_view line)
 {
-    return std::ranges::all_of(line.begin(), line.end(), [](char c) { return std::isspace(c) || c == '\n'; });
+    return simd::skip_space(line) == line.size();
 }
 
 } // namespace vlark
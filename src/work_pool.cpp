@@ -0,0 +1,212 @@
+// Copyright(c) 2023 Dennis Addo
+
+// MIT License
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//===========================================================================
+//  Work pool - a fixed set of threads sharing tasks by work stealing
+//===========================================================================
+
+#include "work_pool.h"
+#include <algorithm>
+
+namespace vlark
+{
+
+namespace
+{
+
+//  the pool and queue of the task running on this thread, for spawn()
+//
+struct running
+{
+    work_pool const* pool = nullptr;
+    unsigned self = 0;
+};
+thread_local running current{};
+
+} // namespace
+
+work_pool::work_pool(unsigned nthreads)
+{
+    unsigned n = nthreads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : nthreads;
+    for (unsigned k = 0; k < n; k++)
+    {
+        queues.push_back(std::make_unique<queue>());
+    }
+    for (unsigned k = 1; k < n; k++)
+    {
+        threads.emplace_back([this, k](std::stop_token stop) { loop(stop, k); });
+    }
+}
+
+work_pool::~work_pool()
+{
+    for (auto& t : threads)
+    {
+        t.request_stop();
+    }
+    threads.clear();
+}
+
+void work_pool::run(std::size_t count, std::function<void(std::size_t)> const& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    //  job is set before any task can be popped, the queue locks order it
+    //
+    job = &task;
+    left.store(count);
+    const std::size_t n = queues.size();
+    for (std::size_t q = 0; q < n; q++)
+    {
+        std::lock_guard lock{queues[q]->lock};
+        for (std::size_t k = q * count / n; k < (q + 1) * count / n; k++)
+        {
+            queues[q]->tasks.push_back(k);
+        }
+    }
+    start();
+}
+
+void work_pool::run(std::span<const std::size_t> first, std::function<void(std::size_t)> const& task)
+{
+    if (first.empty())
+    {
+        return;
+    }
+
+    job = &task;
+    left.store(first.size());
+    const std::size_t n = queues.size();
+    for (std::size_t q = 0; q < n; q++)
+    {
+        std::lock_guard lock{queues[q]->lock};
+        for (std::size_t k = q * first.size() / n; k < (q + 1) * first.size() / n; k++)
+        {
+            queues[q]->tasks.push_back(first[k]);
+        }
+    }
+    start();
+}
+
+//  the task is counted before it is queued, so left cannot drop to 0
+//  while the spawning one is still running
+//
+void work_pool::spawn(std::size_t task)
+{
+    unsigned self = current.pool == this ? current.self : 0;
+    left.fetch_add(1);
+    {
+        std::lock_guard lock{queues[self]->lock};
+        queues[self]->tasks.push_front(task);
+    }
+    {
+        std::lock_guard lock{state};
+        pushed.fetch_add(1);
+    }
+    done.notify_all();
+}
+
+//  wake the threads and work along until all tasks are done
+//
+void work_pool::start()
+{
+    {
+        std::lock_guard lock{state};
+        round++;
+    }
+    wake.notify_all();
+    work(0);
+}
+
+//  the front of the own queue, or else the back of another one
+//
+bool work_pool::next(unsigned self, std::size_t& task)
+{
+    const std::size_t n = queues.size();
+    for (std::size_t d = 0; d < n; d++)
+    {
+        auto& q = *queues[(self + d) % n];
+        std::lock_guard lock{q.lock};
+        if (q.tasks.empty())
+        {
+            continue;
+        }
+        if (d == 0)
+        {
+            task = q.tasks.front();
+            q.tasks.pop_front();
+        }
+        else
+        {
+            task = q.tasks.back();
+            q.tasks.pop_back();
+            stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------
+//  work: run tasks until all of the run are done. Out of tasks, the
+//  thread waits for a spawn or the end; pushed is read before looking
+//  at the queues, so a task spawned in between is not missed.
+//
+void work_pool::work(unsigned self)
+{
+    auto outer = current; // a task may run a pool of its own
+    current = {this, self};
+    std::size_t task = 0;
+    for (;;)
+    {
+        auto seen = pushed.load();
+        if (next(self, task))
+        {
+            (*job)(task);
+            if (left.fetch_sub(1) == 1)
+            {
+                std::lock_guard lock{state};
+                done.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock lock{state};
+        done.wait(lock, [&] { return left.load() == 0 || pushed.load() != seen; });
+        if (left.load() == 0)
+        {
+            break;
+        }
+    }
+    current = outer;
+}
+
+void work_pool::loop(std::stop_token stop, unsigned self)
+{
+    std::uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock lock{state};
+            if (!wake.wait(lock, stop, [&] { return round != seen; }))
+            {
+                return;
+            }
+            seen = round;
+        }
+        work(self);
+    }
+}
+
+} // namespace vlark
@@ -0,0 +1,72 @@
+// test_ast.cpp
+#include <gtest/gtest.h>
+#include "ast.hpp"
+
+class AstTestFixture : public ::testing::Test
+{
+public:
+    vlark::ast tree;
+
+    vlark::ref<vlark::expr> name(vlark::symbol_id id)
+    {
+        return tree.add(vlark::expr{vlark::expr_kind::name, {}, 0, id});
+    }
+};
+
+TEST_F(AstTestFixture, AstNodesAndListsTest)
+{
+    using namespace vlark;
+
+    //  a(b, c) + d
+    //
+    std::vector<ref<expr>> args{name(2), name(3)};
+    auto call = tree.add(expr{expr_kind::call, {}, 0, name(1).index, tree.add_list<expr>(args).at});
+    auto sum = tree.add(expr{expr_kind::binary, token_type::Plus, 0, call.index, name(4).index});
+
+    auto const& e = tree[sum];
+    ASSERT_EQ(e.kind, expr_kind::binary);
+    ASSERT_EQ(tree[e.right()].symbol(), 4);
+    auto const& c = tree[e.left()];
+    ASSERT_EQ(tree[c.left()].symbol(), 1);
+    auto items = tree.items(c.items());
+    ASSERT_EQ(items.size(), 2);
+    ASSERT_EQ(tree[items[1]].symbol(), 3);
+    ASSERT_TRUE(tree.items(list<expr>{}).empty());
+    ASSERT_FALSE(ref<expr>{});
+
+    auto port = tree.add(decl{decl_kind::port, token_type::In, 10, 5, name(6)});
+    std::vector<ref<decl>> decls{port};
+    auto unit = tree.add(design_unit{unit_kind::entity, 0, 40, 7, no_symbol, {}, tree.add_list<decl>(decls)});
+    std::vector<ref<design_unit>> units{unit};
+    tree.set_design_units(units);
+    ASSERT_EQ(tree.design_units().size(), 1);
+    ASSERT_EQ(tree[tree.items(tree[tree.design_units()[0]].decls)[0]].mode, token_type::In);
+    ASSERT_EQ(tree.node_count(), 9);
+}
+
+TEST_F(AstTestFixture, AstArenaTest)
+{
+    using namespace vlark;
+
+    //  pools keep their content when they move to bigger blocks
+    //
+    std::vector<ref<expr>> all;
+    for (std::uint32_t i = 0; i < 100000; i++)
+    {
+        all.push_back(name(i + 1));
+    }
+    auto big = tree.add_list<expr>(all);
+    ASSERT_EQ(tree[all[77777]].symbol(), 77778);
+    ASSERT_EQ(tree.items(big).size(), all.size());
+    ASSERT_EQ(tree.items(big)[99999], all[99999]);
+    ASSERT_GE(tree.bytes(), 100000 * sizeof(expr));
+
+    ast moved = std::move(tree);
+    ASSERT_EQ(moved[all[5]].symbol(), 6);
+    ASSERT_EQ(moved.node_count(), 100000);
+
+    moved.release();
+    ASSERT_EQ(moved.node_count(), 0);
+    ASSERT_LT(moved.bytes(), arena::block_size + 1);
+    ASSERT_EQ(moved[moved.add(expr{expr_kind::null})].kind, expr_kind::null);
+}
@@ -0,0 +1,184 @@
+// test_ast_cache.cpp
+#include <gtest/gtest.h>
+#include "ast_cache.h"
+#include "json_writer.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+
+constexpr std::string_view design = R"(library ieee;
+use ieee.std_logic_1164.all;
+entity \Mixed\ is
+  port (clk : in std_logic; q : out integer);
+end entity;
+architecture rtl of \Mixed\ is
+  constant k : real := 2.5;
+  signal s : bit_vector (3 downto 0) := x"A";
+begin
+  q <= 10 ns when s'event else "two words" & $;
+end architecture;
+)";
+
+} // namespace
+
+class AstCacheTestFixture : public ::testing::Test
+{
+public:
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "vlark_ast_cache_test";
+    vlark::token_stream tokens{}; // of the last parse
+
+    void SetUp() override { std::filesystem::remove_all(dir); }
+    void TearDown() override { std::filesystem::remove_all(dir); }
+
+    vlark::ast parse(std::string_view text, vlark::diagnostics& diags, vlark::parse_mode mode)
+    {
+        tokens.clear();
+        vlark::tokenize(text, tokens);
+        diags.append(tokens.diags());
+        return vlark::parse_design_units(tokens, text, diags, nullptr, mode);
+    }
+
+    std::string json(vlark::ast const& tree)
+    {
+        std::ostringstream s;
+        {
+            vlark::json_writer out{s};
+            vlark::write_json(tree, out);
+        }
+        return s.str();
+    }
+};
+
+TEST_F(AstCacheTestFixture, AstCacheHashTest)
+{
+    using vlark::content_hash;
+
+    ASSERT_EQ(content_hash(""), 0xEF46DB3751D8E999u);
+    ASSERT_EQ(content_hash("abc"), 0x44BC2CF5AD770999u);
+    ASSERT_EQ(content_hash("Nobody inspects the spammish repetition"), 0xFBCEA83C8A378BF1u);
+    ASSERT_NE(content_hash("abc", 1), content_hash("abc"));
+}
+
+TEST_F(AstCacheTestFixture, AstCacheRoundTripTest)
+{
+    using namespace vlark;
+
+    ast_cache cache{dir.string()};
+    diagnostics diags;
+    auto tree = parse(design, diags, parse_mode::full);
+    ASSERT_NE(diags.total(), 0u); // the '$'
+
+    diagnostics none;
+    ASSERT_FALSE(cache.load(design, parse_mode::full, none));
+    ASSERT_TRUE(cache.store(design, parse_mode::full, tree, tokens, diags));
+
+    diagnostics again;
+    auto hit = cache.load(design, parse_mode::full, again);
+    ASSERT_TRUE(hit);
+    ASSERT_EQ(json(*hit), json(tree));
+    ASSERT_EQ(hit->node_count(), tree.node_count());
+    ASSERT_EQ(again.total(), diags.total());
+    ASSERT_EQ(again.kept()[0].offset, diags.kept()[0].offset);
+    ASSERT_EQ(again.kept()[0].code, diags.kept()[0].code);
+
+    //  the adopted pools grow into the arena like any other
+    //
+    auto r = hit->add(expr{expr_kind::others, token_type::Invalid, 7});
+    ASSERT_EQ((*hit)[r].pos, 7u);
+    ASSERT_EQ(json(*hit), json(tree));
+
+    //  another text, another mode or a damaged file is a miss
+    //
+    std::string changed{design};
+    changed[changed.find("rtl")] = 'R';
+    ASSERT_FALSE(cache.load(changed, parse_mode::full, none));
+    ASSERT_FALSE(cache.load(design, parse_mode::outline, none));
+
+    auto path = cache.path_of(design, parse_mode::full);
+    auto size = std::filesystem::file_size(path);
+    {
+        std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+        file.seekp(static_cast<std::streamoff>(size - 8));
+        file.put('\x7f'); // a body byte, the header still matches
+    }
+    ASSERT_FALSE(cache.load(design, parse_mode::full, none));
+    ASSERT_TRUE(cache.store(design, parse_mode::full, tree, tokens, diags));
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+    ASSERT_FALSE(cache.load(design, parse_mode::full, none));
+    ASSERT_EQ(none.total(), 0u);
+
+    std::ofstream{path, std::ios::binary | std::ios::trunc} << "vlarkast";
+    ASSERT_FALSE(cache.load(design, parse_mode::full, none));
+}
+
+TEST_F(AstCacheTestFixture, AstCacheOutlineTest)
+{
+    using namespace vlark;
+
+    ast_cache cache{dir.string()};
+    diagnostics diags;
+    auto outline = parse(design, diags, parse_mode::outline);
+    ASSERT_TRUE(cache.store(design, parse_mode::outline, outline, tokens, diags));
+    ASSERT_NE(cache.path_of(design, parse_mode::outline), cache.path_of(design, parse_mode::full));
+
+    diagnostics none;
+    auto hit = cache.load(design, parse_mode::outline, none);
+    ASSERT_TRUE(hit);
+    ASSERT_EQ(json(*hit), json(outline));
+    ASSERT_EQ(symbol_table::global().name(hit->symbol((*hit)[hit->design_units()[0]].name)), "\\Mixed\\");
+}
+
+TEST_F(AstCacheTestFixture, AstCacheTokensTest)
+{
+    using namespace vlark;
+
+    ast_cache cache{dir.string()};
+    diagnostics diags;
+    auto tree = parse(design, diags, parse_mode::full);
+    ASSERT_TRUE(cache.store(design, parse_mode::full, tree, tokens, diags));
+    auto bytes = std::filesystem::file_size(cache.path_of(design, parse_mode::full));
+
+    //  the nodes keep the numbers of the file, the tree maps them
+    //
+    diagnostics again;
+    token_stream loaded;
+    auto hit = cache.load(design, parse_mode::full, again, &loaded);
+    ASSERT_TRUE(hit);
+    ASSERT_TRUE(hit->file_numbered());
+    ASSERT_FALSE(tree.file_numbered());
+    auto const& unit = (*hit)[hit->design_units()[1]];
+    ASSERT_EQ(hit->symbol(unit.name), symbol_table::global().intern("rtl"));
+    ASSERT_EQ(hit->symbol(unit.of), tree[tree.design_units()[1]].of);
+    ASSERT_EQ(hit->symbol(no_symbol), no_symbol);
+
+    //  the tokens come back as they were scanned
+    //
+    ASSERT_EQ(loaded.size(), tokens.size());
+    ASSERT_TRUE(std::ranges::equal(loaded.types(), tokens.types()));
+    ASSERT_TRUE(std::ranges::equal(loaded.offsets(), tokens.offsets()));
+    ASSERT_TRUE(std::ranges::equal(loaded.lengths(), tokens.lengths()));
+    ASSERT_TRUE(std::ranges::equal(loaded.ids(), tokens.ids()));
+    ASSERT_TRUE(std::ranges::equal(loaded.flags(), tokens.flags()));
+    ASSERT_EQ(loaded.literals().all_chars(), tokens.literals().all_chars());
+    ASSERT_EQ(loaded.literals().all_values().size(), tokens.literals().all_values().size());
+    ASSERT_EQ(loaded.diags().total(), tokens.diags().total());
+
+    //  a loaded tree is parsed again from them the same way
+    //
+    diagnostics reparsed;
+    ASSERT_EQ(json(parse_design_units(loaded, design, reparsed)), json(*hit));
+
+    //  and stored again by the names it maps to
+    //
+    std::filesystem::remove_all(dir);
+    ASSERT_TRUE(cache.store(design, parse_mode::full, *hit, loaded, diags));
+    ASSERT_EQ(std::filesystem::file_size(cache.path_of(design, parse_mode::full)), bytes);
+    auto twice = cache.load(design, parse_mode::full, again);
+    ASSERT_TRUE(twice);
+    ASSERT_EQ(json(*twice), json(tree));
+}
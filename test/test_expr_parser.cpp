@@ -0,0 +1,173 @@
+// test_expr_parser.cpp
+#include <gtest/gtest.h>
+#include "expr_parser.h"
+#include <algorithm>
+#include <sstream>
+
+class ExprParserTestFixture : public ::testing::Test
+{
+public:
+    std::string source;
+    vlark::token_stream tokens;
+    vlark::ast tree;
+    vlark::diagnostics diags;
+
+    //  the expression as (op left right), operators spelled as in the source
+    //
+    std::string parse(std::string text)
+    {
+        source = std::move(text);
+        tokens.clear();
+        diags.clear();
+        vlark::tokenize(source, tokens);
+        vlark::expr_parser parser{tokens, source, tree, diags};
+        auto e = parser.expression();
+        return show(e);
+    }
+
+    std::string word_at(vlark::offset_t pos) const
+    {
+        for (std::size_t i = 0; i < tokens.size(); i++)
+        {
+            if (tokens.offset(i) == pos)
+            {
+                return source.substr(pos, tokens.length(i));
+            }
+        }
+        return "?";
+    }
+
+    std::string show(vlark::ref<vlark::expr> r) const
+    {
+        using namespace vlark;
+        if (!r)
+        {
+            return "?";
+        }
+        auto const& e = tree[r];
+        auto sym = [](symbol_id id) { return std::string{symbol_table::global().name(id)}; };
+        auto items = [&](list<expr> l) {
+            std::string s;
+            for (auto item : tree.items(l))
+            {
+                s += " " + show(item);
+            }
+            return s;
+        };
+        switch (e.kind)
+        {
+        case expr_kind::name: return sym(e.symbol());
+        case expr_kind::integer: return std::to_string(tree.literals().integer(e.value()));
+        case expr_kind::character: return std::string{'\'', static_cast<char>(e.value()), '\''};
+        case expr_kind::physical: return "(" + show(e.left()) + " " + sym(e.b) + ")";
+        case expr_kind::others: return "others";
+        case expr_kind::open: return "open";
+        case expr_kind::unary: return "(" + word_at(e.pos) + " " + show(e.left()) + ")";
+        case expr_kind::binary: return "(" + word_at(e.pos) + " " + show(e.left()) + " " + show(e.right()) + ")";
+        case expr_kind::call: return "(call " + show(e.left()) + items(e.items()) + ")";
+        case expr_kind::select: return "(. " + show(e.left()) + " " + (e.b == no_symbol ? "all" : sym(e.b)) + ")";
+        case expr_kind::attribute: return "(' " + show(e.left()) + " " + sym(e.b) + ")";
+        case expr_kind::qualified: return "(qualified " + show(e.left()) + " " + show(e.right()) + ")";
+        case expr_kind::aggregate: return "(aggregate" + items(e.items()) + ")";
+        case expr_kind::association: return "(=> " + show(e.left()) + " " + show(e.right()) + ")";
+        case expr_kind::range: return "(range " + show(e.left()) + " " + show(e.right()) + ")";
+        default: return std::string{kind_name(e.kind)};
+        }
+    }
+};
+
+TEST_F(ExprParserTestFixture, ExprPrecedenceTest)
+{
+    ASSERT_EQ(parse("a + b * c"), "(+ a (* b c))");
+    ASSERT_EQ(parse("a - b - c"), "(- (- a b) c)");
+    ASSERT_EQ(parse("a and b and c"), "(and (and a b) c)");
+    ASSERT_EQ(parse("a = b or c /= d"), "(or (= a b) (/= c d))");
+    ASSERT_EQ(parse("x sll 2 + 1"), "(sll x (+ 2 1))");
+    ASSERT_EQ(parse("-a * b"), "(- (* a b))");
+    ASSERT_EQ(parse("-a ** 2"), "(- (** a 2))");
+    ASSERT_EQ(parse("not a and b"), "(and (not a) b)");
+    ASSERT_EQ(parse("abs a * b"), "(* (abs a) b)");
+    ASSERT_EQ(parse("(a or b) and c"), "(and (or a b) c)");
+    ASSERT_EQ(parse("10 ns + t"), "(+ (10 ns) t)");
+    ASSERT_TRUE(diags.kept().empty());
+    ASSERT_GT(vlark::binary_precedence(vlark::token_type::Star), vlark::binary_precedence(vlark::token_type::Plus));
+    ASSERT_EQ(vlark::binary_precedence(vlark::token_type::Identifier), 0u);
+}
+
+TEST_F(ExprParserTestFixture, ExprNamesAndAggregatesTest)
+{
+    ASSERT_EQ(parse("f(a, b => c)"), "(call f a (=> b c))");
+    ASSERT_EQ(parse("ieee.std_logic_1164.all"), "(. (. ieee std_logic_1164) all)");
+    ASSERT_EQ(parse("s'range"), "(' s range)");
+    ASSERT_EQ(parse("v'length - 1"), "(- (' v length) 1)");
+    ASSERT_EQ(parse("t'(others => '0')"), "(qualified t (aggregate (=> others '0')))");
+    ASSERT_EQ(parse("(1 | 3 => x, 4 to 7 => y)"), "(aggregate (=> (aggregate 1 3) x) (=> (range 4 7) y))");
+    ASSERT_EQ(parse("a(7 downto 0)"), "(call a (range 7 0))");
+    ASSERT_EQ(parse("m(i)(j).f"), "(. (call (call m i) j) f)");
+    ASSERT_TRUE(diags.kept().empty());
+}
+
+TEST_F(ExprParserTestFixture, ExprErrorsTest)
+{
+    using vlark::diag_code;
+
+    //  each error is reported once, the parse still completes
+    //
+    ASSERT_EQ(parse("a and b or c"), "(or (and a b) c)");
+    ASSERT_EQ(diags.kept().size(), 1u);
+    ASSERT_EQ(diags.kept()[0].code, diag_code::needs_parentheses);
+
+    parse("a nand b nand c");
+    ASSERT_EQ(diags.kept()[0].code, diag_code::needs_parentheses);
+
+    parse("a = b = c");
+    ASSERT_EQ(diags.kept()[0].code, diag_code::needs_parentheses);
+
+    ASSERT_EQ(parse("a * -b"), "(* a (- b))");
+    ASSERT_EQ(diags.kept()[0].code, diag_code::misplaced_sign);
+
+    ASSERT_EQ(parse("f(a"), "(call f a)");
+    ASSERT_EQ(diags.kept()[0].code, diag_code::expected_right_paren);
+
+    ASSERT_EQ(parse("a + ;"), "(+ a ?)");
+    ASSERT_EQ(diags.kept()[0].code, diag_code::expected_expression);
+    ASSERT_EQ(diags.kept()[0].offset, 4u);
+}
+
+TEST_F(ExprParserTestFixture, ExprNestingTooDeepTest)
+{
+    using vlark::diag_code;
+    auto reported = [this](diag_code code) {
+        return std::ranges::count(diags.kept(), code, &vlark::diagnostic::code);
+    };
+
+    //  past max_nesting the rest is skipped up to the matching ')' and
+    //  the parse goes on after it, the stack is no deeper than the limit
+    //
+    std::size_t deep = 100'000;
+    ASSERT_EQ(parse(std::string(deep, '(') + "1" + std::string(deep, ')') + " + 2"), "(+ ? 2)");
+    ASSERT_EQ(diags.kept().size(), 1u);
+    ASSERT_EQ(diags.kept()[0].code, diag_code::nesting_too_deep);
+    ASSERT_EQ(diags.kept()[0].offset, vlark::expr_parser::max_nesting);
+
+    std::string calls;
+    for (std::size_t k = 0; k < deep; k++)
+    {
+        calls += "f(";
+    }
+    auto shown = parse(calls + "x" + std::string(deep, ')') + " and b");
+    ASSERT_EQ(reported(diag_code::nesting_too_deep), 1);
+    ASSERT_TRUE(shown.starts_with("(and (call f") && shown.ends_with(" b)")) << shown.substr(0, 40);
+
+    std::string signs;
+    for (std::size_t k = 0; k < deep; k++)
+    {
+        signs += "- ";
+    }
+    parse(signs + "a");
+    ASSERT_EQ(reported(diag_code::nesting_too_deep), 1);
+
+    std::string fine(200, '(');
+    ASSERT_EQ(parse(fine + "1" + std::string(200, ')')), "1");
+    ASSERT_TRUE(diags.kept().empty());
+}
@@ -0,0 +1,204 @@
+// test_json_writer.cpp
+#include <gtest/gtest.h>
+#include "json_reader.h"
+#include "json_writer.h"
+#include "unit_parser.h"
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+TEST(JsonWriterTest, JsonWriterValueTest)
+{
+    using namespace vlark;
+
+    std::ostringstream s;
+    {
+        json_writer out{s};
+        out.begin_object();
+        out.key("a");
+        out.number(std::int64_t{-42});
+        out.key("b");
+        out.begin_array();
+        out.number(0.5);
+        out.number(std::nan(""));
+        out.boolean(true);
+        out.null();
+        out.begin_object();
+        out.end_object();
+        out.end_array();
+        out.key("c");
+        out.string("q\"b\\n\nt\t\x01\x1f");
+        out.end_object();
+    }
+    ASSERT_EQ(s.str(), R"({"a":-42,"b":[0.5,null,true,null,{}],"c":"q\"b\\n\nt\t\u0001\u001f"})");
+
+    //  pretty, and two documents in a row
+    //
+    s.str("");
+    {
+        json_writer out{s, true};
+        for (int k = 0; k < 2; k++)
+        {
+            out.begin_object();
+            out.key("x");
+            out.begin_array();
+            out.number(std::int64_t{k});
+            out.end_array();
+            out.key("y");
+            out.begin_array();
+            out.end_array();
+            out.end_object();
+            out.next_document();
+        }
+    }
+    ASSERT_EQ(s.str(), "{\n  \"x\": [\n    0\n  ],\n  \"y\": []\n}\n{\n  \"x\": [\n    1\n  ],\n  \"y\": []\n}\n");
+}
+
+TEST(JsonWriterTest, JsonWriterSmallBufferTest)
+{
+    using namespace vlark;
+
+    //  strings longer than the buffer, escapes at every offset
+    //
+    std::ostringstream s;
+    std::string expected;
+    std::size_t size = 0;
+    {
+        json_writer out{s, false, 64};
+        out.begin_array();
+        std::string grown;
+        expected = "[";
+        for (int k = 0; k < 300; k++)
+        {
+            grown += std::string(static_cast<std::size_t>(k % 70), static_cast<char>('a' + k % 26)) + "\"";
+            out.string(grown);
+            std::string quoted;
+            for (char c : grown)
+            {
+                quoted += c == '"' ? "\\\"" : std::string(1, c);
+            }
+            expected += (k ? ",\"" : "\"") + quoted + "\"";
+        }
+        out.end_array();
+        expected += "]";
+        size = out.size();
+    }
+    ASSERT_EQ(s.str(), expected);
+    ASSERT_EQ(size, expected.size());
+}
+
+TEST(JsonWriterTest, JsonWriterAstTest)
+{
+    using namespace vlark;
+
+    constexpr std::string_view text = R"(entity e is
+  port (a : in bit);
+end entity;
+architecture rtl of e is
+  signal s : bit := '0';
+begin
+  y <= a + 16#1F# when s = '1' else "line""quote";
+end architecture;
+)";
+    token_stream tokens;
+    diagnostics diags;
+    tokenize(text, tokens);
+    auto tree = parse_design_units(tokens, text, diags);
+    ASSERT_EQ(diags.total(), 0u);
+
+    std::ostringstream s;
+    {
+        json_writer out{s};
+        write_json(tree, out, "e.vhd");
+    }
+    auto json = s.str();
+    ASSERT_EQ(json.rfind(R"({"file":"e.vhd","units":[{"kind":"entity","pos":0,)", 0), 0u) << json;
+    for (auto part : {R"("name":"e")", R"("mode":"in")", R"("kind":"architecture")", R"("of":"e")",
+                      R"("op":"+")", R"("value":31)", R"("value":"0")", R"("value":"line\"quote")"})
+    {
+        ASSERT_NE(json.find(part), std::string::npos) << part << " in " << json;
+    }
+    ASSERT_EQ(json.back(), '}');
+}
+
+TEST(JsonWriterTest, JsonWriterDeepAstTest)
+{
+    using namespace vlark;
+
+    //  a + a + ... is as deep as it is long, the emitter walks it on the
+    //  heap and writes the same text as a shallow tree would
+    //
+    std::size_t terms = 200'000;
+    std::string text = "architecture rtl of e is begin\n  x <= a";
+    for (std::size_t k = 1; k < terms; k++)
+    {
+        text += " + a";
+    }
+    text += ";\nend;\n";
+    token_stream tokens;
+    diagnostics diags;
+    tokenize(text, tokens);
+    auto tree = parse_design_units(tokens, text, diags);
+    ASSERT_EQ(diags.total(), 0u);
+
+    std::ostringstream s;
+    {
+        json_writer out{s};
+        write_json(tree, out);
+    }
+    auto json = s.str();
+    auto count = [&json](std::string_view part) {
+        std::size_t n = 0;
+        for (auto at = json.find(part); at != std::string::npos; at = json.find(part, at + 1))
+        {
+            n++;
+        }
+        return n;
+    };
+    ASSERT_EQ(count(R"("kind":"binary")"), terms - 1);
+    ASSERT_EQ(count(R"("name":"a")"), terms);
+    ASSERT_EQ(count("{"), count("}"));
+    ASSERT_TRUE(json.ends_with("}}}]}]}"));
+}
+
+TEST(JsonWriterTest, JsonReaderTest)
+{
+    using namespace vlark;
+
+    auto doc = json_value::parse(
+        R"( {"id": 7, "s": "a\"\\\u00e9\ud83d\ude00\n", "list": [true, false, null, -1.5e2, {}], "o": {"k": []}} )");
+    ASSERT_TRUE(doc);
+    ASSERT_EQ((*doc)["id"].integer(), 7);
+    ASSERT_EQ((*doc)["s"].string(), "a\"\\\xc3\xa9\xf0\x9f\x98\x80\n");
+    ASSERT_EQ((*doc)["list"].size(), 5u);
+    ASSERT_TRUE((*doc)["list"][0].boolean());
+    ASSERT_TRUE((*doc)["list"][2].is_null());
+    ASSERT_EQ((*doc)["list"][3].number(), -150.0);
+    ASSERT_EQ((*doc)["o"]["k"].type(), json_value::kind::array);
+    ASSERT_TRUE((*doc)["missing"]["deeper"][3].is_null());
+
+    std::ostringstream s;
+    {
+        json_writer out{s};
+        write_json(*doc, out);
+    }
+    ASSERT_EQ(s.str(), R"({"id":7,"s":"a\"\\)"
+                       "\xc3\xa9\xf0\x9f\x98\x80"
+                       R"(\n","list":[true,false,null,-150,{}],"o":{"k":[]}})");
+    auto again = json_value::parse(s.str());
+    ASSERT_TRUE(again);
+    ASSERT_EQ((*again)["s"].string(), (*doc)["s"].string());
+
+    for (auto bad : {"", "{", "[1,]", "{\"a\" 1}", "\"open", "tru", "01x", "nan", "[1] 2", "\"\\ud83d\\u0041\""})
+    {
+        ASSERT_FALSE(json_value::parse(bad)) << bad;
+    }
+    ASSERT_FALSE(json_value::parse(std::string(json_value::max_depth + 2, '[')));
+
+    auto big = json_value::parse("[1e30, -1e300, 9.5, -2.9]");
+    ASSERT_TRUE(big);
+    ASSERT_EQ((*big)[0].integer(), std::numeric_limits<std::int64_t>::max());
+    ASSERT_EQ((*big)[1].integer(), std::numeric_limits<std::int64_t>::min());
+    ASSERT_EQ((*big)[2].integer(), 9);
+    ASSERT_EQ((*big)[3].integer(), -2);
+}
@@ -0,0 +1,181 @@
+// test_literal.cpp
+#include <gtest/gtest.h>
+#include "literal.h"
+#include "token.h"
+
+class LiteralTestFixture : public ::testing::Test
+{
+public:
+    vlark::literal_table values;
+
+    vlark::literal_scan number(std::string_view text) { return vlark::scan_number(text, &values); }
+};
+
+TEST_F(LiteralTestFixture, LiteralDecimalTest)
+{
+    auto lit = number("1_000_000;");
+    ASSERT_TRUE(lit.ok);
+    ASSERT_EQ(lit.kind, vlark::literal_kind::integer);
+    ASSERT_EQ(lit.len, 9);
+    ASSERT_EQ(values.integer(lit.value), 1000000);
+
+    lit = number("2E3 ns");
+    ASSERT_EQ(lit.len, 3);
+    ASSERT_EQ(values.integer(lit.value), 2000);
+
+    lit = number("3.25e-2)");
+    ASSERT_EQ(lit.kind, vlark::literal_kind::real);
+    ASSERT_EQ(lit.len, 7);
+    ASSERT_DOUBLE_EQ(values.real(lit.value), 0.0325);
+
+    //  no digit after the '.' or the 'e': they belong to the next token
+    //
+    ASSERT_EQ(number("10 to 12").len, 2);
+    ASSERT_EQ(number("7.all").len, 1);
+    ASSERT_EQ(number("5else").len, 1);
+
+    lit = number("99999999999999999999");
+    ASSERT_TRUE(lit.ok);
+    ASSERT_TRUE(values.overflow(lit.value));
+
+    ASSERT_FALSE(number("1__0").ok);
+    ASSERT_FALSE(number("1_ ").ok);
+    ASSERT_FALSE(number("1E-2").ok); // integers have no negative exponent
+}
+
+TEST_F(LiteralTestFixture, LiteralBasedTest)
+{
+    auto lit = number("16#FF_FF#,");
+    ASSERT_TRUE(lit.ok);
+    ASSERT_EQ(lit.len, 9);
+    ASSERT_EQ(values.integer(lit.value), 0xffff);
+
+    lit = number("2#1.0#E3");
+    ASSERT_EQ(lit.kind, vlark::literal_kind::real);
+    ASSERT_EQ(lit.len, 8);
+    ASSERT_DOUBLE_EQ(values.real(lit.value), 8.0);
+
+    lit = number("8#17#e1");
+    ASSERT_EQ(values.integer(lit.value), 15 * 8);
+    ASSERT_DOUBLE_EQ(values.real(number("16#F.8#").value), 15.5);
+
+    ASSERT_FALSE(number("2#102#").ok);   // digit too big for the base
+    ASSERT_FALSE(number("17#1#").ok);    // base out of range
+    ASSERT_FALSE(number("16#FF;").ok);   // no closing '#'
+    ASSERT_EQ(number("16#FF;").len, 5);
+}
+
+TEST_F(LiteralTestFixture, LiteralBitStringTest)
+{
+    auto lit = number("12UX\"F-\";");
+    ASSERT_TRUE(lit.ok);
+    ASSERT_EQ(lit.kind, vlark::literal_kind::bit_string);
+    ASSERT_EQ(lit.len, 8);
+    ASSERT_EQ(values.bits(lit.value), "00001111----");
+
+    ASSERT_EQ(values.bits(number("6SB\"101\"").value), "111101");
+    ASSERT_EQ(values.bits(number("4X\"0A\"").value), "1010");
+    ASSERT_EQ(values.bits(number("3SX\"F\"").value), "111");
+    ASSERT_FALSE(number("4X\"1A\"").ok);  // a '1' bit dropped
+    ASSERT_FALSE(number("3SX\"7\"").ok);  // the sign changes
+
+    ASSERT_EQ(vlark::bit_string_prefix("X\"1F\""), 1);
+    ASSERT_EQ(vlark::bit_string_prefix("ub\"1\""), 2);
+    ASSERT_EQ(vlark::bit_string_prefix("sd\"1\""), 0);
+    ASSERT_EQ(vlark::bit_string_prefix("x1"), 0);
+
+    auto bits = [this](std::string_view text) {
+        return values.bits(vlark::scan_bit_string(text, vlark::bit_string_prefix(text), &values).value);
+    };
+    ASSERT_EQ(bits("B\"1_0Z\""), "10Z");
+    ASSERT_EQ(bits("O\"17\""), "001111");
+    ASSERT_EQ(bits("D\"300\""), "100101100");
+    ASSERT_EQ(bits("D\"0_0\""), "0");
+    ASSERT_EQ(bits("D\"4294967296\""), "1" + std::string(32, '0'));
+    ASSERT_EQ(bits("D\"123_456_789_012_345_678_901_234_567_890\""),
+              "1100011101110100100001111111101101100001101110011111000001110111001001110001111110000101011010010");
+    std::string huge = "D\"" + std::string(20000, '9') + "\"";
+    ASSERT_FALSE(vlark::scan_bit_string(huge, 1).ok); // too many digits to convert
+    ASSERT_EQ(bits("X\"\""), "");
+    ASSERT_FALSE(vlark::scan_bit_string("B\"12\"", 1).ok);
+    ASSERT_FALSE(vlark::scan_bit_string("X\"1F\n", 1).ok);
+}
+
+TEST_F(LiteralTestFixture, LiteralTokensTest)
+{
+    std::string_view source = "x <= 16#FF# + 2.5 & x\"0F\" & 8UB\"1\";";
+    std::vector<vlark::token_type> types;
+    vlark::literal_table literals;
+    for (std::size_t i = 0; i < source.size();)
+    {
+        if (source[i] == ' ')
+        {
+            i++;
+            continue;
+        }
+        auto r = vlark::scan_token(source.substr(i), &literals);
+        types.push_back(r.type);
+        i += r.len;
+    }
+
+    using tt = vlark::token_type;
+    std::vector<tt> expected = {tt::Identifier, tt::Less_Equal, tt::Integer,   tt::Plus,       tt::Real,
+                                tt::Ampersand,  tt::Bit_String, tt::Ampersand, tt::Bit_String, tt::Semi_Colon};
+    ASSERT_EQ(types, expected);
+    ASSERT_EQ(literals.size(), 4);
+    ASSERT_EQ(literals.bits(3), "00000001");
+}
+
+TEST_F(LiteralTestFixture, LiteralStringTest)
+{
+    auto lit = vlark::scan_string("\"say \"\"hi\"\"\" & x", &values);
+    ASSERT_TRUE(lit.ok);
+    ASSERT_EQ(lit.kind, vlark::literal_kind::string);
+    ASSERT_EQ(lit.len, 12);
+    ASSERT_EQ(values.str(lit.value), "say \"hi\"");
+
+    ASSERT_EQ(values.str(vlark::scan_string("\"\";", &values).value), "");
+    std::string long_string = "\"" + std::string(100, 'x') + "\"";
+    ASSERT_EQ(vlark::scan_string(long_string).len, 102);
+
+    lit = vlark::scan_string("\"open\nnext\"");
+    ASSERT_FALSE(lit.ok);
+    ASSERT_EQ(lit.len, 5); // up to the line end
+    ASSERT_FALSE(vlark::scan_string("\"open").ok);
+}
+
+TEST_F(LiteralTestFixture, LiteralCharacterTickTest)
+{
+    //  token types of source, the previous token given like scan_next does
+    //
+    auto types = [this](std::string_view source) {
+        std::vector<vlark::token_type> result;
+        auto prev = vlark::token_type::Eof;
+        for (std::size_t i = 0; i < source.size();)
+        {
+            if (source[i] == ' ')
+            {
+                i++;
+                continue;
+            }
+            auto r = vlark::scan_token(source.substr(i), &values, prev);
+            result.push_back(r.type);
+            prev = r.type;
+            i += r.len;
+        }
+        return result;
+    };
+
+    using tt = vlark::token_type;
+    ASSERT_EQ(types("('0', '1')"),
+              (std::vector{tt::Left_Paren, tt::Character, tt::Comma, tt::Character, tt::Right_Paren}));
+    ASSERT_EQ(types("a'length"), (std::vector{tt::Identifier, tt::Tick, tt::Identifier}));
+    ASSERT_EQ(types("f(x)'image"),
+              (std::vector{tt::Identifier, tt::Left_Paren, tt::Identifier, tt::Right_Paren, tt::Tick, tt::Identifier}));
+    ASSERT_EQ(types("t'('a')"),
+              (std::vector{tt::Identifier, tt::Tick, tt::Left_Paren, tt::Character, tt::Right_Paren}));
+    ASSERT_EQ(types("'''"), (std::vector{tt::Character}));
+
+    ASSERT_EQ(types("\\a\\\\b\\ \\"), (std::vector{tt::Identifier, tt::Invalid}));
+    ASSERT_EQ(types("\\\\"), (std::vector{tt::Invalid})); // empty
+}
@@ -0,0 +1,208 @@
+// test_lsp.cpp
+#include <gtest/gtest.h>
+#include "lsp_server.h"
+#include <sstream>
+
+namespace
+{
+
+constexpr std::string_view design = "entity counter is\n"
+                                    "  port (clk : in bit; q : out integer);\n"
+                                    "end entity;\n"
+                                    "architecture rtl of counter is\n"
+                                    "  /* \xf0\x9f\x98\x80 */ signal a : integer := 0;\n"
+                                    "begin\n"
+                                    "  tick : process (clk) is\n"
+                                    "    variable v : integer;\n"
+                                    "  begin\n"
+                                    "    a <= a + 1;\n"
+                                    "    v := a;\n"
+                                    "  end process;\n"
+                                    "  q <= a;\n"
+                                    "end architecture;\n";
+
+//  a scripted client: the messages go in as one stream, what comes out is
+//  split into messages again
+//
+class client
+{
+public:
+    void send(std::string_view body) { script << "Content-Length: " << body.size() << "\r\n\r\n" << body; }
+    void raw(std::string_view text) { script << text; }
+
+    void request(int id, std::string_view method, std::string_view params)
+    {
+        send(R"({"jsonrpc":"2.0","id":)" + std::to_string(id) + R"(,"method":")" + std::string{method} +
+             R"(","params":)" + std::string{params} + "}");
+    }
+    void notify(std::string_view method, std::string_view params)
+    {
+        send(R"({"jsonrpc":"2.0","method":")" + std::string{method} + R"(","params":)" + std::string{params} + "}");
+    }
+
+    int run()
+    {
+        std::istringstream in{script.str()};
+        std::ostringstream out;
+        int code;
+        {
+            vlark::lsp_server server{in, out, 2};
+            code = server.run();
+        }
+        std::string all = out.str();
+        for (std::size_t at = 0; at < all.size();)
+        {
+            auto head = all.find("\r\n\r\n", at);
+            auto length = std::stoul(all.substr(at + 16, head - at - 16));
+            auto msg = vlark::json_value::parse(std::string_view{all}.substr(head + 4, length));
+            EXPECT_TRUE(msg);
+            received.push_back(*msg);
+            at = head + 4 + length;
+        }
+        return code;
+    }
+
+    vlark::json_value const& response(int id) const
+    {
+        for (auto const& msg : received)
+        {
+            if (msg["id"].type() == vlark::json_value::kind::number && msg["id"].integer() == id)
+            {
+                return msg;
+            }
+        }
+        ADD_FAILURE() << "no response " << id;
+        return received.front();
+    }
+
+    // the diagnostics published for version
+    vlark::json_value const* diagnostics(std::int64_t version) const
+    {
+        for (auto const& msg : received)
+        {
+            if (msg["method"].string() == "textDocument/publishDiagnostics" &&
+                msg["params"]["version"].integer() == version)
+            {
+                return &msg["params"]["diagnostics"];
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<vlark::json_value> received{};
+
+private:
+    std::ostringstream script{};
+};
+
+std::string quoted(std::string_view text)
+{
+    std::ostringstream s;
+    {
+        vlark::json_writer out{s};
+        out.string(text);
+    }
+    return s.str();
+}
+
+std::string at(int line, int character)
+{
+    return R"({"textDocument":{"uri":"file:///c.vhd"},"position":{"line":)" + std::to_string(line) +
+           R"(,"character":)" + std::to_string(character) + "}}";
+}
+
+void expect_range(vlark::json_value const& range, int line, int first, int last)
+{
+    EXPECT_EQ(range["start"]["line"].integer(), line);
+    EXPECT_EQ(range["start"]["character"].integer(), first);
+    EXPECT_EQ(range["end"]["line"].integer(), line);
+    EXPECT_EQ(range["end"]["character"].integer(), last);
+}
+
+} // namespace
+
+TEST(LspServerTest, LspServerSessionTest)
+{
+    client c;
+    c.request(1, "initialize", R"({"processId":null,"capabilities":{}})");
+    c.notify("initialized", "{}");
+    c.notify("textDocument/didOpen", R"({"textDocument":{"uri":"file:///c.vhd","languageId":"vhdl","version":1,)"
+                                     R"("text":)" + quoted(design) + "}}");
+    c.request(2, "textDocument/documentSymbol", R"({"textDocument":{"uri":"file:///c.vhd"}})");
+    c.request(3, "textDocument/definition", at(10, 9));  // a in v := a
+    c.request(4, "textDocument/definition", at(6, 18));  // clk, a port of the entity
+    c.request(5, "textDocument/definition", at(10, 4));  // v
+
+    c.notify("textDocument/didChange", R"({"textDocument":{"uri":"file:///c.vhd","version":2},"contentChanges":[)"
+                                       R"({"range":{"start":{"line":5,"character":0},"end":{"line":5,"character":0}},)"
+                                       R"("text":"  signal b : bit;\n"},)"
+                                       R"({"range":{"start":{"line":13,"character":7},)"
+                                       R"("end":{"line":13,"character":8}},)"
+                                       R"("text":"b"}]})");
+    c.request(6, "textDocument/definition", at(13, 7));
+
+    c.notify("textDocument/didChange", R"({"textDocument":{"uri":"file:///c.vhd","version":3},"contentChanges":[)"
+                                       R"({"range":{"start":{"line":12,"character":2},)"
+                                       R"("end":{"line":12,"character":14}},)"
+                                       R"("text":""}]})");
+    c.request(7, "textDocument/documentSymbol", R"({"textDocument":{"uri":"file:///c.vhd"}})");
+    c.request(8, "textDocument/hover", at(0, 0));
+    c.request(9, "shutdown", "null");
+    c.notify("exit", "null");
+    ASSERT_EQ(c.run(), 0);
+
+    auto const& caps = c.response(1)["result"]["capabilities"];
+    ASSERT_TRUE(caps["definitionProvider"].boolean());
+    ASSERT_EQ(caps["textDocumentSync"]["change"].integer(), 2);
+    ASSERT_EQ(caps["positionEncoding"].string(), "utf-16");
+
+    auto const& units = c.response(2)["result"];
+    ASSERT_EQ(units.size(), 2u);
+    ASSERT_EQ(units[0]["name"].string(), "counter");
+    ASSERT_EQ(units[0]["children"].size(), 2u);
+    ASSERT_EQ(units[0]["children"][1]["name"].string(), "q");
+    auto const& rtl = units[1]["children"];
+    ASSERT_EQ(rtl.size(), 2u);
+    ASSERT_EQ(rtl[0]["name"].string(), "a");
+    expect_range(rtl[0]["selectionRange"], 4, 18, 19); // the emoji is two UTF-16 code units
+    ASSERT_EQ(rtl[1]["name"].string(), "tick");
+    ASSERT_EQ(rtl[1]["children"][0]["name"].string(), "v");
+
+    expect_range(c.response(3)["result"]["range"], 4, 18, 19);
+    expect_range(c.response(4)["result"]["range"], 1, 8, 11);
+    expect_range(c.response(5)["result"]["range"], 7, 13, 14);
+    ASSERT_EQ(c.response(6)["result"]["uri"].string(), "file:///c.vhd");
+    expect_range(c.response(6)["result"]["range"], 5, 9, 10);
+
+    ASSERT_NE(c.diagnostics(1), nullptr);
+    ASSERT_EQ(c.diagnostics(1)->size(), 0u);
+    ASSERT_NE(c.diagnostics(3), nullptr);
+    ASSERT_NE(c.diagnostics(3)->size(), 0u);
+    ASSERT_EQ((*c.diagnostics(3))[0]["severity"].integer(), 1);
+
+    ASSERT_EQ(c.response(8)["error"]["code"].integer(), -32601);
+    ASSERT_TRUE(c.response(9)["result"].is_null());
+}
+
+TEST(LspServerTest, LspServerUtf8Test)
+{
+    client c;
+    c.request(1, "initialize", R"({"capabilities":{"general":{"positionEncodings":["utf-8","utf-16"]}}})");
+    c.notify("textDocument/didOpen", R"({"textDocument":{"uri":"file:///c.vhd","version":1,"text":)" +
+                                         quoted(design) + "}}");
+    c.request(2, "textDocument/definition", at(12, 7)); // a in q <= a
+    c.request(4, "textDocument/definition",
+              R"({"textDocument":{"uri":"file:///c.vhd"},"position":{"line":1e30,"character":-1e300}})");
+    c.notify("textDocument/didClose", R"({"textDocument":{"uri":"file:///c.vhd"}})");
+    c.request(3, "textDocument/definition", at(12, 7));
+    c.send("{broken");
+    c.raw("Content-Length: 99999999999999999\r\n\r\n{}");
+    ASSERT_EQ(c.run(), 1); // no shutdown
+
+    ASSERT_EQ(c.response(1)["result"]["capabilities"]["positionEncoding"].string(), "utf-8");
+    expect_range(c.response(2)["result"]["range"], 4, 20, 21);
+    ASSERT_TRUE(c.response(3)["result"].is_null());
+    ASSERT_TRUE(c.response(4)["result"].is_null());
+    ASSERT_EQ(c.received.rbegin()[1]["error"]["code"].integer(), -32700);
+    ASSERT_EQ(c.received.back()["error"]["code"].integer(), -32700);
+}
@@ -0,0 +1,248 @@
+// test_project.cpp
+#include <gtest/gtest.h>
+#include "project.h"
+#include <mutex>
+
+namespace
+{
+
+constexpr std::string_view types_pkg = R"(package types is
+  subtype word is bit_vector (15 downto 0);
+end package;
+package body types is
+end package body;
+)";
+
+constexpr std::string_view alu_vhd = R"(library ieee;
+use ieee.std_logic_1164.all;
+use work.types.all;
+entity alu is
+  port (a, b : in word; y : out word);
+end entity;
+architecture rtl of alu is
+begin
+  y <= a;
+end architecture;
+)";
+
+constexpr std::string_view top_vhd = R"(library work;
+context work.ctx;
+entity top is
+end entity;
+architecture rtl of top is
+  component reg is port (d : in bit); end component;
+begin
+  u0 : entity work.alu (rtl) port map (a => x, b => x, y => z);
+  g : for k in 0 to 3 generate
+    r : reg port map (d => x);
+  end generate;
+end architecture;
+configuration top_cfg of top is
+  for rtl
+  end for;
+end configuration;
+)";
+
+constexpr std::string_view lib_vhd = R"(context ctx is
+  library work;
+  use work.types.all;
+end context;
+entity reg is port (d : in bit); end entity;
+architecture a of reg is begin end architecture;
+)";
+
+} // namespace
+
+class ProjectTestFixture : public ::testing::Test
+{
+public:
+    std::string_view name(vlark::symbol_id id) { return vlark::symbol_table::global().name(id); }
+
+    //  kind name, as printed by --order
+    std::string unit(vlark::project const& p, std::uint32_t u)
+    {
+        auto const& n = p.units()[u];
+        std::string s{vlark::kind_name(n.kind)};
+        s += " ";
+        s += name(n.name);
+        return s;
+    }
+
+    std::uint32_t find(vlark::project const& p, std::string_view what)
+    {
+        for (std::uint32_t u = 0; u < p.units().size(); u++)
+        {
+            if (unit(p, u) == what)
+            {
+                return u;
+            }
+        }
+        ADD_FAILURE() << what << " not found";
+        return 0;
+    }
+};
+
+TEST_F(ProjectTestFixture, ProjectGraphTest)
+{
+    using namespace vlark;
+
+    //  the files in the wrong order on purpose
+    //
+    project p{2};
+    p.add_source("top.vhd", std::string{top_vhd});
+    p.add_source("alu.vhd", std::string{alu_vhd});
+    p.add_source("lib.vhd", std::string{lib_vhd});
+    p.add_source("types.vhd", std::string{types_pkg});
+    p.scan();
+    for (auto const& f : p.files())
+    {
+        ASSERT_EQ(f.diags.total(), 0u) << f.path;
+    }
+    ASSERT_EQ(p.units().size(), 10u);
+    ASSERT_TRUE(p.cycles().empty());
+
+    auto needs = [&](std::string_view u) {
+        std::vector<std::string> names;
+        for (auto d : p.needs(find(p, u)))
+        {
+            names.push_back(unit(p, d));
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    };
+    ASSERT_EQ(needs("entity alu"), (std::vector<std::string>{"package types"}));
+    ASSERT_EQ(needs("entity top"), (std::vector<std::string>{"context ctx"}));
+    ASSERT_EQ(needs("package_body types"), (std::vector<std::string>{"package types"}));
+    ASSERT_EQ(needs("context ctx"), (std::vector<std::string>{"package types"}));
+    ASSERT_EQ(needs("configuration top_cfg"), (std::vector<std::string>{"architecture rtl", "entity top"}));
+
+    //  top's architecture: its entity (which has the context clause) and
+    //  the instances, work.alu(rtl) and the component reg
+    //
+    std::uint32_t top_rtl = 0;
+    for (std::uint32_t u = 0; u < p.units().size(); u++)
+    {
+        if (p.units()[u].kind == unit_kind::architecture && name(p.units()[u].of) == "top")
+        {
+            top_rtl = u;
+        }
+    }
+    std::vector<std::string> wanted;
+    for (auto d : p.needs(top_rtl))
+    {
+        wanted.push_back(unit(p, d) + (p.units()[d].kind == unit_kind::architecture ? " of alu" : ""));
+    }
+    std::sort(wanted.begin(), wanted.end());
+    ASSERT_EQ(wanted, (std::vector<std::string>{"architecture rtl of alu", "entity alu", "entity reg", "entity top"}));
+
+    //  waves and the parallel run both keep every unit after the ones it needs
+    //
+    auto waves = p.waves();
+    std::vector<std::string> first;
+    for (auto u : waves[0])
+    {
+        first.push_back(unit(p, u));
+    }
+    std::sort(first.begin(), first.end());
+    ASSERT_EQ(first, (std::vector<std::string>{"entity reg", "package types"}));
+    std::vector<std::size_t> wave_of(p.units().size());
+    std::size_t in_waves = 0;
+    for (std::size_t w = 0; w < waves.size(); w++)
+    {
+        for (auto u : waves[w])
+        {
+            wave_of[u] = w;
+            in_waves++;
+        }
+    }
+    ASSERT_EQ(in_waves, p.units().size());
+
+    std::mutex lock;
+    std::vector<std::uint32_t> order;
+    ASSERT_EQ(p.analyze([&](std::uint32_t u) {
+        std::lock_guard guard{lock};
+        order.push_back(u);
+    }),
+              p.units().size());
+    ASSERT_EQ(order.size(), p.units().size());
+    std::vector<std::size_t> done_at(p.units().size());
+    for (std::size_t k = 0; k < order.size(); k++)
+    {
+        done_at[order[k]] = k;
+    }
+    for (std::uint32_t u = 0; u < p.units().size(); u++)
+    {
+        for (auto d : p.needs(u))
+        {
+            ASSERT_LT(wave_of[d], wave_of[u]);
+            ASSERT_LT(done_at[d], done_at[u]);
+        }
+    }
+}
+
+TEST_F(ProjectTestFixture, ProjectCycleTest)
+{
+    using namespace vlark;
+
+    project p{4};
+    p.add_source("a.vhd", "use work.b.all;\npackage a is end;\n");
+    p.add_source("b.vhd", "use work.a.all;\npackage b is end;\nuse work.b.all;\nentity e is end;\n");
+    p.add_source("c.vhd", "entity c is end;\npackage c is end;\n");
+    p.add_file("/nonexistent/file.vhd");
+    p.scan();
+
+    ASSERT_EQ(p.cycles().size(), 1u);
+    ASSERT_EQ(p.cycles()[0].size(), 2u);
+    ASSERT_EQ(p.files()[0].diags.kept()[0].code, diag_code::dependency_cycle);
+    ASSERT_EQ(p.files()[1].diags.kept()[0].code, diag_code::dependency_cycle);
+    ASSERT_EQ(p.files()[2].diags.kept()[0].code, diag_code::duplicate_unit);
+    ASSERT_EQ(p.files()[3].diags.kept()[0].code, diag_code::cannot_read);
+
+    //  entity e is behind the cycle, both c units need nothing
+    //
+    std::mutex lock;
+    std::vector<std::string> done;
+    ASSERT_EQ(p.analyze([&](std::uint32_t u) {
+        std::lock_guard guard{lock};
+        done.push_back(unit(p, u));
+    }),
+              2u);
+    std::sort(done.begin(), done.end());
+    ASSERT_EQ(done, (std::vector<std::string>{"entity c", "package c"}));
+    ASSERT_EQ(p.waves().size(), 1u);
+}
+
+TEST_F(ProjectTestFixture, ProjectParseTest)
+{
+    using namespace vlark;
+
+    project p{4};
+    p.add_source("top.vhd", std::string{top_vhd});
+    p.add_source("alu.vhd", std::string{alu_vhd});
+    p.add_source("bad.vhd", "use work.b.all;\npackage a is\n  signal s : ;\nend;\nuse work.a.all;\npackage b is end;\n");
+    p.add_source("empty.vhd", "\n");
+    p.add_file("/nonexistent/file.vhd");
+    p.add_source("/nonexistent/unsaved.vhd", ""); // an empty buffer, not the file of its name
+    p.scan();
+    p.parse();
+
+    // the full tree, bodies and all
+    auto const& top = p.files()[0].tree;
+    ASSERT_EQ(top.design_units().size(), 3u);
+    ASSERT_EQ(top.items(top[top.design_units()[1]].stmts).size(), 2u);
+    ASSERT_EQ(p.files()[1].tree.design_units().size(), 2u);
+
+    // the parse error next to the cycle found by the scan, the units of a cycle are parsed too
+    auto const& bad = p.files()[2].diags;
+    ASSERT_EQ(bad.total(), 3u);
+    ASSERT_TRUE(std::any_of(bad.kept().begin(), bad.kept().end(),
+                            [](auto const& d) { return d.code == diag_code::dependency_cycle; }));
+    ASSERT_TRUE(std::any_of(bad.kept().begin(), bad.kept().end(),
+                            [](auto const& d) { return d.code == diag_code::expected_expression; }));
+    ASSERT_EQ(p.files()[2].tree.design_units().size(), 2u);
+    ASSERT_TRUE(p.files()[3].tree.design_units().empty());
+    ASSERT_EQ(p.files()[4].diags.kept()[0].code, diag_code::cannot_read);
+    ASSERT_EQ(p.files()[5].diags.total(), 1u);
+    ASSERT_EQ(p.files()[5].diags.kept()[0].code, diag_code::empty_source);
+    ASSERT_TRUE(p.files()[5].tree.design_units().empty());
+}
@@ -0,0 +1,206 @@
+// test_reparse.cpp
+#include <gtest/gtest.h>
+#include "json_writer.h"
+#include "reparse.h"
+#include <random>
+#include <sstream>
+
+namespace
+{
+
+constexpr std::string_view design = R"(library ieee;
+use ieee.std_logic_1164.all;
+package util is
+  constant width : integer := 8;
+  function parity (v : bit_vector) return bit;
+end package;
+package body util is
+  function parity (v : bit_vector) return bit is
+    variable p : bit := '0';
+  begin
+    for i in v'range loop
+      p := p xor v(i);
+    end loop;
+    return p;
+  end function;
+end package body;
+entity counter is
+  generic (n : integer := 4);
+  port (clk, rst : in bit; q : out integer);
+end entity;
+architecture rtl of counter is
+  signal a, b : integer := 0;
+  signal c : bit;
+begin
+  tick : process (clk) is
+    variable v : integer;
+  begin
+    if rst = '1' then
+      a <= 0;
+      c <= '0';
+    elsif clk'event and clk = '1' then
+      case a is
+        when 0 => a <= 1;
+        when others => a <= a + 1;
+      end case;
+    end if;
+  end process;
+  q <= a when c = '1' else b;
+  g : for k in 0 to 3 generate
+    b <= a + k;
+  end generate;
+end architecture;
+)";
+
+} // namespace
+
+class ReparseTestFixture : public ::testing::Test
+{
+public:
+    std::string text{design};
+    vlark::token_stream tokens;
+    vlark::ast tree;
+    vlark::diagnostics diags;
+
+    void SetUp() override { tree = parse(text, tokens, diags); }
+
+    static vlark::ast parse(std::string_view source, vlark::token_stream& toks, vlark::diagnostics& found)
+    {
+        vlark::tokenize(source, toks);
+        found.append(toks.diags());
+        return vlark::parse_design_units(toks, source, found);
+    }
+
+    static std::string json(vlark::ast const& t)
+    {
+        std::ostringstream s;
+        {
+            vlark::json_writer out{s};
+            vlark::write_json(t, out);
+        }
+        return s.str();
+    }
+
+    static std::vector<std::uint64_t> offsets(vlark::diagnostics const& found)
+    {
+        std::vector<std::uint64_t> all;
+        for (auto const& e : found.kept())
+        {
+            all.push_back(e.offset);
+        }
+        std::sort(all.begin(), all.end());
+        return all;
+    }
+
+    vlark::reparse_stats edit(std::string_view from, std::string_view to)
+    {
+        auto at = text.find(from);
+        EXPECT_NE(at, std::string::npos);
+        auto begin = static_cast<vlark::offset_t>(at);
+        return vlark::reparse(text, tokens, tree, diags, {begin, static_cast<vlark::offset_t>(at + from.size()), to});
+    }
+
+    // the state, tree and diagnostics are the ones of a parse from scratch
+    void expect_fresh()
+    {
+        vlark::token_stream toks;
+        vlark::diagnostics found;
+        auto t = parse(text, toks, found);
+
+        ASSERT_EQ(tokens.size(), toks.size());
+        for (std::size_t k = 0; k < toks.size(); k++)
+        {
+            ASSERT_EQ(tokens.type(k), toks.type(k)) << k;
+            ASSERT_EQ(tokens.offset(k), toks.offset(k)) << k;
+            ASSERT_EQ(tokens.length(k), toks.length(k)) << k;
+            ASSERT_EQ(tokens.flags(k), toks.flags(k)) << k;
+        }
+        ASSERT_EQ(offsets(tokens.diags()), offsets(toks.diags()));
+        ASSERT_EQ(offsets(diags), offsets(found));
+        ASSERT_EQ(diags.total(), found.total());
+        ASSERT_EQ(json(tree), json(t));
+    }
+};
+
+TEST_F(ReparseTestFixture, ReparseStatementTest)
+{
+    ASSERT_EQ(diags.total(), 0u);
+
+    auto stats = edit("a <= 0;", "a <= 2 * n;");
+    expect_fresh();
+    ASSERT_FALSE(stats.whole_units);
+    ASSERT_EQ(stats.replaced, 1u);
+    ASSERT_EQ(stats.reparsed, 6u);
+
+    // the last statement of a list goes with the statement around it
+    stats = edit("a <= a + 1;", "a <= a + 2;");
+    expect_fresh();
+    ASSERT_FALSE(stats.whole_units);
+
+    stats = edit("p := p xor v(i);", "p := p xor v(i);\n      p := not p;");
+    expect_fresh();
+    ASSERT_FALSE(stats.whole_units);
+
+    stats = edit("signal a, b", "signal a, b, d");
+    expect_fresh();
+    ASSERT_FALSE(stats.whole_units);
+    ASSERT_EQ(stats.replaced, 2u);
+
+    stats = edit("  signal a, b, d : integer := 0;\n", "");
+    expect_fresh();
+    ASSERT_FALSE(stats.whole_units);
+    ASSERT_EQ(stats.replaced, 3u);
+
+    stats = edit("b <= a + k;", "-- b <= a + k;");
+    expect_fresh();
+
+    stats = edit("  ", "  ");
+    expect_fresh();
+    ASSERT_EQ(stats.reparsed, 0u);
+}
+
+TEST_F(ReparseTestFixture, ReparseUnitTest)
+{
+    // an error, then its fix
+    auto stats = edit("    end if;\n", "");
+    expect_fresh();
+    ASSERT_TRUE(stats.whole_units);
+    ASSERT_NE(diags.total(), 0u);
+
+    edit("  end process;", "    end if;\n  end process;");
+    expect_fresh();
+    ASSERT_EQ(diags.total(), 0u);
+
+    // a unit split in two, a comment that runs to the end
+    edit("end package;\n", "end package;\npackage more is\nend;\n");
+    expect_fresh();
+    edit("entity counter", "/* entity counter");
+    expect_fresh();
+    ASSERT_NE(tokens.diags().total(), 0u);
+    edit("/* entity counter", "entity counter");
+    expect_fresh();
+    ASSERT_EQ(diags.total(), 0u);
+
+    edit(design.substr(0, 10), "");
+    expect_fresh();
+}
+
+TEST_F(ReparseTestFixture, ReparseRandomTest)
+{
+    constexpr std::string_view pieces[] = {"",   " ",  "\n", "x",  ";",     "--",         "\"",    "'",
+                                           "1.", "e+", "/*", "*/", "end ", "a <= b;\n", "begin", "\\"};
+    std::mt19937 gen{24};
+    for (int round = 0; round < 400; round++)
+    {
+        if (round % 50 == 0)
+        {
+            vlark::reparse(text, tokens, tree, diags,
+                           {0, static_cast<vlark::offset_t>(text.size()), design});
+            expect_fresh();
+        }
+        auto at = static_cast<vlark::offset_t>(gen() % (text.size() + 1));
+        auto end = static_cast<vlark::offset_t>(std::min<std::size_t>(text.size(), at + gen() % 8));
+        vlark::reparse(text, tokens, tree, diags, {at, end, pieces[gen() % std::size(pieces)]});
+        expect_fresh();
+    }
+}
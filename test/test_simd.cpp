@@ -0,0 +1,155 @@
+// test_simd.cpp
+#include <gtest/gtest.h>
+#include "simd.h"
+#include "utils.h"
+#include <cctype>
+#include <random>
+
+class SimdTestFixture : public ::testing::Test
+{
+public:
+    std::vector<vlark::simd::isa> levels;
+
+    void SetUp() override
+    {
+        // every level up to the best one the cpu can run
+        for (auto level : {vlark::simd::isa::sse2, vlark::simd::isa::avx2})
+        {
+            if (level <= vlark::simd::best())
+            {
+                levels.push_back(level);
+            }
+        }
+    }
+
+    // random text made of the chars the line classification looks at
+    static std::string random_source(std::mt19937& rng, std::size_t len)
+    {
+        static constexpr std::string_view alphabet = "  \t\n\n\r\v-/*ab;09_";
+        std::uniform_int_distribution<std::size_t> pick(0, alphabet.size() - 1);
+        std::string text(len, ' ');
+        for (auto& ch : text)
+        {
+            ch = alphabet[pick(rng)];
+        }
+        return text;
+    }
+};
+
+TEST_F(SimdTestFixture, SimdKernelsMatchScalarTest)
+{
+    using vlark::simd::isa;
+    std::mt19937 rng(2023);
+
+    for (std::size_t len = 0; len < 300; len++)
+    {
+        auto text = random_source(rng, len);
+        std::vector<std::uint32_t> expected;
+        vlark::simd::find_newlines(text, expected, isa::scalar);
+
+        for (auto level : levels)
+        {
+            std::vector<std::uint32_t> starts;
+            vlark::simd::find_newlines(text, starts, level);
+            ASSERT_EQ(starts, expected) << vlark::simd::isa_name(level);
+
+            for (std::size_t from = 0; from < len; from += 7)
+            {
+                std::string_view rest = std::string_view(text).substr(from);
+                ASSERT_EQ(vlark::simd::skip_space(rest, level), vlark::simd::skip_space(rest, isa::scalar));
+                ASSERT_EQ(vlark::simd::digit_run(rest, level), vlark::simd::digit_run(rest, isa::scalar));
+                ASSERT_EQ(vlark::simd::ident_run(rest, level), vlark::simd::ident_run(rest, isa::scalar));
+                ASSERT_EQ(vlark::simd::find_pair(rest, '*', '/', level),
+                          vlark::simd::find_pair(rest, '*', '/', isa::scalar));
+                ASSERT_EQ(vlark::simd::find_either(rest, '*', '\n', level),
+                          vlark::simd::find_either(rest, '*', '\n', isa::scalar));
+            }
+        }
+    }
+}
+
+TEST_F(SimdTestFixture, SimdClassTableTest)
+{
+    for (int c = 0; c < 256; c++)
+    {
+        auto ch = static_cast<char>(c);
+        ASSERT_EQ(vlark::simd::is_space(ch), std::isspace(c) != 0) << c;
+        ASSERT_EQ(vlark::simd::is_ident(ch), std::isalnum(c) != 0 || ch == '_') << c;
+        ASSERT_EQ(vlark::simd::is_digit_run(ch), std::isdigit(c) != 0 || ch == '_') << c;
+    }
+
+    //  every byte value through the vector compares, on a run longer than a step
+    //
+    for (int c = 0; c < 256; c++)
+    {
+        std::string text(50, 'k');
+        text[20] = static_cast<char>(c);
+        for (auto level : levels)
+        {
+            ASSERT_EQ(vlark::simd::ident_run(text, level), vlark::simd::is_ident(text[20]) ? 50u : 20u) << c;
+            ASSERT_EQ(vlark::simd::skip_space(std::string(50, ' ').replace(20, 1, 1, text[20]), level),
+                      vlark::simd::is_space(text[20]) ? 50u : 20u)
+                << c;
+        }
+
+        bool plain = c >= 0x20 && c != '"' && c != '\\';
+        ASSERT_EQ(vlark::simd::escape_free_run(text, vlark::simd::isa::scalar), plain ? 50u : 20u) << c;
+        for (auto level : levels)
+        {
+            ASSERT_EQ(vlark::simd::escape_free_run(text, level), plain ? 50u : 20u) << c;
+        }
+    }
+}
+
+TEST_F(SimdTestFixture, SimdDigitRunTest)
+{
+    //  long constants cross the 16 and 32 byte steps
+    //
+    for (std::size_t len = 0; len < 100; len++)
+    {
+        std::string text(len, '5');
+        for (std::size_t i = 3; i < len; i += 4)
+        {
+            text[i] = '_';
+        }
+        text += "#FF";
+        for (auto level : levels)
+        {
+            ASSERT_EQ(vlark::simd::digit_run(text, level), len) << vlark::simd::isa_name(level);
+        }
+    }
+}
+
+TEST_F(SimdTestFixture, SimdSplitLinesMatchScalarTest)
+{
+    using vlark::simd::isa;
+    std::mt19937 rng(42);
+
+    for (int round = 0; round < 200; round++)
+    {
+        auto text = random_source(rng, 64 + static_cast<std::size_t>(round) * 13);
+        vlark::line_table expected;
+        vlark::split_lines(text, expected, isa::scalar);
+
+        for (auto level : levels)
+        {
+            vlark::line_table table;
+            vlark::split_lines(text, table, level);
+            ASSERT_EQ(table.starts, expected.starts) << vlark::simd::isa_name(level);
+            ASSERT_EQ(table.cats, expected.cats) << vlark::simd::isa_name(level);
+        }
+    }
+}
+
+TEST_F(SimdTestFixture, SimdSplitLinesCategoryTest)
+{
+    using category = vlark::source_line::category;
+    std::string text = "  \t\r\n  -- c\n x /* y\n  /* a */ b\n c\n d */ e\n f\n";
+
+    vlark::line_table table;
+    vlark::split_lines(text, table, vlark::simd::isa::scalar);
+    std::vector<category> expected = {category::empty,      category::comment,    category::raw,
+                                      category::multii_com_s, category::multii_com, category::multi_com_e,
+                                      category::raw};
+    ASSERT_EQ(table.cats, expected);
+}
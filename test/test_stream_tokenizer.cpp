@@ -0,0 +1,114 @@
+// test_stream_tokenizer.cpp
+#include <gtest/gtest.h>
+#include "stream_tokenizer.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+class StreamTokenizerTestFixture : public ::testing::Test
+{
+public:
+    static constexpr std::string_view source = "-- header comment\n"
+                                               "library ieee;\n"
+                                               "use ieee.std_logic_1164.all;\n"
+                                               "\n"
+                                               "entity aggr01 is\n"
+                                               "  port (a : std_logic_vector;\n"
+                                               "        b : out std_logic_vector);\n"
+                                               "end aggr01;\n"
+                                               "/*\n"
+                                               "   multi-line comment */ and more\n"
+                                               "*/\n"
+                                               "architecture behav of aggr01 is\n"
+                                               "begin\n"
+                                               "  -- Code block comment\n"
+                                               "  b <= a and mask; -- trailing comment\n"
+                                               "  c <= 16#FF# + 2.5e+3 + 1.0 + 12UX\"F-\" + x\"0\";\n"
+                                               "end behav;";
+
+    std::vector<vlark::stream_token> tokens;
+    std::string texts; // keeps the token text alive
+
+    void stream(std::size_t chunk)
+    {
+        tokens.clear();
+        texts.clear();
+        std::istringstream in{std::string(source)};
+        vlark::stream_tokenizer stream(chunk);
+        stream.run(in, [&](vlark::stream_token const& tk) {
+            tokens.push_back(tk);
+            texts += tk.text;
+            texts += ' ';
+        });
+    }
+};
+
+TEST_F(StreamTokenizerTestFixture, StreamMatchesTokenizeLinesTest)
+{
+    auto path = (std::filesystem::temp_directory_path() / "vlark_stream.vhdl").string();
+    {
+        std::ofstream out{path, std::ios::binary};
+        out << source;
+    }
+    vlark::sourceBuffer sbuf(path);
+    auto expected = vlark::tokenize_lines(sbuf);
+
+    std::string expected_texts;
+    for (auto tk : expected)
+    {
+        expected_texts += tk.text(sbuf.text());
+        expected_texts += ' ';
+    }
+
+    //  every chunk size must give the same tokens, whatever edge they cross
+    //
+    for (std::size_t chunk : {1, 2, 3, 7, 16, 64, 4096})
+    {
+        stream(chunk);
+        ASSERT_EQ(tokens.size(), expected.size()) << "chunk " << chunk;
+        ASSERT_EQ(texts, expected_texts) << "chunk " << chunk;
+        for (std::size_t i = 0; i < tokens.size(); i++)
+        {
+            ASSERT_EQ(tokens[i].type, expected[i].type()) << "chunk " << chunk;
+            ASSERT_EQ(tokens[i].pos, sbuf.position_of(expected[i].offset())) << "chunk " << chunk;
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_F(StreamTokenizerTestFixture, StreamLongTokenTest)
+{
+    constexpr auto many = 3 * vlark::stream_tokenizer::max_carry;
+    std::string text = "a <= \"" + std::string(many, 'x') + "\";\nb\n/*";
+    for (std::size_t i = 0; i < many / 2; i++)
+    {
+        text += "y\n";
+    }
+    text += "*/ c\n-- " + std::string(many, 'z') + "\nd";
+
+    std::istringstream in{text};
+    vlark::stream_tokenizer stream(4096);
+    std::vector<std::pair<std::string, vlark::token_position>> got;
+    stream.run(in, [&](vlark::stream_token const& tk) { got.emplace_back(tk.text, tk.pos); });
+
+    // the string is skipped with the rest of its line, the comments go through
+    std::vector<std::pair<std::string, vlark::token_position>> expected = {
+        {"a", {1, 0}}, {"<=", {1, 2}}, {"b", {2, 0}}, {"c", {3 + many / 2, 3}}, {"d", {5 + many / 2, 0}}};
+    ASSERT_EQ(got, expected);
+    ASSERT_EQ(stream.diags().total(), 1u);
+    ASSERT_EQ(stream.diags().kept()[0].code, vlark::diag_code::token_too_long);
+    ASSERT_EQ(stream.diags().kept()[0].offset, 5u);
+
+    // the dropped name still comes before the tick on the next line
+    std::istringstream tick{"f (\n" + std::string(many, 'n') + "\n'a'"};
+    got.clear();
+    stream.run(tick, [&](vlark::stream_token const& tk) { got.emplace_back(tk.text, tk.pos); });
+    expected = {{"f", {1, 0}}, {"(", {1, 2}}, {"'", {3, 0}}, {"a", {3, 1}}, {"'", {3, 2}}};
+    ASSERT_EQ(got, expected);
+
+    std::istringstream open{"a /*" + std::string(many, ' ')};
+    stream.run(open, [](vlark::stream_token const&) {});
+    ASSERT_EQ(stream.diags().total(), 1u);
+    ASSERT_EQ(stream.diags().kept()[0].code, vlark::diag_code::unterminated_comment);
+    ASSERT_EQ(stream.diags().kept()[0].offset, 2u);
+}
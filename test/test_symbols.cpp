@@ -0,0 +1,63 @@
+// test_symbols.cpp
+#include <gtest/gtest.h>
+#include "symbols.h"
+#include <set>
+#include <string>
+#include <thread>
+
+class SymbolTableTestFixture : public ::testing::Test
+{
+public:
+    vlark::symbol_table table;
+};
+
+TEST_F(SymbolTableTestFixture, SymbolCaseFoldTest)
+{
+    auto clk = table.intern("CLK");
+    ASSERT_NE(clk, vlark::no_symbol);
+    ASSERT_EQ(table.intern("clk"), clk);
+    ASSERT_EQ(table.intern("Clk"), clk);
+    ASSERT_EQ(table.name(clk), "clk");
+    ASSERT_NE(table.intern("clk2"), clk);
+
+    // extended identifiers keep their case
+    auto ext = table.intern("\\Clk\\", false);
+    ASSERT_NE(table.intern("\\clk\\", false), ext);
+    ASSERT_EQ(table.name(ext), "\\Clk\\");
+    ASSERT_EQ(table.size(), 4);
+}
+
+TEST_F(SymbolTableTestFixture, SymbolConcurrentInternTest)
+{
+    constexpr int nthreads = 8;
+    constexpr int nnames = 5000;
+    std::vector<std::vector<vlark::symbol_id>> ids(nthreads);
+
+    //  all threads intern the same names, in different letter cases
+    //
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nthreads; t++)
+    {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < nnames; i++)
+            {
+                std::string name = (t % 2 ? "SIG_" : "sig_") + std::to_string(i);
+                ids[static_cast<std::size_t>(t)].push_back(table.intern(name));
+            }
+        });
+    }
+    for (auto& w : workers)
+    {
+        w.join();
+    }
+
+    ASSERT_EQ(table.size(), nnames);
+    std::set<vlark::symbol_id> distinct(ids[0].begin(), ids[0].end());
+    ASSERT_EQ(distinct.size(), nnames);
+    ASSERT_EQ(*distinct.rbegin(), nnames); // dense ids 1..n
+    for (int t = 1; t < nthreads; t++)
+    {
+        ASSERT_EQ(ids[static_cast<std::size_t>(t)], ids[0]);
+    }
+    ASSERT_EQ(table.name(ids[0][42]), "sig_42");
+}
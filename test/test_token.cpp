@@ -1,6 +1,9 @@
 // test_parser.cpp
 #include <gtest/gtest.h>
 #include "token.h"
+#include "token_source.h"
+#include <algorithm>
+#include <sstream>
 
 class TokenTestFixture : public ::testing::Test
 {
@@ -27,3 +30,303 @@ TEST_F(TokenTestFixture, TokenEmptyLineEQTest)
     status |= vlark::is_empty_line("     \n");
     ASSERT_TRUE(status);
 }
+
+TEST_F(TokenTestFixture, TokenViewTextTest)
+{
+    std::string_view source = "signal clk : bit; signal clk2 : bit;";
+    vlark::token sig(0, 6, vlark::token_type::Signal);
+    vlark::token clk(7, 3, vlark::token_type::Identifier);
+    vlark::token clk_again(7, 3, vlark::token_type::Identifier);
+    vlark::token clk2(25, 4, vlark::token_type::Identifier);
+
+    static_assert(sizeof(vlark::token) <= 16, "tokens are offset+length views");
+    ASSERT_EQ(sig.text(source), "signal");
+    ASSERT_EQ(clk2.text(source), "clk2");
+    ASSERT_TRUE(sig == vlark::token_type::Signal);
+    ASSERT_TRUE(clk.same_text(clk_again, source));
+    ASSERT_FALSE(clk.same_text(clk2, source));
+}
+
+TEST_F(TokenTestFixture, TokenStreamTest)
+{
+    std::string_view source = "a <= b;";
+    vlark::token_stream tokens;
+    tokens.reserve(vlark::token_stream::estimate(source.size()));
+    tokens.push_back(vlark::token_type::Identifier, 0, 1, vlark::token_stream::line_start);
+    tokens.push_back(vlark::token_type::Less_Equal, 2, 2);
+    tokens.push_back(vlark::token_type::Identifier, 5, 1);
+    tokens.push_back(vlark::token_type::Semi_Colon, 6, 1);
+
+    ASSERT_EQ(tokens.size(), 4);
+    ASSERT_EQ(tokens.types().size(), 4);
+    ASSERT_EQ(tokens.types()[3], vlark::token_type::Semi_Colon);
+    ASSERT_EQ(tokens[1].text(source), "<=");
+    ASSERT_EQ(tokens.flags(0), vlark::token_stream::line_start);
+    ASSERT_EQ(tokens.flags(2), vlark::token_stream::none);
+
+    std::string spelled;
+    for (auto tk : tokens)
+    {
+        spelled += tk.text(source);
+    }
+    ASSERT_EQ(spelled, "a<=b;");
+    ASSERT_EQ(std::count(tokens.begin(), tokens.end(), vlark::token_type::Identifier), 2);
+}
+
+TEST_F(TokenTestFixture, TokenKeywordLookupTest)
+{
+    using vlark::token_type;
+
+    // every key word of the enum range is found by its own spelling, in any case
+    for (auto t = static_cast<int>(token_type::Mod); t <= static_cast<int>(token_type::Onehot0); t++)
+    {
+        auto type = static_cast<token_type>(t);
+        auto spelling = vlark::token_tostr(type);
+        std::string upper = spelling;
+        std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) { return std::toupper(c); });
+
+        ASSERT_EQ(vlark::keyword_lookup(spelling, vlark::vhdl_std::v19, true), type) << spelling;
+        ASSERT_EQ(vlark::keyword_lookup(upper, vlark::vhdl_std::v19, true), type) << upper;
+    }
+
+    ASSERT_EQ(vlark::classify_name("ENTITY"), token_type::Entity);
+    ASSERT_EQ(vlark::classify_name("Begin"), token_type::Begin);
+    ASSERT_EQ(vlark::classify_name("entity_1"), token_type::Identifier);
+    ASSERT_EQ(vlark::classify_name("clk"), token_type::Identifier);
+
+    // reserved words depend on the standard, PSL words on the PSL context
+    ASSERT_EQ(vlark::keyword_lookup("xnor", vlark::vhdl_std::v87), token_type::Invalid);
+    ASSERT_EQ(vlark::keyword_lookup("xnor", vlark::vhdl_std::v93), token_type::Xnor);
+    ASSERT_EQ(vlark::keyword_lookup("context", vlark::vhdl_std::v93), token_type::Invalid);
+    ASSERT_EQ(vlark::keyword_lookup("view", vlark::vhdl_std::v08), token_type::Invalid);
+    ASSERT_EQ(vlark::keyword_lookup("view", vlark::vhdl_std::v19), token_type::View);
+    ASSERT_EQ(vlark::classify_name("always"), token_type::Identifier);
+    ASSERT_EQ(vlark::keyword_lookup("always", vlark::vhdl_std::v08, true), token_type::Always);
+}
+
+TEST_F(TokenTestFixture, TokenExclamationEndsNameTest)
+{
+    using tt = vlark::token_type;
+    std::string_view source = "before! next_e! x";
+    vlark::token_stream tokens;
+    vlark::tokenize(source, tokens);
+
+    // the '!' forms only come from keyword_lookup, the scanner splits them
+    std::vector<tt> expected = {tt::Identifier, tt::Exclam_Mark, tt::Identifier, tt::Exclam_Mark, tt::Identifier};
+    ASSERT_EQ(std::vector<tt>(tokens.types().begin(), tokens.types().end()), expected);
+    ASSERT_EQ(tokens[0].text(source), "before");
+    ASSERT_EQ(tokens[2].text(source), "next_e");
+    ASSERT_EQ(vlark::keyword_lookup("before!", vlark::vhdl_std::v08, true), tt::Before_Em);
+
+    // only letters fold: DEL is no '_' and 0x01 no '!'
+    ASSERT_EQ(vlark::keyword_lookup("next_e!", vlark::vhdl_std::v08, true), tt::Next_E_Em);
+    ASSERT_EQ(vlark::keyword_lookup("next\x7f" "e!", vlark::vhdl_std::v08, true), tt::Invalid);
+    ASSERT_EQ(vlark::keyword_lookup("next_e\x01", vlark::vhdl_std::v08, true), tt::Invalid);
+    ASSERT_EQ(vlark::keyword_lookup("before\x01", vlark::vhdl_std::v08, true), tt::Invalid);
+}
+
+TEST_F(TokenTestFixture, TokenDelimiterMunchTest)
+{
+    using tt = vlark::token_type;
+    std::string_view source = "a<=b=>c:=d/=e**f<>g ?= h??i<<j>>k ?/= l |->m[*n[->o<->p'q -- a <= comment\n"
+                              "r /* block\n */ s /**/ t\n";
+    vlark::token_stream tokens;
+    vlark::tokenize(source, tokens);
+
+    std::vector<tt> expected = {
+        tt::Identifier, tt::Less_Equal,     tt::Identifier, tt::Double_Arrow,   tt::Identifier, tt::Assign,
+        tt::Identifier, tt::Not_Equal,      tt::Identifier, tt::Double_Star,    tt::Identifier, tt::Box,
+        tt::Identifier, tt::Match_Equal,    tt::Identifier, tt::Condition,      tt::Identifier, tt::Double_Less,
+        tt::Identifier, tt::Double_Greater, tt::Identifier, tt::Match_Not_Equal, tt::Identifier, tt::Bar_Arrow,
+        tt::Identifier, tt::Brack_Star,     tt::Identifier, tt::Brack_Arrow,    tt::Identifier, tt::Equiv_Arrow,
+        tt::Identifier, tt::Tick,           tt::Identifier, tt::Identifier,     tt::Identifier, tt::Identifier};
+    ASSERT_EQ(std::vector<tt>(tokens.types().begin(), tokens.types().end()), expected);
+
+    // comments anywhere on a line, the token after a multi-line comment starts a line
+    ASSERT_EQ(tokens[tokens.size() - 3].text(source), "r");
+    ASSERT_EQ(tokens.flags(tokens.size() - 3), vlark::token_stream::line_start);
+    ASSERT_EQ(tokens.flags(tokens.size() - 2), vlark::token_stream::line_start);
+    ASSERT_EQ(tokens.flags(tokens.size() - 1), vlark::token_stream::none);
+}
+
+TEST_F(TokenTestFixture, TokenParallelMatchesSerialTest)
+{
+    //  big enough for several chunks, with block comments running over the
+    //  chunk edges and literals in every chunk
+    //
+    std::string source;
+    for (int i = 0; source.size() < 3 * 1024 * 1024; i++)
+    {
+        source += "  data_" + std::to_string(i % 977) + " <= 16#FF# + 2.5 & x\"0F\"; -- comment\n";
+        source += "  arr\n'high <= t'('1') & \"a\"\"b\"; \\Ext Id\\ <= ' ';\n"; // a tick may start a chunk
+        if (i % 3 == 0)
+        {
+            source += "\n  \n"; // blank lines, some of them cut by a chunk edge
+        }
+        if (i % 20000 == 3)
+        {
+            source += "  s <= \"/*\"; -- no comment, it only keeps the cuts away\n";
+        }
+        if (i % 20000 == 7)
+        {
+            source += "/* a long $\n";
+            source.append(300 * 1024, 'x');
+            source += "\n end of it */ sig <= 12UB\"1\"; $\n";
+        }
+    }
+
+    vlark::token_stream serial;
+    vlark::tokenize(source, serial, 1, vlark::trivia_mode::keep);
+    for (unsigned threads : {2u, 3u, 8u})
+    {
+        vlark::token_stream parallel;
+        vlark::tokenize(source, parallel, threads, vlark::trivia_mode::keep);
+
+        ASSERT_EQ(parallel.size(), serial.size()) << threads;
+        ASSERT_TRUE(std::ranges::equal(parallel.types(), serial.types()));
+        ASSERT_TRUE(std::ranges::equal(parallel.offsets(), serial.offsets()));
+        ASSERT_TRUE(std::ranges::equal(parallel.lengths(), serial.lengths()));
+        ASSERT_TRUE(std::ranges::equal(parallel.flags(), serial.flags()));
+        ASSERT_TRUE(std::ranges::equal(parallel.ids(), serial.ids())); // names already interned by the serial run
+        ASSERT_EQ(parallel.literals().size(), serial.literals().size());
+        for (std::size_t i = 0; i < serial.size(); i++)
+        {
+            if (serial.type(i) == vlark::token_type::Bit_String)
+            {
+                ASSERT_EQ(parallel.literals().bits(parallel.id(i)), serial.literals().bits(serial.id(i)));
+            }
+        }
+
+        //  only the '$' behind each comment, not the ones a chunk saw inside
+        //
+        ASSERT_EQ(parallel.diags().total(), serial.diags().total());
+        ASSERT_TRUE(std::ranges::equal(parallel.diags().kept(), serial.diags().kept(),
+                                       [](auto const& a, auto const& b) { return a.offset == b.offset; }));
+
+        ASSERT_EQ(parallel.trivia().size(), serial.trivia().size());
+        auto same = [](auto const& a, auto const& b) {
+            return a.token == b.token && a.offset == b.offset && a.length == b.length && a.kind == b.kind;
+        };
+        ASSERT_TRUE(std::ranges::equal(parallel.trivia().all(), serial.trivia().all(), same));
+    }
+    ASSERT_EQ(serial.diags().total(), static_cast<std::size_t>(std::ranges::count(source, '$') / 2));
+}
+
+TEST_F(TokenTestFixture, TokenDiagnosticsTest)
+{
+    std::string_view source = "a <= 1__0;\n$ b <= x\"12;\n_c /* open";
+    vlark::token_stream tokens;
+    vlark::tokenize(source, tokens);
+
+    using dc = vlark::diag_code;
+    auto kept = tokens.diags().kept();
+    ASSERT_EQ(kept.size(), 5);
+    ASSERT_EQ(kept[0].code, dc::invalid_literal);
+    ASSERT_EQ(kept[0].offset, 5);
+    ASSERT_EQ(kept[1].code, dc::unknown_char);
+    ASSERT_EQ(kept[2].code, dc::invalid_bit_string);
+    ASSERT_EQ(kept[3].code, dc::invalid_name);
+    ASSERT_EQ(kept[4].code, dc::unterminated_comment);
+    ASSERT_EQ(tokens.diags().count(vlark::severity::error), 5);
+    ASSERT_EQ(tokens.diags().dropped(), 0);
+
+    std::ostringstream out;
+    tokens.diags().render(out, source, "t.vhd");
+    ASSERT_TRUE(out.str().starts_with("t.vhd:1:6: error: invalid abstract literal: 1__0\n"));
+    ASSERT_NE(out.str().find("t.vhd:2:1: error: unknown character: $\n"), std::string::npos);
+
+    //  the column is the one of the offending char, counted from 1
+    //
+    std::string_view port = "entity c is\n  port (a : in bit $);\nend;\n";
+    vlark::token_stream port_tokens;
+    vlark::tokenize(port, port_tokens);
+    out.str("");
+    port_tokens.diags().render(out, port, "c.vhd");
+    ASSERT_EQ(out.str(), "c.vhd:2:20: error: unknown character: $\n");
+
+    //  past the cap only the counts grow
+    //
+    vlark::diagnostics capped(2);
+    capped.append(tokens.diags());
+    ASSERT_EQ(capped.kept().size(), 2);
+    ASSERT_EQ(capped.dropped(), 3);
+    out.str("");
+    capped.render(out);
+    ASSERT_NE(out.str().find("3 more diagnostics not shown"), std::string::npos);
+}
+
+TEST_F(TokenTestFixture, TokenTriviaTest)
+{
+    std::string_view source = "-- header\n\n  \nentity e is /* a\n b */ end; -- tail\n\n";
+    using tk = vlark::trivia_kind;
+
+    vlark::token_stream fast;
+    vlark::tokenize(source, fast);
+    ASSERT_TRUE(fast.trivia().empty());
+
+    vlark::token_stream tokens;
+    vlark::tokenize(source, tokens, 1, vlark::trivia_mode::keep);
+    ASSERT_EQ(tokens.size(), fast.size());
+
+    auto text = [&](vlark::trivia_item const& t) { return source.substr(t.offset, t.length); };
+    auto lead = tokens.trivia().before(0);
+    ASSERT_EQ(lead.size(), 2);
+    ASSERT_EQ(lead[0].kind, tk::line_comment);
+    ASSERT_EQ(text(lead[0]), "-- header");
+    ASSERT_EQ(lead[1].kind, tk::blank_lines);
+    ASSERT_EQ(text(lead[1]), "\n  \n"); // the two lines after the comment line
+
+    ASSERT_TRUE(tokens.trivia().before(1).empty());
+    auto mid = tokens.trivia().before(3); // before "end"
+    ASSERT_EQ(mid.size(), 1);
+    ASSERT_EQ(text(mid[0]), "/* a\n b */");
+
+    auto tail = tokens.trivia().before(static_cast<std::uint32_t>(tokens.size()));
+    ASSERT_EQ(tail.size(), 2);
+    ASSERT_EQ(text(tail[0]), "-- tail");
+    ASSERT_EQ(text(tail[1]), "\n");
+
+    //  the pull source gives the same
+    //
+    vlark::token_source pulled(source, vlark::trivia_mode::keep);
+    while (!pulled.at_end())
+    {
+        pulled.next();
+    }
+    ASSERT_EQ(pulled.trivia().size(), tokens.trivia().size());
+    ASSERT_EQ(pulled.trivia().before(3)[0].offset, mid[0].offset);
+}
+
+TEST_F(TokenTestFixture, TokenSourcePeekTest)
+{
+    std::string_view source = "entity e is -- comment\n  port (a : in bit := '1');\nend /* x\n */ e;\n";
+    vlark::token_stream expected;
+    vlark::tokenize(source, expected);
+
+    vlark::token_source tokens(source);
+    ASSERT_EQ(tokens.peek(3).text(source), "port");
+    ASSERT_EQ(tokens.peek_flags(3), vlark::token_stream::line_start);
+
+    for (std::size_t i = 0; i < expected.size(); i++)
+    {
+        //  the lookahead window agrees with the complete stream, up to and past the end
+        //
+        for (std::size_t k = 0; k < vlark::token_source::window; k++)
+        {
+            auto ahead = tokens.peek(k);
+            if (i + k < expected.size())
+            {
+                ASSERT_EQ(ahead.offset(), expected.offset(i + k));
+                ASSERT_EQ(ahead.type(), expected.type(i + k));
+            }
+            else
+            {
+                ASSERT_EQ(ahead.type(), vlark::token_type::Eof);
+            }
+        }
+        ASSERT_EQ(tokens.peek_flags(), expected.flags(i));
+        ASSERT_EQ(tokens.next().length(), expected.length(i));
+    }
+    ASSERT_TRUE(tokens.at_end());
+    ASSERT_EQ(tokens.next().type(), vlark::token_type::Eof);
+}
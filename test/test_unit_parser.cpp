@@ -0,0 +1,525 @@
+// test_unit_parser.cpp
+#include <gtest/gtest.h>
+#include "json_writer.h"
+#include "unit_parser.h"
+#include "work_pool.h"
+#include <sstream>
+
+namespace
+{
+
+constexpr std::string_view design = R"(library ieee;
+use ieee.std_logic_1164.all, ieee.numeric_std.all;
+
+entity counter is
+  generic (width : natural := 8);
+  port (clk, rst : in std_logic;
+        q : out unsigned (width - 1 downto 0));
+end entity counter;
+
+architecture rtl of counter is
+  type state_t is (idle, run);
+  type mem_t is array (natural range <>) of std_logic_vector (7 downto 0);
+  type pair is record
+    a, b : integer;
+  end record;
+  signal count : unsigned (width - 1 downto 0) := (others => '0');
+  signal state : state_t;
+  component cell is
+    port (d : in std_logic; o : out std_logic);
+  end component;
+  function inc (x : unsigned) return unsigned is
+  begin
+    return x + 1;
+  end function inc;
+begin
+  tick : process (clk, rst)
+    variable n : integer range 0 to 7;
+  begin
+    if rst = '1' then
+      count <= (others => '0');
+    elsif rising_edge (clk) then
+      case state is
+        when idle => state <= run;
+        when others =>
+          for i in 0 to 3 loop
+            n := n + i;
+          end loop;
+          count <= inc (count);
+      end case;
+    end if;
+  end process tick;
+
+  q <= count when state = run else (others => '0');
+
+  with state select
+    flag <= '1' when idle, '0' when others;
+
+  u0 : cell port map (d => clk, o => open);
+  u1 : entity work.cell (rtl) port map (clk, open);
+
+  gen : for k in 0 to 3 generate
+    assert k < 4 report "bad" severity error;
+  end generate gen;
+end architecture rtl;
+
+package util is
+  constant zero : integer := 0;
+  procedure nop;
+end package util;
+
+package body util is
+  procedure nop is
+  begin
+    null;
+  end procedure;
+end package body util;
+
+configuration cfg of counter is
+  for rtl
+    for u0 : cell use entity work.cell; end for;
+  end for;
+end configuration cfg;
+)";
+
+} // namespace
+
+class UnitParserTestFixture : public ::testing::Test
+{
+public:
+    vlark::token_stream tokens;
+    vlark::diagnostics diags;
+
+    vlark::ast parse(std::string_view text, vlark::parse_mode mode = vlark::parse_mode::full)
+    {
+        tokens.clear();
+        diags.clear();
+        vlark::tokenize(text, tokens);
+        return vlark::parse_design_units(tokens, text, diags, nullptr, mode);
+    }
+
+    std::string_view name(vlark::symbol_id id) { return vlark::symbol_table::global().name(id); }
+};
+
+TEST_F(UnitParserTestFixture, UnitParserDesignTest)
+{
+    using namespace vlark;
+
+    auto tree = parse(design);
+    for (auto d : diags.kept())
+    {
+        ADD_FAILURE() << diag_message(d.code) << " at " << design.substr(d.offset, 20);
+    }
+
+    auto units = tree.design_units();
+    ASSERT_EQ(units.size(), 5u);
+    std::vector<unit_kind> kinds;
+    for (auto u : units)
+    {
+        kinds.push_back(tree[u].kind);
+    }
+    ASSERT_EQ(kinds, (std::vector{unit_kind::entity, unit_kind::architecture, unit_kind::package,
+                                  unit_kind::package_body, unit_kind::configuration}));
+
+    //  the entity keeps its context clause, generics and ports
+    //
+    auto const& ent = tree[units[0]];
+    ASSERT_EQ(name(ent.name), "counter");
+    ASSERT_EQ(tree.items(ent.context).size(), 3u);
+    ASSERT_EQ(ent.pos, 0u);
+    auto ports = tree.items(ent.decls);
+    ASSERT_EQ(ports.size(), 4u);
+    ASSERT_EQ(tree[ports[0]].kind, decl_kind::generic);
+    ASSERT_EQ(tree[ports[2]].mode, token_type::In);
+    ASSERT_EQ(name(tree[ports[3]].name), "q");
+    ASSERT_EQ(design.substr(ent.end - 19, 19), "end entity counter;");
+
+    auto const& arch = tree[units[1]];
+    ASSERT_EQ(name(arch.of), "counter");
+    ASSERT_EQ(tree.items(arch.decls).size(), 7u);
+    auto stmts = tree.items(arch.stmts);
+    ASSERT_EQ(stmts.size(), 6u);
+    ASSERT_EQ(tree[stmts[0]].kind, stmt_kind::process);
+    ASSERT_EQ(name(tree[stmts[0]].label), "tick");
+    ASSERT_EQ(tree[stmts[1]].kind, stmt_kind::signal_assign);
+    ASSERT_TRUE(tree[stmts[1]].alt);
+    ASSERT_EQ(tree[stmts[2]].kind, stmt_kind::case_);
+    ASSERT_EQ(tree[stmts[3]].kind, stmt_kind::instance);
+    ASSERT_EQ(tree[stmts[5]].kind, stmt_kind::generate);
+
+    //  process: if / elsif chain with a case inside
+    //
+    auto body = tree.items(tree[stmts[0]].body);
+    ASSERT_EQ(body.size(), 1u);
+    auto const& elsif = tree[tree[body[0]].alt];
+    ASSERT_EQ(elsif.kind, stmt_kind::if_);
+    auto const& choice = tree[tree.items(elsif.body)[0]];
+    ASSERT_EQ(choice.kind, stmt_kind::case_);
+    ASSERT_EQ(tree.items(choice.body).size(), 2u);
+}
+
+TEST_F(UnitParserTestFixture, UnitParserRecoveryTest)
+{
+    using namespace vlark;
+
+    //  a broken statement costs that statement only
+    //
+    auto tree = parse("entity e is end;\narchitecture a of e is\nbegin\n  x <= ;\n  y <= z;\nend;\n");
+    ASSERT_EQ(diags.kept().size(), 1u);
+    ASSERT_EQ(diags.kept()[0].code, diag_code::expected_expression);
+    ASSERT_EQ(tree.design_units().size(), 2u);
+    ASSERT_EQ(tree.items(tree[tree.design_units()[1]].stmts).size(), 2u);
+
+    parse("garbage ; entity e is end;");
+    ASSERT_EQ(diags.kept()[0].code, diag_code::expected_design_unit);
+}
+
+TEST_F(UnitParserTestFixture, UnitParserOutlineTest)
+{
+    using namespace vlark;
+
+    auto full = parse(design);
+    auto tree = parse(design, parse_mode::outline);
+    ASSERT_EQ(diags.total(), 0u);
+    ASSERT_LT(tree.node_count(), full.node_count() / 3);
+
+    //  same units and headers, the bodies are gone but for the instances
+    //
+    auto units = tree.design_units();
+    ASSERT_EQ(units.size(), full.design_units().size());
+    for (std::size_t k = 0; k < units.size(); k++)
+    {
+        auto const& u = tree[units[k]];
+        auto const& f = full[full.design_units()[k]];
+        ASSERT_EQ(u.kind, f.kind);
+        ASSERT_EQ(u.name, f.name);
+        ASSERT_EQ(u.of, f.of);
+        ASSERT_EQ(u.end, f.end);
+        ASSERT_EQ(tree.items(u.context).size(), full.items(f.context).size());
+    }
+    ASSERT_EQ(tree.items(tree[units[0]].decls).size(), 4u);
+    ASSERT_EQ(tree.items(tree[units[1]].decls).size(), 0u);
+
+    auto stmts = tree.items(tree[units[1]].stmts);
+    ASSERT_EQ(stmts.size(), 2u);
+    ASSERT_EQ(name(tree[stmts[0]].label), "u0");
+    ASSERT_EQ(name(tree[tree[stmts[0]].target].a), "cell");
+    ASSERT_EQ(tree[tree[stmts[1]].target].kind, expr_kind::call); // work.cell (rtl)
+
+    //  nested constructs, VHDL-2008 generate bodies and use clauses inside
+    //
+    tree = parse("architecture a of e is\n"
+                 "  use work.p.all;\n"
+                 "  type r is record x : bit; end record;\n"
+                 "  function f return bit is begin if x then return '1'; end if; return '0'; end;\n"
+                 "  function g is new h;\n"
+                 "begin\n"
+                 "  g1 : if c generate begin u1 : component c1 port map (a); end;\n"
+                 "  elsif d generate u2 : c2 port map (b); else generate end generate;\n"
+                 "  g2 : for i in 0 to 1 generate p : process begin l : x; end process; end generate;\n"
+                 "  g3 : case k generate when 0 => u3 : entity work.c3; end generate;\n"
+                 "end architecture a;\n"
+                 "entity next_one is end;\n",
+                 parse_mode::outline);
+    ASSERT_EQ(diags.total(), 0u);
+    ASSERT_EQ(tree.design_units().size(), 2u);
+    auto const& arch = tree[tree.design_units()[0]];
+    ASSERT_EQ(tree.items(arch.decls).size(), 1u);
+    std::vector<std::string_view> labels;
+    for (auto s : tree.items(arch.stmts))
+    {
+        labels.push_back(name(tree[s].label));
+    }
+    ASSERT_EQ(labels, (std::vector<std::string_view>{"u1", "u2", "u3"}));
+
+    //  a stray generate after a closed if does not retag what is no longer open
+    //
+    tree = parse("entity e is end; architecture a of e is begin\n"
+                 "  p : process begin if x then null; end if; wait; end process;\n"
+                 "  g : generate end;\n"
+                 "entity f is end;\n",
+                 parse_mode::outline);
+    ASSERT_GE(tree.design_units().size(), 2u);
+}
+
+TEST_F(UnitParserTestFixture, UnitParserParallelMatchesSerialTest)
+{
+    using namespace vlark;
+
+    std::string text;
+    for (int k = 0; k < 300; k++)
+    {
+        text += design;
+    }
+    tokens.clear();
+    tokenize(text, tokens);
+    auto starts = unit_starts(tokens);
+    ASSERT_EQ(starts.size(), 1500u);
+    ASSERT_EQ(tokens.type(starts[1]), token_type::Architecture);
+    ASSERT_EQ(tokens.type(starts[5]), token_type::Library);
+
+    diagnostics serial_diags, parallel_diags;
+    work_pool pool{4};
+    auto serial = parse_design_units(tokens, text, serial_diags);
+    auto parallel = parse_design_units(tokens, text, parallel_diags, &pool);
+    ASSERT_EQ(serial_diags.total(), 0u);
+    ASSERT_EQ(parallel_diags.total(), 0u);
+    ASSERT_EQ(serial.node_count(), parallel.node_count());
+    ASSERT_EQ(serial.design_units().size(), parallel.design_units().size());
+
+    //  same units, same children, same literals, in the same order
+    //
+    for (std::size_t k = 0; k < serial.design_units().size(); k++)
+    {
+        auto const& s = serial[serial.design_units()[k]];
+        auto const& p = parallel[parallel.design_units()[k]];
+        ASSERT_EQ(s.kind, p.kind);
+        ASSERT_EQ(s.pos, p.pos);
+        ASSERT_EQ(s.end, p.end);
+        auto sd = serial.items(s.decls);
+        auto pd = parallel.items(p.decls);
+        ASSERT_EQ(sd.size(), pd.size());
+        for (std::size_t j = 0; j < sd.size(); j++)
+        {
+            ASSERT_EQ(serial[sd[j]].name, parallel[pd[j]].name);
+            auto st = serial[sd[j]].type;
+            auto pt = parallel[pd[j]].type;
+            ASSERT_EQ(serial[st].kind, parallel[pt].kind);
+            ASSERT_EQ(serial[st].pos, parallel[pt].pos);
+        }
+        auto ss = serial.items(s.stmts);
+        auto ps = parallel.items(p.stmts);
+        ASSERT_EQ(ss.size(), ps.size());
+        for (std::size_t j = 0; j < ss.size(); j++)
+        {
+            ASSERT_EQ(serial[ss[j]].kind, parallel[ps[j]].kind);
+            ASSERT_EQ(serial.items(serial[ss[j]].body).size(), parallel.items(parallel[ps[j]].body).size());
+            auto sv = serial[ss[j]].value;
+            auto pv = parallel[ps[j]].value;
+            ASSERT_EQ(serial[sv].kind, parallel[pv].kind);
+            ASSERT_EQ(serial[sv].pos, parallel[pv].pos);
+        }
+    }
+    ASSERT_EQ(serial.literals().size(), parallel.literals().size());
+}
+
+namespace
+{
+
+std::string json(vlark::ast const& tree)
+{
+    std::ostringstream s;
+    {
+        vlark::json_writer out{s};
+        vlark::write_json(tree, out);
+    }
+    return s.str();
+}
+
+} // namespace
+
+TEST_F(UnitParserTestFixture, UnitParserNestedPackageTest)
+{
+    using namespace vlark;
+
+    //  packages declared in an architecture and in a process, each one
+    //  more than a task's worth of tokens into the file
+    //
+    auto signals = [](std::string& text, int from) {
+        for (int k = from; k < from + 1000; k++)
+        {
+            text += "  signal s" + std::to_string(k) + " : bit;\n";
+        }
+    };
+    std::string text = "entity e is end;\narchitecture a of e is\n";
+    signals(text, 0);
+    text += "  package inner is\n    constant c : integer := 1;\n  end package;\n";
+    signals(text, 1000);
+    text += "begin\n  p : process is\n";
+    for (int k = 0; k < 1000; k++)
+    {
+        text += "    variable v" + std::to_string(k) + " : bit;\n";
+    }
+    text += "    package deeper is\n    end package;\n  begin\n    wait;\n  end process;\nend architecture;\n";
+    text += "package outer is\n";
+    signals(text, 2000);
+    text += "end package;\n";
+
+    tokens.clear();
+    tokenize(text, tokens);
+    ASSERT_EQ(unit_starts(tokens).size(), 5u); // the two nested packages look like units
+
+    diagnostics serial_diags, parallel_diags;
+    work_pool pool{4};
+    auto serial = parse_design_units(tokens, text, serial_diags);
+    auto parallel = parse_design_units(tokens, text, parallel_diags, &pool);
+    ASSERT_EQ(serial_diags.total(), 0u);
+    ASSERT_EQ(parallel_diags.total(), 0u);
+    ASSERT_EQ(serial.design_units().size(), 3u);
+    ASSERT_EQ(json(parallel), json(serial));
+}
+
+TEST_F(UnitParserTestFixture, UnitParserPullTest)
+{
+    using namespace vlark;
+
+    //  pulled from a token_source or parsed from the whole stream, the
+    //  same tree and the same diagnostics
+    //
+    std::string broken = std::string{design} + "architecture x of y is\n  signal s : ;\nbegin\n  a <= 1 +;\n\"open\n";
+    //  the names spelled by a literal or a reserved word
+    constexpr std::string_view spelled = R"(package p is
+  function "+" (a, b : integer) return integer;
+  alias '0' is bit'('0');
+  alias "and" is ieee.p."and" [bit, bit return bit];
+end package p;
+
+architecture a of e is
+  subtype t is v'subtype;
+begin
+  process
+  begin
+    for i in v'range loop
+      x := ieee.p."and" (a, b) + w'range'length;
+    end loop;
+    y := ieee.p.'1';
+  end process;
+end architecture a;
+)";
+    for (std::string_view text : {design, spelled, std::string_view{broken}})
+    {
+        for (auto mode : {parse_mode::full, parse_mode::outline})
+        {
+            auto stream = parse(text, mode);
+            token_source source{text};
+            diagnostics pulled_diags;
+            auto pulled = parse_design_units(source, pulled_diags, mode);
+            diagnostics stream_diags;
+            stream_diags.append(tokens.diags()); // the scanner reports first, as in the pull overload
+            stream_diags.append(diags);
+            ASSERT_EQ(json(pulled), json(stream));
+            ASSERT_EQ(pulled_diags.total(), stream_diags.total());
+            if (text.data() == spelled.data())
+            {
+                ASSERT_EQ(stream_diags.total(), 0u);
+            }
+            for (std::size_t k = 0; k < stream_diags.kept().size(); k++)
+            {
+                ASSERT_EQ(pulled_diags.kept()[k].offset, stream_diags.kept()[k].offset);
+                ASSERT_EQ(pulled_diags.kept()[k].code, stream_diags.kept()[k].code);
+            }
+        }
+    }
+    ASSERT_NE(diags.total(), 0u);
+}
+
+TEST_F(UnitParserTestFixture, UnitParserLongNameTest)
+{
+    using namespace vlark;
+
+    //  an instance of a name with more dotted parts than the pull
+    //  lookahead holds, pulled or parsed on the pool
+    //
+    constexpr std::string_view text = "architecture a of e is\n"
+                                      "begin\n"
+                                      "  u1 : a.b.c.d.e.f.g.h.i.j port map (x);\n"
+                                      "  l : a.b.c.d.e.f.g.h.i.j <= y;\n"
+                                      "  u2 : c port map (y);\n"
+                                      "end architecture a;\n";
+    work_pool pool{4};
+    for (auto mode : {parse_mode::full, parse_mode::outline})
+    {
+        token_source source{text};
+        diagnostics pulled_diags;
+        auto pulled = parse_design_units(source, pulled_diags, mode);
+        auto stream = parse(text, mode);
+        diagnostics parallel_diags;
+        auto parallel = parse_design_units(tokens, text, parallel_diags, &pool, mode);
+        ASSERT_EQ(pulled_diags.total(), 0u);
+        ASSERT_EQ(parallel_diags.total(), 0u);
+        ASSERT_EQ(json(pulled), json(parallel));
+        ASSERT_EQ(json(pulled), json(stream));
+    }
+
+    auto tree = parse(text, parse_mode::outline);
+    auto stmts = tree.items(tree[tree.design_units()[0]].stmts);
+    ASSERT_EQ(stmts.size(), 2u);
+    ASSERT_EQ(name(tree[stmts[0]].label), "u1");
+    ASSERT_EQ(name(tree[stmts[1]].label), "u2");
+    std::size_t parts = 1;
+    auto target = tree[stmts[0]].target;
+    for (; tree[target].kind == expr_kind::select; parts++)
+    {
+        target = ref<expr>{tree[target].a};
+    }
+    ASSERT_EQ(parts, 10u);
+    ASSERT_EQ(name(tree[target].a), "a");
+}
+
+TEST_F(UnitParserTestFixture, UnitParserNestingTooDeepTest)
+{
+    using namespace vlark;
+
+    //  statements nested past max_nesting are reported once and skipped
+    //  up to their end, what follows them still parses. A long elsif
+    //  chain is no nesting.
+    //
+    std::size_t deep = 30'000;
+    std::string text = "architecture a of e is begin\n";
+    for (std::size_t k = 0; k < deep; k++)
+    {
+        text += "g : if c generate\n";
+    }
+    text += "x <= y;\n";
+    for (std::size_t k = 0; k < deep; k++)
+    {
+        text += "end generate;\n";
+    }
+    text += "p : process begin\n";
+    for (std::size_t k = 0; k < deep; k++)
+    {
+        text += "if c then\n";
+    }
+    for (std::size_t k = 0; k < deep; k++)
+    {
+        text += "end if;\n";
+    }
+    text += "if c then null;\n";
+    for (std::size_t k = 0; k < deep; k++)
+    {
+        text += "elsif d then null;\n";
+    }
+    text += "else null; end if;\nend process;\nz <= y;\nend;\nentity next_one is end;\n";
+
+    for (auto mode : {parse_mode::full, parse_mode::outline})
+    {
+        auto tree = parse(text, mode);
+        std::size_t too_deep = mode == parse_mode::full ? 2 : 0;
+        ASSERT_EQ(diags.total(), too_deep);
+        for (auto d : diags.kept())
+        {
+            ASSERT_EQ(d.code, diag_code::nesting_too_deep);
+        }
+        ASSERT_EQ(tree.design_units().size(), 2u);
+
+        token_source source{text};
+        diagnostics pulled_diags;
+        auto pulled = parse_design_units(source, pulled_diags, mode);
+        ASSERT_EQ(pulled_diags.total(), too_deep);
+        ASSERT_EQ(pulled.node_count(), tree.node_count());
+    }
+
+    auto tree = parse(text);
+    auto stmts = tree.items(tree[tree.design_units()[0]].stmts);
+    ASSERT_EQ(stmts.size(), 3u);
+    ASSERT_EQ(tree[stmts[2]].kind, stmt_kind::signal_assign);
+
+    auto body = tree.items(tree[stmts[1]].body);
+    ASSERT_EQ(body.size(), 2u);
+    std::size_t branches = 0;
+    for (auto b = tree[body[1]].alt; b; b = tree[b].alt)
+    {
+        branches++;
+    }
+    ASSERT_EQ(branches, deep + 1);
+}
@@ -0,0 +1,68 @@
+// test_utils.cpp
+#include <gtest/gtest.h>
+#include "utils.h"
+#include <filesystem>
+#include <fstream>
+
+class SourceBufferTestFixture : public ::testing::Test
+{
+public:
+    std::string path;
+
+    void write_source(std::string_view name, std::string_view content)
+    {
+        path = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream out{path, std::ios::binary};
+        out << content;
+    }
+
+    void TearDown() override { std::filesystem::remove(path); }
+};
+
+TEST_F(SourceBufferTestFixture, SourceBufferLongLineTest)
+{
+    // a machine generated single line netlist, longer than the old 98'000 limit
+    std::string line = "signal s : bit;";
+    while (line.size() < 200'000)
+    {
+        line += " signal s : bit;";
+    }
+    write_source("vlark_long_line.vhdl", line);
+
+    for (auto mode : {vlark::sourceBuffer::load_mode::mapped, vlark::sourceBuffer::load_mode::buffered})
+    {
+        vlark::sourceBuffer sbuf(path, mode);
+        ASSERT_EQ(sbuf.line_count(), 1);
+        ASSERT_EQ(sbuf.get_line(0).text, line);
+        ASSERT_EQ(sbuf.get_line(0).cat, vlark::source_line::category::raw);
+    }
+}
+
+TEST_F(SourceBufferTestFixture, SourceBufferCategoryTest)
+{
+    write_source("vlark_categories.vhdl", "-- header\n\nentity e is\n/*\n text\n*/\nend e;");
+
+    vlark::sourceBuffer sbuf(path);
+    ASSERT_EQ(sbuf.line_count(), 7);
+    ASSERT_EQ(sbuf.get_line(0).cat, vlark::source_line::category::comment);
+    ASSERT_EQ(sbuf.get_line(1).cat, vlark::source_line::category::empty);
+    ASSERT_EQ(sbuf.get_line(2).cat, vlark::source_line::category::raw);
+    ASSERT_EQ(sbuf.get_line(3).cat, vlark::source_line::category::multii_com_s);
+    ASSERT_EQ(sbuf.get_line(4).cat, vlark::source_line::category::multii_com);
+    ASSERT_EQ(sbuf.get_line(5).cat, vlark::source_line::category::multi_com_e);
+    ASSERT_EQ(sbuf.get_line(6).text, "end e;");
+}
+
+TEST_F(SourceBufferTestFixture, SourceBufferPositionOfTest)
+{
+    write_source("vlark_positions.vhdl", "library ieee;\n\n  use ieee.all;\nend");
+
+    vlark::sourceBuffer sbuf(path);
+    ASSERT_EQ(sbuf.line_starts(), (std::vector<vlark::offset_t>{0, 14, 15, 31}));
+    ASSERT_EQ(sbuf.position_of(0), vlark::token_position(1, 0));
+    ASSERT_EQ(sbuf.position_of(13), vlark::token_position(1, 13));
+    ASSERT_EQ(sbuf.position_of(14), vlark::token_position(2, 0));
+    ASSERT_EQ(sbuf.position_of(17), vlark::token_position(3, 2));
+    ASSERT_EQ(sbuf.position_of(33), vlark::token_position(4, 2));
+    ASSERT_EQ(sbuf.get_line(sbuf.line_index(19)).text, "  use ieee.all;");
+}
@@ -0,0 +1,4 @@
+architecture a of e is
+begin
+  x <= 1 +;
+end architecture a;